@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Records CPU time spent in every stage of the frame loop for a fixed number of frames
+/// and writes the statistics (percentiles and histograms) to a JSON file.
+class FrameBenchmark
+{
+public:
+    enum STAGE : Uint32
+    {
+        STAGE_UPDATE = 0,
+        STAGE_RENDER,
+        STAGE_IMGUI,
+        STAGE_PRESENT,
+        STAGE_COUNT
+    };
+
+    FrameBenchmark(Uint32 NumFrames, double TimeStep);
+
+    void BeginStage(STAGE Stage);
+    void EndStage(STAGE Stage);
+
+    // Commits timings of the current frame and advances the frame counter
+    void EndFrame();
+
+    bool IsComplete() const { return m_Frames.size() >= m_NumFrames; }
+
+    Uint32 GetNumFramesRecorded() const { return static_cast<Uint32>(m_Frames.size()); }
+    Uint32 GetNumFrames() const { return m_NumFrames; }
+
+    // Simulated time of the current frame and fixed time step that
+    // replace the wall-clock values passed to the sample.
+    double GetSimulatedTime() const { return m_TimeStep * static_cast<double>(m_Frames.size()); }
+    double GetTimeStep() const { return m_TimeStep; }
+
+    bool WriteReport(const char* FilePath, const char* AppTitle) const;
+
+    static const char* GetStageName(STAGE Stage);
+
+    static constexpr Uint32 NumHistogramBins = 64;
+
+    class ScopedStage
+    {
+    public:
+        ScopedStage(FrameBenchmark* pBenchmark, STAGE Stage) :
+            m_pBenchmark{pBenchmark},
+            m_Stage{Stage}
+        {
+            if (m_pBenchmark != nullptr)
+                m_pBenchmark->BeginStage(m_Stage);
+        }
+
+        ~ScopedStage()
+        {
+            if (m_pBenchmark != nullptr)
+                m_pBenchmark->EndStage(m_Stage);
+        }
+
+        // clang-format off
+        ScopedStage           (const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+        // clang-format on
+
+    private:
+        FrameBenchmark* const m_pBenchmark;
+        const STAGE           m_Stage;
+    };
+
+private:
+    using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+    // Stage durations in milliseconds
+    using FrameTimings = std::array<double, STAGE_COUNT>;
+
+    const Uint32 m_NumFrames;
+    const double m_TimeStep;
+
+    std::array<TimePoint, STAGE_COUNT> m_StageStart = {};
+    FrameTimings                       m_CurrFrame  = {};
+    std::vector<FrameTimings>          m_Frames;
+};
+
+} // namespace Diligent
@@ -0,0 +1,320 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Records nested named CPU scopes and GPU timestamps of every command queue for a ring buffer
+/// of frames, and exports them to Chrome trace event JSON that can be opened with chrome://tracing
+/// or https://ui.perfetto.dev.
+///
+/// The profiler must be created on the thread that renders the frames, and all methods except
+/// the frame accessors must be called from that thread. Other threads record their scopes with
+/// ScopedZone (or DILIGENT_PROFILE_SCOPE) into per-thread buffers, which is lock-free.
+class FrameProfiler
+{
+public:
+    static constexpr Uint32 DefaultMaxFrames = 4096;
+
+    // Number of frames after which the timestamp queries of a frame are read
+    static constexpr Uint32 QueryLatency = 8;
+
+    // Lane of the render thread. Every other thread that records scopes and every device context
+    // that records GPU timestamps gets its own lane.
+    static constexpr Uint32 CpuLane = 0;
+
+    // Number of scopes that a thread other than the render thread can record between
+    // two EndFrame() calls. Scopes that do not fit are dropped.
+    static constexpr Uint32 ThreadBufferSize = 4096;
+
+    struct Scope
+    {
+        const char* Name  = nullptr;
+        Uint32      Depth = 0; // Nesting level within the thread that recorded the scope
+
+        // CPU time in seconds since the profiler was created
+        Uint32 ThreadLane = CpuLane;
+        double CpuBegin   = 0;
+        double CpuEnd   = 0;
+
+        // GPU timestamps in seconds. Timestamps are only available if GpuLane != CpuLane
+        // and the frame has been resolved.
+        Uint32 GpuLane  = CpuLane;
+        double GpuBegin = 0;
+        double GpuEnd   = 0;
+
+        Uint32 QueryIndex = 0;
+    };
+
+    struct Frame
+    {
+        Uint64             Index    = 0;
+        bool               Resolved = false; // GPU timestamps have been read
+        // Scopes of the render thread in the order they were opened, followed by the
+        // scopes that other threads closed since the previous frame
+        std::vector<Scope> Scopes;
+    };
+
+    // Average timings of all scopes with the same name and lanes
+    struct ScopeStats
+    {
+        const char* Name       = nullptr;
+        Uint32      Depth      = 0;
+        Uint32      ThreadLane = CpuLane;
+        Uint32      GpuLane    = CpuLane;
+
+        // Per-frame averages. Times are in seconds.
+        double Count   = 0;
+        double CpuTime = 0;
+        double GpuTime = 0;
+    };
+
+    /// If pDevice is null, only CPU scopes are recorded.
+    explicit FrameProfiler(IRenderDevice* pDevice, Uint32 MaxFrames = DefaultMaxFrames);
+
+    // clang-format off
+    FrameProfiler           (const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+    // clang-format on
+
+    ~FrameProfiler();
+
+    /// Makes the profiler the target of ScopedZone and the DILIGENT_PROFILE_* macros. Pass null to stop
+    /// profiling. The profiler must outlive all zones that are open when it is deactivated.
+    static void SetActive(FrameProfiler* pProfiler);
+
+    static FrameProfiler* GetActive() { return s_pActive.load(std::memory_order_acquire); }
+
+    void BeginFrame();
+
+    /// Closes the frame and moves the scopes recorded by other threads into it.
+    void EndFrame();
+
+    /// Reads the GPU timestamps of the frames that have not been resolved yet. All command
+    /// queues must be idle, e.g. before the trace is written at exit.
+    void ResolvePendingFrames();
+
+    bool IsInFrame() const { return m_InFrame; }
+
+    /// Opens a scope. Name must point to a string that outlives the profiler, e.g. a string literal.
+    /// If pContext is not null and its queue supports timestamp queries, the GPU time is recorded as well.
+    void BeginScope(const char* Name, IDeviceContext* pContext = nullptr);
+
+    /// Closes the innermost open scope. pContext must be the same as in the matching BeginScope().
+    void EndScope(IDeviceContext* pContext = nullptr);
+
+    /// Number of frames that have been started
+    Uint64 GetFrameCount() const { return m_FrameCount; }
+
+    /// Returns the frame with the given index, or null if the frame has been overwritten or not recorded yet.
+    const Frame* GetFrame(Uint64 Index) const;
+
+    /// Returns the most recent frame whose GPU timestamps have been read, or null.
+    const Frame* GetLastResolvedFrame() const;
+
+    /// Computes per-frame averages of the scopes over the last NumFrames resolved frames.
+    /// Scopes are listed in the order they first appear.
+    void GetScopeStats(Uint32 NumFrames, std::vector<ScopeStats>& Stats) const;
+
+    /// Number of scopes that other threads dropped because their buffer was full
+    Uint32 GetNumDroppedScopes() const { return m_NumDroppedScopes; }
+
+    Uint32      GetLaneCount() const { return static_cast<Uint32>(m_LaneNames.size()); }
+    const char* GetLaneName(Uint32 Lane) const { return m_LaneNames[Lane].c_str(); }
+
+    /// Writes all resolved frames in the ring buffer. GPU timestamps are shifted by a constant
+    /// offset so that no GPU scope starts before the CPU recorded it, which keeps the relative
+    /// timing of the queues intact.
+    bool WriteChromeTrace(const char* FilePath) const;
+
+    class ScopedRegion
+    {
+    public:
+        ScopedRegion(FrameProfiler& Profiler, const char* Name, IDeviceContext* pContext = nullptr) :
+            m_Profiler{Profiler},
+            m_pContext{pContext}
+        {
+            m_Profiler.BeginScope(Name, m_pContext);
+        }
+
+        ~ScopedRegion()
+        {
+            m_Profiler.EndScope(m_pContext);
+        }
+
+        // clang-format off
+        ScopedRegion           (const ScopedRegion&) = delete;
+        ScopedRegion& operator=(const ScopedRegion&) = delete;
+        // clang-format on
+
+    private:
+        FrameProfiler&        m_Profiler;
+        IDeviceContext* const m_pContext;
+    };
+
+private:
+    struct ThreadBuffer;
+
+public:
+    /// Records a scope in the active profiler, if there is one. On the render thread between BeginFrame()
+    /// and EndFrame(), the zone is a regular scope that is also timed on the GPU if pContext is not null.
+    /// On other threads, the zone is written to the thread's buffer and pContext is ignored.
+    class ScopedZone
+    {
+    public:
+        explicit ScopedZone(const char* Name, IDeviceContext* pContext = nullptr) :
+            m_pProfiler{GetActive()}
+        {
+            if (m_pProfiler != nullptr)
+                m_pProfiler->BeginZone(*this, Name, pContext);
+        }
+
+        ~ScopedZone()
+        {
+            if (m_pProfiler != nullptr)
+                m_pProfiler->EndZone(*this);
+        }
+
+        // clang-format off
+        ScopedZone           (const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+        // clang-format on
+
+    private:
+        friend FrameProfiler;
+
+        FrameProfiler* const m_pProfiler;
+        IDeviceContext*      m_pContext = nullptr;
+        ThreadBuffer*        m_pBuffer  = nullptr; // Null if the zone is a scope of the current frame
+        const char*          m_Name     = nullptr;
+        double               m_Begin    = 0;
+    };
+
+private:
+    // Single-producer single-consumer ring of the scopes closed by one thread. The thread
+    // writes the scopes, and the render thread reads them in EndFrame().
+    struct ThreadBuffer
+    {
+        struct Event
+        {
+            const char* Name  = nullptr;
+            Uint32      Depth = 0;
+            double      Begin = 0;
+            double      End   = 0;
+        };
+        std::array<Event, ThreadBufferSize> Events;
+
+        std::atomic<Uint32> WriteIndex{0}; // Advanced by the owning thread
+        std::atomic<Uint32> ReadIndex{0};  // Advanced by the render thread
+        std::atomic<Uint32> NumDropped{0};
+
+        std::thread::id ThreadId;
+        Uint32          Depth = 0;       // Accessed by the owning thread only
+        Uint32          Lane  = CpuLane; // Accessed by the render thread only
+    };
+
+    void          BeginZone(ScopedZone& Zone, const char* Name, IDeviceContext* pContext);
+    void          EndZone(ScopedZone& Zone);
+    ThreadBuffer* GetThreadBuffer();
+    void          ReadThreadBuffers(Frame& F);
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    double GetCpuTime() const;
+    Uint32 GetGpuLane(IDeviceContext* pContext);
+    void   ResolveFrame(Frame& F);
+
+    Frame& GetCurrentFrame() { return m_Frames[(m_FrameCount - 1) % m_Frames.size()]; }
+
+    static std::atomic<FrameProfiler*> s_pActive;
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    bool                         m_TransferQueueTimestamps = false;
+
+    const std::thread::id m_RenderThreadId;
+    const Uint64          m_UniqueId; // Identifies the profiler in the per-thread buffer cache
+
+    const Clock::time_point m_StartTime;
+
+    std::vector<Frame> m_Frames;
+    Uint64             m_FrameCount = 0;
+    bool               m_InFrame    = false;
+
+    // Indices of the open scopes in the current frame
+    std::vector<Uint32> m_OpenScopes;
+
+    // Begin and end queries of all GPU scopes of a frame, one set per frame in flight
+    std::array<std::vector<RefCntAutoPtr<IQuery>>, QueryLatency> m_Queries;
+    Uint32                                                        m_NumQueriesUsed = 0;
+
+    // Buffers of all threads that have recorded zones. The mutex only guards the list.
+    std::vector<std::unique_ptr<ThreadBuffer>> m_ThreadBuffers;
+    std::mutex                                 m_ThreadBuffersMtx;
+    Uint32                                     m_NumDroppedScopes = 0;
+    Uint32                                     m_NumThreadLanes   = 0;
+
+    std::vector<std::string> m_LaneNames;
+    std::vector<Uint32>      m_ContextLanes; // Lane of every immediate context indexed by context ID, 0 if not assigned
+};
+
+} // namespace Diligent
+
+// Profiling zones can be compiled out by defining DILIGENT_PROFILING as 0. When they are compiled in
+// and no profiler is active, a zone costs one atomic load.
+#ifndef DILIGENT_PROFILING
+#    define DILIGENT_PROFILING 1
+#endif
+
+#if DILIGENT_PROFILING
+#    define DILIGENT_PROFILE_CONCAT_IMPL(a, b) a##b
+#    define DILIGENT_PROFILE_CONCAT(a, b)      DILIGENT_PROFILE_CONCAT_IMPL(a, b)
+
+// Records a CPU zone until the end of the enclosing block
+#    define DILIGENT_PROFILE_SCOPE(Name) Diligent::FrameProfiler::ScopedZone DILIGENT_PROFILE_CONCAT(_ProfileZone, __LINE__){Name}
+
+// Records a CPU zone and, on the render thread, the GPU time of the commands recorded into pContext
+#    define DILIGENT_PROFILE_GPU_SCOPE(Name, pContext) Diligent::FrameProfiler::ScopedZone DILIGENT_PROFILE_CONCAT(_ProfileZone, __LINE__){Name, pContext}
+#else
+#    define DILIGENT_PROFILE_SCOPE(Name)
+#    define DILIGENT_PROFILE_GPU_SCOPE(Name, pContext)
+#endif
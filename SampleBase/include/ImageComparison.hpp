@@ -0,0 +1,92 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+class TaskScheduler;
+
+/// 8-bit image with 3 or 4 components per pixel that takes part in the comparison
+struct ImageView8
+{
+    const Uint8* pData         = nullptr;
+    Uint32       Stride        = 0;
+    Uint32       NumComponents = 4;
+
+    // Whether the color components are stored in BGR order
+    bool BGR = false;
+};
+
+struct ImageComparisonAttribs
+{
+    Uint32 Width  = 0;
+    Uint32 Height = 0;
+
+    ImageView8 Image0;
+    ImageView8 Image1;
+
+    /// Maximum per-channel difference for two pixels to be considered equal
+    int Tolerance = 0;
+
+    /// Whether to produce the diff heatmap
+    bool GenerateHeatmap = false;
+
+    /// Optional scheduler to spread the rows between the threads
+    TaskScheduler* pScheduler = nullptr;
+};
+
+struct ImageComparisonResult
+{
+    /// Number of pixels where at least one color channel differs by more than the tolerance
+    Uint64 NumDifferentPixels = 0;
+
+    /// Maximum absolute error of R, G and B channels. Alpha is ignored.
+    Uint8 MaxError[3] = {};
+
+    /// Root mean square error of every channel and of all channels combined
+    double RMSE[3]      = {};
+    double RMSECombined = 0;
+
+    /// Peak signal-to-noise ratio in dB. Infinity if the images are identical.
+    double PSNR = 0;
+
+    /// RGBA8 image where every pixel shows the maximum channel error on a blue-green-red scale,
+    /// normalized by the maximum error in the image. Only filled if requested and the images differ.
+    std::vector<Uint8> Heatmap;
+};
+
+/// Compares two images using SIMD instructions (SSE2 or NEON) and, if the scheduler
+/// is provided, multiple threads.
+ImageComparisonResult CompareImages(const ImageComparisonAttribs& Attribs);
+
+} // namespace Diligent
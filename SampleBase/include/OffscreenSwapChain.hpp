@@ -0,0 +1,81 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "SwapChain.h"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "RefCntAutoPtr.hpp"
+#include "ObjectBase.hpp"
+
+namespace Diligent
+{
+
+/// Swap chain implementation that renders into engine-owned color and depth textures
+/// and does not require a native window. Like native swap chains, Present() does the
+/// frame-end work for the immediate context the swap chain was created with.
+class OffscreenSwapChain final : public ObjectBase<ISwapChain>
+{
+public:
+    using TBase = ObjectBase<ISwapChain>;
+
+    OffscreenSwapChain(IReferenceCounters* pRefCounters, IRenderDevice* pDevice, IDeviceContext* pImmediateContext, const SwapChainDesc& SCDesc);
+
+    IMPLEMENT_QUERY_INTERFACE_IN_PLACE(IID_SwapChain, TBase)
+
+    static void Create(IRenderDevice* pDevice, IDeviceContext* pImmediateContext, const SwapChainDesc& SCDesc, ISwapChain** ppSwapChain);
+
+    virtual void DILIGENT_CALL_TYPE Present(Uint32 SyncInterval) override final;
+
+    virtual const SwapChainDesc& DILIGENT_CALL_TYPE GetDesc() const override final { return m_Desc; }
+
+    virtual void DILIGENT_CALL_TYPE Resize(Uint32 NewWidth, Uint32 NewHeight, SURFACE_TRANSFORM NewPreTransform) override final;
+
+    // clang-format off
+    virtual void DILIGENT_CALL_TYPE SetFullscreenMode(const DisplayModeAttribs& DisplayMode) override final {}
+    virtual void DILIGENT_CALL_TYPE SetWindowedMode()                                         override final {}
+    virtual void DILIGENT_CALL_TYPE SetMaximumFrameLatency(Uint32 MaxLatency)                 override final {}
+    // clang-format on
+
+    virtual ITextureView* DILIGENT_CALL_TYPE GetCurrentBackBufferRTV() override final { return m_pRTV; }
+    virtual ITextureView* DILIGENT_CALL_TYPE GetDepthBufferDSV() override final { return m_pDSV; }
+
+private:
+    void CreateBuffers();
+
+    RefCntAutoPtr<IRenderDevice>  m_pDevice;
+    RefCntWeakPtr<IDeviceContext> m_wpDeviceContext;
+    SwapChainDesc                 m_Desc;
+
+    RefCntAutoPtr<ITexture>     m_pColorBuffer;
+    RefCntAutoPtr<ITexture>     m_pDepthBuffer;
+    RefCntAutoPtr<ITextureView> m_pRTV;
+    RefCntAutoPtr<ITextureView> m_pDSV;
+};
+
+} // namespace Diligent
@@ -40,6 +40,10 @@
 #include "SampleBase.hpp"
 #include "ScreenCapture.hpp"
 #include "Image.h"
+#include "FrameBenchmark.hpp"
+#include "FrameProfiler.hpp"
+#include "ScreenCaptureWriter.hpp"
+#include "VideoCaptureStream.hpp"
 
 namespace Diligent
 {
@@ -77,7 +81,12 @@ public:
 
     virtual bool IsReady() const override final
     {
-        return m_pDevice && m_pSwapChain && m_NumImmediateContexts > 0;
+        return m_pDevice && m_pSwapChain && m_NumImmediateContexts > 0 && !m_bQuitRequested;
+    }
+
+    bool IsQuitRequested() const
+    {
+        return m_bQuitRequested;
     }
 
     IDeviceContext* GetImmediateContext(size_t Ind = 0)
@@ -90,6 +99,17 @@ protected:
     void InitializeDiligentEngine(const NativeWindow* pWindow);
     void InitializeSample();
     void UpdateAdaptersDialog();
+    void UpdateProfilerDialog();
+    int  RunHeadless();
+
+    // Releases the sample and all engine objects. Called by the destructor, or by platforms
+    // that exit without destroying the application.
+    void ReleaseEngine();
+
+    // Headless entry point, called by ProcessCommandLine() before the native application
+    // creates a window. The default implementation runs the headless loop and asks the
+    // native loop to quit.
+    virtual void HeadlessMain();
 
     virtual void SetFullscreenMode(const DisplayModeAttribs& DisplayMode)
     {
@@ -104,6 +124,24 @@ protected:
 
     void CompareGoldenImage(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
     void SaveScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
+    void SubmitScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
+    void ProcessCompletedScreenCaptures(bool Wait);
+    // Saves or submits all captures whose copies have completed
+    void ProcessScreenCaptures();
+    // Waits for the GPU, then saves all pending captures and waits for the writer
+    void DrainScreenCaptures();
+    void FinishScreenCaptures();
+    void FinishBenchmark();
+    void FinishProfiling();
+
+    // Stops rendering and asks the native application loop to exit. The loop then
+    // destroys the application as usual and returns GetExitCode().
+    // Platforms whose native loop can be notified override this method. The benchmark
+    // mode, which quits on its own, is rejected on the remaining platforms.
+    virtual void RequestQuit()
+    {
+        m_bQuitRequested = true;
+    }
 
     RENDER_DEVICE_TYPE                         m_DeviceType = RENDER_DEVICE_TYPE_UNDEFINED;
     RefCntAutoPtr<IEngineFactory>              m_pEngineFactory;
@@ -129,6 +167,8 @@ protected:
     bool         m_bShowAdaptersDialog  = true;
     bool         m_bShowUI              = true;
     bool         m_bForceNonSeprblProgs = false;
+    bool         m_bHeadless            = false;
+    bool         m_bQuitRequested       = false;
     double       m_CurrentTime          = 0;
     Uint32       m_MaxFrameLatency      = SwapChainDesc{}.BufferCount;
 
@@ -147,14 +187,41 @@ protected:
         IMAGE_FILE_FORMAT FileFormat      = IMAGE_FILE_FORMAT_PNG;
         int               JpegQuality     = 95;
         bool              KeepAlpha       = false;
+        Uint32            WriterThreads   = 2; // 0 - encode and write files on the render thread
+        Uint32            MaxWriterJobs   = 4;
+
+        // Write all frames into a single video stream instead of individual image files
+        bool                       Stream       = false;
+        VideoCaptureStream::FORMAT StreamFormat = VideoCaptureStream::FORMAT_Y4M;
+        std::string                StreamPath; // File or FIFO. If empty, the path is derived from Directory and FileName.
 
     } m_ScreenCaptureInfo;
-    std::unique_ptr<ScreenCapture> m_pScreenCapture;
+    std::unique_ptr<ScreenCapture>       m_pScreenCapture;
+    std::unique_ptr<VideoCaptureStream>  m_pVideoCaptureStream;
+    std::unique_ptr<ScreenCaptureWriter> m_pScreenCaptureWriter;
 
     std::unique_ptr<ImGuiImplDiligent> m_pImGui;
 
+    struct BenchmarkInfo
+    {
+        Uint32      NumFrames  = 0;
+        double      TimeStep   = 1.0 / 60.0;
+        std::string OutputPath = "benchmark.json";
+    } m_BenchmarkInfo;
+    std::unique_ptr<FrameBenchmark> m_pBenchmark;
+
+    struct ProfilingInfo
+    {
+        bool        Enabled       = false;
+        std::string OutputPath    = "profile.json";
+        double      LastStatsTime = -1e+10;
+    } m_ProfilingInfo;
+    std::unique_ptr<FrameProfiler>         m_pProfiler;
+    std::vector<FrameProfiler::ScopeStats> m_ProfilerStats; // Shown in the profiler dialog
+
     GoldenImageMode m_GoldenImgMode           = GoldenImageMode::None;
     int             m_GoldenImgPixelTolerance = 0;
+    bool            m_bGoldenImgHeatmap       = false;
     int             m_ExitCode                = 0;
 };
 
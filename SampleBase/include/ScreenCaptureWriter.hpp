@@ -0,0 +1,113 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "Texture.h"
+#include "Image.h"
+#include "VideoCaptureStream.hpp"
+
+namespace Diligent
+{
+
+/// Encodes screen captures and writes them to files or to a video stream on a pool of background threads.
+
+/// The render thread maps the staging texture and submits a job that references the mapped memory.
+/// Worker threads encode the image directly from that memory and write the file. Completed jobs are
+/// returned to the render thread that unmaps the texture and recycles it, since device contexts
+/// may only be used by one thread.
+///
+/// The number of jobs in flight is limited. When the limit is reached, the render thread must
+/// wait for the oldest job to complete, which applies back-pressure to the frame loop instead of
+/// letting the number of mapped staging textures grow without bound.
+class ScreenCaptureWriter
+{
+public:
+    struct Job
+    {
+        // Mapped staging texture. The writer keeps the reference, but never accesses the texture.
+        RefCntAutoPtr<ITexture> pTexture;
+
+        // pData points to the mapped texture memory
+        Image::EncodeInfo EncodeInfo;
+        std::string       FileName;
+
+        // If not null, the frame is appended to the stream instead of being written to FileName.
+        // Frames are written in the submission order only if the writer uses a single thread.
+        VideoCaptureStream* pStream = nullptr;
+
+        // Set by the worker thread
+        bool Succeeded = false;
+    };
+
+    ScreenCaptureWriter(Uint32 NumThreads, Uint32 MaxJobsInFlight);
+    ~ScreenCaptureWriter();
+
+    // clang-format off
+    ScreenCaptureWriter           (const ScreenCaptureWriter&) = delete;
+    ScreenCaptureWriter& operator=(const ScreenCaptureWriter&) = delete;
+    // clang-format on
+
+    /// Returns true if a new job can be submitted without exceeding the limit
+    bool CanSubmit();
+
+    /// Submits the job. The caller must make sure that CanSubmit() returns true.
+    void Submit(Job&& NewJob);
+
+    /// Returns all completed jobs. If Wait is true and no jobs have completed,
+    /// blocks until at least one job completes or there are no jobs in flight.
+    std::vector<Job> GetCompletedJobs(bool Wait);
+
+    Uint32 GetNumJobsInFlight();
+
+private:
+    void WorkerThreadProc();
+
+    const Uint32 m_MaxJobsInFlight;
+
+    std::vector<std::thread> m_WorkerThreads;
+
+    std::mutex              m_Mtx;
+    std::condition_variable m_JobQueueCondVar;
+    std::condition_variable m_JobCompleteCondVar;
+
+    // Protected by m_Mtx
+    std::deque<Job>  m_JobQueue;
+    std::vector<Job> m_CompletedJobs;
+    Uint32           m_NumJobsInFlight = 0;
+    bool             m_Stop            = false;
+};
+
+} // namespace Diligent
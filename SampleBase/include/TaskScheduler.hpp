@@ -0,0 +1,112 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Work-stealing task scheduler with a fixed pool of worker threads.
+
+/// Every thread owns a range of task indices (a deque) that it consumes from the front.
+/// When a thread runs out of tasks, it steals the back half of another thread's range.
+/// Ranges are packed into 64-bit atomics, so neither consuming nor stealing takes a lock.
+///
+/// The thread that calls ParallelFor() or RunOnEachThread() always participates in the work
+/// and has thread id 0. Worker threads have ids 1 to GetNumWorkerThreads(). The id of a thread
+/// never changes, so it can be used to index per-thread resources such as deferred contexts.
+class TaskScheduler
+{
+public:
+    using TaskFunc   = std::function<void(Uint32 ThreadId, Uint32 TaskId)>;
+    using ThreadFunc = std::function<void(Uint32 ThreadId)>;
+
+    explicit TaskScheduler(Uint32 NumWorkerThreads);
+    ~TaskScheduler();
+
+    // clang-format off
+    TaskScheduler           (const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    // clang-format on
+
+    /// Executes Task for every task id in [0, NumTasks) and waits until all tasks are complete.
+    /// OnThreadFinished, if not null, is called on every thread when there are no more tasks left for it.
+    void ParallelFor(Uint32 NumTasks, const TaskFunc& Task, const ThreadFunc& OnThreadFinished = nullptr);
+
+    /// Runs Func exactly once on every thread, including the calling thread, and waits for completion.
+    void RunOnEachThread(const ThreadFunc& Func);
+
+    Uint32 GetNumWorkerThreads() const { return static_cast<Uint32>(m_WorkerThreads.size()); }
+
+    // Total number of threads that execute tasks, including the calling thread
+    Uint32 GetNumThreads() const { return GetNumWorkerThreads() + 1; }
+
+private:
+    void WorkerThreadProc(Uint32 ThreadId);
+    void Dispatch();
+    void ExecuteJob(Uint32 ThreadId);
+    bool PopTask(Uint32 ThreadId, Uint32& TaskId);
+    bool StealTasks(Uint32 ThreadId);
+
+    struct TaskRange
+    {
+        // Begin is stored in the low 32 bits, End in the high 32 bits
+        std::atomic<Uint64> Range{0};
+
+        // Keep ranges of different threads in separate cache lines
+        Uint8 Padding[64 - sizeof(std::atomic<Uint64>)];
+    };
+
+    std::vector<std::thread>     m_WorkerThreads;
+    std::unique_ptr<TaskRange[]> m_Ranges;
+
+    std::mutex              m_Mtx;
+    std::condition_variable m_WakeUpCondVar;
+    std::condition_variable m_JobDoneCondVar;
+
+    // Protected by m_Mtx
+    Uint64 m_JobId             = 0;
+    Uint32 m_NumThreadsRunning = 0;
+    bool   m_Stop              = false;
+
+    // Current job. Only modified by the dispatching thread while no worker is running.
+    const TaskFunc*   m_pTask             = nullptr;
+    const ThreadFunc* m_pOnThreadFinished = nullptr;
+    const ThreadFunc* m_pEachThreadFunc   = nullptr;
+};
+
+} // namespace Diligent
@@ -0,0 +1,90 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "FileWrapper.hpp"
+#include "Image.h"
+
+namespace Diligent
+{
+
+/// Writes captured frames into a single file or FIFO as an uncompressed video stream
+/// that can be consumed directly by an external encoder (e.g. ffmpeg).
+class VideoCaptureStream
+{
+public:
+    enum FORMAT : Uint32
+    {
+        // YUV4MPEG2 stream with 4:2:0 chroma subsampling (BT.601, limited range)
+        FORMAT_Y4M = 0,
+
+        // Headerless stream of RGBA8 frames
+        FORMAT_RAW_RGBA
+    };
+
+    VideoCaptureStream(const char* Path, FORMAT Format, double FPS);
+
+    // clang-format off
+    VideoCaptureStream           (const VideoCaptureStream&) = delete;
+    VideoCaptureStream& operator=(const VideoCaptureStream&) = delete;
+    // clang-format on
+
+    bool IsOpen() const { return static_cast<bool>(m_File); }
+
+    /// Appends the frame to the stream. All frames must have the same size.
+    /// The method is not thread-safe: frames must be written by one thread at a time and in order.
+    bool WriteFrame(const Image::EncodeInfo& Frame);
+
+    Uint32 GetNumFramesWritten() const { return m_NumFramesWritten; }
+
+    /// Returns the file extension (without the dot) for the format
+    static const char* GetFileExtension(FORMAT Format);
+
+private:
+    bool WriteY4MFrame(const Uint8* pRGBA, Uint32 Stride, bool BGR);
+    bool WriteRawFrame(const Uint8* pRGBA, Uint32 Stride, bool BGR);
+
+    const std::string m_Path;
+    const FORMAT      m_Format;
+    const double      m_FPS;
+
+    FileWrapper m_File;
+
+    Uint32 m_Width            = 0;
+    Uint32 m_Height           = 0;
+    Uint32 m_NumFramesWritten = 0;
+
+    // Reused between frames to avoid allocations
+    std::vector<Uint8> m_ConvertedPixels;
+    std::vector<Uint8> m_FrameData;
+};
+
+} // namespace Diligent
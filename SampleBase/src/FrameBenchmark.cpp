@@ -0,0 +1,255 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameBenchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "Errors.hpp"
+#include "FileWrapper.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct StageStatistics
+{
+    double Min  = 0;
+    double Max  = 0;
+    double Mean = 0;
+    double P50  = 0;
+    double P95  = 0;
+    double P99  = 0;
+
+    double BinWidth = 0;
+
+    std::array<Uint32, FrameBenchmark::NumHistogramBins> Histogram = {};
+};
+
+// Nearest-rank percentile of the sorted sample array
+double GetPercentile(const std::vector<double>& Sorted, double Percentile)
+{
+    VERIFY_EXPR(!Sorted.empty());
+    auto Rank = static_cast<size_t>(std::ceil(Percentile / 100.0 * static_cast<double>(Sorted.size())));
+    Rank      = std::max(Rank, size_t{1});
+    return Sorted[std::min(Rank, Sorted.size()) - 1];
+}
+
+StageStatistics ComputeStatistics(std::vector<double> Samples)
+{
+    StageStatistics Stats;
+    if (Samples.empty())
+        return Stats;
+
+    std::sort(Samples.begin(), Samples.end());
+
+    Stats.Min = Samples.front();
+    Stats.Max = Samples.back();
+    for (auto s : Samples)
+        Stats.Mean += s;
+    Stats.Mean /= static_cast<double>(Samples.size());
+
+    Stats.P50 = GetPercentile(Samples, 50);
+    Stats.P95 = GetPercentile(Samples, 95);
+    Stats.P99 = GetPercentile(Samples, 99);
+
+    Stats.BinWidth = (Stats.Max - Stats.Min) / FrameBenchmark::NumHistogramBins;
+    for (auto s : Samples)
+    {
+        Uint32 Bin = Stats.BinWidth > 0 ?
+            static_cast<Uint32>((s - Stats.Min) / Stats.BinWidth) :
+            0;
+        // The maximum value falls exactly on the right edge of the last bin
+        Bin = std::min(Bin, FrameBenchmark::NumHistogramBins - 1);
+        ++Stats.Histogram[Bin];
+    }
+
+    return Stats;
+}
+
+void WriteJsonString(std::stringstream& ss, const char* Str)
+{
+    ss << '"';
+    for (const char* c = Str; *c != 0; ++c)
+    {
+        switch (*c)
+        {
+            case '"': ss << "\\\""; break;
+            case '\\': ss << "\\\\"; break;
+            case '\n': ss << "\\n"; break;
+            case '\r': ss << "\\r"; break;
+            case '\t': ss << "\\t"; break;
+            default: ss << *c;
+        }
+    }
+    ss << '"';
+}
+
+void WriteStatistics(std::stringstream& ss, const StageStatistics& Stats)
+{
+    // clang-format off
+    ss << "{\n"
+       << "      \"min_ms\": "  << Stats.Min  << ",\n"
+       << "      \"max_ms\": "  << Stats.Max  << ",\n"
+       << "      \"mean_ms\": " << Stats.Mean << ",\n"
+       << "      \"p50_ms\": "  << Stats.P50  << ",\n"
+       << "      \"p95_ms\": "  << Stats.P95  << ",\n"
+       << "      \"p99_ms\": "  << Stats.P99  << ",\n"
+       << "      \"histogram\": {\n"
+       << "        \"min_ms\": "       << Stats.Min      << ",\n"
+       << "        \"bin_width_ms\": " << Stats.BinWidth << ",\n"
+       << "        \"counts\": [";
+    // clang-format on
+    for (Uint32 bin = 0; bin < FrameBenchmark::NumHistogramBins; ++bin)
+    {
+        if (bin > 0)
+            ss << ", ";
+        ss << Stats.Histogram[bin];
+    }
+    ss << "]\n"
+       << "      }\n"
+       << "    }";
+}
+
+} // namespace
+
+FrameBenchmark::FrameBenchmark(Uint32 NumFrames, double TimeStep) :
+    m_NumFrames{NumFrames},
+    m_TimeStep{TimeStep}
+{
+    m_Frames.reserve(m_NumFrames);
+}
+
+const char* FrameBenchmark::GetStageName(STAGE Stage)
+{
+    switch (Stage)
+    {
+        // clang-format off
+        case STAGE_UPDATE:  return "update";
+        case STAGE_RENDER:  return "render";
+        case STAGE_IMGUI:   return "imgui";
+        case STAGE_PRESENT: return "present";
+        // clang-format on
+        default:
+            UNEXPECTED("Unexpected stage");
+            return "unknown";
+    }
+}
+
+void FrameBenchmark::BeginStage(STAGE Stage)
+{
+    VERIFY_EXPR(Stage < STAGE_COUNT);
+    m_StageStart[Stage] = TimePoint::clock::now();
+}
+
+void FrameBenchmark::EndStage(STAGE Stage)
+{
+    VERIFY_EXPR(Stage < STAGE_COUNT);
+    const auto EndTime = TimePoint::clock::now();
+    // A stage may be entered several times during the frame
+    m_CurrFrame[Stage] += std::chrono::duration<double, std::milli>{EndTime - m_StageStart[Stage]}.count();
+}
+
+void FrameBenchmark::EndFrame()
+{
+    if (IsComplete())
+        return;
+
+    m_Frames.push_back(m_CurrFrame);
+    m_CurrFrame = {};
+}
+
+bool FrameBenchmark::WriteReport(const char* FilePath, const char* AppTitle) const
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(4);
+
+    ss << "{\n"
+       << "  \"app\": ";
+    WriteJsonString(ss, AppTitle);
+    ss << ",\n"
+       << "  \"num_frames\": " << m_Frames.size() << ",\n"
+       << "  \"time_step\": " << m_TimeStep << ",\n"
+       << "  \"stages\": {\n";
+
+    std::vector<double> Samples(m_Frames.size());
+    std::vector<double> FrameTotal(m_Frames.size());
+    for (Uint32 stage = 0; stage < STAGE_COUNT; ++stage)
+    {
+        for (size_t frame = 0; frame < m_Frames.size(); ++frame)
+        {
+            Samples[frame] = m_Frames[frame][stage];
+            FrameTotal[frame] += Samples[frame];
+        }
+        ss << "    \"" << GetStageName(static_cast<STAGE>(stage)) << "\": ";
+        WriteStatistics(ss, ComputeStatistics(Samples));
+        ss << ",\n";
+    }
+    ss << "    \"frame\": ";
+    WriteStatistics(ss, ComputeStatistics(FrameTotal));
+    ss << "\n"
+       << "  },\n";
+
+    // Raw per-frame timings in the stage order
+    ss << "  \"frames\": [\n";
+    for (size_t frame = 0; frame < m_Frames.size(); ++frame)
+    {
+        ss << "    [";
+        for (Uint32 stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            if (stage > 0)
+                ss << ", ";
+            ss << m_Frames[frame][stage];
+        }
+        ss << (frame + 1 < m_Frames.size() ? "],\n" : "]\n");
+    }
+    ss << "  ]\n"
+       << "}\n";
+
+    FileWrapper pFile{FilePath, EFileAccessMode::Overwrite};
+    if (!pFile)
+    {
+        LOG_ERROR_MESSAGE("Failed to create benchmark report file '", FilePath, "'.");
+        return false;
+    }
+
+    const auto Report = ss.str();
+    if (!pFile->Write(Report.data(), Report.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write benchmark report file '", FilePath, "'.");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace Diligent
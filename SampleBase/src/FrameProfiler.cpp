@@ -0,0 +1,509 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+#include "FileWrapper.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+void WriteJsonString(std::stringstream& ss, const char* Str)
+{
+    ss << '"';
+    for (const char* c = Str; *c != 0; ++c)
+    {
+        switch (*c)
+        {
+            case '"': ss << "\\\""; break;
+            case '\\': ss << "\\\\"; break;
+            case '\n': ss << "\\n"; break;
+            case '\r': ss << "\\r"; break;
+            case '\t': ss << "\\t"; break;
+            default: ss << *c;
+        }
+    }
+    ss << '"';
+}
+
+// Writes a complete event. Times are in seconds, the trace uses microseconds.
+void WriteTraceEvent(std::stringstream& ss, const char* Name, const char* Category, Uint32 Lane, double Begin, double End, Uint64 FrameIndex)
+{
+    ss << ",\n    {\"name\": ";
+    WriteJsonString(ss, Name);
+    ss << ", \"cat\": \"" << Category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << Lane
+       << ", \"ts\": " << Begin * 1e+6 << ", \"dur\": " << std::max(End - Begin, 0.0) * 1e+6
+       << ", \"args\": {\"frame\": " << FrameIndex << "}}";
+}
+
+std::atomic<Uint64> NextProfilerId{1};
+
+} // namespace
+
+constexpr Uint32 FrameProfiler::DefaultMaxFrames;
+constexpr Uint32 FrameProfiler::QueryLatency;
+constexpr Uint32 FrameProfiler::CpuLane;
+constexpr Uint32 FrameProfiler::ThreadBufferSize;
+
+std::atomic<FrameProfiler*> FrameProfiler::s_pActive{nullptr};
+
+FrameProfiler::FrameProfiler(IRenderDevice* pDevice, Uint32 MaxFrames) :
+    m_pDevice{pDevice},
+    m_RenderThreadId{std::this_thread::get_id()},
+    m_UniqueId{NextProfilerId.fetch_add(1)},
+    m_StartTime{Clock::now()},
+    // Frames must stay in the ring buffer until their queries are read
+    m_Frames(std::max(MaxFrames, QueryLatency + 1))
+{
+    if (m_pDevice)
+        m_TransferQueueTimestamps = m_pDevice->GetDeviceInfo().Features.TransferQueueTimestampQueries;
+
+    m_LaneNames.emplace_back("CPU");
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    VERIFY(GetActive() != this, "The profiler is destroyed while it is active");
+}
+
+void FrameProfiler::SetActive(FrameProfiler* pProfiler)
+{
+    s_pActive.store(pProfiler, std::memory_order_release);
+}
+
+double FrameProfiler::GetCpuTime() const
+{
+    return std::chrono::duration<double>{Clock::now() - m_StartTime}.count();
+}
+
+void FrameProfiler::BeginFrame()
+{
+    VERIFY(!m_InFrame, "EndFrame() was not called for the previous frame");
+    VERIFY(m_OpenScopes.empty(), "Not all scopes of the previous frame have been closed");
+
+    // The query set is about to be reused, so read the timestamps of the frame that used it last.
+    if (m_FrameCount >= QueryLatency)
+    {
+        auto& OldFrame = m_Frames[(m_FrameCount - QueryLatency) % m_Frames.size()];
+        if (!OldFrame.Resolved)
+            ResolveFrame(OldFrame);
+    }
+
+    ++m_FrameCount;
+    m_InFrame        = true;
+    m_NumQueriesUsed = 0;
+
+    auto& F    = GetCurrentFrame();
+    F.Index    = m_FrameCount - 1;
+    F.Resolved = false;
+    F.Scopes.clear();
+}
+
+void FrameProfiler::EndFrame()
+{
+    VERIFY(m_InFrame, "BeginFrame() was not called");
+    VERIFY(m_OpenScopes.empty(), "Not all scopes have been closed");
+    ReadThreadBuffers(GetCurrentFrame());
+    m_InFrame = false;
+}
+
+void FrameProfiler::ResolvePendingFrames()
+{
+    VERIFY(!m_InFrame, "Frames can't be resolved while a frame is being recorded");
+
+    const auto FirstFrame = m_FrameCount > QueryLatency ? m_FrameCount - QueryLatency : 0;
+    for (auto FrameInd = FirstFrame; FrameInd < m_FrameCount; ++FrameInd)
+    {
+        auto& F = m_Frames[FrameInd % m_Frames.size()];
+        if (!F.Resolved)
+            ResolveFrame(F);
+    }
+}
+
+FrameProfiler::ThreadBuffer* FrameProfiler::GetThreadBuffer()
+{
+    // Every thread remembers its buffer in the last profiler it has used
+    struct CachedBuffer
+    {
+        Uint64        ProfilerId = 0;
+        ThreadBuffer* pBuffer    = nullptr;
+    };
+    static thread_local CachedBuffer Cache;
+    if (Cache.ProfilerId == m_UniqueId)
+        return Cache.pBuffer;
+
+    const auto ThreadId = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> Lock{m_ThreadBuffersMtx};
+
+    auto it = std::find_if(m_ThreadBuffers.begin(), m_ThreadBuffers.end(),
+                           [ThreadId](const std::unique_ptr<ThreadBuffer>& pBuffer) { return pBuffer->ThreadId == ThreadId; });
+    if (it == m_ThreadBuffers.end())
+    {
+        std::unique_ptr<ThreadBuffer> pBuffer{new ThreadBuffer};
+        pBuffer->ThreadId = ThreadId;
+        it                = m_ThreadBuffers.insert(m_ThreadBuffers.end(), std::move(pBuffer));
+    }
+
+    Cache = {m_UniqueId, it->get()};
+    return Cache.pBuffer;
+}
+
+void FrameProfiler::BeginZone(ScopedZone& Zone, const char* Name, IDeviceContext* pContext)
+{
+    // m_InFrame must only be read by the render thread
+    if (std::this_thread::get_id() == m_RenderThreadId && m_InFrame)
+    {
+        Zone.m_pContext = pContext;
+        BeginScope(Name, pContext);
+        return;
+    }
+
+    Zone.m_pBuffer = GetThreadBuffer();
+    Zone.m_Name    = Name;
+    ++Zone.m_pBuffer->Depth;
+    Zone.m_Begin = GetCpuTime();
+}
+
+void FrameProfiler::EndZone(ScopedZone& Zone)
+{
+    if (Zone.m_pBuffer == nullptr)
+    {
+        EndScope(Zone.m_pContext);
+        return;
+    }
+
+    const auto End = GetCpuTime();
+
+    auto& Buffer = *Zone.m_pBuffer;
+    VERIFY_EXPR(Buffer.Depth > 0);
+    --Buffer.Depth;
+
+    const auto WriteIdx = Buffer.WriteIndex.load(std::memory_order_relaxed);
+    if (WriteIdx - Buffer.ReadIndex.load(std::memory_order_acquire) >= ThreadBufferSize)
+    {
+        Buffer.NumDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& Event = Buffer.Events[WriteIdx % ThreadBufferSize];
+    Event.Name  = Zone.m_Name;
+    Event.Depth = Buffer.Depth;
+    Event.Begin = Zone.m_Begin;
+    Event.End   = End;
+    // Publish the event to the render thread
+    Buffer.WriteIndex.store(WriteIdx + 1, std::memory_order_release);
+}
+
+void FrameProfiler::ReadThreadBuffers(Frame& F)
+{
+    std::lock_guard<std::mutex> Lock{m_ThreadBuffersMtx};
+    for (auto& pBuffer : m_ThreadBuffers)
+    {
+        auto&      Buffer   = *pBuffer;
+        const auto WriteIdx = Buffer.WriteIndex.load(std::memory_order_acquire);
+        auto       ReadIdx  = Buffer.ReadIndex.load(std::memory_order_relaxed);
+
+        m_NumDroppedScopes += Buffer.NumDropped.exchange(0, std::memory_order_relaxed);
+        if (ReadIdx == WriteIdx)
+            continue;
+
+        // Zones of the render thread outside of frames go to the render thread lane
+        if (Buffer.Lane == CpuLane && Buffer.ThreadId != m_RenderThreadId)
+        {
+            Buffer.Lane = static_cast<Uint32>(m_LaneNames.size());
+            m_LaneNames.emplace_back("CPU: thread " + std::to_string(m_NumThreadLanes++));
+        }
+
+        const auto FirstScope = F.Scopes.size();
+        for (; ReadIdx != WriteIdx; ++ReadIdx)
+        {
+            const auto& Event = Buffer.Events[ReadIdx % ThreadBufferSize];
+
+            Scope S;
+            S.Name       = Event.Name;
+            S.Depth      = Event.Depth;
+            S.ThreadLane = Buffer.Lane;
+            S.CpuBegin   = Event.Begin;
+            S.CpuEnd     = Event.End;
+            F.Scopes.push_back(S);
+        }
+        // Let the thread reuse the slots
+        Buffer.ReadIndex.store(WriteIdx, std::memory_order_release);
+
+        // Scopes are written when they are closed, so inner scopes precede outer ones
+        std::sort(F.Scopes.begin() + FirstScope, F.Scopes.end(), [](const Scope& S0, const Scope& S1) { return S0.CpuBegin < S1.CpuBegin; });
+    }
+}
+
+Uint32 FrameProfiler::GetGpuLane(IDeviceContext* pContext)
+{
+    const auto& Desc = pContext->GetDesc();
+    if (m_pDevice == nullptr || Desc.IsDeferred)
+        return CpuLane;
+
+    // Timestamps in the transfer queue are an optional feature
+    if ((Desc.QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK) <= COMMAND_QUEUE_TYPE_TRANSFER && !m_TransferQueueTimestamps)
+        return CpuLane;
+
+    if (Desc.ContextId >= m_ContextLanes.size())
+        m_ContextLanes.resize(Desc.ContextId + size_t{1}, CpuLane);
+
+    auto& Lane = m_ContextLanes[Desc.ContextId];
+    if (Lane == CpuLane)
+    {
+        Lane = static_cast<Uint32>(m_LaneNames.size());
+        m_LaneNames.emplace_back(Desc.Name != nullptr ? std::string{"GPU: "} + Desc.Name : "GPU: context " + std::to_string(Desc.ContextId));
+    }
+    return Lane;
+}
+
+void FrameProfiler::BeginScope(const char* Name, IDeviceContext* pContext)
+{
+    VERIFY(m_InFrame, "Scopes must be recorded between BeginFrame() and EndFrame()");
+    VERIFY_EXPR(Name != nullptr);
+
+    auto& F = GetCurrentFrame();
+
+    Scope S;
+    S.Name  = Name;
+    S.Depth = static_cast<Uint32>(m_OpenScopes.size());
+
+    if (pContext != nullptr)
+        S.GpuLane = GetGpuLane(pContext);
+
+    if (S.GpuLane != CpuLane)
+    {
+        auto& Queries = m_Queries[F.Index % QueryLatency];
+        S.QueryIndex  = m_NumQueriesUsed;
+        m_NumQueriesUsed += 2;
+        while (Queries.size() < m_NumQueriesUsed)
+        {
+            QueryDesc Desc;
+            Desc.Name = "Frame profiler timestamp query";
+            Desc.Type = QUERY_TYPE_TIMESTAMP;
+
+            RefCntAutoPtr<IQuery> pQuery;
+            m_pDevice->CreateQuery(Desc, &pQuery);
+            Queries.emplace_back(std::move(pQuery));
+        }
+        pContext->EndQuery(Queries[S.QueryIndex]);
+    }
+
+    m_OpenScopes.push_back(static_cast<Uint32>(F.Scopes.size()));
+    // Read the time last so that the scope does not include the profiler overhead
+    S.CpuBegin = GetCpuTime();
+    F.Scopes.push_back(S);
+}
+
+void FrameProfiler::EndScope(IDeviceContext* pContext)
+{
+    const auto CpuEnd = GetCpuTime();
+
+    VERIFY(!m_OpenScopes.empty(), "There is no open scope");
+    auto& F = GetCurrentFrame();
+    auto& S = F.Scopes[m_OpenScopes.back()];
+    m_OpenScopes.pop_back();
+
+    S.CpuEnd = CpuEnd;
+    if (S.GpuLane != CpuLane)
+    {
+        VERIFY(pContext != nullptr && m_ContextLanes[pContext->GetDesc().ContextId] == S.GpuLane,
+               "The scope must be closed in the same context it was opened in");
+        pContext->EndQuery(m_Queries[F.Index % QueryLatency][S.QueryIndex + 1]);
+    }
+}
+
+void FrameProfiler::ResolveFrame(Frame& F)
+{
+    auto& Queries = m_Queries[F.Index % QueryLatency];
+
+    const auto ReadTime = [](IQuery* pQuery, double& Time) {
+        QueryDataTimestamp TimeData;
+        if (!pQuery->GetData(&TimeData, sizeof(TimeData), true) || TimeData.Frequency == 0)
+            return false;
+        Time = static_cast<double>(TimeData.Counter) / static_cast<double>(TimeData.Frequency);
+        return true;
+    };
+
+    for (auto& S : F.Scopes)
+    {
+        if (S.GpuLane == CpuLane)
+            continue;
+
+        // The timestamps of a scope whose queries are not available are discarded
+        if (!ReadTime(Queries[S.QueryIndex], S.GpuBegin) || !ReadTime(Queries[S.QueryIndex + 1], S.GpuEnd))
+            S.GpuLane = CpuLane;
+    }
+    F.Resolved = true;
+}
+
+const FrameProfiler::Frame* FrameProfiler::GetFrame(Uint64 Index) const
+{
+    if (Index >= m_FrameCount)
+        return nullptr;
+
+    const auto& F = m_Frames[Index % m_Frames.size()];
+    return F.Index == Index ? &F : nullptr;
+}
+
+const FrameProfiler::Frame* FrameProfiler::GetLastResolvedFrame() const
+{
+    if (m_FrameCount <= QueryLatency)
+        return nullptr;
+
+    return GetFrame(m_FrameCount - QueryLatency - 1);
+}
+
+void FrameProfiler::GetScopeStats(Uint32 NumFrames, std::vector<ScopeStats>& Stats) const
+{
+    Stats.clear();
+
+    const auto* pLastFrame = GetLastResolvedFrame();
+    if (pLastFrame == nullptr)
+        return;
+
+    Uint32 NumFramesFound = 0;
+    for (Uint32 i = 0; i < NumFrames && i <= pLastFrame->Index; ++i)
+    {
+        const auto* pFrame = GetFrame(pLastFrame->Index - i);
+        if (pFrame == nullptr || !pFrame->Resolved)
+            break;
+        ++NumFramesFound;
+
+        for (const auto& S : pFrame->Scopes)
+        {
+            auto it = std::find_if(Stats.begin(), Stats.end(), [&S](const ScopeStats& St) {
+                return St.ThreadLane == S.ThreadLane && St.GpuLane == S.GpuLane && St.Depth == S.Depth && strcmp(St.Name, S.Name) == 0;
+            });
+            if (it == Stats.end())
+            {
+                ScopeStats St;
+                St.Name       = S.Name;
+                St.Depth      = S.Depth;
+                St.ThreadLane = S.ThreadLane;
+                St.GpuLane    = S.GpuLane;
+                it            = Stats.insert(Stats.end(), St);
+            }
+            it->Count += 1;
+            it->CpuTime += S.CpuEnd - S.CpuBegin;
+            if (S.GpuLane != CpuLane)
+                it->GpuTime += S.GpuEnd - S.GpuBegin;
+        }
+    }
+
+    // Group the scopes by thread. Within a thread, they stay in the order they first appear.
+    std::stable_sort(Stats.begin(), Stats.end(), [](const ScopeStats& St0, const ScopeStats& St1) { return St0.ThreadLane < St1.ThreadLane; });
+
+    for (auto& St : Stats)
+    {
+        St.Count /= NumFramesFound;
+        St.CpuTime /= NumFramesFound;
+        St.GpuTime /= NumFramesFound;
+    }
+}
+
+bool FrameProfiler::WriteChromeTrace(const char* FilePath) const
+{
+    const Uint64 NumFrames  = std::min(m_FrameCount, Uint64{m_Frames.size()});
+    const Uint64 FirstFrame = m_FrameCount - NumFrames;
+
+    // A GPU scope cannot start before it was recorded on the CPU, so use the smallest offset
+    // that satisfies this for all scopes.
+    double GpuTimeOffset = -std::numeric_limits<double>::max();
+    for (auto FrameInd = FirstFrame; FrameInd < m_FrameCount; ++FrameInd)
+    {
+        const auto& F = m_Frames[FrameInd % m_Frames.size()];
+        if (!F.Resolved)
+            continue;
+        for (const auto& S : F.Scopes)
+        {
+            if (S.GpuLane != CpuLane)
+                GpuTimeOffset = std::max(GpuTimeOffset, S.CpuBegin - S.GpuBegin);
+        }
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\n"
+       << "  \"displayTimeUnit\": \"ms\",\n"
+       << "  \"traceEvents\": [\n"
+       << "    {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Frame profiler\"}}";
+
+    for (Uint32 Lane = 0; Lane < m_LaneNames.size(); ++Lane)
+    {
+        ss << ",\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << Lane << ", \"args\": {\"name\": ";
+        WriteJsonString(ss, m_LaneNames[Lane].c_str());
+        ss << "}}";
+        ss << ",\n    {\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << Lane << ", \"args\": {\"sort_index\": " << Lane << "}}";
+    }
+
+    for (auto FrameInd = FirstFrame; FrameInd < m_FrameCount; ++FrameInd)
+    {
+        const auto& F = m_Frames[FrameInd % m_Frames.size()];
+        if (!F.Resolved)
+            continue;
+
+        for (const auto& S : F.Scopes)
+        {
+            WriteTraceEvent(ss, S.Name, "cpu", S.ThreadLane, S.CpuBegin, S.CpuEnd, F.Index);
+            if (S.GpuLane != CpuLane)
+                WriteTraceEvent(ss, S.Name, "gpu", S.GpuLane, S.GpuBegin + GpuTimeOffset, S.GpuEnd + GpuTimeOffset, F.Index);
+        }
+    }
+    ss << "\n  ]\n"
+       << "}\n";
+
+    FileWrapper pFile{FilePath, EFileAccessMode::Overwrite};
+    if (!pFile)
+    {
+        LOG_ERROR_MESSAGE("Failed to create trace file '", FilePath, "'.");
+        return false;
+    }
+
+    const auto Trace = ss.str();
+    if (!pFile->Write(Trace.data(), Trace.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write trace file '", FilePath, "'.");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,339 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ImageComparison.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "DebugUtilities.hpp"
+#include "TaskScheduler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define IMAGE_COMPARISON_SSE2 1
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define IMAGE_COMPARISON_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Number of rows processed by a single task
+constexpr Uint32 RowsPerTask = 32;
+
+struct RowStatistics
+{
+    Uint64 NumDifferentPixels = 0;
+    Uint64 SqErrorSum[4]      = {};
+    Uint8  MaxError[4]        = {};
+};
+
+// Returns a pointer to the row of the image in 4-component layout with the color channels
+// in the order of the reference image. Rows that need conversion are expanded into Scratch.
+const Uint8* GetRGBARow(const ImageView8& Img, Uint32 Row, Uint32 Width, bool SwapRB, std::vector<Uint8>& Scratch)
+{
+    const auto* pSrc = Img.pData + size_t{Row} * Img.Stride;
+    if (Img.NumComponents == 4 && !SwapRB)
+        return pSrc;
+
+    Scratch.resize(size_t{Width} * 4);
+    const auto R = SwapRB ? 2 : 0;
+    const auto B = SwapRB ? 0 : 2;
+    for (Uint32 x = 0; x < Width; ++x)
+    {
+        const auto* pSrcPx = pSrc + size_t{x} * Img.NumComponents;
+        auto*       pDstPx = &Scratch[size_t{x} * 4];
+        pDstPx[0]          = pSrcPx[R];
+        pDstPx[1]          = pSrcPx[1];
+        pDstPx[2]          = pSrcPx[B];
+        pDstPx[3]          = 0;
+    }
+    return Scratch.data();
+}
+
+// Compares the pixels [Start, Width) of two RGBA rows. Alpha is ignored.
+void CompareRowScalar(const Uint8* pRow0, const Uint8* pRow1, Uint32 Start, Uint32 Width, int Tolerance, RowStatistics& Stats)
+{
+    for (Uint32 x = Start; x < Width; ++x)
+    {
+        bool IsDifferent = false;
+        for (Uint32 c = 0; c < 3; ++c)
+        {
+            const auto Diff = static_cast<Uint8>(std::abs(int{pRow0[x * 4 + c]} - int{pRow1[x * 4 + c]}));
+            Stats.MaxError[c] = std::max(Stats.MaxError[c], Diff);
+            Stats.SqErrorSum[c] += Uint32{Diff} * Uint32{Diff};
+            IsDifferent = IsDifferent || Diff > Tolerance;
+        }
+        if (IsDifferent)
+            ++Stats.NumDifferentPixels;
+    }
+}
+
+#if IMAGE_COMPARISON_SSE2
+
+void CompareRow(const Uint8* pRow0, const Uint8* pRow1, Uint32 Width, int Tolerance, RowStatistics& Stats)
+{
+    // Squares of byte differences fit into 16 bits, and the sum of the squares of one row
+    // (up to 64K pixels) fits into 32 bits.
+    VERIFY_EXPR(Width <= 65536);
+
+    const auto Zero      = _mm_setzero_si128();
+    const auto ColorMask = _mm_set1_epi32(0x00FFFFFF);
+    const auto TolV      = _mm_set1_epi8(static_cast<char>(std::min(std::max(Tolerance, 0), 255)));
+
+    auto MaxErr = _mm_setzero_si128();
+    auto SqSum  = _mm_setzero_si128();
+
+    Uint32 x = 0;
+    for (; x + 4 <= Width; x += 4)
+    {
+        const auto Px0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 4));
+        const auto Px1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 4));
+
+        // |a - b| for unsigned bytes
+        auto Diff = _mm_or_si128(_mm_subs_epu8(Px0, Px1), _mm_subs_epu8(Px1, Px0));
+        Diff      = _mm_and_si128(Diff, ColorMask);
+
+        MaxErr = _mm_max_epu8(MaxErr, Diff);
+
+        // A pixel is different if any of its channels exceeds the tolerance
+        const auto Exceed   = _mm_subs_epu8(Diff, TolV);
+        const auto SameMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(Exceed, Zero)));
+        Stats.NumDifferentPixels += 4 - ((SameMask & 1) + ((SameMask >> 1) & 1) + ((SameMask >> 2) & 1) + ((SameMask >> 3) & 1));
+
+        const auto DiffLo = _mm_unpacklo_epi8(Diff, Zero);
+        const auto DiffHi = _mm_unpackhi_epi8(Diff, Zero);
+        const auto SqLo   = _mm_mullo_epi16(DiffLo, DiffLo);
+        const auto SqHi   = _mm_mullo_epi16(DiffHi, DiffHi);
+        // Every 32-bit lane accumulates one channel
+        SqSum = _mm_add_epi32(SqSum, _mm_unpacklo_epi16(SqLo, Zero));
+        SqSum = _mm_add_epi32(SqSum, _mm_unpackhi_epi16(SqLo, Zero));
+        SqSum = _mm_add_epi32(SqSum, _mm_unpacklo_epi16(SqHi, Zero));
+        SqSum = _mm_add_epi32(SqSum, _mm_unpackhi_epi16(SqHi, Zero));
+    }
+
+    alignas(16) Uint8  MaxErrBytes[16];
+    alignas(16) Uint32 SqSumLanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(MaxErrBytes), MaxErr);
+    _mm_store_si128(reinterpret_cast<__m128i*>(SqSumLanes), SqSum);
+    for (Uint32 i = 0; i < 16; ++i)
+        Stats.MaxError[i % 4] = std::max(Stats.MaxError[i % 4], MaxErrBytes[i]);
+    for (Uint32 c = 0; c < 4; ++c)
+        Stats.SqErrorSum[c] += SqSumLanes[c];
+
+    CompareRowScalar(pRow0, pRow1, x, Width, Tolerance, Stats);
+}
+
+#elif IMAGE_COMPARISON_NEON
+
+void CompareRow(const Uint8* pRow0, const Uint8* pRow1, Uint32 Width, int Tolerance, RowStatistics& Stats)
+{
+    VERIFY_EXPR(Width <= 65536);
+
+    const auto ColorMask = vreinterpretq_u8_u32(vdupq_n_u32(0x00FFFFFFu));
+    const auto TolV      = vdupq_n_u8(static_cast<Uint8>(std::min(std::max(Tolerance, 0), 255)));
+
+    auto MaxErr = vdupq_n_u8(0);
+    auto SqSum  = vdupq_n_u32(0);
+
+    Uint32 x = 0;
+    for (; x + 4 <= Width; x += 4)
+    {
+        const auto Px0  = vld1q_u8(pRow0 + x * 4);
+        const auto Px1  = vld1q_u8(pRow1 + x * 4);
+        const auto Diff = vandq_u8(vabdq_u8(Px0, Px1), ColorMask);
+
+        MaxErr = vmaxq_u8(MaxErr, Diff);
+
+        // 0xFFFFFFFF for every pixel that has a channel exceeding the tolerance
+        const auto Exceed = vtstq_u32(vreinterpretq_u32_u8(vqsubq_u8(Diff, TolV)), vdupq_n_u32(0xFFFFFFFFu));
+        Stats.NumDifferentPixels += vaddvq_u32(vshrq_n_u32(Exceed, 31));
+
+        const auto SqLo = vmull_u8(vget_low_u8(Diff), vget_low_u8(Diff));
+        const auto SqHi = vmull_u8(vget_high_u8(Diff), vget_high_u8(Diff));
+        // Every 32-bit lane accumulates one channel
+        SqSum = vaddw_u16(SqSum, vget_low_u16(SqLo));
+        SqSum = vaddw_u16(SqSum, vget_high_u16(SqLo));
+        SqSum = vaddw_u16(SqSum, vget_low_u16(SqHi));
+        SqSum = vaddw_u16(SqSum, vget_high_u16(SqHi));
+    }
+
+    Uint8  MaxErrBytes[16];
+    Uint32 SqSumLanes[4];
+    vst1q_u8(MaxErrBytes, MaxErr);
+    vst1q_u32(SqSumLanes, SqSum);
+    for (Uint32 i = 0; i < 16; ++i)
+        Stats.MaxError[i % 4] = std::max(Stats.MaxError[i % 4], MaxErrBytes[i]);
+    for (Uint32 c = 0; c < 4; ++c)
+        Stats.SqErrorSum[c] += SqSumLanes[c];
+
+    CompareRowScalar(pRow0, pRow1, x, Width, Tolerance, Stats);
+}
+
+#else
+
+void CompareRow(const Uint8* pRow0, const Uint8* pRow1, Uint32 Width, int Tolerance, RowStatistics& Stats)
+{
+    CompareRowScalar(pRow0, pRow1, 0, Width, Tolerance, Stats);
+}
+
+#endif
+
+// Blue-green-red color scale for t in [0, 1]
+void GetHeatmapColor(float t, Uint8* pColor)
+{
+    const auto r = std::min(std::max(2.f * t - 1.f, 0.f), 1.f);
+    const auto g = 1.f - std::abs(2.f * t - 1.f);
+    const auto b = std::min(std::max(1.f - 2.f * t, 0.f), 1.f);
+
+    pColor[0] = static_cast<Uint8>(r * 255.f + 0.5f);
+    pColor[1] = static_cast<Uint8>(g * 255.f + 0.5f);
+    pColor[2] = static_cast<Uint8>(b * 255.f + 0.5f);
+    pColor[3] = 255;
+}
+
+} // namespace
+
+ImageComparisonResult CompareImages(const ImageComparisonAttribs& Attribs)
+{
+    VERIFY_EXPR(Attribs.Image0.pData != nullptr && Attribs.Image1.pData != nullptr);
+    VERIFY_EXPR(Attribs.Image0.NumComponents >= 3 && Attribs.Image1.NumComponents >= 3);
+
+    const auto Width  = Attribs.Width;
+    const auto Height = Attribs.Height;
+    // Image1 is converted to the channel order of Image0
+    const bool SwapRB = Attribs.Image0.BGR != Attribs.Image1.BGR;
+
+    // Per-pixel maximum channel error used to build the heatmap
+    std::vector<Uint8> ErrorMap;
+    if (Attribs.GenerateHeatmap)
+        ErrorMap.resize(size_t{Width} * Height);
+
+    const Uint32               NumTasks = (Height + RowsPerTask - 1) / RowsPerTask;
+    std::vector<RowStatistics> TaskStats(NumTasks);
+
+    auto ProcessRows = [&](Uint32 TaskId) {
+        std::vector<Uint8> Scratch0, Scratch1;
+
+        auto&        Stats    = TaskStats[TaskId];
+        const Uint32 StartRow = TaskId * RowsPerTask;
+        const Uint32 EndRow   = std::min(StartRow + RowsPerTask, Height);
+        for (Uint32 Row = StartRow; Row < EndRow; ++Row)
+        {
+            const auto* pRow0 = GetRGBARow(Attribs.Image0, Row, Width, false, Scratch0);
+            const auto* pRow1 = GetRGBARow(Attribs.Image1, Row, Width, SwapRB, Scratch1);
+            CompareRow(pRow0, pRow1, Width, Attribs.Tolerance, Stats);
+
+            if (!ErrorMap.empty())
+            {
+                auto* pErrRow = &ErrorMap[size_t{Row} * Width];
+                for (Uint32 x = 0; x < Width; ++x)
+                {
+                    int MaxDiff = 0;
+                    for (Uint32 c = 0; c < 3; ++c)
+                        MaxDiff = std::max(MaxDiff, std::abs(int{pRow0[x * 4 + c]} - int{pRow1[x * 4 + c]}));
+                    pErrRow[x] = static_cast<Uint8>(MaxDiff);
+                }
+            }
+        }
+    };
+
+    if (Attribs.pScheduler != nullptr && NumTasks > 1)
+    {
+        Attribs.pScheduler->ParallelFor(NumTasks, [&](Uint32, Uint32 TaskId) {
+            ProcessRows(TaskId);
+        });
+    }
+    else
+    {
+        for (Uint32 TaskId = 0; TaskId < NumTasks; ++TaskId)
+            ProcessRows(TaskId);
+    }
+
+    RowStatistics Total;
+    for (const auto& Stats : TaskStats)
+    {
+        Total.NumDifferentPixels += Stats.NumDifferentPixels;
+        for (Uint32 c = 0; c < 4; ++c)
+        {
+            Total.SqErrorSum[c] += Stats.SqErrorSum[c];
+            Total.MaxError[c] = std::max(Total.MaxError[c], Stats.MaxError[c]);
+        }
+    }
+
+    ImageComparisonResult Result;
+    Result.NumDifferentPixels = Total.NumDifferentPixels;
+
+    const double NumPixels = std::max(static_cast<double>(Width) * static_cast<double>(Height), 1.0);
+    Uint64       SqErrorSum = 0;
+    for (Uint32 c = 0; c < 3; ++c)
+    {
+        // Statistics are computed in the channel order of Image0
+        const auto SrcChannel = Attribs.Image0.BGR ? 2 - c : c;
+        Result.MaxError[c]    = Total.MaxError[SrcChannel];
+        Result.RMSE[c]        = std::sqrt(static_cast<double>(Total.SqErrorSum[SrcChannel]) / NumPixels);
+        SqErrorSum += Total.SqErrorSum[SrcChannel];
+    }
+
+    const auto MSE      = static_cast<double>(SqErrorSum) / (NumPixels * 3.0);
+    Result.RMSECombined = std::sqrt(MSE);
+    Result.PSNR         = MSE > 0 ? 10.0 * std::log10(255.0 * 255.0 / MSE) : std::numeric_limits<double>::infinity();
+
+    const auto MaxError = std::max({Result.MaxError[0], Result.MaxError[1], Result.MaxError[2]});
+    if (!ErrorMap.empty() && MaxError > 0)
+    {
+        Uint8 Palette[256][4];
+        for (Uint32 e = 0; e < 256; ++e)
+        {
+            if (e == 0)
+            {
+                // Identical pixels are black
+                Palette[e][0] = Palette[e][1] = Palette[e][2] = 0;
+                Palette[e][3]                                 = 255;
+            }
+            else
+            {
+                GetHeatmapColor(std::min(static_cast<float>(e) / static_cast<float>(MaxError), 1.f), Palette[e]);
+            }
+        }
+
+        Result.Heatmap.resize(ErrorMap.size() * 4);
+        for (size_t i = 0; i < ErrorMap.size(); ++i)
+            memcpy(&Result.Heatmap[i * 4], Palette[ErrorMap[i]], 4);
+    }
+
+    return Result;
+}
+
+} // namespace Diligent
@@ -21,6 +21,9 @@
 *  of the possibility of such damages.
 */
 
+#include <cstdlib>
+#include <cstring>
+
 #include "SampleApp.hpp"
 #if VULKAN_SUPPORTED
 #    include "ImGuiImplLinuxXCB.hpp"
@@ -43,6 +46,9 @@ public:
     }
     virtual bool OnGLContextCreated(Display* display, Window window) override final
     {
+        m_pDisplay = display;
+        m_Window   = window;
+
         try
         {
             LinuxNativeWindow LinuxWindow;
@@ -74,6 +80,9 @@ public:
 #if VULKAN_SUPPORTED
     virtual bool InitVulkan(xcb_connection_t* connection, uint32_t window) override final
     {
+        m_pXCBConnection = connection;
+        m_XCBWindow      = window;
+
         try
         {
             m_DeviceType = RENDER_DEVICE_TYPE_VULKAN;
@@ -103,6 +112,74 @@ public:
         }
     }
 #endif
+
+protected:
+    // The native entry point opens the X display and creates the window after the command line
+    // is processed. Neither is needed in headless mode, so the engine is released and the process
+    // exits as soon as the headless run is complete.
+    virtual void HeadlessMain() override final
+    {
+        const auto ExitCode = RunHeadless();
+        ReleaseEngine();
+        std::exit(ExitCode);
+    }
+
+    virtual void RequestQuit() override final
+    {
+        SampleApp::RequestQuit();
+        PostCloseEvent();
+    }
+
+private:
+    // The native loop exits when the window manager asks to close the window,
+    // so send ourselves the same WM_DELETE_WINDOW client message.
+    void PostCloseEvent()
+    {
+        if (m_pDisplay != nullptr)
+        {
+            XEvent Event{};
+            Event.xclient.type         = ClientMessage;
+            Event.xclient.window       = m_Window;
+            Event.xclient.message_type = XInternAtom(m_pDisplay, "WM_PROTOCOLS", False);
+            Event.xclient.format       = 32;
+            Event.xclient.data.l[0]    = static_cast<long>(XInternAtom(m_pDisplay, "WM_DELETE_WINDOW", False));
+            Event.xclient.data.l[1]    = CurrentTime;
+            XSendEvent(m_pDisplay, m_Window, False, NoEventMask, &Event);
+            XFlush(m_pDisplay);
+        }
+
+#if VULKAN_SUPPORTED
+        if (m_pXCBConnection != nullptr)
+        {
+            auto InternAtom = [this](const char* Name) {
+                auto  Cookie = xcb_intern_atom(m_pXCBConnection, 0, static_cast<uint16_t>(strlen(Name)), Name);
+                auto* pReply = xcb_intern_atom_reply(m_pXCBConnection, Cookie, nullptr);
+                if (pReply == nullptr)
+                    return xcb_atom_t{XCB_ATOM_NONE};
+                const auto Atom = pReply->atom;
+                free(pReply);
+                return Atom;
+            };
+
+            xcb_client_message_event_t Event{};
+            Event.response_type  = XCB_CLIENT_MESSAGE;
+            Event.format         = 32;
+            Event.window         = m_XCBWindow;
+            Event.type           = InternAtom("WM_PROTOCOLS");
+            Event.data.data32[0] = InternAtom("WM_DELETE_WINDOW");
+            Event.data.data32[1] = XCB_CURRENT_TIME;
+            xcb_send_event(m_pXCBConnection, 0, m_XCBWindow, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>(&Event));
+            xcb_flush(m_pXCBConnection);
+        }
+#endif
+    }
+
+    Display* m_pDisplay = nullptr;
+    Window   m_Window   = 0;
+#if VULKAN_SUPPORTED
+    xcb_connection_t* m_pXCBConnection = nullptr;
+    uint32_t          m_XCBWindow      = 0;
+#endif
 };
 
 NativeAppBase* CreateApplication()
@@ -0,0 +1,124 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "OffscreenSwapChain.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+OffscreenSwapChain::OffscreenSwapChain(IReferenceCounters* pRefCounters, IRenderDevice* pDevice, IDeviceContext* pImmediateContext, const SwapChainDesc& SCDesc) :
+    TBase{pRefCounters},
+    m_pDevice{pDevice},
+    m_wpDeviceContext{pImmediateContext},
+    m_Desc{SCDesc}
+{
+    // There is no presentation surface, so there is nothing to rotate
+    m_Desc.PreTransform = SURFACE_TRANSFORM_IDENTITY;
+    m_Desc.BufferCount  = 1;
+    if (m_Desc.Width == 0 || m_Desc.Height == 0)
+    {
+        m_Desc.Width  = 1024;
+        m_Desc.Height = 768;
+    }
+    CreateBuffers();
+}
+
+void OffscreenSwapChain::Create(IRenderDevice* pDevice, IDeviceContext* pImmediateContext, const SwapChainDesc& SCDesc, ISwapChain** ppSwapChain)
+{
+    DEV_CHECK_ERR(ppSwapChain != nullptr && *ppSwapChain == nullptr, "Swap chain pointer must not be null and must not point to an existing object");
+    DEV_CHECK_ERR(pImmediateContext != nullptr, "Immediate context must not be null");
+
+    auto* pSwapChain = MakeNewRCObj<OffscreenSwapChain>()(pDevice, pImmediateContext, SCDesc);
+    pSwapChain->QueryInterface(IID_SwapChain, reinterpret_cast<IObject**>(ppSwapChain));
+}
+
+void OffscreenSwapChain::CreateBuffers()
+{
+    m_pRTV.Release();
+    m_pDSV.Release();
+    m_pColorBuffer.Release();
+    m_pDepthBuffer.Release();
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Offscreen color buffer";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = m_Desc.Width;
+    TexDesc.Height    = m_Desc.Height;
+    TexDesc.Format    = m_Desc.ColorBufferFormat;
+    TexDesc.BindFlags = BIND_RENDER_TARGET | BIND_SHADER_RESOURCE;
+
+    TexDesc.ClearValue.Format = m_Desc.ColorBufferFormat;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_pColorBuffer);
+    if (!m_pColorBuffer)
+        LOG_ERROR_AND_THROW("Failed to create offscreen color buffer");
+    m_pRTV = m_pColorBuffer->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+
+    if (m_Desc.DepthBufferFormat != TEX_FORMAT_UNKNOWN)
+    {
+        TexDesc.Name      = "Offscreen depth buffer";
+        TexDesc.Format    = m_Desc.DepthBufferFormat;
+        TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+
+        TexDesc.ClearValue.Format               = m_Desc.DepthBufferFormat;
+        TexDesc.ClearValue.DepthStencil.Depth   = m_Desc.DefaultDepthValue;
+        TexDesc.ClearValue.DepthStencil.Stencil = m_Desc.DefaultStencilValue;
+        m_pDevice->CreateTexture(TexDesc, nullptr, &m_pDepthBuffer);
+        if (!m_pDepthBuffer)
+            LOG_ERROR_AND_THROW("Failed to create offscreen depth buffer");
+        m_pDSV = m_pDepthBuffer->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+    }
+}
+
+void OffscreenSwapChain::Present(Uint32 SyncInterval)
+{
+    // There is nothing to show, but the frame still has to be ended: submit the
+    // commands, release per-frame dynamic allocations and stale resources,
+    // exactly as native swap chains do when they present.
+    auto pDeviceContext = m_wpDeviceContext.Lock();
+    if (!pDeviceContext)
+    {
+        LOG_ERROR_MESSAGE("Immediate context has been released");
+        return;
+    }
+
+    pDeviceContext->Flush();
+    pDeviceContext->FinishFrame();
+    m_pDevice->ReleaseStaleResources();
+}
+
+void OffscreenSwapChain::Resize(Uint32 NewWidth, Uint32 NewHeight, SURFACE_TRANSFORM NewPreTransform)
+{
+    if (NewWidth == 0 || NewHeight == 0 || (NewWidth == m_Desc.Width && NewHeight == m_Desc.Height))
+        return;
+
+    m_Desc.Width  = NewWidth;
+    m_Desc.Height = NewHeight;
+    CreateBuffers();
+}
+
+} // namespace Diligent
@@ -29,6 +29,10 @@
 #include <iomanip>
 #include <cstdlib>
 #include <cmath>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <algorithm>
 
 #include "PlatformDefinitions.h"
 #include "SampleApp.hpp"
@@ -37,6 +41,9 @@
 #include "MapHelper.hpp"
 #include "Image.h"
 #include "FileWrapper.hpp"
+#include "OffscreenSwapChain.hpp"
+#include "ImageComparison.hpp"
+#include "TaskScheduler.hpp"
 
 #if D3D11_SUPPORTED
 #    include "EngineFactoryD3D11.h"
@@ -73,9 +80,21 @@ SampleApp::SampleApp() :
 
 SampleApp::~SampleApp()
 {
+    ReleaseEngine();
+}
+
+void SampleApp::ReleaseEngine()
+{
+    FinishScreenCaptures();
+    m_pScreenCaptureWriter.reset();
+    m_pVideoCaptureStream.reset();
+
     m_pImGui.reset();
     m_TheSample.reset();
 
+    // The sample has stopped its threads, so no zones can be recorded anymore
+    FinishProfiling();
+
     if (!m_pDeviceContexts.empty())
     {
         for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
@@ -258,6 +277,10 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
         case RENDER_DEVICE_TYPE_GL:
         case RENDER_DEVICE_TYPE_GLES:
         {
+            if (m_bHeadless)
+            {
+                LOG_ERROR_AND_THROW("Headless mode is not supported in OpenGL mode");
+            }
 #    if !PLATFORM_MACOS
             VERIFY_EXPR(pWindow != nullptr);
 #    endif
@@ -360,6 +383,14 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
             break;
     }
 
+    if (m_bHeadless)
+    {
+        VERIFY(!m_pSwapChain, "Swap chain is not expected to be created in headless mode");
+        m_SwapChainInitDesc.Width  = static_cast<Uint32>(std::max(m_InitialWindowWidth, 0));
+        m_SwapChainInitDesc.Height = static_cast<Uint32>(std::max(m_InitialWindowHeight, 0));
+        OffscreenSwapChain::Create(m_pDevice, ppContexts[0], m_SwapChainInitDesc, &m_pSwapChain);
+    }
+
     switch (m_DeviceType)
     {
         // clang-format off
@@ -390,6 +421,38 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
         }
 
         m_pScreenCapture.reset(new ScreenCapture(m_pDevice));
+
+        if (m_ScreenCaptureInfo.Stream && m_GoldenImgMode == GoldenImageMode::None)
+        {
+            auto StreamPath = m_ScreenCaptureInfo.StreamPath;
+            if (StreamPath.empty())
+            {
+                std::stringstream PathSS;
+                if (!m_ScreenCaptureInfo.Directory.empty())
+                {
+                    PathSS << m_ScreenCaptureInfo.Directory;
+                    if (m_ScreenCaptureInfo.Directory.back() != '/')
+                        PathSS << '/';
+                }
+                PathSS << m_ScreenCaptureInfo.FileName << '.' << VideoCaptureStream::GetFileExtension(m_ScreenCaptureInfo.StreamFormat);
+                StreamPath = PathSS.str();
+            }
+
+            m_pVideoCaptureStream.reset(new VideoCaptureStream{StreamPath.c_str(), m_ScreenCaptureInfo.StreamFormat, m_ScreenCaptureInfo.CaptureFPS});
+            if (!m_pVideoCaptureStream->IsOpen())
+            {
+                LOG_ERROR_MESSAGE("Failed to open capture stream. Frames will be saved as individual images.");
+                m_pVideoCaptureStream.reset();
+            }
+        }
+
+        // Golden images are compared and saved right after the capture
+        if (m_GoldenImgMode == GoldenImageMode::None && m_ScreenCaptureInfo.WriterThreads > 0)
+        {
+            // Stream frames must be written in order, which requires a single thread
+            const auto NumThreads = m_pVideoCaptureStream ? 1u : m_ScreenCaptureInfo.WriterThreads;
+            m_pScreenCaptureWriter.reset(new ScreenCaptureWriter{NumThreads, m_ScreenCaptureInfo.MaxWriterJobs});
+        }
     }
 }
 
@@ -432,6 +495,14 @@ void SampleApp::InitializeSample()
     InitInfo.NumDeferredCtx = static_cast<Uint32>(m_pDeviceContexts.size()) - m_NumImmediateContexts;
     InitInfo.pSwapChain     = m_pSwapChain;
     InitInfo.pImGui         = m_pImGui.get();
+
+    if (m_ProfilingInfo.Enabled && !m_pProfiler)
+    {
+        // Zones recorded during the initialization are added to the first frame
+        m_pProfiler.reset(new FrameProfiler{m_pDevice});
+        FrameProfiler::SetActive(m_pProfiler.get());
+    }
+
     m_TheSample->Initialize(InitInfo);
 
     m_TheSample->WindowResize(SCDesc.Width, SCDesc.Height);
@@ -537,6 +608,72 @@ void SampleApp::UpdateAdaptersDialog()
 #endif
 }
 
+void SampleApp::UpdateProfilerDialog()
+{
+    VERIFY_EXPR(m_pProfiler);
+
+    // Refresh the statistics twice per second to keep the numbers readable
+    if (m_CurrentTime - m_ProfilingInfo.LastStatsTime > 0.5)
+    {
+        m_pProfiler->GetScopeStats(60, m_ProfilerStats);
+        m_ProfilingInfo.LastStatsTime = m_CurrentTime;
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(10, 300), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Frame Profiler"))
+    {
+        ImGui::TextDisabled("Average per frame over the last 60 frames");
+
+        ImGui::Columns(4, "##ProfilerScopes");
+        ImGui::SetColumnWidth(0, 200);
+        // clang-format off
+        ImGui::TextDisabled("Scope");   ImGui::NextColumn();
+        ImGui::TextDisabled("Count");   ImGui::NextColumn();
+        ImGui::TextDisabled("CPU, ms"); ImGui::NextColumn();
+        ImGui::TextDisabled("GPU, ms"); ImGui::NextColumn();
+        // clang-format on
+        ImGui::Separator();
+
+        Uint32 ThreadLane = ~0u;
+        for (const auto& St : m_ProfilerStats)
+        {
+            if (St.ThreadLane != ThreadLane)
+            {
+                ThreadLane = St.ThreadLane;
+                ImGui::TextDisabled("%s", m_pProfiler->GetLaneName(ThreadLane));
+                for (int i = 0; i < 4; ++i)
+                    ImGui::NextColumn();
+            }
+            ImGui::Text("%*s%s", static_cast<int>(St.Depth * 2 + 2), "", St.Name);
+            ImGui::NextColumn();
+            ImGui::Text("%.1f", St.Count);
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", St.CpuTime * 1000.0);
+            ImGui::NextColumn();
+            if (St.GpuLane != FrameProfiler::CpuLane)
+                ImGui::Text("%.3f", St.GpuTime * 1000.0);
+            else
+                ImGui::TextDisabled("-");
+            ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+        ImGui::Separator();
+
+        if (m_pProfiler->GetNumDroppedScopes() > 0)
+            ImGui::TextDisabled("Dropped scopes: %u", m_pProfiler->GetNumDroppedScopes());
+
+        if (ImGui::Button("Save trace"))
+        {
+            if (m_pProfiler->WriteChromeTrace(m_ProfilingInfo.OutputPath.c_str()))
+                LOG_INFO_MESSAGE("Profiler trace is written to '", m_ProfilingInfo.OutputPath, "'.");
+        }
+        ImGui::HelpMarker("Writes the timeline of the recorded frames in Chrome trace event format. Open it in chrome://tracing or https://ui.perfetto.dev");
+    }
+    ImGui::End();
+}
+
 
 std::string GetArgument(const char*& pos, const char* ArgName)
 {
@@ -651,11 +788,27 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
             {
                 m_ScreenCaptureInfo.FileFormat = IMAGE_FILE_FORMAT_PNG;
             }
+            else if (StrCmpNoCase(Arg.c_str(), "y4m", Arg.length()) == 0)
+            {
+                m_ScreenCaptureInfo.Stream       = true;
+                m_ScreenCaptureInfo.StreamFormat = VideoCaptureStream::FORMAT_Y4M;
+            }
+            else if (StrCmpNoCase(Arg.c_str(), "raw", Arg.length()) == 0 || StrCmpNoCase(Arg.c_str(), "rgba", Arg.length()) == 0)
+            {
+                m_ScreenCaptureInfo.Stream       = true;
+                m_ScreenCaptureInfo.StreamFormat = VideoCaptureStream::FORMAT_RAW_RGBA;
+            }
             else
             {
-                LOG_ERROR_MESSAGE("Unknown capture format. The following are allowed values: 'jpeg', 'jpg', 'png'");
+                LOG_ERROR_MESSAGE("Unknown capture format. The following are allowed values: 'jpeg', 'jpg', 'png', 'y4m', 'raw'");
             }
         }
+        else if (!(Arg = GetArgument(pos, "capture_stream")).empty())
+        {
+            m_ScreenCaptureInfo.StreamPath   = std::move(Arg);
+            m_ScreenCaptureInfo.Stream       = true;
+            m_ScreenCaptureInfo.AllowCapture = true;
+        }
         else if (!(Arg = GetArgument(pos, "capture_quality")).empty())
         {
             m_ScreenCaptureInfo.JpegQuality = atoi(Arg.c_str());
@@ -664,6 +817,14 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_ScreenCaptureInfo.KeepAlpha = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || Arg == "1";
         }
+        else if (!(Arg = GetArgument(pos, "capture_threads")).empty())
+        {
+            m_ScreenCaptureInfo.WriterThreads = static_cast<Uint32>(std::max(atoi(Arg.c_str()), 0));
+        }
+        else if (!(Arg = GetArgument(pos, "capture_queue")).empty())
+        {
+            m_ScreenCaptureInfo.MaxWriterJobs = static_cast<Uint32>(std::max(atoi(Arg.c_str()), 1));
+        }
         else if (!(Arg = GetArgument(pos, "width")).empty())
         {
             m_InitialWindowWidth = atoi(Arg.c_str());
@@ -724,6 +885,10 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_GoldenImgPixelTolerance = atoi(Arg.c_str());
         }
+        else if (!(Arg = GetArgument(pos, "golden_image_heatmap")).empty())
+        {
+            m_bGoldenImgHeatmap = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
+        }
         else if (!(Arg = GetArgument(pos, "vsync")).empty())
         {
             m_bVSync = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
@@ -732,6 +897,45 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_bForceNonSeprblProgs = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
         }
+        else if (!(Arg = GetArgument(pos, "headless")).empty())
+        {
+#if PLATFORM_WIN32 || PLATFORM_LINUX
+            m_bHeadless = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
+#else
+            LOG_ERROR_MESSAGE("Headless mode is not supported on this platform");
+#endif
+        }
+        else if (!(Arg = GetArgument(pos, "bench_frames")).empty())
+        {
+#if PLATFORM_WIN32 || PLATFORM_LINUX
+            auto NumFrames            = atoi(Arg.c_str());
+            m_BenchmarkInfo.NumFrames = static_cast<Uint32>(std::max(NumFrames, 0));
+#else
+            // The benchmark quits the application when it is complete, see RequestQuit()
+            LOG_ERROR_MESSAGE("Benchmark mode is not supported on this platform");
+#endif
+        }
+        else if (!(Arg = GetArgument(pos, "bench_out")).empty())
+        {
+            m_BenchmarkInfo.OutputPath = std::move(Arg);
+        }
+        else if (!(Arg = GetArgument(pos, "bench_dt")).empty())
+        {
+            auto TimeStep = atof(Arg.c_str());
+            if (TimeStep > 0)
+                m_BenchmarkInfo.TimeStep = TimeStep;
+            else
+                LOG_ERROR_MESSAGE("Benchmark time step must be positive");
+        }
+        else if (!(Arg = GetArgument(pos, "profile")).empty())
+        {
+            m_ProfilingInfo.Enabled = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
+        }
+        else if (!(Arg = GetArgument(pos, "profile_out")).empty())
+        {
+            m_ProfilingInfo.OutputPath = std::move(Arg);
+            m_ProfilingInfo.Enabled    = true;
+        }
 
         pos = strchr(pos, '-');
     }
@@ -753,7 +957,92 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         }
     }
 
+    if (m_BenchmarkInfo.NumFrames > 0)
+    {
+        m_pBenchmark.reset(new FrameBenchmark{m_BenchmarkInfo.NumFrames, m_BenchmarkInfo.TimeStep});
+    }
+
     m_TheSample->ProcessCommandLine(CmdLine);
+
+    if (m_bHeadless)
+    {
+        // Native application entry points create a window after the command line
+        // is processed, so the headless run has to start here.
+        HeadlessMain();
+    }
+}
+
+void SampleApp::HeadlessMain()
+{
+    // Ask the native application loop to quit right away, so that the application
+    // is destroyed through the normal path.
+    m_ExitCode = RunHeadless();
+    RequestQuit();
+}
+
+int SampleApp::RunHeadless()
+{
+    VERIFY_EXPR(m_bHeadless);
+
+    const bool CaptureRequested = m_ScreenCaptureInfo.AllowCapture && (m_ScreenCaptureInfo.FramesToCapture > 0 || m_GoldenImgMode != GoldenImageMode::None);
+    if (!CaptureRequested && !m_pBenchmark)
+    {
+        LOG_ERROR_MESSAGE("Headless mode requires screen capture (-capture_frames or -golden_image_mode) or benchmark (-bench_frames) to be enabled");
+        return -1;
+    }
+
+    if (m_DeviceType == RENDER_DEVICE_TYPE_GL || m_DeviceType == RENDER_DEVICE_TYPE_GLES)
+    {
+#if VULKAN_SUPPORTED
+        LOG_INFO_MESSAGE("OpenGL requires a window. Using Vulkan in headless mode.");
+        m_DeviceType = RENDER_DEVICE_TYPE_VULKAN;
+#else
+        LOG_ERROR_MESSAGE("Headless mode is not supported in OpenGL mode");
+        return -1;
+#endif
+    }
+
+    try
+    {
+        InitializeDiligentEngine(nullptr);
+        const auto& SCDesc = m_pSwapChain->GetDesc();
+        m_pImGui.reset(new ImGuiImplDiligent(m_pDevice, SCDesc.ColorBufferFormat, SCDesc.DepthBufferFormat));
+        InitializeSample();
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize the application in headless mode");
+        return -1;
+    }
+
+    using TimePoint = std::chrono::high_resolution_clock::time_point;
+    using SecondsD  = std::chrono::duration<double>;
+
+    const auto StartTime = TimePoint::clock::now();
+    double     PrevTime  = 0;
+    while (true)
+    {
+        const auto CurrTime = std::chrono::duration_cast<SecondsD>(TimePoint::clock::now() - StartTime).count();
+        Update(CurrTime, CurrTime - PrevTime);
+        Render();
+        Present();
+        PrevTime = CurrTime;
+
+        // Golden image is processed right after the first frame (this mirrors the native app loop).
+        // Benchmark mode requests a quit on its own when all frames are recorded.
+        if (m_GoldenImgMode != GoldenImageMode::None || m_bQuitRequested)
+            break;
+
+        if (CaptureRequested && m_ScreenCaptureInfo.FramesToCapture == 0 && !m_pBenchmark)
+        {
+            DrainScreenCaptures();
+            break;
+        }
+    }
+
+    FinishProfiling();
+
+    return m_ExitCode;
 }
 
 void SampleApp::WindowResize(int width, int height)
@@ -770,6 +1059,27 @@ void SampleApp::WindowResize(int width, int height)
 
 void SampleApp::Update(double CurrTime, double ElapsedTime)
 {
+    if (m_bQuitRequested)
+        return;
+
+    if (m_pBenchmark)
+    {
+        // Use fixed time step so that every benchmark run simulates exactly the same frames
+        CurrTime    = m_pBenchmark->GetSimulatedTime();
+        ElapsedTime = m_pBenchmark->GetTimeStep();
+    }
+
+    if (m_pProfiler)
+    {
+        // A profiler frame spans Update(), Render() and Present()
+        if (m_pProfiler->IsInFrame())
+            m_pProfiler->EndFrame();
+        m_pProfiler->BeginFrame();
+    }
+    DILIGENT_PROFILE_SCOPE("Update");
+
+    FrameBenchmark::ScopedStage BenchStage{m_pBenchmark.get(), FrameBenchmark::STAGE_UPDATE};
+
     m_CurrentTime = CurrTime;
 
     if (m_pImGui)
@@ -780,6 +1090,10 @@ void SampleApp::Update(double CurrTime, double ElapsedTime)
         {
             UpdateAdaptersDialog();
         }
+        if (m_pProfiler)
+        {
+            UpdateProfilerDialog();
+        }
     }
     if (m_pDevice)
     {
@@ -790,20 +1104,28 @@ void SampleApp::Update(double CurrTime, double ElapsedTime)
 
 void SampleApp::Render()
 {
-    if (m_NumImmediateContexts == 0 || !m_pSwapChain)
+    if (m_NumImmediateContexts == 0 || !m_pSwapChain || m_bQuitRequested)
         return;
 
     auto* pCtx = GetImmediateContext();
     auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
     auto* pDSV = m_pSwapChain->GetDepthBufferDSV();
-    pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    m_TheSample->Render();
+    {
+        DILIGENT_PROFILE_GPU_SCOPE("Render", pCtx);
+        FrameBenchmark::ScopedStage BenchStage{m_pBenchmark.get(), FrameBenchmark::STAGE_RENDER};
+
+        pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        m_TheSample->Render();
+    }
 
     // Restore default render target in case the sample has changed it
     pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     if (m_pImGui)
     {
+        DILIGENT_PROFILE_GPU_SCOPE("ImGui", pCtx);
+        FrameBenchmark::ScopedStage BenchStage{m_pBenchmark.get(), FrameBenchmark::STAGE_IMGUI};
         if (m_bShowUI)
         {
             // No need to call EndFrame as ImGui::Render calls it automatically
@@ -846,25 +1168,90 @@ void SampleApp::CompareGoldenImage(const std::string& FileName, ScreenCapture::C
 
     MappedTextureSubresource TexData;
     pCtx->MapTextureSubresource(Capture.pTexture, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, TexData);
-    auto CapturedPixels = Image::ConvertImageData(TexDesc.Width, TexDesc.Height,
-                                                  reinterpret_cast<const Uint8*>(TexData.pData), static_cast<Uint32>(TexData.Stride),
-                                                  TexDesc.Format, TEX_FORMAT_RGBA8_UNORM, false /*Keep alpha*/);
+
+    ImageComparisonAttribs CompareAttribs;
+    CompareAttribs.Width           = TexDesc.Width;
+    CompareAttribs.Height          = TexDesc.Height;
+    CompareAttribs.Tolerance       = m_GoldenImgPixelTolerance;
+    CompareAttribs.GenerateHeatmap = m_bGoldenImgHeatmap;
+
+    // 8-bit RGBA and BGRA captures are compared directly. Other formats are converted first.
+    std::vector<Uint8> CapturedPixels;
+    switch (TexDesc.Format)
+    {
+        case TEX_FORMAT_RGBA8_UNORM:
+        case TEX_FORMAT_RGBA8_UNORM_SRGB:
+        case TEX_FORMAT_BGRA8_UNORM:
+        case TEX_FORMAT_BGRA8_UNORM_SRGB:
+            CompareAttribs.Image0.pData         = reinterpret_cast<const Uint8*>(TexData.pData);
+            CompareAttribs.Image0.Stride        = static_cast<Uint32>(TexData.Stride);
+            CompareAttribs.Image0.NumComponents = 4;
+            CompareAttribs.Image0.BGR           = TexDesc.Format == TEX_FORMAT_BGRA8_UNORM || TexDesc.Format == TEX_FORMAT_BGRA8_UNORM_SRGB;
+            break;
+
+        default:
+            CapturedPixels = Image::ConvertImageData(TexDesc.Width, TexDesc.Height,
+                                                     reinterpret_cast<const Uint8*>(TexData.pData), static_cast<Uint32>(TexData.Stride),
+                                                     TexDesc.Format, TEX_FORMAT_RGBA8_UNORM, false /*Keep alpha*/);
+
+            CompareAttribs.Image0.pData         = CapturedPixels.data();
+            CompareAttribs.Image0.Stride        = TexDesc.Width * 3;
+            CompareAttribs.Image0.NumComponents = 3;
+    }
+
+    CompareAttribs.Image1.pData         = reinterpret_cast<const Uint8*>(pGoldenImg->GetData()->GetDataPtr());
+    CompareAttribs.Image1.Stride        = GoldenImgDesc.RowStride;
+    CompareAttribs.Image1.NumComponents = GoldenImgDesc.NumComponents;
+
+    ImageComparisonResult CompareResult;
+    {
+        // The main thread takes part in the work
+        const auto    NumCores = std::max(std::thread::hardware_concurrency(), 1u);
+        TaskScheduler Scheduler{NumCores - 1};
+        CompareAttribs.pScheduler = &Scheduler;
+
+        CompareResult = CompareImages(CompareAttribs);
+    }
     pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
 
-    auto* pGoldenImgPixels = reinterpret_cast<const Uint8*>(pGoldenImg->GetData()->GetDataPtr());
+    m_ExitCode = static_cast<int>(std::min(CompareResult.NumDifferentPixels, Uint64{std::numeric_limits<int>::max()}));
+
+    std::stringstream ReportSS;
+    ReportSS << std::fixed << std::setprecision(3)
+             << "Golden image comparison (" << FileName << "): " << CompareResult.NumDifferentPixels << " pixels differ by more than " << m_GoldenImgPixelTolerance
+             << ". Max error (R, G, B): " << int{CompareResult.MaxError[0]} << ", " << int{CompareResult.MaxError[1]} << ", " << int{CompareResult.MaxError[2]}
+             << ". RMSE (R, G, B): " << CompareResult.RMSE[0] << ", " << CompareResult.RMSE[1] << ", " << CompareResult.RMSE[2]
+             << ". RMSE: " << CompareResult.RMSECombined << ". PSNR: " << CompareResult.PSNR << " dB.";
+    if (m_ExitCode != 0)
+        LOG_ERROR_MESSAGE(ReportSS.str());
+    else
+        LOG_INFO_MESSAGE(ReportSS.str());
 
-    m_ExitCode = 0;
-    for (Uint32 row = 0; row < TexDesc.Height; ++row)
+    if (!CompareResult.Heatmap.empty())
     {
-        for (Uint32 col = 0; col < TexDesc.Width; ++col)
-        {
-            const auto* SrcPixel = &CapturedPixels[(col + row * TexDesc.Width) * 3];
-            const auto* DstPixel = pGoldenImgPixels + row * GoldenImgDesc.RowStride + col * GoldenImgDesc.NumComponents;
-            if (std::abs(int{SrcPixel[0]} - int{DstPixel[0]}) > m_GoldenImgPixelTolerance ||
-                std::abs(int{SrcPixel[1]} - int{DstPixel[1]}) > m_GoldenImgPixelTolerance ||
-                std::abs(int{SrcPixel[2]} - int{DstPixel[2]}) > m_GoldenImgPixelTolerance)
-                ++m_ExitCode;
-        }
+        auto HeatmapFileName = FileName;
+        auto DotPos          = HeatmapFileName.find_last_of('.');
+        if (DotPos != std::string::npos && HeatmapFileName.find_first_of("/\\", DotPos) == std::string::npos)
+            HeatmapFileName.erase(DotPos);
+        HeatmapFileName += "_diff.png";
+
+        Image::EncodeInfo Info;
+        Info.Width      = TexDesc.Width;
+        Info.Height     = TexDesc.Height;
+        Info.TexFormat  = TEX_FORMAT_RGBA8_UNORM;
+        Info.KeepAlpha  = false;
+        Info.pData      = CompareResult.Heatmap.data();
+        Info.Stride     = TexDesc.Width * 4;
+        Info.FileFormat = IMAGE_FILE_FORMAT_PNG;
+
+        RefCntAutoPtr<IDataBlob> pEncodedImage;
+        Image::Encode(Info, &pEncodedImage);
+
+        FileWrapper pFile(HeatmapFileName.c_str(), EFileAccessMode::Overwrite);
+        if (pFile && pFile->Write(pEncodedImage->GetDataPtr(), pEncodedImage->GetSize()))
+            LOG_INFO_MESSAGE("Golden image diff heatmap is written to '", HeatmapFileName, "'.");
+        else
+            LOG_ERROR_MESSAGE("Failed to write golden image diff heatmap to '", HeatmapFileName, "'.");
     }
 }
 
@@ -886,6 +1273,14 @@ void SampleApp::SaveScreenCapture(const std::string& FileName, ScreenCapture::Ca
     Info.FileFormat  = m_ScreenCaptureInfo.FileFormat;
     Info.JpegQuality = m_ScreenCaptureInfo.JpegQuality;
 
+    if (m_pVideoCaptureStream)
+    {
+        if (!m_pVideoCaptureStream->WriteFrame(Info))
+            m_ExitCode = -5;
+        pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
+        return;
+    }
+
     RefCntAutoPtr<IDataBlob> pEncodedImage;
     Image::Encode(Info, &pEncodedImage);
     pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
@@ -908,11 +1303,180 @@ void SampleApp::SaveScreenCapture(const std::string& FileName, ScreenCapture::Ca
     }
 }
 
+void SampleApp::SubmitScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture)
+{
+    VERIFY_EXPR(m_pScreenCaptureWriter);
+
+    // Wait for the writer if there are too many captures in flight
+    while (!m_pScreenCaptureWriter->CanSubmit())
+        ProcessCompletedScreenCaptures(true);
+
+    auto* const pCtx = GetImmediateContext();
+
+    // The texture stays mapped until the writer thread has encoded the image
+    MappedTextureSubresource TexData;
+    pCtx->MapTextureSubresource(Capture.pTexture, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, TexData);
+    const auto& TexDesc = Capture.pTexture->GetDesc();
+
+    ScreenCaptureWriter::Job Job;
+    Job.EncodeInfo.Width       = TexDesc.Width;
+    Job.EncodeInfo.Height      = TexDesc.Height;
+    Job.EncodeInfo.TexFormat   = TexDesc.Format;
+    Job.EncodeInfo.KeepAlpha   = m_ScreenCaptureInfo.KeepAlpha;
+    Job.EncodeInfo.pData       = TexData.pData;
+    Job.EncodeInfo.Stride      = static_cast<Uint32>(TexData.Stride);
+    Job.EncodeInfo.FileFormat  = m_ScreenCaptureInfo.FileFormat;
+    Job.EncodeInfo.JpegQuality = m_ScreenCaptureInfo.JpegQuality;
+    Job.FileName               = FileName;
+    Job.pStream                = m_pVideoCaptureStream.get();
+    Job.pTexture               = std::move(Capture.pTexture);
+    m_pScreenCaptureWriter->Submit(std::move(Job));
+}
+
+void SampleApp::ProcessCompletedScreenCaptures(bool Wait)
+{
+    if (!m_pScreenCaptureWriter)
+        return;
+
+    auto* const pCtx = GetImmediateContext();
+    for (auto& Job : m_pScreenCaptureWriter->GetCompletedJobs(Wait))
+    {
+        if (!Job.Succeeded)
+            m_ExitCode = -5;
+
+        pCtx->UnmapTextureSubresource(Job.pTexture, 0, 0);
+        m_pScreenCapture->RecycleStagingTexture(std::move(Job.pTexture));
+    }
+}
+
+void SampleApp::ProcessScreenCaptures()
+{
+    while (auto Capture = m_pScreenCapture->GetCapture())
+    {
+        std::string FileName;
+        {
+            std::stringstream FileNameSS;
+            if (!m_ScreenCaptureInfo.Directory.empty())
+            {
+                FileNameSS << m_ScreenCaptureInfo.Directory;
+                if (m_ScreenCaptureInfo.Directory.back() != '/')
+                    FileNameSS << '/';
+            }
+            FileNameSS << m_ScreenCaptureInfo.FileName;
+            if (m_GoldenImgMode == GoldenImageMode::None)
+            {
+                FileNameSS << std::setw(3) << std::setfill('0') << Capture.Id;
+            }
+            FileNameSS << (m_ScreenCaptureInfo.FileFormat == IMAGE_FILE_FORMAT_JPEG ? ".jpg" : ".png");
+            FileName = FileNameSS.str();
+        }
+
+        if (m_GoldenImgMode == GoldenImageMode::Compare || m_GoldenImgMode == GoldenImageMode::CompareUpdate)
+        {
+            CompareGoldenImage(FileName, Capture);
+        }
+
+        if (m_pScreenCaptureWriter)
+        {
+            // The staging texture is recycled when the writer is done with it
+            SubmitScreenCapture(FileName, Capture);
+            continue;
+        }
+
+        if (m_GoldenImgMode == GoldenImageMode::None ||
+            m_GoldenImgMode == GoldenImageMode::Capture ||
+            m_GoldenImgMode == GoldenImageMode::CompareUpdate)
+        {
+            SaveScreenCapture(FileName, Capture);
+        }
+
+        m_pScreenCapture->RecycleStagingTexture(std::move(Capture.pTexture));
+    }
+}
+
+void SampleApp::DrainScreenCaptures()
+{
+    if (!m_pScreenCapture)
+        return;
+
+    // Captures become available when the GPU has finished copying them
+    for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
+        m_pDeviceContexts[q]->WaitForIdle();
+    ProcessScreenCaptures();
+    VERIFY(!m_pScreenCapture->HasCapture(), "All captures are expected to be processed");
+
+    FinishScreenCaptures();
+}
+
+void SampleApp::FinishScreenCaptures()
+{
+    if (!m_pScreenCaptureWriter)
+        return;
+
+    while (m_pScreenCaptureWriter->GetNumJobsInFlight() > 0)
+        ProcessCompletedScreenCaptures(true);
+    ProcessCompletedScreenCaptures(false);
+}
+
+void SampleApp::FinishBenchmark()
+{
+    VERIFY_EXPR(m_pBenchmark && m_pBenchmark->IsComplete());
+
+    // Captured frames are part of the run, so write all of them before the report
+    DrainScreenCaptures();
+
+    if (m_pBenchmark->WriteReport(m_BenchmarkInfo.OutputPath.c_str(), m_AppTitle.c_str()))
+    {
+        LOG_INFO_MESSAGE("Benchmark of ", m_pBenchmark->GetNumFramesRecorded(), " frames is complete. The report is written to '", m_BenchmarkInfo.OutputPath, "'.");
+    }
+    else
+    {
+        m_ExitCode = -7;
+    }
+
+    m_pVideoCaptureStream.reset();
+
+    for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
+        m_pDeviceContexts[q]->WaitForIdle();
+
+    FinishProfiling();
+
+    // Let the current frame return to the native loop and stop there; the
+    // application is then destroyed through the normal shutdown path.
+    RequestQuit();
+}
+
+void SampleApp::FinishProfiling()
+{
+    if (!m_pProfiler)
+        return;
+
+    FrameProfiler::SetActive(nullptr);
+    if (m_pProfiler->IsInFrame())
+        m_pProfiler->EndFrame();
+
+    // Wait for the GPU so that the last frames are included in the trace
+    for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
+        m_pDeviceContexts[q]->WaitForIdle();
+    m_pProfiler->ResolvePendingFrames();
+
+    if (m_pProfiler->WriteChromeTrace(m_ProfilingInfo.OutputPath.c_str()))
+    {
+        LOG_INFO_MESSAGE("Profiler trace of ", std::min(m_pProfiler->GetFrameCount(), Uint64{FrameProfiler::DefaultMaxFrames}),
+                         " frames is written to '", m_ProfilingInfo.OutputPath, "'.");
+    }
+
+    m_pProfiler.reset();
+}
+
 void SampleApp::Present()
 {
-    if (!m_pSwapChain)
+    if (!m_pSwapChain || m_bQuitRequested)
         return;
 
+    if (m_pBenchmark)
+        m_pBenchmark->BeginStage(FrameBenchmark::STAGE_PRESENT);
+
     auto* const pCtx = GetImmediateContext();
 
     if (m_pScreenCapture && m_ScreenCaptureInfo.FramesToCapture > 0)
@@ -941,44 +1505,28 @@ void SampleApp::Present()
         }
     }
 
-    m_pSwapChain->Present(m_bVSync ? 1 : 0);
+    {
+        DILIGENT_PROFILE_SCOPE("Present");
+        m_pSwapChain->Present(m_bVSync ? 1 : 0);
+    }
 
     if (m_pScreenCapture)
     {
-        while (auto Capture = m_pScreenCapture->GetCapture())
-        {
-            std::string FileName;
-            {
-                std::stringstream FileNameSS;
-                if (!m_ScreenCaptureInfo.Directory.empty())
-                {
-                    FileNameSS << m_ScreenCaptureInfo.Directory;
-                    if (m_ScreenCaptureInfo.Directory.back() != '/')
-                        FileNameSS << '/';
-                }
-                FileNameSS << m_ScreenCaptureInfo.FileName;
-                if (m_GoldenImgMode == GoldenImageMode::None)
-                {
-                    FileNameSS << std::setw(3) << std::setfill('0') << Capture.Id;
-                }
-                FileNameSS << (m_ScreenCaptureInfo.FileFormat == IMAGE_FILE_FORMAT_JPEG ? ".jpg" : ".png");
-                FileName = FileNameSS.str();
-            }
+        // Recycle the staging textures of the captures that have been written
+        ProcessCompletedScreenCaptures(false);
 
-            if (m_GoldenImgMode == GoldenImageMode::Compare || m_GoldenImgMode == GoldenImageMode::CompareUpdate)
-            {
-                CompareGoldenImage(FileName, Capture);
-            }
+        ProcessScreenCaptures();
+    }
 
-            if (m_GoldenImgMode == GoldenImageMode::None ||
-                m_GoldenImgMode == GoldenImageMode::Capture ||
-                m_GoldenImgMode == GoldenImageMode::CompareUpdate)
-            {
-                SaveScreenCapture(FileName, Capture);
-            }
+    if (m_pProfiler && m_pProfiler->IsInFrame())
+        m_pProfiler->EndFrame();
 
-            m_pScreenCapture->RecycleStagingTexture(std::move(Capture.pTexture));
-        }
+    if (m_pBenchmark)
+    {
+        m_pBenchmark->EndStage(FrameBenchmark::STAGE_PRESENT);
+        m_pBenchmark->EndFrame();
+        if (m_pBenchmark->IsComplete())
+            FinishBenchmark();
     }
 }
 
@@ -0,0 +1,149 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ScreenCaptureWriter.hpp"
+
+#include <algorithm>
+
+#include "Errors.hpp"
+#include "FileWrapper.hpp"
+#include "DataBlob.h"
+
+namespace Diligent
+{
+
+ScreenCaptureWriter::ScreenCaptureWriter(Uint32 NumThreads, Uint32 MaxJobsInFlight) :
+    m_MaxJobsInFlight{std::max(MaxJobsInFlight, 1u)}
+{
+    VERIFY_EXPR(NumThreads > 0);
+    m_WorkerThreads.reserve(NumThreads);
+    for (Uint32 i = 0; i < NumThreads; ++i)
+        m_WorkerThreads.emplace_back(&ScreenCaptureWriter::WorkerThreadProc, this);
+}
+
+ScreenCaptureWriter::~ScreenCaptureWriter()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        // Jobs reference mapped memory that is about to be unmapped
+        VERIFY(m_NumJobsInFlight == 0 && m_CompletedJobs.empty(), "All jobs must be completed and retrieved before the writer is destroyed");
+        m_Stop = true;
+    }
+    m_JobQueueCondVar.notify_all();
+
+    for (auto& Thread : m_WorkerThreads)
+        Thread.join();
+}
+
+bool ScreenCaptureWriter::CanSubmit()
+{
+    std::lock_guard<std::mutex> Lock{m_Mtx};
+    return m_NumJobsInFlight < m_MaxJobsInFlight;
+}
+
+void ScreenCaptureWriter::Submit(Job&& NewJob)
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        VERIFY(m_NumJobsInFlight < m_MaxJobsInFlight, "Too many jobs in flight. Wait for completed jobs first.");
+        m_JobQueue.emplace_back(std::move(NewJob));
+        ++m_NumJobsInFlight;
+    }
+    m_JobQueueCondVar.notify_one();
+}
+
+std::vector<ScreenCaptureWriter::Job> ScreenCaptureWriter::GetCompletedJobs(bool Wait)
+{
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    if (Wait)
+    {
+        m_JobCompleteCondVar.wait(Lock, [this] {
+            return !m_CompletedJobs.empty() || m_NumJobsInFlight == 0;
+        });
+    }
+
+    std::vector<Job> CompletedJobs;
+    std::swap(CompletedJobs, m_CompletedJobs);
+    return CompletedJobs;
+}
+
+Uint32 ScreenCaptureWriter::GetNumJobsInFlight()
+{
+    std::lock_guard<std::mutex> Lock{m_Mtx};
+    return m_NumJobsInFlight;
+}
+
+void ScreenCaptureWriter::WorkerThreadProc()
+{
+    while (true)
+    {
+        Job CurrJob;
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_JobQueueCondVar.wait(Lock, [this] {
+                return m_Stop || !m_JobQueue.empty();
+            });
+            if (m_JobQueue.empty())
+                return;
+
+            CurrJob = std::move(m_JobQueue.front());
+            m_JobQueue.pop_front();
+        }
+
+        if (CurrJob.pStream != nullptr)
+        {
+            CurrJob.Succeeded = CurrJob.pStream->WriteFrame(CurrJob.EncodeInfo);
+        }
+        else
+        {
+            RefCntAutoPtr<IDataBlob> pEncodedImage;
+            Image::Encode(CurrJob.EncodeInfo, &pEncodedImage);
+
+            FileWrapper pFile(CurrJob.FileName.c_str(), EFileAccessMode::Overwrite);
+            if (pFile)
+            {
+                CurrJob.Succeeded = pEncodedImage && pFile->Write(pEncodedImage->GetDataPtr(), pEncodedImage->GetSize());
+                if (!CurrJob.Succeeded)
+                    LOG_ERROR_MESSAGE("Failed to write screen capture file '", CurrJob.FileName, "'.");
+                pFile.Close();
+            }
+            else
+            {
+                LOG_ERROR_MESSAGE("Failed to create screen capture file '", CurrJob.FileName, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_CompletedJobs.emplace_back(std::move(CurrJob));
+            --m_NumJobsInFlight;
+        }
+        m_JobCompleteCondVar.notify_all();
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,235 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "TaskScheduler.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+inline Uint64 PackRange(Uint32 Begin, Uint32 End)
+{
+    return (Uint64{End} << 32u) | Uint64{Begin};
+}
+
+inline Uint32 GetRangeBegin(Uint64 Range)
+{
+    return static_cast<Uint32>(Range & 0xFFFFFFFFu);
+}
+
+inline Uint32 GetRangeEnd(Uint64 Range)
+{
+    return static_cast<Uint32>(Range >> 32u);
+}
+
+} // namespace
+
+TaskScheduler::TaskScheduler(Uint32 NumWorkerThreads) :
+    m_Ranges{new TaskRange[NumWorkerThreads + 1]}
+{
+    m_WorkerThreads.reserve(NumWorkerThreads);
+    for (Uint32 t = 0; t < NumWorkerThreads; ++t)
+        m_WorkerThreads.emplace_back(&TaskScheduler::WorkerThreadProc, this, t + 1);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        m_Stop = true;
+    }
+    m_WakeUpCondVar.notify_all();
+
+    for (auto& Thread : m_WorkerThreads)
+        Thread.join();
+}
+
+void TaskScheduler::ParallelFor(Uint32 NumTasks, const TaskFunc& Task, const ThreadFunc& OnThreadFinished)
+{
+    VERIFY_EXPR(Task);
+
+    // Distribute the tasks evenly between all threads. Stealing will take care of the imbalance.
+    const auto NumThreads = GetNumThreads();
+    for (Uint32 t = 0; t < NumThreads; ++t)
+    {
+        const auto Begin = static_cast<Uint32>(Uint64{NumTasks} * t / NumThreads);
+        const auto End   = static_cast<Uint32>(Uint64{NumTasks} * (t + 1) / NumThreads);
+        m_Ranges[t].Range.store(PackRange(Begin, End), std::memory_order_relaxed);
+    }
+
+    m_pTask             = &Task;
+    m_pOnThreadFinished = OnThreadFinished ? &OnThreadFinished : nullptr;
+    m_pEachThreadFunc   = nullptr;
+
+    Dispatch();
+}
+
+void TaskScheduler::RunOnEachThread(const ThreadFunc& Func)
+{
+    VERIFY_EXPR(Func);
+
+    m_pTask             = nullptr;
+    m_pOnThreadFinished = nullptr;
+    m_pEachThreadFunc   = &Func;
+
+    Dispatch();
+}
+
+void TaskScheduler::Dispatch()
+{
+    if (!m_WorkerThreads.empty())
+    {
+        {
+            // Releasing the mutex makes the job description and the task ranges visible to the workers
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_NumThreadsRunning = GetNumWorkerThreads();
+            ++m_JobId;
+        }
+        m_WakeUpCondVar.notify_all();
+    }
+
+    ExecuteJob(0);
+
+    if (!m_WorkerThreads.empty())
+    {
+        std::unique_lock<std::mutex> Lock{m_Mtx};
+        m_JobDoneCondVar.wait(Lock, [this] { return m_NumThreadsRunning == 0; });
+    }
+
+    m_pTask             = nullptr;
+    m_pOnThreadFinished = nullptr;
+    m_pEachThreadFunc   = nullptr;
+}
+
+void TaskScheduler::WorkerThreadProc(Uint32 ThreadId)
+{
+    Uint64 LastJobId = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_WakeUpCondVar.wait(Lock, [&] { return m_Stop || m_JobId != LastJobId; });
+            if (m_Stop)
+                return;
+            LastJobId = m_JobId;
+        }
+
+        ExecuteJob(ThreadId);
+
+        bool AllDone = false;
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            VERIFY_EXPR(m_NumThreadsRunning > 0);
+            AllDone = --m_NumThreadsRunning == 0;
+        }
+        if (AllDone)
+            m_JobDoneCondVar.notify_one();
+    }
+}
+
+void TaskScheduler::ExecuteJob(Uint32 ThreadId)
+{
+    if (m_pEachThreadFunc != nullptr)
+    {
+        (*m_pEachThreadFunc)(ThreadId);
+        return;
+    }
+
+    VERIFY_EXPR(m_pTask != nullptr);
+    for (;;)
+    {
+        Uint32 TaskId = 0;
+        while (PopTask(ThreadId, TaskId))
+            (*m_pTask)(ThreadId, TaskId);
+
+        // Note that a thread may fail to find any tasks while some other thread is
+        // in the middle of moving stolen tasks into its own range. This is fine since
+        // that thread will execute these tasks itself.
+        if (!StealTasks(ThreadId))
+            break;
+    }
+
+    if (m_pOnThreadFinished != nullptr)
+        (*m_pOnThreadFinished)(ThreadId);
+}
+
+bool TaskScheduler::PopTask(Uint32 ThreadId, Uint32& TaskId)
+{
+    auto& Range = m_Ranges[ThreadId].Range;
+
+    auto CurrRange = Range.load(std::memory_order_acquire);
+    for (;;)
+    {
+        const auto Begin = GetRangeBegin(CurrRange);
+        const auto End   = GetRangeEnd(CurrRange);
+        if (Begin >= End)
+            return false;
+
+        // Thieves may modify the range concurrently, so we have to use CAS even for our own range
+        if (Range.compare_exchange_weak(CurrRange, PackRange(Begin + 1, End), std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            TaskId = Begin;
+            return true;
+        }
+    }
+}
+
+bool TaskScheduler::StealTasks(Uint32 ThreadId)
+{
+    const auto NumThreads = GetNumThreads();
+    for (Uint32 i = 1; i < NumThreads; ++i)
+    {
+        const auto VictimId = (ThreadId + i) % NumThreads;
+        auto&      Range    = m_Ranges[VictimId].Range;
+
+        auto CurrRange = Range.load(std::memory_order_acquire);
+        for (;;)
+        {
+            const auto Begin = GetRangeBegin(CurrRange);
+            const auto End   = GetRangeEnd(CurrRange);
+            if (Begin >= End)
+                break;
+
+            // Steal the back half of the victim's range
+            const auto NumToSteal = (End - Begin + 1) / 2;
+            const auto NewEnd     = End - NumToSteal;
+            if (Range.compare_exchange_weak(CurrRange, PackRange(Begin, NewEnd), std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                // Our own range is empty at this point, so nobody else can modify it
+                m_Ranges[ThreadId].Range.store(PackRange(NewEnd, End), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+} // namespace Diligent
@@ -0,0 +1,235 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "VideoCaptureStream.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// BT.601 limited range conversion in 8-bit fixed point
+inline Uint8 RGBToY(int R, int G, int B)
+{
+    return static_cast<Uint8>(((66 * R + 129 * G + 25 * B + 128) >> 8) + 16);
+}
+
+inline Uint8 RGBToU(int R, int G, int B)
+{
+    return static_cast<Uint8>(((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128);
+}
+
+inline Uint8 RGBToV(int R, int G, int B)
+{
+    return static_cast<Uint8>(((112 * R - 94 * G - 18 * B + 128) >> 8) + 128);
+}
+
+} // namespace
+
+const char* VideoCaptureStream::GetFileExtension(FORMAT Format)
+{
+    switch (Format)
+    {
+        case FORMAT_Y4M: return "y4m";
+        case FORMAT_RAW_RGBA: return "rgba";
+        default:
+            UNEXPECTED("Unexpected stream format");
+            return "";
+    }
+}
+
+VideoCaptureStream::VideoCaptureStream(const char* Path, FORMAT Format, double FPS) :
+    m_Path{Path},
+    m_Format{Format},
+    m_FPS{FPS},
+    // Opening a FIFO blocks until the reader opens the other end
+    m_File{Path, EFileAccessMode::Overwrite}
+{
+    if (!m_File)
+    {
+        LOG_ERROR_MESSAGE("Failed to open capture stream '", m_Path, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
+    }
+}
+
+bool VideoCaptureStream::WriteFrame(const Image::EncodeInfo& Frame)
+{
+    if (!m_File)
+        return false;
+
+    if (m_NumFramesWritten == 0)
+    {
+        m_Width  = Frame.Width;
+        m_Height = Frame.Height;
+
+        if (m_Format == FORMAT_Y4M)
+        {
+            // Frame rate is written as a fraction with millisecond precision
+            std::stringstream HeaderSS;
+            HeaderSS << "YUV4MPEG2 W" << m_Width << " H" << m_Height
+                     << " F" << static_cast<Uint32>(std::round(m_FPS * 1000)) << ":1000"
+                     << " Ip A1:1 C420jpeg\n";
+            const auto Header = HeaderSS.str();
+            if (!m_File->Write(Header.data(), Header.size()))
+            {
+                LOG_ERROR_MESSAGE("Failed to write Y4M header to capture stream '", m_Path, "'.");
+                return false;
+            }
+        }
+        else
+        {
+            LOG_INFO_MESSAGE("Writing raw RGBA ", m_Width, "x", m_Height, " frames to '", m_Path, "'.");
+        }
+    }
+    else if (Frame.Width != m_Width || Frame.Height != m_Height)
+    {
+        LOG_ERROR_MESSAGE("Frame size (", Frame.Width, "x", Frame.Height, ") does not match the stream size (", m_Width, "x", m_Height,
+                          "). Capture streams do not support resizing; the frame is skipped.");
+        return false;
+    }
+
+    bool Result = false;
+    switch (Frame.TexFormat)
+    {
+        case TEX_FORMAT_RGBA8_UNORM:
+        case TEX_FORMAT_RGBA8_UNORM_SRGB:
+        case TEX_FORMAT_BGRA8_UNORM:
+        case TEX_FORMAT_BGRA8_UNORM_SRGB:
+        {
+            const auto* pPixels = static_cast<const Uint8*>(Frame.pData);
+            const bool  BGR     = Frame.TexFormat == TEX_FORMAT_BGRA8_UNORM || Frame.TexFormat == TEX_FORMAT_BGRA8_UNORM_SRGB;
+            Result              = m_Format == FORMAT_Y4M ? WriteY4MFrame(pPixels, Frame.Stride, BGR) : WriteRawFrame(pPixels, Frame.Stride, BGR);
+            break;
+        }
+
+        default:
+            m_ConvertedPixels = Image::ConvertImageData(Frame.Width, Frame.Height, static_cast<const Uint8*>(Frame.pData), Frame.Stride,
+                                                        Frame.TexFormat, TEX_FORMAT_RGBA8_UNORM, true /*Keep alpha*/);
+            Result = m_Format == FORMAT_Y4M ? WriteY4MFrame(m_ConvertedPixels.data(), Frame.Width * 4, false) : WriteRawFrame(m_ConvertedPixels.data(), Frame.Width * 4, false);
+    }
+
+    if (Result)
+        ++m_NumFramesWritten;
+    else
+        LOG_ERROR_MESSAGE("Failed to write frame ", m_NumFramesWritten, " to capture stream '", m_Path, "'.");
+
+    return Result;
+}
+
+bool VideoCaptureStream::WriteY4MFrame(const Uint8* pRGBA, Uint32 Stride, bool BGR)
+{
+    static constexpr char FrameHeader[] = "FRAME\n";
+
+    const auto ChromaWidth  = (m_Width + 1) / 2;
+    const auto ChromaHeight = (m_Height + 1) / 2;
+    const auto LumaSize     = size_t{m_Width} * m_Height;
+    const auto ChromaSize   = size_t{ChromaWidth} * ChromaHeight;
+
+    m_FrameData.resize(sizeof(FrameHeader) - 1 + LumaSize + ChromaSize * 2);
+    memcpy(m_FrameData.data(), FrameHeader, sizeof(FrameHeader) - 1);
+
+    auto* pY = m_FrameData.data() + sizeof(FrameHeader) - 1;
+    auto* pU = pY + LumaSize;
+    auto* pV = pU + ChromaSize;
+
+    const auto R = BGR ? 2 : 0;
+    const auto B = BGR ? 0 : 2;
+    for (Uint32 cy = 0; cy < ChromaHeight; ++cy)
+    {
+        // Odd sizes replicate the last row/column
+        const Uint32 Rows[2] = {cy * 2, std::min(cy * 2 + 1, m_Height - 1)};
+        for (Uint32 cx = 0; cx < ChromaWidth; ++cx)
+        {
+            const Uint32 Cols[2] = {cx * 2, std::min(cx * 2 + 1, m_Width - 1)};
+
+            int SumR = 0, SumG = 0, SumB = 0;
+            for (Uint32 j = 0; j < 2; ++j)
+            {
+                for (Uint32 i = 0; i < 2; ++i)
+                {
+                    const auto* pPixel = pRGBA + size_t{Rows[j]} * Stride + Cols[i] * 4;
+                    const int   PixR   = pPixel[R];
+                    const int   PixG   = pPixel[1];
+                    const int   PixB   = pPixel[B];
+
+                    pY[size_t{Rows[j]} * m_Width + Cols[i]] = RGBToY(PixR, PixG, PixB);
+
+                    SumR += PixR;
+                    SumG += PixG;
+                    SumB += PixB;
+                }
+            }
+
+            pU[size_t{cy} * ChromaWidth + cx] = RGBToU((SumR + 2) / 4, (SumG + 2) / 4, (SumB + 2) / 4);
+            pV[size_t{cy} * ChromaWidth + cx] = RGBToV((SumR + 2) / 4, (SumG + 2) / 4, (SumB + 2) / 4);
+        }
+    }
+
+    return m_File->Write(m_FrameData.data(), m_FrameData.size());
+}
+
+bool VideoCaptureStream::WriteRawFrame(const Uint8* pRGBA, Uint32 Stride, bool BGR)
+{
+    const auto RowSize = size_t{m_Width} * 4;
+    if (!BGR && Stride == RowSize)
+    {
+        // The frame can be written as is
+        return m_File->Write(pRGBA, RowSize * m_Height);
+    }
+
+    m_FrameData.resize(RowSize * m_Height);
+    for (Uint32 y = 0; y < m_Height; ++y)
+    {
+        const auto* pSrcRow = pRGBA + size_t{y} * Stride;
+        auto*       pDstRow = &m_FrameData[y * RowSize];
+        if (BGR)
+        {
+            for (Uint32 x = 0; x < m_Width; ++x)
+            {
+                pDstRow[x * 4 + 0] = pSrcRow[x * 4 + 2];
+                pDstRow[x * 4 + 1] = pSrcRow[x * 4 + 1];
+                pDstRow[x * 4 + 2] = pSrcRow[x * 4 + 0];
+                pDstRow[x * 4 + 3] = pSrcRow[x * 4 + 3];
+            }
+        }
+        else
+        {
+            memcpy(pDstRow, pSrcRow, RowSize);
+        }
+    }
+
+    return m_File->Write(m_FrameData.data(), m_FrameData.size());
+}
+
+} // namespace Diligent
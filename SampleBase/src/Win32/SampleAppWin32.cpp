@@ -184,6 +184,10 @@ public:
     {
         m_hWnd = hWnd;
 
+        // The headless run has already finished and WM_QUIT is pending
+        if (IsQuitRequested())
+            return;
+
         try
         {
             Win32NativeWindow Window{hWnd};
@@ -276,6 +280,13 @@ protected:
         SampleApp::SetWindowedMode();
     }
 
+    virtual void RequestQuit() override final
+    {
+        SampleApp::RequestQuit();
+        // The message loop exits when it retrieves WM_QUIT
+        PostQuitMessage(m_ExitCode);
+    }
+
     virtual void SelectDeviceType() override final
     {
         DialogBox(NULL, MAKEINTRESOURCE(IDD_DEVICE_TYPE_SELECTION_DIALOG), NULL, SelectDeviceTypeDialogProc);
@@ -21,6 +21,7 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <thread>
 
 #include "asteroids_d3d11.h"
 #include "asteroids_d3d12.h"
@@ -187,6 +188,10 @@ LRESULT CALLBACK WindowProc(
                 gSettings.executeIndirect = !gSettings.executeIndirect;
                 std::cout << "ExecuteIndirect Rendering: " << gSettings.executeIndirect << std::endl;
                 return 0;
+            case 'C':
+                gSettings.frustumCulling = !gSettings.frustumCulling;
+                std::cout << "Frustum Culling: " << gSettings.frustumCulling << std::endl;
+                return 0;
             case 'S':
                 gSettings.submitRendering = !gSettings.submitRendering;
                 std::cout << "Submit Rendering: " << gSettings.submitRendering << std::endl;
@@ -409,6 +414,10 @@ int main(int argc, char** argv)
             gSettings.lockedFrameRate = atoi(argv[++a]);
         } else if (_stricmp(argv[a], "-threads") == 0 && a + 1 < argc) {
             gSettings.numThreads = atoi(argv[++a]);
+        } else if (_stricmp(argv[a], "-cache") == 0 && a + 1 < argc) {
+            gSettings.cacheFile = argv[++a];
+        } else if (_stricmp(argv[a], "-nocache") == 0) {
+            gSettings.cacheFile = nullptr;
         } else if (_stricmp(argv[a], "-d3d11") == 0) {
             gSettings.mode = Settings::RenderMode::DiligentD3D11;
         } else if (_stricmp(argv[a], "-d3d12") == 0) {
@@ -427,6 +436,8 @@ int main(int argc, char** argv)
             fprintf(stderr, "  -render_scale [scale]\n");
             fprintf(stderr, "  -locked_fps [fps]\n");
             fprintf(stderr, "  -warp\n");
+            fprintf(stderr, "  -cache [file]\n");
+            fprintf(stderr, "  -nocache\n");
             return -1;
         }
     }
@@ -450,7 +461,7 @@ int main(int argc, char** argv)
     ResetCameraView();
     // Camera projection set up in WM_SIZE
 
-    AsteroidsSimulation asteroids(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES);
+    AsteroidsSimulation asteroids(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES, gSettings.cacheFile);
 
     if (gSettings.mode == Settings::RenderMode::Undefined)
     {
@@ -215,11 +215,9 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         m_BindingMode = BindingMode::TextureMutable;
 
     mCmdLists.resize(mDeferredCtxt.size());
-    mWorkerThreads.resize(mNumSubsets - 1);
-    for (auto& thread : mWorkerThreads)
-    {
-        thread = std::thread(WorkerThreadFunc, this, (Uint32)(&thread - mWorkerThreads.data()));
-    }
+    mContextReady.resize(mDeferredCtxt.size() + 1);
+    if (!mDeferredCtxt.empty())
+        mScheduler.reset(new TaskScheduler{static_cast<Uint32>(mDeferredCtxt.size())});
 
     const char* spriteFile = nullptr;
     switch (DevType)
@@ -649,12 +647,7 @@ Asteroids::~Asteroids()
     mDeviceCtxt->Flush();
     mDeviceCtxt->FinishFrame();
 
-    mUpdateSubsetsSignal.Trigger(true, -1);
-
-    for (auto& thread : mWorkerThreads)
-    {
-        thread.join();
-    }
+    mScheduler.reset();
 }
 
 
@@ -744,7 +737,7 @@ void Asteroids::InitializeTextureData()
     textureDesc.Type        = RESOURCE_DIM_TEX_2D_ARRAY;
     textureDesc.Width       = TEXTURE_DIM;
     textureDesc.Height      = TEXTURE_DIM;
-    textureDesc.ArraySize   = 3;
+    textureDesc.ArraySize   = TEXTURE_ARRAY_SIZE;
     textureDesc.MipLevels   = 0; // Full chain
     textureDesc.Format      = TEX_FORMAT_RGBA8_UNORM_SRGB;
     textureDesc.SampleCount = 1;
@@ -819,36 +812,22 @@ void Asteroids::CreateGUIResources()
 
 static_assert(sizeof(IndexType) == 2, "Expecting 16-bit index buffer");
 
-void Asteroids::WorkerThreadFunc(Asteroids* pThis, Uint32 ThreadNum)
+void Asteroids::PrepareContext(IDeviceContext* pCtx)
 {
-    for (;;)
-    {
-        // Wait for UpdateSubsets signal
-        auto SignalledValue = pThis->mUpdateSubsetsSignal.Wait();
-        if (SignalledValue < 0)
-            return;
-
-        auto  SubsetSize   = NUM_ASTEROIDS / pThis->mNumSubsets;
-        auto  SubsetStart  = SubsetSize * (ThreadNum + 1);
-        auto& FrameAttribs = pThis->mFrameAttribs;
-
-        pThis->mAsteroids->Update(FrameAttribs.frameTime, FrameAttribs.camera->Eye(), *FrameAttribs.settings, SubsetStart, SubsetSize);
-
-        // Increment number of completed threads
-        ++pThis->m_NumThreadsCompleted;
-
-
-        // Wait for RenderSubsets signal
-        pThis->mRenderSubsetsSignal.Wait();
+    if (pCtx->GetDesc().IsDeferred)
+        pCtx->Begin(0);
 
-        pThis->RenderSubset(1 + ThreadNum, pThis->mDeferredCtxt[ThreadNum], *FrameAttribs.camera, SubsetStart, SubsetSize);
+    auto* pRTV = mSwapChain->GetCurrentBackBufferRTV();
+    auto* pDSV = mSwapChain->GetDepthBufferDSV();
+    pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pThis->mCmdLists[ThreadNum].Release();
-        pThis->mDeferredCtxt[ThreadNum]->FinishCommandList(&pThis->mCmdLists[ThreadNum]);
+    pCtx->SetPipelineState(mAsteroidsPSO);
 
-        // Increment number of completed threads
-        ++pThis->m_NumThreadsCompleted;
+    {
+        IBuffer* ia_buffers[] = {mVertexBuffer, mInstanceIDBuffer};
+        // Bind instance data buffer in bindless mode
+        pCtx->SetVertexBuffers(0, (m_BindingMode == BindingMode::Bindless) ? 2 : 1, ia_buffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_NONE);
+        pCtx->SetIndexBuffer(mIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 }
 
@@ -858,25 +837,14 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
                              Uint32             startIdx,
                              Uint32             numAsteroids)
 {
-    if (pCtx->GetDesc().IsDeferred)
-        pCtx->Begin(0);
-
-    auto* pRTV = mSwapChain->GetCurrentBackBufferRTV();
-    auto* pDSV = mSwapChain->GetDepthBufferDSV();
-    pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+    if (numAsteroids == 0)
+        return;
 
     // Frame data
     auto staticAsteroidData  = mAsteroids->StaticData();
     auto dynamicAsteroidData = mAsteroids->DynamicData();
-
-    pCtx->SetPipelineState(mAsteroidsPSO);
-
-    {
-        IBuffer* ia_buffers[] = {mVertexBuffer, mInstanceIDBuffer};
-        // Bind instance data buffer in bindless mode
-        pCtx->SetVertexBuffers(0, (m_BindingMode == BindingMode::Bindless) ? 2 : 1, ia_buffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_NONE);
-        pCtx->SetIndexBuffer(mIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-    }
+    // startIdx and numAsteroids define the range in the list of visible asteroids
+    auto visibleAsteroids = mAsteroids->VisibleAsteroids();
 
     if (m_BindingMode == BindingMode::Bindless)
     {
@@ -886,10 +854,11 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
             UINT                    i = 0;
             for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx, ++i)
             {
-                const auto staticData  = &staticAsteroidData[drawIdx];
-                const auto dynamicData = &dynamicAsteroidData[drawIdx];
+                const auto asteroidIdx = visibleAsteroids[drawIdx];
+                const auto staticData  = &staticAsteroidData[asteroidIdx];
+                const auto dynamicData = &dynamicAsteroidData[asteroidIdx];
 
-                XMStoreFloat4x4(&asteroidData[i].mWorld, dynamicData->world);
+                StoreWorldMatrix(&asteroidData[i].mWorld, *dynamicData);
                 asteroidData[i].mSurfaceColor = staticData->surfaceColor;
                 asteroidData[i].mDeepColor    = staticData->deepColor;
                 asteroidData[i].mTextureIndex = staticData->textureIndex;
@@ -907,13 +876,14 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
     auto        pVar           = m_BindingMode == BindingMode::Dynamic ? mAsteroidsSRBs[SubsetNum]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex") : nullptr;
     for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx)
     {
-        const auto staticData  = &staticAsteroidData[drawIdx];
-        const auto dynamicData = &dynamicAsteroidData[drawIdx];
+        const auto asteroidIdx = visibleAsteroids[drawIdx];
+        const auto staticData  = &staticAsteroidData[asteroidIdx];
+        const auto dynamicData = &dynamicAsteroidData[asteroidIdx];
 
         if (m_BindingMode != BindingMode::Bindless)
         {
             MapHelper<DrawConstantBuffer> drawConstants(pCtx, mDrawConstantBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-            XMStoreFloat4x4(&drawConstants->mWorld, dynamicData->world);
+            StoreWorldMatrix(&drawConstants->mWorld, *dynamicData);
             XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
             drawConstants->mSurfaceColor = staticData->surfaceColor;
             drawConstants->mDeepColor    = staticData->deepColor;
@@ -927,7 +897,7 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
         }
         else if (m_BindingMode == BindingMode::Mutable)
         {
-            pCtx->CommitShaderResources(mAsteroidsSRBs[drawIdx], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            pCtx->CommitShaderResources(mAsteroidsSRBs[asteroidIdx], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
         }
         else if (m_BindingMode == BindingMode::TextureMutable)
         {
@@ -952,10 +922,6 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
 
 void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Settings& settings)
 {
-    mFrameAttribs.frameTime = frameTime;
-    mFrameAttribs.camera    = &camera;
-    mFrameAttribs.settings  = &settings;
-
     // Clear the render target
     float clearcol[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     auto* pRTV        = mSwapChain->GetCurrentBackBufferRTV();
@@ -968,8 +934,6 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
     mUpdateTicks = currCounter;
 
-    auto SubsetSize = NUM_ASTEROIDS / mNumSubsets;
-
     if (m_BindingMode == BindingMode::Bindless)
     {
         // Write view-projection matrix into the buffer
@@ -980,52 +944,60 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         mDeviceCtxt->TransitionResourceStates(1, &Barrier);
     }
 
-    if (settings.multithreadedRendering)
+    mAsteroids->SetViewFrustum(camera.ViewProjection(), settings.frustumCulling);
+
+    const bool multithreaded = settings.multithreadedRendering && mScheduler;
+    if (multithreaded)
     {
-        m_NumThreadsCompleted = 0;
-        mUpdateSubsetsSignal.Trigger(true);
+        // The simulation splits the update into small chunks that the threads steal from each other
+        mAsteroids->Update(frameTime, camera.Eye(), settings, *mScheduler);
     }
-
-    // Update all subsets in this thread when multithreadedRendering is false
-    for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        mAsteroids->Update(frameTime, camera.Eye(), settings, SubsetSize * i, SubsetSize);
-
-    if (settings.multithreadedRendering)
+    else
     {
-        // Wait for worker threads to finish
-        while (m_NumThreadsCompleted < (int)mNumSubsets - 1)
-            std::this_thread::yield();
-        // Reset mUpdateSubsetsSignal while all threads are waiting for mRenderSubsetsSignal
-        mUpdateSubsetsSignal.Reset();
+        // Update all asteroids in this thread when multithreadedRendering is false
+        mAsteroids->Update(frameTime, camera.Eye(), settings);
+        mAsteroids->BuildDrawLists();
     }
 
+    // Only visible asteroids are rendered. They are sorted by LOD, and every subset gets an equal share.
+    const auto NumVisible  = static_cast<Uint32>(mAsteroids->GetVisibleAsteroidCount());
+    const auto SubsetSize  = (NumVisible + mNumSubsets - 1) / mNumSubsets;
+    const auto SubsetStart = [&](Uint32 subset) { return std::min(SubsetSize * subset, NumVisible); };
+    const auto SubsetCount = [&](Uint32 subset) { return SubsetStart(subset + 1) - SubsetStart(subset); };
+
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
     mUpdateTicks = currCounter - mUpdateTicks;
 
     mRenderTicks = currCounter;
 
-    if (settings.multithreadedRendering)
+    if (multithreaded)
     {
-        // Signal RenderSubsets
-        m_NumThreadsCompleted = 0;
-        mRenderSubsetsSignal.Trigger(true);
-    }
-
-    // Render all subsets in this thread when multithreadedRendering is false
-    for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        RenderSubset(i, mDeviceCtxt, camera, SubsetSize * i, SubsetSize);
-
-    if (settings.multithreadedRendering)
-    {
-        // Wait for worker threads to finish
-        while (m_NumThreadsCompleted < (int)mNumSubsets - 1)
-            std::this_thread::yield();
-        // Reset mRenderSubsetsSignal while all threads are waiting for mUpdateSubsetsSignal
-        mRenderSubsetsSignal.Reset();
-
-        mCmdListPtrs.resize(mCmdLists.size());
-        for (size_t i = 0; i < mCmdLists.size(); ++i)
-            mCmdListPtrs[i] = mCmdLists[i];
+        std::fill(mContextReady.begin(), mContextReady.end(), Uint8{0});
+
+        // Every subset has its own SRB and data buffer, so one subset must be rendered by one thread.
+        // A thread records all subsets it picks up into the same context.
+        mScheduler->ParallelFor(
+            mNumSubsets,
+            [&](Uint32 threadId, Uint32 subset) {
+                IDeviceContext* pCtx = threadId == 0 ? mDeviceCtxt.RawPtr() : mDeferredCtxt[threadId - 1].RawPtr();
+                if (!mContextReady[threadId])
+                {
+                    PrepareContext(pCtx);
+                    mContextReady[threadId] = 1;
+                }
+                RenderSubset(subset, pCtx, camera, SubsetStart(subset), SubsetCount(subset));
+            },
+            [&](Uint32 threadId) {
+                if (threadId > 0 && mContextReady[threadId])
+                    mDeferredCtxt[threadId - 1]->FinishCommandList(&mCmdLists[threadId - 1]);
+            });
+
+        mCmdListPtrs.clear();
+        for (auto& cmdList : mCmdLists)
+        {
+            if (cmdList)
+                mCmdListPtrs.push_back(cmdList);
+        }
         mDeviceCtxt->ExecuteCommandLists(static_cast<Uint32>(mCmdListPtrs.size()), mCmdListPtrs.data());
 
         for (auto& cmdList : mCmdLists)
@@ -1036,6 +1008,13 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
             cmdList.Release();
         }
     }
+    else
+    {
+        // Render all subsets in this thread when multithreadedRendering is false
+        PrepareContext(mDeviceCtxt);
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+            RenderSubset(i, mDeviceCtxt, camera, SubsetStart(i), SubsetCount(i));
+    }
 
     // Call FinishFrame() to release dynamic resources allocated by deferred contexts
     // IMPORTANT: we must wait until the command lists are submitted for execution
@@ -14,10 +14,9 @@
 #include "SwapChain.h"
 #include "DeviceContext.h"
 #include "RefCntAutoPtr.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
 #include <map>
-#include <mutex>
-#include <atomic>
+#include <memory>
 
 #include "camera.h"
 #include "settings.h"
@@ -43,6 +42,7 @@ private:
     void CreateMeshes();
     void InitializeTextureData();
     void CreateGUIResources();
+    void PrepareContext(Diligent::IDeviceContext *pCtx);
     void RenderSubset(Diligent::Uint32 SubsetNum, Diligent::IDeviceContext *pCtx, const OrbitCamera& camera, Diligent::Uint32 startIdx, Diligent::Uint32 numAsteroids);
     void InitDevice(HWND hWnd, Diligent::RENDER_DEVICE_TYPE DevType);
 
@@ -66,21 +66,10 @@ private:
     
     Diligent::Uint32 mBackBufferWidth, mBackBufferHeight;
     Diligent::Uint32 mNumSubsets = 0;
-    std::vector<std::thread> mWorkerThreads;
-    
-    std::mutex mMutex;
-    std::condition_variable mCondVar;
-    ThreadingTools::Signal mUpdateSubsetsSignal;
-    ThreadingTools::Signal mRenderSubsetsSignal;
-    std::atomic_int m_NumThreadsCompleted;
-    static void WorkerThreadFunc(Asteroids *pThis, Diligent::Uint32 ThreadNum);
-
-    struct FrameAttribs
-    {
-        float frameTime;
-        const OrbitCamera* camera;
-        const Settings* settings;
-    }mFrameAttribs;
+
+    // Main thread (thread id 0) records into the immediate context, worker thread N into mDeferredCtxt[N-1].
+    std::unique_ptr<Diligent::TaskScheduler> mScheduler;
+    std::vector<Diligent::Uint8> mContextReady;
 
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mIndexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mVertexBuffer;
@@ -0,0 +1,297 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "asteroids_cache.h"
+#include "texture_synthesis.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+
+const char          CacheMagic[8] = {'A', 'S', 'T', 'C', 'A', 'C', 'H', 'E'};
+const std::uint32_t CacheVersion  = 1;
+
+// Sections are aligned so that the mapped data can be read with aligned loads
+const std::uint64_t SectionAlignment = 64;
+
+struct CacheHeader
+{
+    char          magic[8];
+    std::uint32_t version;
+    // Layout of the data, so that a cache written by a different build is rejected
+    std::uint32_t vertexSize;
+    std::uint32_t indexSize;
+    std::uint32_t vertexCountPerMesh;
+
+    AsteroidsCacheKey key;
+
+    std::uint64_t indexOffsetsOffset;
+    std::uint64_t indexOffsetsCount;
+    std::uint64_t verticesOffset;
+    std::uint64_t vertexCount;
+    std::uint64_t indicesOffset;
+    std::uint64_t indexCount;
+    std::uint64_t textureDataOffset;
+    std::uint64_t textureDataSize;
+};
+
+bool operator==(const AsteroidsCacheKey& key0, const AsteroidsCacheKey& key1)
+{
+    // clang-format off
+    return key0.rngSeed           == key1.rngSeed &&
+           key0.meshInstanceCount == key1.meshInstanceCount &&
+           key0.subdivCount       == key1.subdivCount &&
+           key0.textureCount      == key1.textureCount &&
+           key0.textureDim        == key1.textureDim &&
+           key0.textureArraySize  == key1.textureArraySize;
+    // clang-format on
+}
+
+std::uint64_t AlignSection(std::uint64_t offset)
+{
+    return (offset + SectionAlignment - 1) & ~(SectionAlignment - 1);
+}
+
+bool SectionFits(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, size_t fileSize)
+{
+    return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+// The header only guarantees that the sections fit into the file. The data itself is
+// used to index vertex and texture memory, so it is checked before it is trusted.
+bool ContentsAreValid(const CacheHeader& header, const std::uint8_t* data)
+{
+    // Sections are written aligned, so that they can be accessed in place
+    if (header.indexOffsetsOffset % SectionAlignment != 0 ||
+        header.verticesOffset % SectionAlignment != 0 ||
+        header.indicesOffset % SectionAlignment != 0 ||
+        header.textureDataOffset % SectionAlignment != 0)
+        return false;
+
+    const auto& key = header.key;
+    if (header.vertexCountPerMesh == 0 ||
+        header.vertexCount != std::uint64_t{key.meshInstanceCount} * header.vertexCountPerMesh)
+        return false;
+
+    if (header.textureDataSize != AsteroidTextureSet::ComputeDataSize(key.textureCount, key.textureDim, key.textureArraySize))
+        return false;
+
+    // Subdivision levels are stored back to back: offsets start at zero, never decrease and end at the index count
+    const auto* indexOffsets = reinterpret_cast<const unsigned int*>(data + header.indexOffsetsOffset);
+    if (indexOffsets[0] != 0 || indexOffsets[header.indexOffsetsCount - 1] != header.indexCount)
+        return false;
+    for (std::uint64_t i = 1; i < header.indexOffsetsCount; ++i)
+    {
+        if (indexOffsets[i] < indexOffsets[i - 1])
+            return false;
+    }
+
+    // Indices are shared by all mesh instances and must stay within a single instance
+    const auto* indices = reinterpret_cast<const IndexType*>(data + header.indicesOffset);
+    for (std::uint64_t i = 0; i < header.indexCount; ++i)
+    {
+        if (indices[i] >= header.vertexCountPerMesh)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+AsteroidsCache::~AsteroidsCache()
+{
+    Close();
+}
+
+bool AsteroidsCache::Open(const char* path, const AsteroidsCacheKey& key)
+{
+    Close();
+
+#if defined(_WIN32)
+    mFileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mFileHandle == INVALID_HANDLE_VALUE)
+    {
+        mFileHandle = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(mFileHandle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(CacheHeader)))
+    {
+        Close();
+        return false;
+    }
+
+    mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMappingHandle == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    mData = static_cast<const std::uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(CacheHeader)))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    mData = static_cast<const std::uint8_t*>(data);
+    mSize = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    if (mData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, mData, sizeof(header));
+
+    // clang-format off
+    const bool isValid =
+        std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) == 0 &&
+        header.version    == CacheVersion      &&
+        header.vertexSize == sizeof(Vertex)    &&
+        header.indexSize  == sizeof(IndexType) &&
+        header.key        == key               &&
+        header.indexOffsetsCount == key.subdivCount + size_t{2} &&
+        SectionFits(header.indexOffsetsOffset, header.indexOffsetsCount, sizeof(unsigned int), mSize) &&
+        SectionFits(header.verticesOffset,     header.vertexCount,       sizeof(Vertex),       mSize) &&
+        SectionFits(header.indicesOffset,      header.indexCount,        sizeof(IndexType),    mSize) &&
+        SectionFits(header.textureDataOffset,  header.textureDataSize,   1,                    mSize) &&
+        ContentsAreValid(header, mData);
+    // clang-format on
+    if (!isValid)
+    {
+        Close();
+        return false;
+    }
+
+    mContents.meshes.vertices = {reinterpret_cast<const Vertex*>(mData + header.verticesOffset), static_cast<size_t>(header.vertexCount)};
+    mContents.meshes.indices  = {reinterpret_cast<const IndexType*>(mData + header.indicesOffset), static_cast<size_t>(header.indexCount)};
+    mContents.indexOffsets    = reinterpret_cast<const unsigned int*>(mData + header.indexOffsetsOffset);
+    mContents.vertexCountPerMesh = header.vertexCountPerMesh;
+    mContents.textureData        = mData + header.textureDataOffset;
+    mContents.textureDataSize    = static_cast<size_t>(header.textureDataSize);
+
+    return true;
+}
+
+void AsteroidsCache::Close()
+{
+#if defined(_WIN32)
+    if (mData != nullptr)
+        UnmapViewOfFile(mData);
+    if (mMappingHandle != nullptr)
+        CloseHandle(mMappingHandle);
+    if (mFileHandle != nullptr)
+        CloseHandle(mFileHandle);
+    mMappingHandle = nullptr;
+    mFileHandle    = nullptr;
+#else
+    if (mData != nullptr)
+        munmap(const_cast<std::uint8_t*>(mData), mSize);
+#endif
+
+    mData     = nullptr;
+    mSize     = 0;
+    mContents = AsteroidsCacheContents{};
+}
+
+bool AsteroidsCache::Write(const char* path, const AsteroidsCacheKey& key, const AsteroidsCacheContents& contents)
+{
+    CacheHeader header = {};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version            = CacheVersion;
+    header.vertexSize         = sizeof(Vertex);
+    header.indexSize          = sizeof(IndexType);
+    header.vertexCountPerMesh = contents.vertexCountPerMesh;
+    header.key                = key;
+
+    header.indexOffsetsOffset = AlignSection(sizeof(header));
+    header.indexOffsetsCount  = key.subdivCount + size_t{2};
+    header.verticesOffset     = AlignSection(header.indexOffsetsOffset + header.indexOffsetsCount * sizeof(unsigned int));
+    header.vertexCount        = contents.meshes.vertices.size();
+    header.indicesOffset      = AlignSection(header.verticesOffset + header.vertexCount * sizeof(Vertex));
+    header.indexCount         = contents.meshes.indices.size();
+    header.textureDataOffset  = AlignSection(header.indicesOffset + header.indexCount * sizeof(IndexType));
+    header.textureDataSize    = contents.textureDataSize;
+
+    const std::string tempPath = std::string{path} + ".tmp";
+
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    std::uint64_t offset = 0;
+    auto writeSection = [&](std::uint64_t sectionOffset, const void* data, std::uint64_t size) {
+        static const std::uint8_t padding[SectionAlignment] = {};
+        const auto paddingSize = static_cast<size_t>(sectionOffset - offset);
+        offset = sectionOffset + size;
+        return std::fwrite(padding, 1, paddingSize, file) == paddingSize &&
+            std::fwrite(data, 1, static_cast<size_t>(size), file) == size;
+    };
+
+    // clang-format off
+    bool succeeded =
+        writeSection(0,                         &header,                         sizeof(header)) &&
+        writeSection(header.indexOffsetsOffset, contents.indexOffsets,           header.indexOffsetsCount * sizeof(unsigned int)) &&
+        writeSection(header.verticesOffset,     contents.meshes.vertices.data(), header.vertexCount * sizeof(Vertex)) &&
+        writeSection(header.indicesOffset,      contents.meshes.indices.data(),  header.indexCount * sizeof(IndexType)) &&
+        writeSection(header.textureDataOffset,  contents.textureData,            header.textureDataSize);
+    // clang-format on
+    succeeded = (std::fclose(file) == 0) && succeeded;
+
+    if (succeeded)
+    {
+        // Replace the previous cache file, if any
+        std::remove(path);
+        succeeded = std::rename(tempPath.c_str(), path) == 0;
+    }
+    if (!succeeded)
+        std::remove(tempPath.c_str());
+
+    return succeeded;
+}
@@ -0,0 +1,73 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+// On-disk cache of the generated asteroid meshes and textures. The cache file is memory-mapped,
+// and the renderers create their buffers and textures directly from the mapped memory.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mesh.h"
+
+// Parameters that the generated data depends on
+struct AsteroidsCacheKey
+{
+    std::uint32_t rngSeed;
+    std::uint32_t meshInstanceCount;
+    std::uint32_t subdivCount;
+    std::uint32_t textureCount;
+    std::uint32_t textureDim;
+    std::uint32_t textureArraySize;
+};
+
+struct AsteroidsCacheContents
+{
+    MeshView            meshes;
+    const unsigned int* indexOffsets = nullptr; // subdivCount + 2 elements, see CreateAsteroidsFromGeospheres
+    unsigned int        vertexCountPerMesh = 0;
+    const std::uint8_t* textureData = nullptr; // See AsteroidTextureSet for the layout
+    size_t              textureDataSize = 0;
+};
+
+class AsteroidsCache
+{
+public:
+    AsteroidsCache() = default;
+    ~AsteroidsCache();
+
+    AsteroidsCache(const AsteroidsCache&) = delete;
+    AsteroidsCache& operator=(const AsteroidsCache&) = delete;
+
+    // Maps the cache file. Returns false if the file does not exist, is damaged, holds inconsistent
+    // meshes or textures, was written by a different version of the cache or was generated with
+    // different parameters.
+    bool Open(const char* path, const AsteroidsCacheKey& key);
+
+    void Close();
+
+    // Pointers remain valid until the cache is closed
+    const AsteroidsCacheContents& GetContents() const { return mContents; }
+
+    // Writes a new cache file. The file is written under a temporary name first,
+    // so a partially written file is never opened.
+    static bool Write(const char* path, const AsteroidsCacheKey& key, const AsteroidsCacheContents& contents);
+
+private:
+    const std::uint8_t* mData = nullptr;
+    size_t              mSize = 0;
+#if defined(_WIN32)
+    void* mFileHandle    = nullptr;
+    void* mMappingHandle = nullptr;
+#endif
+
+    AsteroidsCacheContents mContents;
+};
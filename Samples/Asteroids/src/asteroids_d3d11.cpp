@@ -395,7 +395,7 @@ void Asteroids::InitializeTextureData()
     D3D11_TEXTURE2D_DESC textureDesc = {};
     textureDesc.Width            = TEXTURE_DIM;
     textureDesc.Height           = TEXTURE_DIM;
-    textureDesc.ArraySize        = 3;
+    textureDesc.ArraySize        = TEXTURE_ARRAY_SIZE;
     textureDesc.MipLevels        = 0; // Full chain
     textureDesc.Format           = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
     textureDesc.SampleDesc.Count = 1;
@@ -490,7 +490,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         ThrowIfFailed(mDeviceCtxt->Map(mDrawConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
 
         auto drawConstants = (DrawConstantBuffer*) mapped.pData;
-        XMStoreFloat4x4(&drawConstants->mWorld,          dynamicData->world);
+        StoreWorldMatrix(&drawConstants->mWorld, *dynamicData);
         XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
         drawConstants->mSurfaceColor = staticData->surfaceColor;
         drawConstants->mDeepColor    = staticData->deepColor;
@@ -108,7 +108,7 @@ Asteroids::Asteroids(AsteroidsSimulation* asteroids, GUI *gui, UINT minCmdLsts,
     {
         // TODO: Query simulation for this data? Defines good enough for now...
         D3D12_RESOURCE_DESC textureDesc =
-            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, TEXTURE_DIM, TEXTURE_DIM, 3, 0);
+            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, TEXTURE_DIM, TEXTURE_DIM, TEXTURE_ARRAY_SIZE, 0);
 
         for (UINT i = 0; i < NUM_UNIQUE_TEXTURES; ++i) {
             ThrowIfFailed(mDevice->CreateCommittedResource(
@@ -718,7 +718,7 @@ void Asteroids::RenderSubset(
             auto staticData = &staticAsteroidData[drawIdx];
             auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
+            StoreWorldMatrix(&drawConstantBuffers[drawIdx].mWorld, *dynamicData);
             XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
 
             // Set root cbuffer
@@ -736,7 +736,7 @@ void Asteroids::RenderSubset(
         {
             auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
+            StoreWorldMatrix(&drawConstantBuffers[drawIdx].mWorld, *dynamicData);
             XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
 
             auto drawIndexed = &indirectArgs[drawIdx].mDrawIndexed;
@@ -10,10 +10,13 @@
 
 #include "mesh.h"
 #include "noise.h"
-#include <map>
-#include <random>
+#include "TaskScheduler.hpp"
 
-using namespace DirectX;
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <random>
 
 void CreateIcosahedron(Mesh *outMesh)
 {
@@ -80,18 +83,65 @@ struct Edge
     IndexType v0;
     IndexType v1;
 
-    bool operator<(const Edge &c) const
+    uint32_t Key() const
     {
-        return v0 < c.v0 || (v0 == c.v0 && v1 < c.v1);
+        return (uint32_t{v0} << 16u) | uint32_t{v1};
     }
 };
 
-typedef std::map<Edge, IndexType> MidpointMap;
+// v0 < v1 for every edge, so this key is never used
+static const uint32_t EmptyEdgeKey = 0xFFFFFFFFu;
+
+// Open-addressing hash table with linear probing that maps edges to midpoint vertex indices.
+// The table never grows, so it must be created large enough for all edges of the mesh.
+class MidpointMap
+{
+public:
+    explicit MidpointMap(size_t maxEdgeCount)
+    {
+        // Keep the load factor at or below 1/2
+        size_t capacity = 16;
+        mShift = 28;
+        while (capacity < maxEdgeCount * 2) {
+            capacity *= 2;
+            --mShift;
+        }
+        mKeys.assign(capacity, EmptyEdgeKey);
+        mValues.resize(capacity);
+        mMask = capacity - 1;
+    }
+
+    // Returns the slot for the edge and true if the edge was not in the table.
+    IndexType* FindOrInsert(const Edge& e, bool* inserted)
+    {
+        const uint32_t key = e.Key();
+        // Fibonacci hashing: the top bits of the product depend on all bits of the key
+        for (size_t slot = uint32_t(key * 2654435769u) >> mShift;; slot = (slot + 1) & mMask)
+        {
+            if (mKeys[slot] == key) {
+                *inserted = false;
+                return &mValues[slot];
+            }
+            if (mKeys[slot] == EmptyEdgeKey) {
+                mKeys[slot] = key;
+                *inserted = true;
+                return &mValues[slot];
+            }
+        }
+    }
+
+private:
+    std::vector<uint32_t> mKeys;
+    std::vector<IndexType> mValues;
+    size_t mMask = 0;
+    unsigned int mShift = 0;
+};
 
 inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
 {
-    auto index = midpoints->find(e);
-    if (index == midpoints->end())
+    bool inserted = false;
+    auto index = midpoints->FindOrInsert(e, &inserted);
+    if (inserted)
     {
         auto a = mesh->vertices[e.v0];
         auto b = mesh->vertices[e.v1];
@@ -101,16 +151,17 @@ inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
         m.y = (a.y + b.y) * 0.5f;
         m.z = (a.z + b.z) * 0.5f;
 
-        index = midpoints->insert(std::make_pair(e, static_cast<IndexType>(mesh->vertices.size()))).first;
+        *index = static_cast<IndexType>(mesh->vertices.size());
         mesh->vertices.push_back(m);
     }
-    return index->second;
+    return *index;
 }
 
 
 void SubdivideInPlace(Mesh *outMesh)
 {
-    MidpointMap midpoints;
+    // Every triangle has three edges, and every edge except for the boundary ones is shared by two triangles
+    MidpointMap midpoints(outMesh->indices.size());
 
     std::vector<IndexType> newIndices;
     newIndices.reserve(outMesh->indices.size() * 4);
@@ -152,21 +203,22 @@ void SpherifyInPlace(Mesh *outMesh, float radius)
 }
 
 
-void ComputeAvgNormalsInPlace(Mesh *outMesh)
+static void ComputeAvgNormals(Vertex* vertices, size_t vertexCount, const IndexType* indices, size_t indexCount)
 {
-    for (auto &v : outMesh->vertices) {
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto &v = vertices[i];
         v.nx = 0.0f;
         v.ny = 0.0f;
         v.nz = 0.0f;
     }
 
-    assert(outMesh->indices.size() % 3 == 0); // trilist
-    size_t triangles = outMesh->indices.size() / 3;
+    assert(indexCount % 3 == 0); // trilist
+    size_t triangles = indexCount / 3;
     for (size_t t = 0; t < triangles; ++t)
     {
-        auto v1 = &outMesh->vertices[outMesh->indices[t*3+0]];
-        auto v2 = &outMesh->vertices[outMesh->indices[t*3+1]];
-        auto v3 = &outMesh->vertices[outMesh->indices[t*3+2]];
+        auto v1 = &vertices[indices[t*3+0]];
+        auto v2 = &vertices[indices[t*3+1]];
+        auto v3 = &vertices[indices[t*3+2]];
 
         // Two edge vectors u,v
         auto ux = v2->x - v1->x;
@@ -188,7 +240,8 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
     }
 
     // Normalize
-    for (auto &v : outMesh->vertices) {
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto &v = vertices[i];
         float n = 1.0f / std::sqrt(v.nx*v.nx + v.ny*v.ny + v.nz*v.nz);
         v.nx *= n;
         v.ny *= n;
@@ -197,6 +250,12 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
 }
 
 
+void ComputeAvgNormalsInPlace(Mesh *outMesh)
+{
+    ComputeAvgNormals(outMesh->vertices.data(), outMesh->vertices.size(), outMesh->indices.data(), outMesh->indices.size());
+}
+
+
 void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets)
 {
     CreateIcosahedron(outMesh);
@@ -231,7 +290,8 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int
 void CreateAsteroidsFromGeospheres(Mesh *outMesh,
                                    unsigned int subdivLevelCount, unsigned int meshInstanceCount,
                                    unsigned int rngSeed,
-                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh)
+                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh,
+                                   Diligent::TaskScheduler* scheduler)
 {
     assert(subdivLevelCount <= meshInstanceCount);
 
@@ -242,8 +302,8 @@ void CreateAsteroidsFromGeospheres(Mesh *outMesh,
 
     // Per unique mesh
     *vertexCountPerMesh = (unsigned int)baseMesh.vertices.size();
-    std::vector<Vertex> vertices;
-    vertices.reserve(meshInstanceCount * baseMesh.vertices.size());
+    const size_t baseVertexCount = baseMesh.vertices.size();
+    std::vector<Vertex> vertices(meshInstanceCount * baseVertexCount);
     // Reuse indices for the different unique meshes
 
     auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
@@ -252,22 +312,39 @@ void CreateAsteroidsFromGeospheres(Mesh *outMesh,
     float radiusScale = 0.9f;
     float radiusBias = 0.3f;
 
-    // Create and randomize unique vertices for each mesh instance
+    // Draw the random parameters of all instances up front in the same order as a serial loop would,
+    // so that the meshes do not depend on how the instances are distributed between threads
+    std::vector<float> persistences(meshInstanceCount);
+    std::vector<float> noiseOffsets(meshInstanceCount);
     for (unsigned int m = 0; m < meshInstanceCount; ++m) {
-        Mesh newMesh(baseMesh);
-        NoiseOctaves<4> textureNoise(randomPersistence(rng));
-        float noise = randomNoise(rng);
+        persistences[m] = randomPersistence(rng);
+        noiseOffsets[m] = randomNoise(rng);
+    }
 
-        for (auto &v : newMesh.vertices) {
+    // Create and randomize unique vertices for each mesh instance
+    auto createInstance = [&](unsigned int m) {
+        Vertex* instanceVertices = vertices.data() + m * baseVertexCount;
+        NoiseOctaves<4> textureNoise(persistences[m]);
+        float noise = noiseOffsets[m];
+
+        for (size_t i = 0; i < baseVertexCount; ++i) {
+            auto v = baseMesh.vertices[i];
             float radius = textureNoise(v.x*noiseScale, v.y*noiseScale, v.z*noiseScale, noise);
             radius = radius * radiusScale + radiusBias;
             v.x *= radius;
             v.y *= radius;
             v.z *= radius;
+            instanceVertices[i] = v;
         }
-        ComputeAvgNormalsInPlace(&newMesh);
+        ComputeAvgNormals(instanceVertices, baseVertexCount, baseMesh.indices.data(), baseMesh.indices.size());
+    };
 
-        vertices.insert(vertices.end(), newMesh.vertices.begin(), newMesh.vertices.end());
+    if (scheduler != nullptr) {
+        scheduler->ParallelFor(meshInstanceCount, [&](Diligent::Uint32, Diligent::Uint32 m) { createInstance(m); });
+    } else {
+        for (unsigned int m = 0; m < meshInstanceCount; ++m) {
+            createInstance(m);
+        }
     }
 
     // Copy to output
@@ -282,7 +359,7 @@ void CreateSkyboxMesh(std::vector<SkyboxVertex>* outVertices)
     
     // Cube mesh centered at zero
     static const float c = 0.5f;
-    static const DirectX::XMFLOAT3 vertexPos[] = { // x, y, z
+    static const struct { float x, y, z; } vertexPos[] = { // x, y, z
         {-c,  c, -c}, // 0
         { c,  c, -c}, // 1
         { c,  c,  c}, // 2
@@ -10,8 +10,13 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
-#include <directxmath.h>
+
+namespace Diligent
+{
+class TaskScheduler;
+}
 
 typedef unsigned short IndexType;
 
@@ -38,6 +43,34 @@ struct Mesh
     std::vector<IndexType> indices;
 };
 
+// Read-only array that does not own its memory
+template <typename T>
+struct ArrayView
+{
+    const T* ptr = nullptr;
+    size_t count = 0;
+
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+};
+
+// Mesh data that either belongs to a Mesh or is mapped from a file
+struct MeshView
+{
+    MeshView() = default;
+    MeshView(const Mesh& mesh)
+    {
+        vertices = {mesh.vertices.data(), mesh.vertices.size()};
+        indices = {mesh.indices.data(), mesh.indices.size()};
+    }
+
+    ArrayView<Vertex> vertices;
+    ArrayView<IndexType> indices;
+};
+
 void CreateIcosahedron(Mesh *outMesh);
 
 // 1 face -> 4 faces
@@ -54,10 +87,12 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int
 // - A set of indices for each subdiv level (outSubdivIndexOffsets for offsets/counts)
 // - A set of vertices for each mesh instance (base vertices per mesh computed from vertexCountPerMesh)
 // - Indices already have the vertex offsets for the correct subdiv level "baked-in", so only need the mesh offset
+// Mesh instances are generated in parallel if scheduler is not null. The result does not depend on the scheduler.
 void CreateAsteroidsFromGeospheres(Mesh *outMesh,
                                    unsigned int subdivLevelCount, unsigned int meshInstanceCount,
                                    unsigned int rngSeed,
-                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh);
+                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh,
+                                   Diligent::TaskScheduler* scheduler = nullptr);
 
 
 struct SkyboxVertex
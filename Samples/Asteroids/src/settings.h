@@ -23,6 +23,7 @@ enum { NUM_ASTEROIDS = 2000 };
 enum { NUM_ASTEROIDS = 50000 };
 #endif
 enum { TEXTURE_DIM = 256 }; // Req'd to be pow2 at the moment
+enum { TEXTURE_ARRAY_SIZE = 3 }; // Tri-planar projection planes
 enum { TEXTURE_ANISO = 2 };
 enum { NUM_UNIQUE_MESHES = 1000 };
 enum { MESH_MAX_SUBDIV_LEVELS = 3 }; // 4x polys for each step.
@@ -79,6 +80,7 @@ struct Settings
 
     bool lockFrameRate = false;
     bool animate = true;
+    bool frustumCulling = true; // Only for Diligent modes
 
     // Multithreading actually makes debugging annoying so disable by default
 #if defined(DILIGENT_DEBUG)
@@ -90,4 +92,7 @@ struct Settings
     bool submitRendering = true;
     bool executeIndirect = false;
     bool warp = false;
+
+    // Generated meshes and textures are saved to and loaded from this file, nullptr disables the cache
+    const char* cacheFile = "asteroids_cache.bin";
 };
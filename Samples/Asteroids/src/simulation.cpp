@@ -10,14 +10,15 @@
 
 #include "simulation.h"
 #include "settings.h"
-#include "texture.h"
 #include "util.h"
+#include "TaskScheduler.hpp"
 
 #include <random>
 #include <limits>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <ppl.h>
+#include <thread>
 
 using namespace DirectX;
 
@@ -47,34 +48,76 @@ static XMVECTOR RandomPointOnSphere(std::mt19937& rng)
     // Unreachable
 }
 
-// From http://guihaire.com/code/?p=1135
-static inline float VeryApproxLog2f(float x)
-{   
-    union { float f; uint32_t i; } ux;
-    ux.f = x;
-    return (float)ux.i * 1.1920928955078125e-7f - 126.94269504f;
-}
-
-
 AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int asteroidCount,
                                          unsigned int meshInstanceCount, unsigned int subdivCount,
-                                         unsigned int textureCount)
+                                         unsigned int textureCount, const char* cacheFile)
     : mAsteroidStatic(asteroidCount)
-    , mAsteroidDynamic(asteroidCount)
     , mIndexOffsets(size_t{subdivCount} + 2) // Mesh subdivs are inclusive on both ends and need forward differencing for count
     , mSubdivCount(subdivCount)
 {
     std::mt19937 rng(rngSeed);
 
-    // Create meshes
-    std::cout
-        << "Creating " << meshInstanceCount << " meshes, each with "
-        << subdivCount << " subdivision levels..." << std::endl;
-
-    CreateAsteroidsFromGeospheres(&mMeshes, mSubdivCount, meshInstanceCount,
-                                  rng(), mIndexOffsets.data(), &mVertexCountPerMesh);
+    auto meshSeed = rng();
+    rng(); // Texture seed, kept to preserve the random sequence of the asteroids
+
+    const AsteroidsCacheKey cacheKey = {rngSeed, meshInstanceCount, subdivCount, textureCount, TEXTURE_DIM, TEXTURE_ARRAY_SIZE};
+    if (cacheFile != nullptr && mCache.Open(cacheFile, cacheKey)) {
+        std::cout << "Loaded meshes and textures from " << cacheFile << std::endl;
+
+        const auto& contents = mCache.GetContents();
+        mMeshView = contents.meshes;
+        std::copy(contents.indexOffsets, contents.indexOffsets + mIndexOffsets.size(), mIndexOffsets.begin());
+        mVertexCountPerMesh = contents.vertexCountPerMesh;
+        mTextures.Attach(contents.textureData, textureCount, TEXTURE_DIM, TEXTURE_ARRAY_SIZE);
+        assert(mTextures.GetDataSize() == contents.textureDataSize);
+    } else {
+        // Create meshes
+        std::cout
+            << "Creating " << meshInstanceCount << " meshes, each with "
+            << subdivCount << " subdivision levels..." << std::endl;
+
+        {
+            // Worker threads only live during the mesh and texture generation
+            Diligent::TaskScheduler scheduler{std::max(std::thread::hardware_concurrency(), 2u) - 1};
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            CreateAsteroidsFromGeospheres(&mMeshes, mSubdivCount, meshInstanceCount,
+                                          meshSeed, mIndexOffsets.data(), &mVertexCountPerMesh, &scheduler);
+            auto meshTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+            std::cout << "Meshes created in " << meshTime << " ms" << std::endl;
+
+            startTime = std::chrono::high_resolution_clock::now();
+            CreateTextures(textureCount, &scheduler);
+            auto textureTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+            std::cout << "Textures created in " << textureTime << " ms" << std::endl;
+        }
+        mMeshView = MeshView{mMeshes};
+
+        if (cacheFile != nullptr) {
+            AsteroidsCacheContents contents;
+            contents.meshes = mMeshView;
+            contents.indexOffsets = mIndexOffsets.data();
+            contents.vertexCountPerMesh = mVertexCountPerMesh;
+            contents.textureData = mTextures.GetData();
+            contents.textureDataSize = mTextures.GetDataSize();
+            if (AsteroidsCache::Write(cacheFile, cacheKey, contents)) {
+                std::cout << "Saved meshes and textures to " << cacheFile << std::endl;
+            } else {
+                std::cout << "Unable to write " << cacheFile << std::endl;
+            }
+        }
+    }
+    InitTextureSubresources();
 
-    CreateTextures(textureCount, rng());
+    mCore.Resize(asteroidCount);
+    mCore.SetIndexOffsets(mIndexOffsets.data(), mSubdivCount);
+    {
+        float maxRadiusSq = 0.0f;
+        for (const auto& v : mMeshView.vertices) {
+            maxRadiusSq = std::max(maxRadiusSq, v.x*v.x + v.y*v.y + v.z*v.z);
+        }
+        mCore.SetBoundingRadius(std::sqrt(maxRadiusSq));
+    }
 
     // Constants
     std::normal_distribution<float> orbitRadiusDist(SIM_ORBIT_RADIUS, 0.6f * SIM_DISC_RADIUS);
@@ -101,24 +144,25 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
         scale = scale * 0.3f;
 #endif
         scale = std::max(scale, SIM_MIN_SCALE);
-        auto scaleMatrix = XMMatrixScaling(scale, scale, scale);
-
-        auto orbitRadius = orbitRadiusDist(rng);
-        auto discPosY = float(SIM_DISC_RADIUS) * heightDist(rng);
 
-        auto disc = XMMatrixTranslation(orbitRadius, discPosY, 0.0f);
-
-        auto positionAngle = angleDist(rng);
-        auto orbit = XMMatrixRotationY(positionAngle);
+        AsteroidOrbit orbit;
+        orbit.scale = scale;
+        orbit.orbitRadius = orbitRadiusDist(rng);
+        orbit.orbitHeight = float(SIM_DISC_RADIUS) * heightDist(rng);
+        orbit.orbitAngle = angleDist(rng);
+        orbit.spinAngle = 0.0f;
 
         auto meshInstance = (unsigned int)(i / instancesPerMesh); // Vcache friendly ordering
 
         // Static data
-        mAsteroidStatic[i].spinVelocity = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
-        mAsteroidStatic[i].orbitVelocity = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
+        orbit.spinVelocity = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
+        orbit.orbitVelocity = radialVelocityDist(rng) / (scale * orbit.orbitRadius); // Smaller asteroids go faster, and use arc length
         mAsteroidStatic[i].vertexStart = mVertexCountPerMesh * meshInstance;
-        mAsteroidStatic[i].spinAxis = XMVector3Normalize(RandomPointOnSphere(rng));
-        mAsteroidStatic[i].scale = scale;
+        XMFLOAT3 spinAxis;
+        XMStoreFloat3(&spinAxis, XMVector3Normalize(RandomPointOnSphere(rng)));
+        orbit.spinAxis[0] = spinAxis.x;
+        orbit.spinAxis[1] = spinAxis.y;
+        orbit.spinAxis[2] = spinAxis.z;
         mAsteroidStatic[i].textureIndex = textureIndexDist(rng);
 
         auto colorScheme = ((int)abs(colorSchemeDist(rng))) % NUM_COLOR_SCHEMES;
@@ -127,10 +171,10 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
         mAsteroidStatic[i].deepColor    = XMFLOAT3(c[3], c[4], c[5]);
 
         // Initialize dynamic data
-        mAsteroidDynamic[i].world = scaleMatrix * disc * orbit;
+        mCore.SetAsteroid(i, orbit);
 
-        assert(mAsteroidStatic[i].scale > 0.0f);
-        assert(mAsteroidStatic[i].orbitVelocity > 0.0f);
+        assert(orbit.scale > 0.0f);
+        assert(orbit.orbitVelocity > 0.0f);
     }
 }
 
@@ -138,113 +182,55 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
 void AsteroidsSimulation::Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
                                  size_t startIndex, size_t count)
 {
-    bool animate = settings.animate;
-
-    // TODO: This constant should really depend on resolution and/or be configurable...
-    static const float minSubdivSizeLog2 = std::log2f(0.0019f);
-
-    size_t last = count ? startIndex + count : mAsteroidDynamic.size();
-    for (size_t i = startIndex; i < last; ++i) {
-        const AsteroidStatic& staticData = mAsteroidStatic[i];
-        AsteroidDynamic& dynamicData = mAsteroidDynamic[i];
+    XMFLOAT3 eye;
+    XMStoreFloat3(&eye, cameraEye);
+    mCore.Update(frameTime, &eye.x, settings.animate, startIndex, count);
+}
 
-        if (animate) {
-            auto orbit = XMMatrixRotationY(staticData.orbitVelocity * frameTime);
-            auto spin = XMMatrixRotationNormal(staticData.spinAxis, staticData.spinVelocity * frameTime);
-            dynamicData.world = spin * dynamicData.world * orbit;
-        }
 
-        // Pick LOD based on approx screen area - can be very approximate
-        auto position = dynamicData.world.r[3];
-        auto distanceToEyeRcp = XMVectorGetX(XMVector3ReciprocalLengthEst(XMVectorSubtract(cameraEye, position)));
-        // Add one subdiv for each factor of 2 past min
-        auto relativeScreenSizeLog2 = VeryApproxLog2f(staticData.scale * distanceToEyeRcp);
-        float subdivFloat = std::max(0.0f, relativeScreenSizeLog2 - minSubdivSizeLog2);
-        auto subdiv = std::min(mSubdivCount, (unsigned int)subdivFloat);
-
-        // TODO: Ignore/cull/force lowest subdiv if offscreen?
-        
-        dynamicData.indexStart = mIndexOffsets[subdiv];
-        dynamicData.indexCount = mIndexOffsets[subdiv+1] - dynamicData.indexStart;
-    }
+void AsteroidsSimulation::Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
+                                 Diligent::TaskScheduler& scheduler)
+{
+    XMFLOAT3 eye;
+    XMStoreFloat3(&eye, cameraEye);
+    mCore.Update(frameTime, &eye.x, settings.animate, scheduler);
 }
 
 
-void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int rngSeed)
+void AsteroidsSimulation::SetViewFrustum(DirectX::FXMMATRIX viewProjection, bool enableCulling)
 {
-    mTextureDim = TEXTURE_DIM;
-    mTextureCount = textureCount;
-    mTextureArraySize = 3;
-    {
-        DWORD msbIndex = 0;
-        auto result = _BitScanReverse(&msbIndex, mTextureDim);
-        assert(result); // Should only fail if mTextureDim = 0
-        mTextureMipLevels = msbIndex + 1;
+    if (enableCulling) {
+        XMFLOAT4X4 viewProj;
+        XMStoreFloat4x4(&viewProj, viewProjection);
+        mCore.SetFrustum(viewProj.m);
+    } else {
+        mCore.DisableFrustumCulling();
     }
+}
 
-    assert((mTextureDim & (mTextureDim-1)) == 0); // Must be pow2 currently; we don't handle wacky mip chains
 
+void AsteroidsSimulation::CreateTextures(unsigned int textureCount, Diligent::TaskScheduler* scheduler)
+{
     std::cout
         << "Creating " << textureCount << " "
-        << mTextureDim << "x" << mTextureDim << " textures..." << std::endl;
-    
-    // Allocate space
-    UINT texelSizeInBytes = 4; // RGBA8
-    UINT extraSpaceForMips = 2;
-    UINT totalTextureSizeInBytes = texelSizeInBytes * mTextureDim * mTextureDim * mTextureArraySize * extraSpaceForMips;
-    totalTextureSizeInBytes = AlignUp(totalTextureSizeInBytes, 64U); // Avoid false sharing
-
-    mTextureDataBuffer.resize(size_t{totalTextureSizeInBytes} * size_t{textureCount});
-    mTextureSubresources.resize(size_t{mTextureArraySize} * size_t{mTextureMipLevels} * size_t{textureCount});
-    
-    // Parallel over textures
-    std::vector<unsigned int> rngSeeds(textureCount);
-    {
-        std::mt19937 seeds;
-        for (auto &i : rngSeeds) i = seeds();
-    }
+        << TEXTURE_DIM << "x" << TEXTURE_DIM << " textures..." << std::endl;
 
-    concurrency::parallel_for(UINT(0), textureCount, [&](UINT t) {
-        std::mt19937 rng(rngSeeds[t]);
-        auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
-        auto randomNoiseScale = std::uniform_real_distribution<float>(100, 150);
-        auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
+    // Textures have always been generated from the default seed rather than the simulation seed
+    mTextures.Create(textureCount, TEXTURE_DIM, TEXTURE_ARRAY_SIZE, std::mt19937::default_seed, scheduler);
+}
 
-        BYTE* data = mTextureDataBuffer.data() + t * size_t{totalTextureSizeInBytes};
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
-            for (UINT m = 0; m < mTextureMipLevels; ++m) {
-                auto width  = mTextureDim >> m;
-                auto height = mTextureDim >> m;
 
+void AsteroidsSimulation::InitTextureSubresources()
+{
+    mTextureSubresources.resize(size_t{mTextures.GetArraySize()} * size_t{mTextures.GetMipLevels()} * size_t{mTextures.GetTextureCount()});
+    for (unsigned int t = 0; t < mTextures.GetTextureCount(); ++t) {
+        for (unsigned int a = 0; a < mTextures.GetArraySize(); ++a) {
+            for (unsigned int m = 0; m < mTextures.GetMipLevels(); ++m) {
                 D3D11_SUBRESOURCE_DATA initialData = {};
-                initialData.pSysMem = data;
-                initialData.SysMemPitch = width * texelSizeInBytes;
+                initialData.pSysMem = mTextures.GetSubresourceData(t, a, m);
+                initialData.SysMemPitch = static_cast<UINT>(mTextures.GetRowPitch(m));
                 mTextureSubresources[SubresourceIndex(t, a, m)] = initialData;
-
-                data += size_t{initialData.SysMemPitch} * size_t{height};
             }
         }
-
-        // Use same parameters for each of the tri-planar projection planes/cube map faces/etc.
-        float noiseScale = randomNoiseScale(rng) / float(mTextureDim);
-        float persistence = randomPersistence(rng);
-        float strength = 1.5f;
-
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
-            float redScale   = 255.0f;
-            float greenScale = 255.0f;
-            float blueScale  = 255.0f;
-
-            // DEBUG colors
-#if 0
-            redScale   = t & 1 ? 255.0f : 0.0f;
-            greenScale = t & 2 ? 255.0f : 0.0f;
-            blueScale  = t & 4 ? 255.0f : 0.0f;
-#endif
-
-            FillNoise2D_RGBA8(&mTextureSubresources[SubresourceIndex(t, a)], mTextureDim, mTextureDim, mTextureMipLevels,
-                              randomNoise(rng), persistence, noiseScale, strength,
-                              redScale, greenScale, blueScale);
-        }
-    }); // parallel_for
+    }
 }
@@ -14,77 +14,87 @@
 #include <DirectXMath.h>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 #include <random>
 
 #include "mesh.h"
 #include "settings.h"
+#include "asteroids_cache.h"
+#include "simulation_core.h"
+#include "texture_synthesis.h"
 
-// We may want to ISPC-ify this down the road and just let it own the data structure in AoSoA format or similar
-// For now we'll just do the dumb thing and see if it's fast enough
-struct AsteroidDynamic
-{
-    DirectX::XMMATRIX world;
-    // These depend on chosen subdiv level, hence are not constant
-    unsigned int indexStart;
-    unsigned int indexCount;
-};
-
+// Rendering data that never changes. The orbit and spin parameters live in AsteroidsSimulationCore.
 struct AsteroidStatic
 {
     DirectX::XMFLOAT3 surfaceColor;
     DirectX::XMFLOAT3 deepColor;
-    DirectX::XMVECTOR spinAxis;
-    float scale;
-    float spinVelocity;
-    float orbitVelocity;
     unsigned int vertexStart;
     unsigned int textureIndex;
 };
 
+inline void StoreWorldMatrix(DirectX::XMFLOAT4X4* pDst, const AsteroidDynamic& dynamicData)
+{
+    static_assert(sizeof(*pDst) == sizeof(dynamicData.world), "World matrix layout must match XMFLOAT4X4");
+    std::memcpy(pDst, dynamicData.world, sizeof(*pDst));
+}
+
 class AsteroidsSimulation
 {
 private:
-    // NOTE: Memory could be optimized further for efficient cache traversal, etc.
     std::vector<AsteroidStatic> mAsteroidStatic;
-    std::vector<AsteroidDynamic> mAsteroidDynamic;
+    AsteroidsSimulationCore mCore;
 
-    Mesh mMeshes;
+    Mesh mMeshes; // Empty if the meshes are mapped from the cache
+    MeshView mMeshView;
     std::vector<unsigned int> mIndexOffsets;
     unsigned int mSubdivCount;
     unsigned int mVertexCountPerMesh;
 
-    unsigned int mTextureDim;
-    unsigned int mTextureCount;
-    unsigned int mTextureArraySize;
-    unsigned int mTextureMipLevels;
-    std::vector<BYTE> mTextureDataBuffer;
+    AsteroidsCache mCache;
+    AsteroidTextureSet mTextures;
     std::vector<D3D11_SUBRESOURCE_DATA> mTextureSubresources;
 
     unsigned int SubresourceIndex(unsigned int texture, unsigned int arrayElement = 0, unsigned int mip = 0)
     {
-        return mip + mTextureMipLevels * (arrayElement + mTextureArraySize * texture);
+        return mip + mTextures.GetMipLevels() * (arrayElement + mTextures.GetArraySize() * texture);
     }
 
-    void CreateTextures(unsigned int textureCount, unsigned int rngSeed);
+    void CreateTextures(unsigned int textureCount, Diligent::TaskScheduler* scheduler);
+    void InitTextureSubresources();
     
 public:
     AsteroidsSimulation(unsigned int rngSeed, unsigned int asteroidCount,
                         unsigned int meshInstanceCount, unsigned int subdivCount,
-                        unsigned int textureCount);
+                        unsigned int textureCount, const char* cacheFile = nullptr);
 
-    const Mesh* Meshes() { return &mMeshes; }
+    // Points either to the generated meshes or to the memory-mapped cache file
+    const MeshView* Meshes() { return &mMeshView; }
     const D3D11_SUBRESOURCE_DATA* TextureData(unsigned int textureIndex)
     {
         return mTextureSubresources.data() + SubresourceIndex(textureIndex);
     }
 
-    unsigned int GetTextureMipLevels()const{return mTextureMipLevels;}
+    unsigned int GetTextureMipLevels()const{return mTextures.GetMipLevels();}
 
     const AsteroidStatic* StaticData() const { return mAsteroidStatic.data(); }
-    const AsteroidDynamic* DynamicData() const { return mAsteroidDynamic.data(); }
+    const AsteroidDynamic* DynamicData() const { return mCore.DynamicData(); }
+
+    // Frustum used to cull asteroids by the following updates
+    void SetViewFrustum(DirectX::FXMMATRIX viewProjection, bool enableCulling);
+
+    // Builds the list of visible asteroids after updating them with the range version of Update()
+    void BuildDrawLists() { mCore.BuildDrawLists(); }
+
+    // Indices of the asteroids that passed the frustum test, sorted by LOD
+    const unsigned int* VisibleAsteroids() const { return mCore.VisibleAsteroids(); }
+    size_t GetVisibleAsteroidCount() const { return mCore.GetVisibleAsteroidCount(); }
 
     // Can optionally provide a range of asteroids to update; count = 0 => to the end
     // This is useful for multithreading
     void Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
                 size_t startIndex = 0, size_t count = 0);
+
+    // Updates all asteroids in parallel on the scheduler threads and builds the list of visible asteroids
+    void Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
+                Diligent::TaskScheduler& scheduler);
 };
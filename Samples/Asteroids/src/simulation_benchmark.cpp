@@ -0,0 +1,346 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+// Standalone benchmark of the asteroid simulation core. Usage:
+//
+//   AsteroidsSimulationBenchmark [-asteroids N] [-frames N] [-threads N] [-meshes N] [-subdivs N] [-textures N]
+//
+// Measures the startup time of the mesh and texture generation on the calling thread and in parallel,
+// and the time it takes to map the same data from the cache file.
+// Then runs the update, including frustum culling and draw list construction, on the calling thread
+// and in parallel using the task scheduler, and prints the average time per frame.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "asteroids_cache.h"
+#include "mesh.h"
+#include "simulation_core.h"
+#include "texture_synthesis.h"
+#include "TaskScheduler.hpp"
+
+#define SIM_ORBIT_RADIUS 450.f
+#define SIM_DISC_RADIUS  120.f
+#define SIM_MIN_SCALE    0.2f
+
+namespace
+{
+
+void InitAsteroids(AsteroidsSimulationCore& simulation, size_t asteroidCount, unsigned int rngSeed)
+{
+    std::mt19937 rng(rngSeed);
+
+    // Same distributions as in AsteroidsSimulation
+    std::normal_distribution<float>       orbitRadiusDist(SIM_ORBIT_RADIUS, 0.6f * SIM_DISC_RADIUS);
+    std::normal_distribution<float>       heightDist(0.0f, 0.4f);
+    std::uniform_real_distribution<float> angleDist(-3.14159265f, 3.14159265f);
+    std::uniform_real_distribution<float> radialVelocityDist(5.0f, 15.0f);
+    std::uniform_real_distribution<float> spinVelocityDist(-2.0f, 2.0f);
+    std::normal_distribution<float>       scaleDist(1.3f, 0.7f);
+    std::normal_distribution<float>       axisDist;
+
+    simulation.Resize(asteroidCount);
+    for (size_t i = 0; i < asteroidCount; ++i)
+    {
+        AsteroidOrbit orbit;
+        orbit.scale         = std::max(scaleDist(rng), SIM_MIN_SCALE);
+        orbit.orbitRadius   = orbitRadiusDist(rng);
+        orbit.orbitHeight   = float(SIM_DISC_RADIUS) * heightDist(rng);
+        orbit.orbitAngle    = angleDist(rng);
+        orbit.spinVelocity  = spinVelocityDist(rng) / orbit.scale;
+        orbit.orbitVelocity = radialVelocityDist(rng) / (orbit.scale * orbit.orbitRadius);
+        orbit.spinAngle     = 0;
+
+        float axisLen = 0;
+        while (axisLen < 1e-6f)
+        {
+            for (auto& c : orbit.spinAxis)
+                c = axisDist(rng);
+            axisLen = std::sqrt(orbit.spinAxis[0] * orbit.spinAxis[0] + orbit.spinAxis[1] * orbit.spinAxis[1] + orbit.spinAxis[2] * orbit.spinAxis[2]);
+        }
+        for (auto& c : orbit.spinAxis)
+            c /= axisLen;
+
+        simulation.SetAsteroid(i, orbit);
+    }
+
+    // Index offsets of a geosphere with 3 subdivision levels
+    const unsigned int indexOffsets[] = {0, 60, 300, 1260, 5100};
+    simulation.SetIndexOffsets(indexOffsets, 3);
+}
+
+// Right-handed look-at view matrix followed by a reversed-depth perspective projection,
+// same as OrbitCamera, for a camera that looks at the origin. Row vectors.
+void BuildViewProjection(const float eye[3], float fovY, float aspect, float viewProj[4][4])
+{
+    const float eyeLen = std::sqrt(eye[0] * eye[0] + eye[1] * eye[1] + eye[2] * eye[2]);
+    // Basis: z axis points from the target to the eye
+    const float zAxis[3] = {eye[0] / eyeLen, eye[1] / eyeLen, eye[2] / eyeLen};
+    const float up[3]    = {0, 1, 0};
+    float       xAxis[3] = {up[1] * zAxis[2] - up[2] * zAxis[1], up[2] * zAxis[0] - up[0] * zAxis[2], up[0] * zAxis[1] - up[1] * zAxis[0]};
+    const float xLen     = std::sqrt(xAxis[0] * xAxis[0] + xAxis[1] * xAxis[1] + xAxis[2] * xAxis[2]);
+    for (auto& c : xAxis)
+        c /= xLen;
+    const float yAxis[3] = {zAxis[1] * xAxis[2] - zAxis[2] * xAxis[1], zAxis[2] * xAxis[0] - zAxis[0] * xAxis[2], zAxis[0] * xAxis[1] - zAxis[1] * xAxis[0]};
+
+    float view[4][4] = {};
+    for (int i = 0; i < 3; ++i)
+    {
+        view[i][0] = xAxis[i];
+        view[i][1] = yAxis[i];
+        view[i][2] = zAxis[i];
+        view[3][0] -= xAxis[i] * eye[i];
+        view[3][1] -= yAxis[i] * eye[i];
+        view[3][2] -= zAxis[i] * eye[i];
+    }
+    view[3][3] = 1;
+
+    const float nearZ = 10000.0f, farZ = 0.1f; // Reversed depth
+    const float h = 1.f / std::tan(0.5f * fovY);
+    const float r = farZ / (nearZ - farZ);
+
+    float proj[4][4] = {};
+    proj[0][0]       = h / aspect;
+    proj[1][1]       = h;
+    proj[2][2]       = r;
+    proj[2][3]       = -1;
+    proj[3][2]       = r * nearZ;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            viewProj[i][j] = 0;
+            for (int k = 0; k < 4; ++k)
+                viewProj[i][j] += view[i][k] * proj[k][j];
+        }
+    }
+}
+
+template <typename UpdateFuncType>
+double MeasureFrameTime(unsigned int numFrames, const UpdateFuncType& UpdateFunc)
+{
+    // Warm up
+    UpdateFunc();
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    for (unsigned int frame = 0; frame < numFrames; ++frame)
+        UpdateFunc();
+    const auto endTime = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count() / numFrames;
+}
+
+struct AsteroidMeshes
+{
+    Mesh                      mesh;
+    std::vector<unsigned int> indexOffsets;
+    unsigned int              vertexCountPerMesh = 0;
+};
+
+// Generates the asteroid meshes and returns the time in milliseconds
+double MeasureMeshGeneration(unsigned int meshCount, unsigned int subdivCount, Diligent::TaskScheduler* scheduler, AsteroidMeshes& meshes)
+{
+    meshes.indexOffsets.resize(size_t{subdivCount} + 2);
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    CreateAsteroidsFromGeospheres(&meshes.mesh, subdivCount, meshCount, 1337, meshes.indexOffsets.data(), &meshes.vertexCountPerMesh, scheduler);
+    const auto endTime = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+// Generates the asteroid textures and returns the time in milliseconds
+double MeasureTextureGeneration(unsigned int textureCount, Diligent::TaskScheduler* scheduler, AsteroidTextureSet& textures)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    textures.Create(textureCount, 256, 3, 1337, scheduler);
+    const auto endTime = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t       asteroidCount = 1000000;
+    unsigned int numFrames     = 100;
+    unsigned int numThreads    = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned int meshCount     = 1000;
+    unsigned int subdivCount   = 3;
+    unsigned int textureCount  = 10;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        if (std::strcmp(argv[a], "-asteroids") == 0 && a + 1 < argc)
+            asteroidCount = std::strtoul(argv[++a], nullptr, 10);
+        else if (std::strcmp(argv[a], "-frames") == 0 && a + 1 < argc)
+            numFrames = std::max(static_cast<unsigned int>(std::atoi(argv[++a])), 1u);
+        else if (std::strcmp(argv[a], "-threads") == 0 && a + 1 < argc)
+            numThreads = std::max(static_cast<unsigned int>(std::atoi(argv[++a])), 1u);
+        else if (std::strcmp(argv[a], "-meshes") == 0 && a + 1 < argc)
+            meshCount = std::max(static_cast<unsigned int>(std::atoi(argv[++a])), 1u);
+        else if (std::strcmp(argv[a], "-subdivs") == 0 && a + 1 < argc)
+            subdivCount = std::min(static_cast<unsigned int>(std::atoi(argv[++a])), 6u);
+        else if (std::strcmp(argv[a], "-textures") == 0 && a + 1 < argc)
+            textureCount = std::max(static_cast<unsigned int>(std::atoi(argv[++a])), 1u);
+        else
+        {
+            std::printf("Usage: %s [-asteroids N] [-frames N] [-threads N] [-meshes N] [-subdivs N] [-textures N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    AsteroidMeshes singleThreadMeshes;
+    {
+        const auto singleThreadTime = MeasureMeshGeneration(meshCount, subdivCount, nullptr, singleThreadMeshes);
+        std::printf("Meshes: %u, subdivision levels: %u, vertices: %zu\n", meshCount, subdivCount, singleThreadMeshes.mesh.vertices.size());
+        std::printf("Mesh generation, 1 thread:   %8.1f ms\n", singleThreadTime);
+
+        if (numThreads > 1)
+        {
+            Diligent::TaskScheduler scheduler{numThreads - 1};
+
+            AsteroidMeshes multiThreadMeshes;
+            const auto multiThreadTime = MeasureMeshGeneration(meshCount, subdivCount, &scheduler, multiThreadMeshes);
+            std::printf("Mesh generation, %u threads: %8.1f ms (%.2fx)\n", numThreads, multiThreadTime, singleThreadTime / multiThreadTime);
+
+            const auto& vertices0 = singleThreadMeshes.mesh.vertices;
+            const auto& vertices1 = multiThreadMeshes.mesh.vertices;
+            const bool  identical = vertices0.size() == vertices1.size() &&
+                std::memcmp(vertices0.data(), vertices1.data(), vertices0.size() * sizeof(Vertex)) == 0;
+            if (!identical)
+            {
+                std::printf("Error: meshes generated in parallel do not match the single-threaded result\n");
+                return 1;
+            }
+        }
+    }
+
+    AsteroidTextureSet singleThreadTextures;
+    {
+        const auto         singleThreadTime = MeasureTextureGeneration(textureCount, nullptr, singleThreadTextures);
+        std::printf("Textures: %u\n", textureCount);
+        std::printf("Texture generation, 1 thread:   %8.1f ms\n", singleThreadTime);
+
+        if (numThreads > 1)
+        {
+            Diligent::TaskScheduler scheduler{numThreads - 1};
+
+            AsteroidTextureSet multiThreadTextures;
+            const auto         multiThreadTime = MeasureTextureGeneration(textureCount, &scheduler, multiThreadTextures);
+            std::printf("Texture generation, %u threads: %8.1f ms (%.2fx)\n", numThreads, multiThreadTime, singleThreadTime / multiThreadTime);
+
+            if (std::memcmp(singleThreadTextures.GetData(), multiThreadTextures.GetData(), singleThreadTextures.GetDataSize()) != 0)
+            {
+                std::printf("Error: textures generated in parallel do not match the single-threaded result\n");
+                return 1;
+            }
+        }
+    }
+
+    {
+        const AsteroidsCacheKey cacheKey = {1337, meshCount, subdivCount, textureCount, singleThreadTextures.GetTextureDim(), singleThreadTextures.GetArraySize()};
+
+        AsteroidsCacheContents contents;
+        contents.meshes             = MeshView{singleThreadMeshes.mesh};
+        contents.indexOffsets       = singleThreadMeshes.indexOffsets.data();
+        contents.vertexCountPerMesh = singleThreadMeshes.vertexCountPerMesh;
+        contents.textureData        = singleThreadTextures.GetData();
+        contents.textureDataSize    = singleThreadTextures.GetDataSize();
+
+        const char* cacheFile = "AsteroidsSimulationBenchmark.cache";
+        if (!AsteroidsCache::Write(cacheFile, cacheKey, contents))
+        {
+            std::printf("Error: unable to write %s\n", cacheFile);
+            return 1;
+        }
+
+        AsteroidsCache cache;
+        const auto     startTime = std::chrono::high_resolution_clock::now();
+        const bool     opened    = cache.Open(cacheFile, cacheKey);
+        const auto     openTime  = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        const auto& cached = cache.GetContents();
+        const bool  identical = opened &&
+            cached.meshes.vertices.size() == contents.meshes.vertices.size() &&
+            cached.meshes.indices.size() == contents.meshes.indices.size() &&
+            cached.textureDataSize == contents.textureDataSize &&
+            std::memcmp(cached.meshes.vertices.data(), contents.meshes.vertices.data(), contents.meshes.vertices.size() * sizeof(Vertex)) == 0 &&
+            std::memcmp(cached.meshes.indices.data(), contents.meshes.indices.data(), contents.meshes.indices.size() * sizeof(IndexType)) == 0 &&
+            std::memcmp(cached.textureData, contents.textureData, contents.textureDataSize) == 0;
+        cache.Close();
+        std::remove(cacheFile);
+
+        if (!identical)
+        {
+            std::printf("Error: cached meshes and textures do not match the generated ones\n");
+            return 1;
+        }
+        std::printf("Cache open: %8.3f ms\n", openTime);
+    }
+
+    AsteroidsSimulationCore simulation;
+
+    const auto initStartTime = std::chrono::high_resolution_clock::now();
+    InitAsteroids(simulation, asteroidCount, 1337);
+    const auto initTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - initStartTime).count();
+
+    std::printf("Asteroids: %zu, frames: %u, initialization: %.1f ms\n", asteroidCount, numFrames, initTime);
+
+    const float frameTime    = 1.f / 60.f;
+    const float cameraEye[3] = {-SIM_ORBIT_RADIUS, 0.f, 2.0f * SIM_ORBIT_RADIUS};
+
+    float viewProj[4][4];
+    BuildViewProjection(cameraEye, 0.5f, 16.f / 9.f, viewProj);
+    simulation.SetBoundingRadius(1.2f);
+    simulation.SetFrustum(viewProj);
+
+    const auto singleThreadTime = MeasureFrameTime(numFrames, [&]() {
+        simulation.Update(frameTime, cameraEye, true);
+        simulation.BuildDrawLists();
+    });
+    std::printf("1 thread:   %8.3f ms/frame  %8.1f M asteroids/s\n", singleThreadTime, asteroidCount / (singleThreadTime * 1000.0));
+
+    if (numThreads > 1)
+    {
+        Diligent::TaskScheduler scheduler{numThreads - 1};
+
+        const auto multiThreadTime = MeasureFrameTime(numFrames, [&]() {
+            simulation.Update(frameTime, cameraEye, true, scheduler);
+        });
+        std::printf("%u threads: %8.3f ms/frame  %8.1f M asteroids/s  (%.2fx)\n", numThreads, multiThreadTime,
+                    asteroidCount / (multiThreadTime * 1000.0), singleThreadTime / multiThreadTime);
+    }
+
+    const auto lodOnlyTime = MeasureFrameTime(numFrames, [&]() {
+        simulation.Update(frameTime, cameraEye, false);
+        simulation.BuildDrawLists();
+    });
+    std::printf("LOD only:   %8.3f ms/frame (1 thread, animation paused)\n", lodOnlyTime);
+
+    std::printf("Visible asteroids: %zu", simulation.GetVisibleAsteroidCount());
+    for (unsigned int subdiv = 0; subdiv <= 3; ++subdiv)
+    {
+        size_t first, count;
+        simulation.GetLODBucket(subdiv, first, count);
+        std::printf("%s LOD%u: %zu", subdiv == 0 ? " (" : ",", subdiv, count);
+    }
+    std::printf(")\n");
+
+    return 0;
+}
@@ -0,0 +1,464 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "simulation_core.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "TaskScheduler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define ASTEROIDS_SIMULATION_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define ASTEROIDS_SIMULATION_NEON 1
+#endif
+
+namespace
+{
+
+const float Pi    = 3.14159265358979f;
+const float TwoPi = 6.28318530717959f;
+
+// Minimal set of vector operations required by the simulation.
+// Scalar versions are always available and are used for the asteroids that do not fill a whole vector.
+template <typename V> V Load(const float* p);
+template <typename V> V Splat(float f);
+
+// clang-format off
+template <> inline float Load<float> (const float* p) { return *p; }
+template <> inline float Splat<float>(float f)        { return f; }
+
+inline void  Store    (float* p, float v)              { *p = v; }
+inline float Add      (float a, float b)               { return a + b; }
+inline float Sub      (float a, float b)               { return a - b; }
+inline float Mul      (float a, float b)               { return a * b; }
+inline float Min      (float a, float b)               { return a < b ? a : b; }
+inline float Max      (float a, float b)               { return a > b ? a : b; }
+inline float Abs      (float a)                        { return std::abs(a); }
+inline float Round    (float a)                        { return std::nearbyint(a); }
+inline float RSqrt    (float a)                        { return 1.f / std::sqrt(a); }
+inline bool  CmpGt    (float a, float b)               { return a > b; }
+inline float Select   (bool m, float a, float b)       { return m ? a : b; }
+inline float CopySign (float mag, float sign)          { return std::copysign(mag, sign); }
+inline void  StoreUInt(unsigned int* p, float v)       { *p = static_cast<unsigned int>(v); }
+// Interprets the bits of a float as an integer and converts that integer to float
+inline float BitsToFloat(float a)
+{
+    std::int32_t i;
+    std::memcpy(&i, &a, sizeof(i));
+    return static_cast<float>(i);
+}
+// clang-format on
+
+#if ASTEROIDS_SIMULATION_SSE2
+
+using FloatV = __m128;
+
+// clang-format off
+template <> inline __m128 Load<__m128> (const float* p) { return _mm_loadu_ps(p); }
+template <> inline __m128 Splat<__m128>(float f)        { return _mm_set1_ps(f); }
+
+inline void   Store      (float* p, __m128 v)              { _mm_storeu_ps(p, v); }
+inline __m128 Add        (__m128 a, __m128 b)              { return _mm_add_ps(a, b); }
+inline __m128 Sub        (__m128 a, __m128 b)              { return _mm_sub_ps(a, b); }
+inline __m128 Mul        (__m128 a, __m128 b)              { return _mm_mul_ps(a, b); }
+inline __m128 Min        (__m128 a, __m128 b)              { return _mm_min_ps(a, b); }
+inline __m128 Max        (__m128 a, __m128 b)              { return _mm_max_ps(a, b); }
+inline __m128 Abs        (__m128 a)                        { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+// Uses the default MXCSR rounding mode (round to nearest even), same as std::nearbyint
+inline __m128 Round      (__m128 a)                        { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline __m128 CmpGt      (__m128 a, __m128 b)              { return _mm_cmpgt_ps(a, b); }
+inline __m128 Select     (__m128 m, __m128 a, __m128 b)    { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline __m128 CopySign   (float mag, __m128 sign)          { return _mm_or_ps(_mm_set1_ps(std::abs(mag)), _mm_and_ps(sign, _mm_set1_ps(-0.f))); }
+inline void   StoreUInt  (unsigned int* p, __m128 v)       { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(v)); }
+inline __m128 BitsToFloat(__m128 a)                        { return _mm_cvtepi32_ps(_mm_castps_si128(a)); }
+// clang-format on
+
+// The 12-bit estimate is refined with one Newton-Raphson step, so that the LOD selection
+// matches the scalar path, which computes 1/sqrt exactly
+inline __m128 RSqrt(__m128 a)
+{
+    const __m128 y = _mm_rsqrt_ps(a);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.f), _mm_mul_ps(_mm_mul_ps(a, y), y)));
+}
+
+#elif ASTEROIDS_SIMULATION_NEON
+
+using FloatV = float32x4_t;
+
+// clang-format off
+template <> inline float32x4_t Load<float32x4_t> (const float* p) { return vld1q_f32(p); }
+template <> inline float32x4_t Splat<float32x4_t>(float f)        { return vdupq_n_f32(f); }
+
+inline void        Store      (float* p, float32x4_t v)                     { vst1q_f32(p, v); }
+inline float32x4_t Add        (float32x4_t a, float32x4_t b)                { return vaddq_f32(a, b); }
+inline float32x4_t Sub        (float32x4_t a, float32x4_t b)                { return vsubq_f32(a, b); }
+inline float32x4_t Mul        (float32x4_t a, float32x4_t b)                { return vmulq_f32(a, b); }
+inline float32x4_t Min        (float32x4_t a, float32x4_t b)                { return vminq_f32(a, b); }
+inline float32x4_t Max        (float32x4_t a, float32x4_t b)                { return vmaxq_f32(a, b); }
+inline float32x4_t Abs        (float32x4_t a)                               { return vabsq_f32(a); }
+inline float32x4_t Round      (float32x4_t a)                               { return vrndnq_f32(a); }
+inline uint32x4_t  CmpGt      (float32x4_t a, float32x4_t b)                { return vcgtq_f32(a, b); }
+inline float32x4_t Select     (uint32x4_t m, float32x4_t a, float32x4_t b)  { return vbslq_f32(m, a, b); }
+inline float32x4_t CopySign   (float mag, float32x4_t sign)                 { return vbslq_f32(vdupq_n_u32(0x80000000u), sign, vdupq_n_f32(std::abs(mag))); }
+inline void        StoreUInt  (unsigned int* p, float32x4_t v)              { vst1q_u32(p, vcvtq_u32_f32(v)); }
+inline float32x4_t BitsToFloat(float32x4_t a)                               { return vcvtq_f32_s32(vreinterpretq_s32_f32(a)); }
+// clang-format on
+
+// The 8-bit estimate is refined with two Newton-Raphson steps, so that the LOD selection
+// matches the scalar path, which computes 1/sqrt exactly
+inline float32x4_t RSqrt(float32x4_t a)
+{
+    float32x4_t y = vrsqrteq_f32(a);
+    y             = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a, y), y));
+    y             = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a, y), y));
+    return y;
+}
+
+#else
+
+// No SIMD instruction set is available
+using FloatV = float;
+
+#endif
+
+template <typename V>
+inline V MulAdd(V a, V b, V c)
+{
+    return Add(Mul(a, b), c);
+}
+
+// Wraps the angle to [-pi, pi]
+template <typename V>
+inline V WrapAngle(V a)
+{
+    return Sub(a, Mul(Round(Mul(a, Splat<V>(1.f / TwoPi))), Splat<V>(TwoPi)));
+}
+
+// Computes sine and cosine of x in [-pi, pi] using the same polynomials as XMScalarSinCos
+template <typename V>
+inline void SinCos(V x, V& s, V& c)
+{
+    // Map x to [-pi/2, pi/2], where sin(x) does not change and cos(x) changes its sign
+    const auto reflect = CmpGt(Abs(x), Splat<V>(0.5f * Pi));
+    x = Select(reflect, Sub(CopySign(Pi, x), x), x);
+
+    const V x2 = Mul(x, x);
+
+    // 11-degree minimax approximation
+    V sp = Splat<V>(-2.3889859e-08f);
+    sp   = MulAdd(sp, x2, Splat<V>(2.7525562e-06f));
+    sp   = MulAdd(sp, x2, Splat<V>(-0.00019840874f));
+    sp   = MulAdd(sp, x2, Splat<V>(0.0083333310f));
+    sp   = MulAdd(sp, x2, Splat<V>(-0.16666667f));
+    sp   = MulAdd(sp, x2, Splat<V>(1.f));
+    s    = Mul(sp, x);
+
+    // 10-degree minimax approximation
+    V cp = Splat<V>(-2.6051615e-07f);
+    cp   = MulAdd(cp, x2, Splat<V>(2.4760495e-05f));
+    cp   = MulAdd(cp, x2, Splat<V>(-0.0013888378f));
+    cp   = MulAdd(cp, x2, Splat<V>(0.041666638f));
+    cp   = MulAdd(cp, x2, Splat<V>(-0.5f));
+    cp   = MulAdd(cp, x2, Splat<V>(1.f));
+    c    = Select(reflect, Sub(Splat<V>(0.f), cp), cp);
+}
+
+} // namespace
+
+
+void AsteroidsSimulationCore::Resize(size_t asteroidCount)
+{
+    mAsteroidCount = asteroidCount;
+
+    for (auto* pArray : {&mScale, &mOrbitRadius, &mOrbitHeight, &mOrbitVelocity,
+                         &mSpinAxisX, &mSpinAxisY, &mSpinAxisZ, &mSpinVelocity,
+                         &mOrbitAngle, &mSpinAngle, &mPosX, &mPosY, &mPosZ})
+    {
+        pArray->assign(asteroidCount, 0.f);
+    }
+
+    mLOD.assign(asteroidCount, 0);
+    mVisibleAsteroids.resize(asteroidCount);
+    mDynamic.assign(asteroidCount, AsteroidDynamic{});
+}
+
+void AsteroidsSimulationCore::SetAsteroid(size_t index, const AsteroidOrbit& orbit)
+{
+    assert(index < mAsteroidCount);
+    assert(orbit.scale > 0.0f);
+
+    mScale[index]         = orbit.scale;
+    mOrbitRadius[index]   = orbit.orbitRadius;
+    mOrbitHeight[index]   = orbit.orbitHeight;
+    mOrbitAngle[index]    = orbit.orbitAngle;
+    mOrbitVelocity[index] = orbit.orbitVelocity;
+    mSpinAxisX[index]     = orbit.spinAxis[0];
+    mSpinAxisY[index]     = orbit.spinAxis[1];
+    mSpinAxisZ[index]     = orbit.spinAxis[2];
+    mSpinAngle[index]     = orbit.spinAngle;
+    mSpinVelocity[index]  = orbit.spinVelocity;
+
+    // Build the initial world matrix
+    UpdateBatch<float>(index, 0.f, nullptr, true);
+}
+
+void AsteroidsSimulationCore::SetIndexOffsets(const unsigned int* indexOffsets, unsigned int subdivCount)
+{
+    assert(subdivCount < CulledLOD);
+    mSubdivCount = subdivCount;
+    mIndexOffsets.assign(indexOffsets, indexOffsets + subdivCount + 2);
+}
+
+void AsteroidsSimulationCore::SetFrustum(const float viewProjection[4][4])
+{
+    // Clip-space position is p * viewProjection, so every clip-space coordinate is a dot product
+    // of p with a column of the matrix. The frustum is -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    static const float PlaneSigns[6][2] = // Multipliers of (column, w column)
+        {
+            {+1, 1}, // Left:   w + x >= 0
+            {-1, 1}, // Right:  w - x >= 0
+            {+1, 1}, // Bottom: w + y >= 0
+            {-1, 1}, // Top:    w - y >= 0
+            {+1, 0}, // z >= 0
+            {-1, 1}, // w - z >= 0
+        };
+    static const int PlaneColumns[6] = {0, 0, 1, 1, 2, 2};
+
+    for (int p = 0; p < 6; ++p)
+    {
+        auto& plane = mFrustumPlanes[p];
+        for (int i = 0; i < 4; ++i)
+            plane[i] = PlaneSigns[p][0] * viewProjection[i][PlaneColumns[p]] + PlaneSigns[p][1] * viewProjection[i][3];
+
+        const float len = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        assert(len > 0);
+        for (auto& c : plane)
+            c /= len;
+    }
+}
+
+void AsteroidsSimulationCore::DisableFrustumCulling()
+{
+    std::memset(mFrustumPlanes, 0, sizeof(mFrustumPlanes));
+}
+
+template <typename V>
+void AsteroidsSimulationCore::UpdateBatch(size_t index, float frameTime, const float* cameraEye, bool animate)
+{
+    constexpr size_t Width = sizeof(V) / sizeof(float);
+
+    if (animate)
+    {
+        const V dt = Splat<V>(frameTime);
+
+        const V orbitAngle = WrapAngle(MulAdd(Load<V>(&mOrbitVelocity[index]), dt, Load<V>(&mOrbitAngle[index])));
+        const V spinAngle  = WrapAngle(MulAdd(Load<V>(&mSpinVelocity[index]), dt, Load<V>(&mSpinAngle[index])));
+        Store(&mOrbitAngle[index], orbitAngle);
+        Store(&mSpinAngle[index], spinAngle);
+
+        V so, co, ss, cs;
+        SinCos(orbitAngle, so, co);
+        SinCos(spinAngle, ss, cs);
+
+        // Spin rotation about the normalized axis, same as XMMatrixRotationNormal
+        const V x  = Load<V>(&mSpinAxisX[index]);
+        const V y  = Load<V>(&mSpinAxisY[index]);
+        const V z  = Load<V>(&mSpinAxisZ[index]);
+        const V t  = Sub(Splat<V>(1.f), cs);
+        const V tx = Mul(t, x);
+        const V ty = Mul(t, y);
+        const V tz = Mul(t, z);
+        const V sx = Mul(ss, x);
+        const V sy = Mul(ss, y);
+        const V sz = Mul(ss, z);
+
+        // clang-format off
+        const V spin[3][3] =
+        {
+            {MulAdd(tx, x, cs), MulAdd(tx, y, sz),  Sub(Mul(tx, z), sy)},
+            {Sub(Mul(tx, y), sz), MulAdd(ty, y, cs), MulAdd(ty, z, sx)},
+            {MulAdd(tx, z, sy), Sub(Mul(ty, z), sx), MulAdd(tz, z, cs)}
+        };
+        // clang-format on
+
+        // world = scale * spin * translate(orbitRadius, orbitHeight, 0) * rotateY(orbitAngle)
+        const V scale = Load<V>(&mScale[index]);
+        const V sco   = Mul(scale, co);
+        const V sso   = Mul(scale, so);
+
+        alignas(16) float rotation[3][3][Width];
+        for (int r = 0; r < 3; ++r)
+        {
+            Store(rotation[r][0], MulAdd(spin[r][0], sco, Mul(spin[r][2], sso)));
+            Store(rotation[r][1], Mul(spin[r][1], scale));
+            Store(rotation[r][2], Sub(Mul(spin[r][2], sco), Mul(spin[r][0], sso)));
+        }
+
+        const V radius = Load<V>(&mOrbitRadius[index]);
+        Store(&mPosX[index], Mul(radius, co));
+        Store(&mPosY[index], Load<V>(&mOrbitHeight[index]));
+        Store(&mPosZ[index], Sub(Splat<V>(0.f), Mul(radius, so)));
+
+        for (size_t lane = 0; lane < Width; ++lane)
+        {
+            auto& world = mDynamic[index + lane].world;
+            for (int r = 0; r < 3; ++r)
+            {
+                world[r][0] = rotation[r][0][lane];
+                world[r][1] = rotation[r][1][lane];
+                world[r][2] = rotation[r][2][lane];
+                world[r][3] = 0.f;
+            }
+            world[3][0] = mPosX[index + lane];
+            world[3][1] = mPosY[index + lane];
+            world[3][2] = mPosZ[index + lane];
+            world[3][3] = 1.f;
+        }
+    }
+
+    if (cameraEye != nullptr)
+    {
+        // TODO: This constant should really depend on resolution and/or be configurable...
+        static const float minSubdivSizeLog2 = std::log2(0.0019f);
+
+        // Pick LOD based on approx screen area - can be very approximate
+        const V dx = Sub(Splat<V>(cameraEye[0]), Load<V>(&mPosX[index]));
+        const V dy = Sub(Splat<V>(cameraEye[1]), Load<V>(&mPosY[index]));
+        const V dz = Sub(Splat<V>(cameraEye[2]), Load<V>(&mPosZ[index]));
+
+        const V distanceToEyeRcp = RSqrt(MulAdd(dx, dx, MulAdd(dy, dy, Mul(dz, dz))));
+        // Very approximate log2, from http://guihaire.com/code/?p=1135
+        const V relativeScreenSizeLog2 = MulAdd(BitsToFloat(Mul(Load<V>(&mScale[index]), distanceToEyeRcp)),
+                                                Splat<V>(1.1920928955078125e-7f), Splat<V>(-126.94269504f));
+        // Add one subdiv for each factor of 2 past min
+        const V subdivFloat = Min(Max(Sub(relativeScreenSizeLog2, Splat<V>(minSubdivSizeLog2)), Splat<V>(0.f)),
+                                  Splat<V>(static_cast<float>(mSubdivCount)));
+
+        unsigned int subdiv[Width];
+        StoreUInt(subdiv, subdivFloat);
+
+        // Test the bounding sphere against the frustum planes
+        V minDistance = Splat<V>(0.f);
+        for (int p = 0; p < 6; ++p)
+        {
+            const auto& plane    = mFrustumPlanes[p];
+            const V     distance = MulAdd(Load<V>(&mPosX[index]), Splat<V>(plane[0]),
+                                      MulAdd(Load<V>(&mPosY[index]), Splat<V>(plane[1]),
+                                             MulAdd(Load<V>(&mPosZ[index]), Splat<V>(plane[2]), Splat<V>(plane[3]))));
+            minDistance = p == 0 ? distance : Min(minDistance, distance);
+        }
+        const V    radius  = Mul(Load<V>(&mScale[index]), Splat<V>(mBoundingRadius));
+        const auto visible = CmpGt(Add(minDistance, radius), Splat<V>(0.f));
+        StoreUInt(&mLOD[index], Select(visible, subdivFloat, Splat<V>(static_cast<float>(CulledLOD))));
+
+        for (size_t lane = 0; lane < Width; ++lane)
+        {
+            auto& dynamicData      = mDynamic[index + lane];
+            dynamicData.indexStart = mIndexOffsets[subdiv[lane]];
+            dynamicData.indexCount = mIndexOffsets[subdiv[lane] + 1] - dynamicData.indexStart;
+        }
+    }
+}
+
+void AsteroidsSimulationCore::Update(float frameTime, const float cameraEye[3], bool animate, size_t startIndex, size_t count)
+{
+    assert(!mIndexOffsets.empty());
+
+    const size_t last = count ? startIndex + count : mAsteroidCount;
+    assert(last <= mAsteroidCount);
+
+    constexpr size_t Width = sizeof(FloatV) / sizeof(float);
+
+    // Vectors never cross the range boundaries, so that disjoint ranges can be updated in parallel
+    size_t i = startIndex;
+    for (; i + Width <= last; i += Width)
+        UpdateBatch<FloatV>(i, frameTime, cameraEye, animate);
+    for (; i < last; ++i)
+        UpdateBatch<float>(i, frameTime, cameraEye, animate);
+}
+
+void AsteroidsSimulationCore::Update(float frameTime, const float cameraEye[3], bool animate, Diligent::TaskScheduler& scheduler)
+{
+    const auto numTasks = static_cast<Diligent::Uint32>((mAsteroidCount + AsteroidsPerTask - 1) / AsteroidsPerTask);
+    mChunkLODCounts.assign(size_t{numTasks} * (mSubdivCount + 1), 0);
+
+    scheduler.ParallelFor(numTasks, [&](Diligent::Uint32, Diligent::Uint32 taskId) {
+        const size_t startIndex = size_t{taskId} * AsteroidsPerTask;
+        const size_t endIndex   = std::min(startIndex + AsteroidsPerTask, mAsteroidCount);
+        Update(frameTime, cameraEye, animate, startIndex, endIndex - startIndex);
+        CountVisibleAsteroids(taskId, startIndex, endIndex);
+    });
+
+    ComputeLODBucketOffsets(numTasks);
+
+    scheduler.ParallelFor(numTasks, [&](Diligent::Uint32, Diligent::Uint32 taskId) {
+        const size_t startIndex = size_t{taskId} * AsteroidsPerTask;
+        const size_t endIndex   = std::min(startIndex + AsteroidsPerTask, mAsteroidCount);
+        WriteVisibleAsteroids(taskId, startIndex, endIndex);
+    });
+}
+
+void AsteroidsSimulationCore::BuildDrawLists()
+{
+    mChunkLODCounts.assign(mSubdivCount + 1, 0);
+    CountVisibleAsteroids(0, 0, mAsteroidCount);
+    ComputeLODBucketOffsets(1);
+    WriteVisibleAsteroids(0, 0, mAsteroidCount);
+}
+
+void AsteroidsSimulationCore::CountVisibleAsteroids(size_t chunk, size_t startIndex, size_t endIndex)
+{
+    size_t* counts = &mChunkLODCounts[chunk * (mSubdivCount + 1)];
+    for (size_t i = startIndex; i < endIndex; ++i)
+    {
+        const auto lod = mLOD[i];
+        if (lod != CulledLOD)
+            ++counts[lod];
+    }
+}
+
+void AsteroidsSimulationCore::ComputeLODBucketOffsets(size_t numChunks)
+{
+    const size_t numLODs = mSubdivCount + 1;
+    mLODBucketOffsets.resize(numLODs + 1);
+
+    // Buckets go in LOD order, and chunks within every bucket go in index order
+    size_t offset = 0;
+    for (size_t lod = 0; lod < numLODs; ++lod)
+    {
+        mLODBucketOffsets[lod] = offset;
+        for (size_t chunk = 0; chunk < numChunks; ++chunk)
+        {
+            auto& count = mChunkLODCounts[chunk * numLODs + lod];
+            const auto chunkCount = count;
+            count = offset;
+            offset += chunkCount;
+        }
+    }
+    mLODBucketOffsets[numLODs] = offset;
+}
+
+void AsteroidsSimulationCore::WriteVisibleAsteroids(size_t chunk, size_t startIndex, size_t endIndex)
+{
+    size_t* offsets = &mChunkLODCounts[chunk * (mSubdivCount + 1)];
+    for (size_t i = startIndex; i < endIndex; ++i)
+    {
+        const auto lod = mLOD[i];
+        if (lod != CulledLOD)
+            mVisibleAsteroids[offsets[lod]++] = static_cast<unsigned int>(i);
+    }
+}
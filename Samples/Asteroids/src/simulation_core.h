@@ -0,0 +1,160 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+// Portable part of the asteroid simulation. It does not depend on DirectXMath or any
+// Windows headers, so it can be built and benchmarked on any platform.
+
+#include <cstddef>
+#include <vector>
+
+namespace Diligent
+{
+class TaskScheduler;
+}
+
+// Per-asteroid data consumed by the renderers. The world matrix uses the same layout
+// as DirectX::XMFLOAT4X4 (row-major, row vectors).
+struct AsteroidDynamic
+{
+    float world[4][4];
+    // These depend on chosen subdiv level, hence are not constant
+    unsigned int indexStart;
+    unsigned int indexCount;
+};
+
+// Initial state of an asteroid
+struct AsteroidOrbit
+{
+    float scale;
+    float orbitRadius;
+    float orbitHeight;
+    float orbitAngle;    // Initial position on the orbit, in radians
+    float orbitVelocity; // Radians per second
+    float spinAxis[3];   // Must be normalized
+    float spinAngle;
+    float spinVelocity;  // Radians per second
+};
+
+// Asteroid simulation that keeps its state in structure-of-arrays layout.
+//
+// The world matrix of every asteroid is scale * spin(spinAngle) * translate(orbitRadius, orbitHeight, 0) * rotateY(orbitAngle),
+// so the simulation only needs to integrate two angles per asteroid and rebuild the matrix from them.
+// This is equivalent to accumulating the spin and orbit rotations into the matrix every frame,
+// but does not accumulate round-off errors.
+class AsteroidsSimulationCore
+{
+public:
+    void Resize(size_t asteroidCount);
+
+    void SetAsteroid(size_t index, const AsteroidOrbit& orbit);
+
+    // indexOffsets must contain subdivCount + 2 elements: the first index of every LOD
+    // followed by the total index count.
+    void SetIndexOffsets(const unsigned int* indexOffsets, unsigned int subdivCount);
+
+    // Radius of the bounding sphere of all meshes at scale 1
+    void SetBoundingRadius(float radius) { mBoundingRadius = radius; }
+
+    // Extracts the frustum planes from the view-projection matrix (row vectors, D3D clip space)
+    // that are used by the following updates to cull asteroids.
+    void SetFrustum(const float viewProjection[4][4]);
+
+    // Makes all asteroids visible
+    void DisableFrustumCulling();
+
+    // Advances asteroids in [startIndex, startIndex + count) by frameTime seconds if animate is true,
+    // and picks the LOD of every asteroid based on its distance to the camera.
+    // count = 0 means all asteroids up to the end. Disjoint ranges can be updated from different threads.
+    void Update(float frameTime, const float cameraEye[3], bool animate, size_t startIndex = 0, size_t count = 0);
+
+    // Updates all asteroids in parallel using the scheduler and builds the draw lists.
+    // The calling thread participates in the work.
+    void Update(float frameTime, const float cameraEye[3], bool animate, Diligent::TaskScheduler& scheduler);
+
+    // Collects asteroids that passed the frustum test during the last update into per-LOD buckets.
+    // Must be called after updating all asteroids with the range version of Update().
+    void BuildDrawLists();
+
+    size_t GetAsteroidCount() const { return mAsteroidCount; }
+
+    const AsteroidDynamic* DynamicData() const { return mDynamic.data(); }
+
+    // Indices of the visible asteroids sorted by LOD, coarsest first, and by index within the LOD
+    const unsigned int* VisibleAsteroids() const { return mVisibleAsteroids.data(); }
+
+    size_t GetVisibleAsteroidCount() const { return mLODBucketOffsets.empty() ? 0 : mLODBucketOffsets.back(); }
+
+    // Range of VisibleAsteroids() that use the given subdivision level
+    void GetLODBucket(unsigned int subdiv, size_t& first, size_t& count) const
+    {
+        first = mLODBucketOffsets[subdiv];
+        count = mLODBucketOffsets[subdiv + 1] - first;
+    }
+
+    // Number of asteroids updated by a single task of the parallel update
+    static constexpr size_t AsteroidsPerTask = 2048;
+
+private:
+    // Updates asteroids [index, index + N), where N is the number of floats in V.
+    // The LOD is not updated if cameraEye is null.
+    template <typename V>
+    void UpdateBatch(size_t index, float frameTime, const float* cameraEye, bool animate);
+
+    // Draw list construction is split into three steps so that the first and the last one can run in parallel:
+    // every chunk of asteroids counts its visible asteroids in every LOD, the counts are converted to
+    // write offsets, and every chunk writes its asteroids to the buckets.
+    void CountVisibleAsteroids(size_t chunk, size_t startIndex, size_t endIndex);
+    void ComputeLODBucketOffsets(size_t numChunks);
+    void WriteVisibleAsteroids(size_t chunk, size_t startIndex, size_t endIndex);
+
+    // LOD value of the asteroids outside of the frustum
+    static constexpr unsigned int CulledLOD = 255;
+
+    size_t mAsteroidCount = 0;
+
+    // Constant data
+    std::vector<float> mScale;
+    std::vector<float> mOrbitRadius;
+    std::vector<float> mOrbitHeight;
+    std::vector<float> mOrbitVelocity;
+    std::vector<float> mSpinAxisX;
+    std::vector<float> mSpinAxisY;
+    std::vector<float> mSpinAxisZ;
+    std::vector<float> mSpinVelocity;
+
+    // Integrated state. Angles are kept in [-pi, pi].
+    std::vector<float> mOrbitAngle;
+    std::vector<float> mSpinAngle;
+
+    // World-space positions of the asteroids, updated together with the world matrices
+    std::vector<float> mPosX;
+    std::vector<float> mPosY;
+    std::vector<float> mPosZ;
+
+    // LOD picked by the last update, or CulledLOD
+    std::vector<unsigned int> mLOD;
+
+    std::vector<unsigned int> mIndexOffsets;
+    unsigned int              mSubdivCount = 0;
+
+    // Normalized frustum planes (a, b, c, d), a point is inside if a*x + b*y + c*z + d >= 0.
+    // All-zero planes accept everything.
+    float mFrustumPlanes[6][4] = {};
+    float mBoundingRadius      = 1.f;
+
+    std::vector<unsigned int> mVisibleAsteroids;
+    std::vector<size_t>       mLODBucketOffsets;
+    // Per-chunk, per-LOD counts of visible asteroids that are then replaced with write offsets
+    std::vector<size_t> mChunkLODCounts;
+
+    std::vector<AsteroidDynamic> mDynamic;
+};
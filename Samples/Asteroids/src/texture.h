@@ -14,14 +14,6 @@
 #include <d3dx12.h>
 #include <d3d11.h>
 
-void GenerateMips2D_XXXX8(D3D11_SUBRESOURCE_DATA* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels);
-
-// Will generate mips (into subresources array) is mipLevels > 0
-void FillNoise2D_RGBA8(D3D11_SUBRESOURCE_DATA* subresources, size_t width, size_t height, size_t mipLevels,
-                       float seed, float persistence, float noiseScale, float noiseStrength,
-					   float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
-
-
 // Helper for uploading initial texture data in D3D12; as with D3D11, one initialData structure per subresource
 // Creates temporary resources internally and syncs with GPU... this is a convenience function for init time!
 // NOTE: Currently textures with mip chain must be pow2!
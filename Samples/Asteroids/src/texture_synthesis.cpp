@@ -0,0 +1,496 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "texture_synthesis.h"
+
+#include <algorithm>
+#include <cassert>
+#include <random>
+
+#include "TaskScheduler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define ASTEROIDS_TEXTURE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define ASTEROIDS_TEXTURE_NEON 1
+#endif
+
+// Permutation table from simplexnoise1234.c
+extern "C" unsigned char perm[512];
+
+namespace
+{
+
+// Minimal set of vector operations required by the noise.
+// Scalar versions are always available and are used for the texels that do not fill a whole vector.
+template <typename V> V Load(const float* p);
+template <typename V> V Splat(float f);
+
+// clang-format off
+template <> inline float Load<float> (const float* p) { return *p; }
+template <> inline float Splat<float>(float f)        { return f; }
+
+inline void  Store (float* p, float v)        { *p = v; }
+inline float Add   (float a, float b)         { return a + b; }
+inline float Sub   (float a, float b)         { return a - b; }
+inline float Mul   (float a, float b)         { return a * b; }
+inline float Min   (float a, float b)         { return a < b ? a : b; }
+inline float Max   (float a, float b)         { return a > b ? a : b; }
+inline float Trunc (float a)                  { return static_cast<float>(static_cast<int>(a)); }
+inline bool  CmpGt (float a, float b)         { return a > b; }
+inline bool  CmpGe (float a, float b)         { return a >= b; }
+inline float Select(bool m, float a, float b) { return m ? a : b; }
+// clang-format on
+
+#if ASTEROIDS_TEXTURE_SSE2
+
+using FloatV = __m128;
+
+// clang-format off
+template <> inline __m128 Load<__m128> (const float* p) { return _mm_loadu_ps(p); }
+template <> inline __m128 Splat<__m128>(float f)        { return _mm_set1_ps(f); }
+
+inline void   Store (float* p, __m128 v)           { _mm_storeu_ps(p, v); }
+inline __m128 Add   (__m128 a, __m128 b)           { return _mm_add_ps(a, b); }
+inline __m128 Sub   (__m128 a, __m128 b)           { return _mm_sub_ps(a, b); }
+inline __m128 Mul   (__m128 a, __m128 b)           { return _mm_mul_ps(a, b); }
+inline __m128 Min   (__m128 a, __m128 b)           { return _mm_min_ps(a, b); }
+inline __m128 Max   (__m128 a, __m128 b)           { return _mm_max_ps(a, b); }
+inline __m128 Trunc (__m128 a)                     { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+inline __m128 CmpGt (__m128 a, __m128 b)           { return _mm_cmpgt_ps(a, b); }
+inline __m128 CmpGe (__m128 a, __m128 b)           { return _mm_cmpge_ps(a, b); }
+inline __m128 Select(__m128 m, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+// clang-format on
+
+#elif ASTEROIDS_TEXTURE_NEON
+
+using FloatV = float32x4_t;
+
+// clang-format off
+template <> inline float32x4_t Load<float32x4_t> (const float* p) { return vld1q_f32(p); }
+template <> inline float32x4_t Splat<float32x4_t>(float f)        { return vdupq_n_f32(f); }
+
+inline void        Store (float* p, float32x4_t v)                    { vst1q_f32(p, v); }
+inline float32x4_t Add   (float32x4_t a, float32x4_t b)               { return vaddq_f32(a, b); }
+inline float32x4_t Sub   (float32x4_t a, float32x4_t b)               { return vsubq_f32(a, b); }
+inline float32x4_t Mul   (float32x4_t a, float32x4_t b)               { return vmulq_f32(a, b); }
+inline float32x4_t Min   (float32x4_t a, float32x4_t b)               { return vminq_f32(a, b); }
+inline float32x4_t Max   (float32x4_t a, float32x4_t b)               { return vmaxq_f32(a, b); }
+inline float32x4_t Trunc (float32x4_t a)                              { return vcvtq_f32_s32(vcvtq_s32_f32(a)); }
+inline uint32x4_t  CmpGt (float32x4_t a, float32x4_t b)               { return vcgtq_f32(a, b); }
+inline uint32x4_t  CmpGe (float32x4_t a, float32x4_t b)               { return vcgeq_f32(a, b); }
+inline float32x4_t Select(uint32x4_t m, float32x4_t a, float32x4_t b) { return vbslq_f32(m, a, b); }
+// clang-format on
+
+#else
+
+// No SIMD instruction set is available
+using FloatV = float;
+
+#endif
+
+// Same as FASTFLOOR in simplexnoise1234.c
+template <typename V>
+inline V FastFloor(V x)
+{
+    return Sub(Trunc(x), Select(CmpGt(x, Splat<V>(0.f)), Splat<V>(0.f), Splat<V>(1.f)));
+}
+
+// Picks a per-lane constant for the order of the simplex corners, following the branches in snoise3()
+template <typename V, typename M>
+inline V SelectOrder(M xy, M yz, M xz, float XYZ, float XZY, float ZXY, float ZYX, float YZX, float YXZ)
+{
+    return Select(xy,
+                  Select(yz, Splat<V>(XYZ), Select(xz, Splat<V>(XZY), Splat<V>(ZXY))),
+                  Select(yz, Select(xz, Splat<V>(YXZ), Splat<V>(YZX)), Splat<V>(ZYX)));
+}
+
+// Gradients selected by grad3() for the low 4 bits of the hash.
+// The dot product with the gradient is the same as the sum computed by grad3().
+// clang-format off
+const float Grad3[16][3] =
+{
+    { 1, 1, 0}, {-1, 1, 0}, { 1,-1, 0}, {-1,-1, 0},
+    { 1, 0, 1}, {-1, 0, 1}, { 1, 0,-1}, {-1, 0,-1},
+    { 0, 1, 1}, { 0,-1, 1}, { 0, 1,-1}, { 0,-1,-1},
+    { 1, 1, 0}, { 0,-1, 1}, {-1, 1, 0}, { 0,-1,-1},
+};
+// clang-format on
+
+template <typename V>
+inline V CornerContribution(V x, V y, V z, const float* gx, const float* gy, const float* gz)
+{
+    V t = Sub(Sub(Sub(Splat<V>(0.6f), Mul(x, x)), Mul(y, y)), Mul(z, z));
+    t   = Max(t, Splat<V>(0.f));
+    t   = Mul(t, t);
+
+    const V grad = Add(Add(Mul(Load<V>(gx), x), Mul(Load<V>(gy), y)), Mul(Load<V>(gz), z));
+    return Mul(Mul(t, t), grad);
+}
+
+// 3D simplex noise, same algorithm as snoise3() in simplexnoise1234.c. Only the permutation
+// table lookups are done per lane. Skewing factors are evaluated in single precision, so the
+// result may differ from snoise3() in the last bits.
+template <typename V>
+V SimplexNoise3(V x, V y, V z)
+{
+    constexpr size_t Width = sizeof(V) / sizeof(float);
+
+    const float F3 = 1.f / 3.f;
+    const float G3 = 1.f / 6.f;
+
+    // Skew the input space to determine which simplex cell we're in
+    const V s = Mul(Add(Add(x, y), z), Splat<V>(F3));
+    const V i = FastFloor(Add(x, s));
+    const V j = FastFloor(Add(y, s));
+    const V k = FastFloor(Add(z, s));
+
+    // Unskew the cell origin back to (x,y,z) space and compute the distances from it
+    const V t  = Mul(Add(Add(i, j), k), Splat<V>(G3));
+    const V x0 = Sub(x, Sub(i, t));
+    const V y0 = Sub(y, Sub(j, t));
+    const V z0 = Sub(z, Sub(k, t));
+
+    const auto xy = CmpGe(x0, y0);
+    const auto yz = CmpGe(y0, z0);
+    const auto xz = CmpGe(x0, z0);
+
+    // Offsets of the second and the third corners of the simplex in (i,j,k) coords
+    const V i1 = SelectOrder<V>(xy, yz, xz, 1, 1, 0, 0, 0, 0);
+    const V j1 = SelectOrder<V>(xy, yz, xz, 0, 0, 0, 0, 1, 1);
+    const V k1 = SelectOrder<V>(xy, yz, xz, 0, 0, 1, 1, 0, 0);
+    const V i2 = SelectOrder<V>(xy, yz, xz, 1, 1, 1, 0, 0, 1);
+    const V j2 = SelectOrder<V>(xy, yz, xz, 1, 0, 0, 1, 1, 1);
+    const V k2 = SelectOrder<V>(xy, yz, xz, 0, 1, 1, 1, 1, 0);
+
+    // Hash the corners and look up their gradients
+    alignas(16) float cell[9][Width];
+    Store(cell[0], i);
+    Store(cell[1], j);
+    Store(cell[2], k);
+    Store(cell[3], i1);
+    Store(cell[4], j1);
+    Store(cell[5], k1);
+    Store(cell[6], i2);
+    Store(cell[7], j2);
+    Store(cell[8], k2);
+
+    alignas(16) float grad[4][3][Width];
+    for (size_t lane = 0; lane < Width; ++lane)
+    {
+        // Wrap the integer indices at 256, to avoid indexing perm[] out of bounds
+        const int ii = static_cast<int>(cell[0][lane]) & 0xff;
+        const int jj = static_cast<int>(cell[1][lane]) & 0xff;
+        const int kk = static_cast<int>(cell[2][lane]) & 0xff;
+
+        const int offsets[4][3] =
+            {
+                {0, 0, 0},
+                {static_cast<int>(cell[3][lane]), static_cast<int>(cell[4][lane]), static_cast<int>(cell[5][lane])},
+                {static_cast<int>(cell[6][lane]), static_cast<int>(cell[7][lane]), static_cast<int>(cell[8][lane])},
+                {1, 1, 1},
+            };
+        for (int c = 0; c < 4; ++c)
+        {
+            const int h = perm[ii + offsets[c][0] + perm[jj + offsets[c][1] + perm[kk + offsets[c][2]]]] & 15;
+            for (int d = 0; d < 3; ++d)
+                grad[c][d][lane] = Grad3[h][d];
+        }
+    }
+
+    // Offsets of the remaining corners in (x,y,z) coords
+    const V x1 = Add(Sub(x0, i1), Splat<V>(G3));
+    const V y1 = Add(Sub(y0, j1), Splat<V>(G3));
+    const V z1 = Add(Sub(z0, k1), Splat<V>(G3));
+    const V x2 = Add(Sub(x0, i2), Splat<V>(2.f * G3));
+    const V y2 = Add(Sub(y0, j2), Splat<V>(2.f * G3));
+    const V z2 = Add(Sub(z0, k2), Splat<V>(2.f * G3));
+    const V x3 = Add(Sub(x0, Splat<V>(1.f)), Splat<V>(3.f * G3));
+    const V y3 = Add(Sub(y0, Splat<V>(1.f)), Splat<V>(3.f * G3));
+    const V z3 = Add(Sub(z0, Splat<V>(1.f)), Splat<V>(3.f * G3));
+
+    const V n0 = CornerContribution(x0, y0, z0, grad[0][0], grad[0][1], grad[0][2]);
+    const V n1 = CornerContribution(x1, y1, z1, grad[1][0], grad[1][1], grad[1][2]);
+    const V n2 = CornerContribution(x2, y2, z2, grad[2][0], grad[2][1], grad[2][2]);
+    const V n3 = CornerContribution(x3, y3, z3, grad[3][0], grad[3][1], grad[3][2]);
+
+    return Mul(Splat<V>(32.f), Add(Add(Add(n0, n1), n2), n3));
+}
+
+// Fills Width texels of a row starting at column x
+template <typename V>
+void FillNoiseTexels(std::uint32_t* row, size_t x, float y, float seed, const float (&weights)[4], float weightNorm,
+                     float noiseScale, float noiseStrength, float redScale, float greenScale, float blueScale)
+{
+    constexpr size_t Width = sizeof(V) / sizeof(float);
+
+    alignas(16) float columns[Width];
+    for (size_t lane = 0; lane < Width; ++lane)
+        columns[lane] = static_cast<float>(x + lane);
+
+    // Same as NoiseOctaves<4>
+    V nx = Mul(Load<V>(columns), Splat<V>(noiseScale));
+    V ny = Splat<V>(y * noiseScale);
+    V nz = Splat<V>(seed);
+    V r  = Splat<V>(0.f);
+    for (float weight : weights)
+    {
+        r  = Add(r, Mul(Splat<V>(weight), SimplexNoise3(nx, ny, nz)));
+        nx = Add(nx, nx);
+        ny = Add(ny, ny);
+        nz = Add(nz, nz);
+    }
+    V c = Add(Mul(r, Splat<V>(weightNorm)), Splat<V>(0.5f));
+    c   = Max(Splat<V>(0.f), Min(Splat<V>(1.f), Add(Mul(Sub(c, Splat<V>(0.5f)), Splat<V>(noiseStrength)), Splat<V>(0.5f))));
+
+    alignas(16) float intensity[Width];
+    Store(intensity, c);
+    for (size_t lane = 0; lane < Width; ++lane)
+    {
+        const auto cr = static_cast<std::uint32_t>(intensity[lane] * redScale);
+        const auto cg = static_cast<std::uint32_t>(intensity[lane] * greenScale);
+        const auto cb = static_cast<std::uint32_t>(intensity[lane] * blueScale);
+        assert(cr < 256 && cg < 256 && cb < 256);
+
+        row[x + lane] = cr << 16 | cg << 8 | cb << 0;
+    }
+}
+
+// Averages 2x2 blocks of texels from two source rows into one destination row
+void DownsampleRow(const std::uint8_t* rowSrc0, const std::uint8_t* rowSrc1, std::uint8_t* rowDst, size_t width)
+{
+    size_t x = 0;
+
+#if ASTEROIDS_TEXTURE_SSE2
+    // Four destination texels at a time
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i sums[2];
+        for (int half = 0; half < 2; ++half)
+        {
+            const __m128i src0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowSrc0 + x * 8 + half * 16));
+            const __m128i src1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowSrc1 + x * 8 + half * 16));
+            // Vertical sums of texels 0,1 and 2,3, 16 bits per component
+            const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(src0, zero), _mm_unpacklo_epi8(src1, zero));
+            const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(src0, zero), _mm_unpackhi_epi8(src1, zero));
+            // Horizontal sums of the texel pairs
+            sums[half] = _mm_unpacklo_epi64(_mm_add_epi16(lo, _mm_srli_si128(lo, 8)), _mm_add_epi16(hi, _mm_srli_si128(hi, 8)));
+            sums[half] = _mm_srli_epi16(sums[half], 2);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rowDst + x * 4), _mm_packus_epi16(sums[0], sums[1]));
+    }
+#elif ASTEROIDS_TEXTURE_NEON
+    // Four destination texels at a time
+    for (; x + 4 <= width; x += 4)
+    {
+        // Deinterleave even and odd source texels
+        const uint32x4x2_t src0 = vld2q_u32(reinterpret_cast<const std::uint32_t*>(rowSrc0 + x * 8));
+        const uint32x4x2_t src1 = vld2q_u32(reinterpret_cast<const std::uint32_t*>(rowSrc1 + x * 8));
+
+        const uint8x16_t even0 = vreinterpretq_u8_u32(src0.val[0]);
+        const uint8x16_t odd0  = vreinterpretq_u8_u32(src0.val[1]);
+        const uint8x16_t even1 = vreinterpretq_u8_u32(src1.val[0]);
+        const uint8x16_t odd1  = vreinterpretq_u8_u32(src1.val[1]);
+
+        const uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(even0), vget_low_u8(odd0)), vaddl_u8(vget_low_u8(even1), vget_low_u8(odd1)));
+        const uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(even0), vget_high_u8(odd0)), vaddl_u8(vget_high_u8(even1), vget_high_u8(odd1)));
+        vst1q_u8(rowDst + x * 4, vcombine_u8(vshrn_n_u16(lo, 2), vshrn_n_u16(hi, 2)));
+    }
+#endif
+
+    for (; x < width; ++x)
+    {
+        for (size_t comp = 0; comp < 4; ++comp)
+        {
+            std::uint32_t c = rowSrc0[x * 8 + comp + 0];
+            c += rowSrc0[x * 8 + comp + 4];
+            c += rowSrc1[x * 8 + comp + 0];
+            c += rowSrc1[x * 8 + comp + 4];
+            rowDst[4 * x + comp] = static_cast<std::uint8_t>(c / 4);
+        }
+    }
+}
+
+} // namespace
+
+
+void GenerateMips2D_RGBA8(const TextureSubresourceRGBA8* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels)
+{
+    for (size_t m = 1; m < mipLevels; ++m)
+    {
+        const auto& src = subresources[m - 1];
+        const auto& dst = subresources[m];
+
+        const auto width  = widthLevel0 >> m;
+        const auto height = heightLevel0 >> m;
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            DownsampleRow(src.data + (y * 2 + 0) * src.rowPitch,
+                          src.data + (y * 2 + 1) * src.rowPitch,
+                          dst.data + y * dst.rowPitch,
+                          width);
+        }
+    }
+}
+
+void FillNoise2D_RGBA8(const TextureSubresourceRGBA8* subresources, size_t width, size_t height, size_t mipLevels,
+                       float seed, float persistence, float noiseScale, float noiseStrength,
+                       float redScale, float greenScale, float blueScale)
+{
+    // Same weights as NoiseOctaves<4>
+    float weights[4];
+    float weightSum = 0.0f;
+    for (auto& weight : weights)
+    {
+        weight = persistence;
+        weightSum += persistence;
+        persistence *= persistence;
+    }
+    const float weightNorm = 0.5f / weightSum;
+
+    constexpr size_t Width = sizeof(FloatV) / sizeof(float);
+
+    // Level 0
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto* row = reinterpret_cast<std::uint32_t*>(subresources[0].data + y * subresources[0].rowPitch);
+
+        size_t x = 0;
+        for (; x + Width <= width; x += Width)
+            FillNoiseTexels<FloatV>(row, x, static_cast<float>(y), seed, weights, weightNorm, noiseScale, noiseStrength, redScale, greenScale, blueScale);
+        for (; x < width; ++x)
+            FillNoiseTexels<float>(row, x, static_cast<float>(y), seed, weights, weightNorm, noiseScale, noiseStrength, redScale, greenScale, blueScale);
+    }
+
+    if (mipLevels > 1)
+        GenerateMips2D_RGBA8(subresources, width, height, mipLevels);
+}
+
+
+size_t AsteroidTextureSet::ComputeDataSize(unsigned int textureCount, unsigned int textureDim, unsigned int arraySize)
+{
+    const size_t texelSizeInBytes   = 4; // RGBA8
+    const size_t extraSpaceForMips  = 2;
+    size_t       textureSizeInBytes = texelSizeInBytes * textureDim * textureDim * arraySize * extraSpaceForMips;
+    textureSizeInBytes              = (textureSizeInBytes + 63) & ~size_t{63}; // Avoid false sharing
+    return textureSizeInBytes * textureCount;
+}
+
+void AsteroidTextureSet::InitLayout(unsigned int textureCount, unsigned int textureDim, unsigned int arraySize)
+{
+    assert(textureDim > 0 && (textureDim & (textureDim - 1)) == 0); // Must be pow2 currently; we don't handle wacky mip chains
+
+    mTextureCount = textureCount;
+    mTextureDim   = textureDim;
+    mArraySize    = arraySize;
+    mMipLevels    = 1;
+    while ((textureDim >> mMipLevels) != 0)
+        ++mMipLevels;
+
+    const size_t textureSizeInBytes = ComputeDataSize(1, textureDim, arraySize);
+
+    mDataSize = textureSizeInBytes * textureCount;
+    mSubresourceOffsets.resize(size_t{textureCount} * arraySize * mMipLevels);
+    for (unsigned int t = 0; t < textureCount; ++t)
+    {
+        size_t offset = t * textureSizeInBytes;
+        for (unsigned int a = 0; a < arraySize; ++a)
+        {
+            for (unsigned int m = 0; m < mMipLevels; ++m)
+            {
+                mSubresourceOffsets[m + mMipLevels * (a + arraySize * t)] = offset;
+                offset += GetRowPitch(m) * (textureDim >> m);
+            }
+        }
+    }
+}
+
+void AsteroidTextureSet::Attach(const std::uint8_t* data, unsigned int textureCount, unsigned int textureDim, unsigned int arraySize)
+{
+    InitLayout(textureCount, textureDim, arraySize);
+    mData.clear();
+    mBaseData = data;
+}
+
+void AsteroidTextureSet::Create(unsigned int textureCount, unsigned int textureDim, unsigned int arraySize, unsigned int rngSeed,
+                                Diligent::TaskScheduler* scheduler)
+{
+    InitLayout(textureCount, textureDim, arraySize);
+    mData.resize(mDataSize);
+    mBaseData = mData.data();
+
+    std::vector<TextureSubresourceRGBA8> subresources(mSubresourceOffsets.size());
+    for (size_t s = 0; s < subresources.size(); ++s)
+    {
+        subresources[s].data     = mData.data() + mSubresourceOffsets[s];
+        subresources[s].rowPitch = GetRowPitch(static_cast<unsigned int>(s % mMipLevels));
+    }
+
+    // Draw the random parameters of all textures up front, so that the slices can be generated in any order
+    struct SliceParams
+    {
+        float seed;
+        float persistence;
+        float noiseScale;
+    };
+    std::vector<SliceParams> sliceParams(size_t{textureCount} * arraySize);
+    {
+        std::mt19937 seeds(rngSeed);
+        for (unsigned int t = 0; t < textureCount; ++t)
+        {
+            std::mt19937 rng(seeds());
+            auto randomNoise       = std::uniform_real_distribution<float>(0.0f, 10000.0f);
+            auto randomNoiseScale  = std::uniform_real_distribution<float>(100, 150);
+            auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
+
+            // Use same parameters for each of the tri-planar projection planes/cube map faces/etc.
+            const float noiseScale  = randomNoiseScale(rng) / float(textureDim);
+            const float persistence = randomPersistence(rng);
+            for (unsigned int a = 0; a < arraySize; ++a)
+                sliceParams[size_t{t} * arraySize + a] = SliceParams{randomNoise(rng), persistence, noiseScale};
+        }
+    }
+
+    auto createSlice = [&](size_t slice) {
+        const auto& params   = sliceParams[slice];
+        const float strength = 1.5f;
+
+        float redScale   = 255.0f;
+        float greenScale = 255.0f;
+        float blueScale  = 255.0f;
+
+        // DEBUG colors
+#if 0
+        const auto t = slice / arraySize;
+        redScale   = t & 1 ? 255.0f : 0.0f;
+        greenScale = t & 2 ? 255.0f : 0.0f;
+        blueScale  = t & 4 ? 255.0f : 0.0f;
+#endif
+
+        FillNoise2D_RGBA8(&subresources[slice * mMipLevels], textureDim, textureDim, mMipLevels,
+                          params.seed, params.persistence, params.noiseScale, strength,
+                          redScale, greenScale, blueScale);
+    };
+
+    if (scheduler != nullptr)
+    {
+        scheduler->ParallelFor(static_cast<Diligent::Uint32>(sliceParams.size()),
+                               [&](Diligent::Uint32, Diligent::Uint32 slice) { createSlice(slice); });
+    }
+    else
+    {
+        for (size_t slice = 0; slice < sliceParams.size(); ++slice)
+            createSlice(slice);
+    }
+}
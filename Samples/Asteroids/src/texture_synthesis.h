@@ -0,0 +1,86 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+// Procedural asteroid textures. Like the simulation core, this does not depend on
+// DirectXMath or any Windows headers.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Diligent
+{
+class TaskScheduler;
+}
+
+// One mip level of a 2D RGBA8 texture in memory
+struct TextureSubresourceRGBA8
+{
+    std::uint8_t* data;
+    size_t        rowPitch;
+};
+
+// Generates mip levels [1, mipLevels) by averaging 2x2 texel blocks of the previous level.
+// Dimensions must be powers of two.
+void GenerateMips2D_RGBA8(const TextureSubresourceRGBA8* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels);
+
+// Fills the first level with NoiseOctaves<4> noise and generates the remaining levels if mipLevels > 1.
+// Noise is evaluated for four texels at a time using SSE2 or NEON when available.
+void FillNoise2D_RGBA8(const TextureSubresourceRGBA8* subresources, size_t width, size_t height, size_t mipLevels,
+                       float seed, float persistence, float noiseScale, float noiseStrength,
+                       float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
+
+// A set of noise texture arrays with full mip chains, stored in a single allocation
+class AsteroidTextureSet
+{
+public:
+    // Creates textureCount arrays of arraySize textureDim x textureDim textures. textureDim must be a power of two.
+    // Array slices are generated in parallel if scheduler is not null. The result does not depend on the scheduler.
+    void Create(unsigned int textureCount, unsigned int textureDim, unsigned int arraySize, unsigned int rngSeed,
+                Diligent::TaskScheduler* scheduler = nullptr);
+
+    // Uses texture data previously created by Create() with the same parameters, e.g. mapped from a file.
+    // The data is not copied and must outlive the set.
+    void Attach(const std::uint8_t* data, unsigned int textureCount, unsigned int textureDim, unsigned int arraySize);
+
+    // Size of the data created with the given parameters
+    static size_t ComputeDataSize(unsigned int textureCount, unsigned int textureDim, unsigned int arraySize);
+
+    unsigned int GetTextureCount() const { return mTextureCount; }
+    unsigned int GetTextureDim() const { return mTextureDim; }
+    unsigned int GetArraySize() const { return mArraySize; }
+    unsigned int GetMipLevels() const { return mMipLevels; }
+
+    // All texture data, GetDataSize() bytes
+    const std::uint8_t* GetData() const { return mBaseData; }
+    size_t              GetDataSize() const { return mDataSize; }
+
+    // Subresources are ordered by texture, then by array slice, then by mip level
+    const std::uint8_t* GetSubresourceData(unsigned int texture, unsigned int arrayElement = 0, unsigned int mip = 0) const
+    {
+        return mBaseData + mSubresourceOffsets[mip + mMipLevels * (arrayElement + mArraySize * texture)];
+    }
+    size_t GetRowPitch(unsigned int mip) const { return size_t{mTextureDim >> mip} * 4; }
+
+private:
+    void InitLayout(unsigned int textureCount, unsigned int textureDim, unsigned int arraySize);
+
+    unsigned int mTextureCount = 0;
+    unsigned int mTextureDim   = 0;
+    unsigned int mArraySize    = 0;
+    unsigned int mMipLevels    = 0;
+
+    std::vector<size_t>       mSubresourceOffsets;
+    size_t                    mDataSize = 0;
+    std::vector<std::uint8_t> mData; // Empty if the data is attached
+    const std::uint8_t*       mBaseData = nullptr;
+};
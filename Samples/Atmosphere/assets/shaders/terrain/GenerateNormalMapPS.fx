@@ -30,6 +30,15 @@ float3 ComputeNormal(int2 i2ElevMapIJ,
     int j1  = min( j0 + 1, MipHeight - 1 );
     int j_1 = max( j0 - 1, 0 );
 
+    if( g_NMGenerationAttribs.m_iWrapCoords != 0 )
+    {
+        // The texture is addressed toroidally
+        i1  = (i0 + 1) & (MipWidth - 1);
+        i_1 = (i0 + MipWidth - 1) & (MipWidth - 1);
+        j1  = (j0 + 1) & (MipHeight - 1);
+        j_1 = (j0 + MipHeight - 1) & (MipHeight - 1);
+    }
+
 #   define GET_ELEV(i,j) float( g_tex2DElevationMap.Load(int3(i,j, MIPLevel)) )
 
 #if 1
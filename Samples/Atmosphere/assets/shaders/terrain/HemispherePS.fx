@@ -20,13 +20,21 @@ cbuffer cbLightAttribs
     LightAttribs g_LightAttribs;
 };
 
+cbuffer cbNormalMapAttribs
+{
+    NormalMapAttribs g_NormalMapAttribs;
+};
+
 
 #define EARTH_REFLECTANCE 0.4
 
 
-// Normal map stores only x,y components. z component is calculated as sqrt(1 - x^2 - y^2)
-Texture2D    g_tex2DNormalMap;
-SamplerState g_tex2DNormalMap_sampler; // Linear Mirror
+// Normal maps store only x,y components. z component is calculated as sqrt(1 - x^2 - y^2)
+Texture2D    g_tex2DCoarseNormalMap;
+SamplerState g_tex2DCoarseNormalMap_sampler; // Linear Mirror
+
+Texture2D    g_tex2DDetailNormalMap;
+SamplerState g_tex2DDetailNormalMap_sampler; // Linear Wrap
 
 Texture2D<float4> g_tex2DMtrlMap;
 SamplerState      g_tex2DMtrlMap_sampler; // Linear Mirror
@@ -124,11 +132,22 @@ void HemispherePS(in float4 f4Pos : SV_Position,
     float3 EarthTangent = normalize(VSOut.f3Tangent);
     float3 EarthBitangent = normalize(VSOut.f3Bitangent);
     float3 f3TerrainNormal;
-    f3TerrainNormal.xz = g_tex2DNormalMap.Sample(g_tex2DNormalMap_sampler, VSOut.f2MaskUV0.xy).xy * float2(2.0,2.0) - float2(1.0,1.0);
+    float2 f2CoarseUV = VSOut.f2MaskUV0.xy * g_NormalMapAttribs.f2CoarseUVScale;
+    f3TerrainNormal.xz = g_tex2DCoarseNormalMap.Sample(g_tex2DCoarseNormalMap_sampler, f2CoarseUV).xy * float2(2.0,2.0) - float2(1.0,1.0);
     // Since UVs are mirrored, we have to adjust normal coords accordingly:
-    float2 f2XZSign = sign( float2(0.5,0.5) - frac(VSOut.f2MaskUV0.xy/2.0) );
+    float2 f2XZSign = sign( float2(0.5,0.5) - frac(f2CoarseUV/2.0) );
     f3TerrainNormal.xz *= f2XZSign;
 
+    // The detail normal map is generated from the mirrored height map, so its normals do not need to be flipped
+    float2 f2DetailPos = VSOut.f2MaskUV0.xy * g_NormalMapAttribs.f2TerrainDim - g_NormalMapAttribs.f2DetailWindowStart;
+    float2 f2DetailUV  = f2DetailPos / g_NormalMapAttribs.fDetailWindowSize + g_NormalMapAttribs.f2DetailUVBias;
+    float2 f2DetailNormalXZ = g_tex2DDetailNormalMap.Sample(g_tex2DDetailNormalMap_sampler, f2DetailUV).xy * float2(2.0,2.0) - float2(1.0,1.0);
+    // Normals of the patches on the window border are computed from the wrapped-around samples, so the detail map
+    // is only used further inside the window
+    float2 f2BorderDist  = min(f2DetailPos, float2(g_NormalMapAttribs.fDetailWindowSize, g_NormalMapAttribs.fDetailWindowSize) - f2DetailPos);
+    float  fDetailWeight = saturate(min(f2BorderDist.x, f2BorderDist.y) / g_NormalMapAttribs.fDetailBlendWidth - 1.0);
+    f3TerrainNormal.xz = lerp(f3TerrainNormal.xz, f2DetailNormalXZ, fDetailWeight);
+
     f3TerrainNormal.y = sqrt( saturate(1.0 - dot(f3TerrainNormal.xz,f3TerrainNormal.xz)) );
     //float3 Tangent   = normalize(float3(1,0,VSOut.HeightMapGradients.x));
     //float3 Bitangent = normalize(float3(0,1,VSOut.HeightMapGradients.y));
@@ -28,6 +28,7 @@
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <thread>
 
 #include "AtmosphereSample.hpp"
 #include "MapHelper.hpp"
@@ -36,6 +37,7 @@
 #include "imGuIZMO.h"
 #include "PlatformMisc.hpp"
 #include "ImGuiUtils.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -109,10 +111,13 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
     m_strNormalMapTexPaths[3] = "Terrain\\Tiles\\Snow_NM.jpg";
     m_strNormalMapTexPaths[4] = "Terrain\\Tiles\\grass_NM.dds";
 
+    // Terrain data and geometry are generated by all hardware threads
+    TaskScheduler Scheduler{std::max(std::thread::hardware_concurrency(), 2u) - 1};
+
     // Create data source
     try
     {
-        m_pElevDataSource.reset(new ElevationDataSource(m_strRawDEMDataFile.c_str()));
+        m_pElevDataSource.reset(new ElevationDataSource(m_strRawDEMDataFile.c_str(), &Scheduler));
         m_pElevDataSource->SetOffsets(m_TerrainRenderParams.m_iColOffset, m_TerrainRenderParams.m_iRowOffset);
         m_fMinElevation = m_pElevDataSource->GetGlobalMinElevation() * m_TerrainRenderParams.m_TerrainAttribs.m_fElevationScale;
         m_fMaxElevation = m_pElevDataSource->GetGlobalMaxElevation() * m_TerrainRenderParams.m_TerrainAttribs.m_fElevationScale;
@@ -146,7 +151,8 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
                              strNormalMapPaths,
                              m_pcbCameraAttribs,
                              m_pcbLightAttribs,
-                             pcMediaScatteringParams);
+                             pcMediaScatteringParams,
+                             &Scheduler);
 
     CreateShadowMap();
 }
@@ -565,6 +571,9 @@ void AtmosphereSample::Render()
     // m_iFirstCascade must be initialized before calling RenderShadowMap()!
     m_PPAttribs.iFirstCascadeToRayMarch = std::min(m_PPAttribs.iFirstCascadeToRayMarch, m_TerrainRenderParams.m_iNumShadowCascades - 1);
 
+    // Stream the height map patches around the camera. This changes render targets.
+    m_EarthHemisphere.UpdateDetailNormalMap(m_pImmediateContext, m_f3CameraPos);
+
     RenderShadowMap(m_pImmediateContext, LightAttrs, m_mCameraView, m_mCameraProj);
 
     LightAttrs.ShadowAttribs.bVisualizeCascades = m_ShadowSettings.bVisualizeCascades ? TRUE : FALSE;
@@ -0,0 +1,305 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+// Standalone benchmark of the HierarchyArray layout. Usage:
+//
+//   AtmosphereHierarchyArrayBenchmark [-levels N] [-iterations N]
+//
+// Compares HierarchyArray, which stores all levels in one array in Morton order, with the previous
+// layout, which stored every level in a separate row-major array. Measures the bottom-up min/max
+// computation, a top-down culling traversal and leaf-to-root ancestor walks.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "HierarchyArray.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+using MinMaxElevation = std::pair<Uint16, Uint16>;
+
+// The previous HierarchyArray layout
+template <class T>
+class RowMajorHierarchyArray
+{
+public:
+    T& operator[](const QuadTreeNodeLocation& at)
+    {
+        return m_data[at.level][at.horzOrder + (at.vertOrder << at.level)];
+    }
+    const T& operator[](const QuadTreeNodeLocation& at) const
+    {
+        return m_data[at.level][at.horzOrder + (at.vertOrder << at.level)];
+    }
+
+    void Resize(size_t numLevelsInHierarchy)
+    {
+        m_data.resize(numLevelsInHierarchy);
+        for (size_t level = 0; level < numLevelsInHierarchy; ++level)
+        {
+            size_t numElementsInLevel = (size_t)1 << level;
+            m_data[level].resize(numElementsInLevel * numElementsInLevel);
+        }
+    }
+
+private:
+    std::vector<std::vector<T>> m_data;
+};
+
+template <typename HandlerType>
+double MeasureTime(int NumIterations, HandlerType&& Handler)
+{
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < NumIterations; ++i)
+        Handler();
+    const auto EndTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(EndTime - StartTime).count() / NumIterations;
+}
+
+MinMaxElevation CombineChildren(const MinMaxElevation& LB, const MinMaxElevation& RB, const MinMaxElevation& LT, const MinMaxElevation& RT)
+{
+    return std::make_pair(std::min(std::min(LB.first, RB.first), std::min(LT.first, RT.first)),
+                          std::max(std::max(LB.second, RB.second), std::max(LT.second, RT.second)));
+}
+
+// Culling query: a height band and a disk in normalized terrain coordinates
+struct CullingQuery
+{
+    Uint16 MinElevation;
+    Uint16 MaxElevation;
+    float  CenterX;
+    float  CenterY;
+    float  Radius;
+
+    bool IsVisible(const QuadTreeNodeLocation& Pos, const MinMaxElevation& MinMax) const
+    {
+        if (MinMax.second < MinElevation || MinMax.first > MaxElevation)
+            return false;
+
+        const float NodeSize = 1.f / static_cast<float>(1 << Pos.level);
+        const float MinX     = static_cast<float>(Pos.horzOrder) * NodeSize;
+        const float MinY     = static_cast<float>(Pos.vertOrder) * NodeSize;
+        const float dx       = std::max(std::max(MinX - CenterX, CenterX - (MinX + NodeSize)), 0.f);
+        const float dy       = std::max(std::max(MinY - CenterY, CenterY - (MinY + NodeSize)), 0.f);
+        return dx * dx + dy * dy <= Radius * Radius;
+    }
+};
+
+size_t CullRowMajor(const RowMajorHierarchyArray<MinMaxElevation>& Array, const QuadTreeNodeLocation& Pos, int NumLevels, const CullingQuery& Query)
+{
+    if (!Query.IsVisible(Pos, Array[Pos]))
+        return 0;
+    if (Pos.level == NumLevels - 1)
+        return 1;
+
+    size_t NumVisibleLeaves = 0;
+    for (unsigned int Child = 0; Child < 4; ++Child)
+        NumVisibleLeaves += CullRowMajor(Array, GetChildLocation(Pos, Child), NumLevels, Query);
+    return NumVisibleLeaves;
+}
+
+size_t CullMorton(const HierarchyArray<MinMaxElevation>& Array, const QuadTreeNodeLocation& Pos, const MinMaxElevation& MinMax, int NumLevels, const CullingQuery& Query)
+{
+    if (!Query.IsVisible(Pos, MinMax))
+        return 0;
+    if (Pos.level == NumLevels - 1)
+        return 1;
+
+    const MinMaxElevation* pChildren        = Array.GetChildren(Pos);
+    size_t                 NumVisibleLeaves = 0;
+    for (unsigned int Child = 0; Child < 4; ++Child)
+        NumVisibleLeaves += CullMorton(Array, GetChildLocation(Pos, Child), pChildren[Child], NumLevels, Query);
+    return NumVisibleLeaves;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int NumLevels     = 11;
+    int NumIterations = 20;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-levels") == 0 && i + 1 < argc)
+            NumLevels = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+            NumIterations = atoi(argv[++i]);
+        else
+        {
+            printf("Usage: %s [-levels N] [-iterations N]\n", argv[0]);
+            return 1;
+        }
+    }
+    NumLevels     = std::min(std::max(NumLevels, 1), 13);
+    NumIterations = std::max(NumIterations, 1);
+
+    const int LeafLevel = NumLevels - 1;
+    const int LeafDim   = 1 << LeafLevel;
+
+    RowMajorHierarchyArray<MinMaxElevation> RowMajorArray;
+    HierarchyArray<MinMaxElevation>         MortonArray;
+    RowMajorArray.Resize(NumLevels);
+    MortonArray.Resize(NumLevels);
+
+    // Smooth terrain with some noise, so that the culling query rejects whole subtrees
+    std::mt19937                          Rng{0};
+    std::uniform_int_distribution<Uint32> Noise{0, 2000};
+    for (int v = 0; v < LeafDim; ++v)
+    {
+        for (int h = 0; h < LeafDim; ++h)
+        {
+            const Uint32 Base   = static_cast<Uint32>(h + v) * 40000u / static_cast<Uint32>(2 * LeafDim);
+            const auto   MinMax = std::make_pair(static_cast<Uint16>(Base + Noise(Rng)), static_cast<Uint16>(Base + 4000 + Noise(Rng)));
+
+            const QuadTreeNodeLocation Pos{h, v, LeafLevel};
+            RowMajorArray[Pos] = MinMax;
+            MortonArray[Pos]   = MinMax;
+        }
+    }
+
+    printf("Levels: %d, nodes: %zu, node size: %zu bytes, iterations: %d\n", NumLevels, GetHierarchyLevelOffset(NumLevels), sizeof(MinMaxElevation), NumIterations);
+
+    bool ResultsMatch = true;
+
+    // Bottom-up min/max computation
+    {
+        const double RowMajorTime = MeasureTime(NumIterations, [&]() {
+            for (HierarchyReverseIterator it(LeafLevel); it.IsValid(); it.Next())
+            {
+                const QuadTreeNodeLocation& Pos = it;
+                RowMajorArray[Pos]              = CombineChildren(RowMajorArray[GetChildLocation(Pos, 0)], RowMajorArray[GetChildLocation(Pos, 1)],
+                                                     RowMajorArray[GetChildLocation(Pos, 2)], RowMajorArray[GetChildLocation(Pos, 3)]);
+            }
+        });
+        const double MortonTime   = MeasureTime(NumIterations, [&]() {
+            for (HierarchyReverseMortonIterator it(LeafLevel); it.IsValid(); it.Next())
+            {
+                const MinMaxElevation* pChildren = MortonArray.GetChildren(it);
+                MortonArray[it]                  = CombineChildren(pChildren[0], pChildren[1], pChildren[2], pChildren[3]);
+            }
+        });
+        printf("Min/max build:   row-major %8.3f ms, Morton %8.3f ms (%.2fx)\n", RowMajorTime, MortonTime, RowMajorTime / MortonTime);
+
+        for (HierarchyIterator it(NumLevels); it.IsValid(); it.Next())
+            ResultsMatch = ResultsMatch && RowMajorArray[it] == MortonArray[static_cast<const QuadTreeNodeLocation&>(it)];
+    }
+
+    // Top-down culling traversal
+    {
+        std::uniform_real_distribution<float> Coord{0.f, 1.f};
+        std::uniform_int_distribution<Uint32> Elevation{0, 40000};
+
+        std::vector<CullingQuery> Queries(64);
+        for (auto& Query : Queries)
+        {
+            Query.MinElevation = static_cast<Uint16>(Elevation(Rng));
+            Query.MaxElevation = static_cast<Uint16>(Query.MinElevation + 3000);
+            Query.CenterX      = Coord(Rng);
+            Query.CenterY      = Coord(Rng);
+            Query.Radius       = 0.02f + 0.13f * Coord(Rng);
+        }
+
+        size_t       RowMajorLeaves = 0;
+        size_t       MortonLeaves   = 0;
+        const double RowMajorTime   = MeasureTime(NumIterations, [&]() {
+            RowMajorLeaves = 0;
+            for (const auto& Query : Queries)
+                RowMajorLeaves += CullRowMajor(RowMajorArray, QuadTreeNodeLocation{}, NumLevels, Query);
+        });
+        const double MortonTime     = MeasureTime(NumIterations, [&]() {
+            MortonLeaves = 0;
+            for (const auto& Query : Queries)
+                MortonLeaves += CullMorton(MortonArray, QuadTreeNodeLocation{}, MortonArray[QuadTreeNodeLocation{}], NumLevels, Query);
+        });
+        printf("Culling:         row-major %8.3f ms, Morton %8.3f ms (%.2fx), visible leaves: %zu\n", RowMajorTime, MortonTime, RowMajorTime / MortonTime, MortonLeaves);
+
+        ResultsMatch = ResultsMatch && RowMajorLeaves == MortonLeaves;
+    }
+
+    // Leaf-to-root ancestor walks from spatially coherent leaves, as when updating edited patches
+    {
+        std::vector<QuadTreeNodeLocation>  Leaves;
+        std::uniform_int_distribution<int> LeafCoord{0, LeafDim - 1};
+        for (int Stroke = 0; Stroke < 256; ++Stroke)
+        {
+            const int h0 = LeafCoord(Rng);
+            const int v0 = LeafCoord(Rng);
+            for (int v = v0; v < std::min(v0 + 8, LeafDim); ++v)
+            {
+                for (int h = h0; h < std::min(h0 + 8, LeafDim); ++h)
+                    Leaves.emplace_back(h, v, LeafLevel);
+            }
+        }
+
+        Uint64       RowMajorSum  = 0;
+        Uint64       MortonSum    = 0;
+        const double RowMajorTime = MeasureTime(NumIterations, [&]() {
+            RowMajorSum = 0;
+            for (auto Pos : Leaves)
+            {
+                for (;; Pos = GetParentLocation(Pos))
+                {
+                    RowMajorSum += RowMajorArray[Pos].first;
+                    if (Pos.level == 0)
+                        break;
+                }
+            }
+        });
+        const double MortonTime   = MeasureTime(NumIterations, [&]() {
+            MortonSum = 0;
+            for (auto Pos : Leaves)
+            {
+                for (;; Pos = GetParentLocation(Pos))
+                {
+                    MortonSum += MortonArray[Pos].first;
+                    if (Pos.level == 0)
+                        break;
+                }
+            }
+        });
+        printf("Ancestor walks:  row-major %8.3f ms, Morton %8.3f ms (%.2fx)\n", RowMajorTime, MortonTime, RowMajorTime / MortonTime);
+
+        ResultsMatch = ResultsMatch && RowMajorSum == MortonSum;
+    }
+
+    if (!ResultsMatch)
+    {
+        printf("Error: results of the two layouts do not match\n");
+        return 1;
+    }
+
+    return 0;
+}
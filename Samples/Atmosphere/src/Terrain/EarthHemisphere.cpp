@@ -45,8 +45,17 @@
 
 #include <algorithm>
 #include <cfloat>
+#include <cmath>
 #include <array>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define HEMISPHERE_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define HEMISPHERE_NEON 1
+#endif
+
 #include "EarthHemisphere.hpp"
 
 namespace Diligent
@@ -59,6 +68,7 @@ namespace Diligent
 } // namespace Diligent
 
 #include "ElevationDataSource.hpp"
+#include "ImageDownsampler.hpp"
 #include "MapHelper.hpp"
 #include "GraphicsAccessories.hpp"
 #include "GraphicsUtilities.h"
@@ -66,6 +76,7 @@ namespace Diligent
 #include "TextureUtilities.h"
 #include "CommonlyUsedStates.h"
 #include "CallbackWrapper.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -202,25 +213,215 @@ private:
 typedef TriStrip<Uint32, StdIndexGenerator> StdTriStrip32;
 
 
-void ComputeVertexHeight(HemisphereVertex&          Vertex,
-                         class ElevationDataSource* pDataSource,
-                         float                      fSamplingStep,
-                         float                      fSampleScale)
+namespace
 {
-    float3& f3PosWS = Vertex.f3WorldPos;
 
-    float fCol   = f3PosWS.x / fSamplingStep;
-    float fRow   = f3PosWS.z / fSamplingStep;
-    float fDispl = pDataSource->GetInterpolatedHeight(fCol, fRow);
-    int   iColOffset, iRowOffset;
-    pDataSource->GetOffsets(iColOffset, iRowOffset);
-    Vertex.f2MaskUV0.x = (fCol + (float)iColOffset + 0.5f) / (float)pDataSource->GetNumCols();
-    Vertex.f2MaskUV0.y = (fRow + (float)iRowOffset + 0.5f) / (float)pDataSource->GetNumRows();
+// Four floats that are processed by one SIMD instruction, or one by one when SIMD is not available
+struct Float4
+{
+#if HEMISPHERE_SSE2
+    __m128 v;
+
+    // clang-format off
+    static Float4 Load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Float4 Set (float f)        { return {_mm_set1_ps(f)}; }
+    void          Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    static Float4 Sqrt(Float4 a)           { return {_mm_sqrt_ps(a.v)}; }
+    static Float4 Abs (Float4 a)           { return {_mm_and_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)))}; }
+    static Float4 Min (Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+    static Float4 Max (Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+    // clang-format on
+
+    // Returns IfZero in lanes where Test is zero, and Other in all other lanes
+    static Float4 SelectZero(Float4 Test, Float4 IfZero, Float4 Other)
+    {
+        const __m128 IsZero = _mm_cmpeq_ps(Test.v, _mm_setzero_ps());
+        return {_mm_or_ps(_mm_and_ps(IsZero, IfZero.v), _mm_andnot_ps(IsZero, Other.v))};
+    }
+#elif HEMISPHERE_NEON
+    float32x4_t v;
+
+    // clang-format off
+    static Float4 Load(const float* p) { return {vld1q_f32(p)}; }
+    static Float4 Set (float f)        { return {vdupq_n_f32(f)}; }
+    void          Store(float* p) const { vst1q_f32(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+#    if defined(__aarch64__) || defined(_M_ARM64)
+    friend Float4 operator/(Float4 a, Float4 b) { return {vdivq_f32(a.v, b.v)}; }
+    static Float4 Sqrt(Float4 a)                { return {vsqrtq_f32(a.v)}; }
+#    else
+    // 32-bit NEON has no division and square root instructions
+    friend Float4 operator/(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x / y; }); }
+    static Float4 Sqrt(Float4 a)                { return Apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+#    endif
+    static Float4 Abs (Float4 a)           { return {vabsq_f32(a.v)}; }
+    static Float4 Min (Float4 a, Float4 b) { return {vminq_f32(a.v, b.v)}; }
+    static Float4 Max (Float4 a, Float4 b) { return {vmaxq_f32(a.v, b.v)}; }
+    // clang-format on
+
+    static Float4 SelectZero(Float4 Test, Float4 IfZero, Float4 Other)
+    {
+        return {vbslq_f32(vceqq_f32(Test.v, vdupq_n_f32(0)), IfZero.v, Other.v)};
+    }
+
+    template <typename OpType>
+    static Float4 Apply(Float4 a, Float4 b, OpType Op)
+    {
+        float fa[4], fb[4];
+        vst1q_f32(fa, a.v);
+        vst1q_f32(fb, b.v);
+        for (int i = 0; i < 4; ++i)
+            fa[i] = Op(fa[i], fb[i]);
+        return {vld1q_f32(fa)};
+    }
+#else
+    float v[4];
+
+    // clang-format off
+    static Float4 Load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+    static Float4 Set (float f)        { return {{f, f, f, f}}; }
+    void          Store(float* p) const { std::copy(v, v + 4, p); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x + y; }); }
+    friend Float4 operator-(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x - y; }); }
+    friend Float4 operator*(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x * y; }); }
+    friend Float4 operator/(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x / y; }); }
+
+    static Float4 Sqrt(Float4 a)           { return Apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+    static Float4 Abs (Float4 a)           { return Apply(a, a, [](float x, float) { return std::abs(x); }); }
+    static Float4 Min (Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return std::min(x, y); }); }
+    static Float4 Max (Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return std::max(x, y); }); }
+    // clang-format on
+
+    static Float4 SelectZero(Float4 Test, Float4 IfZero, Float4 Other)
+    {
+        Float4 r;
+        for (int i = 0; i < 4; ++i)
+            r.v[i] = Test.v[i] == 0 ? IfZero.v[i] : Other.v[i];
+        return r;
+    }
 
-    float3 f3SphereNormal = normalize(f3PosWS);
-    f3PosWS += f3SphereNormal * fDispl * fSampleScale;
+    template <typename OpType>
+    static Float4 Apply(Float4 a, Float4 b, OpType Op)
+    {
+        Float4 r;
+        for (int i = 0; i < 4; ++i)
+            r.v[i] = Op(a.v[i], b.v[i]);
+        return r;
+    }
+#endif
+};
+
+// Structure-of-arrays storage for one row of the ring grid, padded to a multiple of four vertices
+struct GridRow
+{
+    explicit GridRow(int iGridDimension) :
+        Size{(iGridDimension + 3) & ~3}
+    {
+        for (auto* pArray : {&X, &Y, &Z, &Col, &Row, &Height})
+            pArray->resize(Size);
+    }
+
+    const int          Size;
+    std::vector<float> X, Y, Z;
+    std::vector<float> Col, Row, Height; // Height map coordinates and interpolated height
+};
+
+struct SphereGridAttribs
+{
+    int   iGridDimension = 0;
+    float fEarthRadius   = 0;
+    float fSamplingStep  = 0;
+    float fSampleScale   = 0;
+
+    const ElevationDataSource* pDataSource = nullptr;
+
+    // Unit grid coordinates of every column, in [-1, 1]
+    std::vector<float> ColCoords;
+};
+
+// Projects one row of the ring grid onto the sphere and displaces it by the terrain height
+void GenerateGridRow(const SphereGridAttribs& Attribs, float fGridScale, int iRow, GridRow& Row, HemisphereVertex* pVerts)
+{
+    const auto* pDataSource = Attribs.pDataSource;
+
+    const float fRowCoord = static_cast<float>(iRow) / static_cast<float>(Attribs.iGridDimension - 1) * 2 - 1;
+
+    const Float4 Zero         = Float4::Set(0);
+    const Float4 One          = Float4::Set(1);
+    const Float4 GridScale    = Float4::Set(fGridScale);
+    const Float4 EarthRadius  = Float4::Set(Attribs.fEarthRadius);
+    const Float4 SamplingStep = Float4::Set(Attribs.fSamplingStep);
+    const Float4 SampleScale  = Float4::Set(Attribs.fSampleScale);
+
+    for (int i = 0; i < Row.Size; i += 4)
+    {
+        Float4 X = Float4::Load(&Attribs.ColCoords[i]);
+        Float4 Z = Float4::Set(fRowCoord);
+
+        // Project the square grid onto the disk
+        const Float4 DX             = Float4::Abs(X);
+        const Float4 DZ             = Float4::Abs(Z);
+        const Float4 MaxD           = Float4::Max(DX, DZ);
+        const Float4 Tan            = Float4::Min(DX, DZ) / MaxD;
+        const Float4 DirectionScale = Float4::SelectZero(MaxD, One, One / Float4::Sqrt(One + Tan * Tan));
+
+        X        = X * (DirectionScale * GridScale);
+        Z        = Z * (DirectionScale * GridScale);
+        Float4 Y = Float4::Sqrt(Float4::Max(Zero, One - (X * X + Z * Z)));
+
+        X = X * EarthRadius;
+        Y = Y * EarthRadius;
+        Z = Z * EarthRadius;
+        X.Store(&Row.X[i]);
+        Y.Store(&Row.Y[i]);
+        Z.Store(&Row.Z[i]);
+        (X / SamplingStep).Store(&Row.Col[i]);
+        (Z / SamplingStep).Store(&Row.Row[i]);
+    }
+
+    pDataSource->GetInterpolatedHeights(Row.Col.data(), Row.Row.data(), Row.Height.data(), Row.Size);
+
+    for (int i = 0; i < Row.Size; i += 4)
+    {
+        Float4 X = Float4::Load(&Row.X[i]);
+        Float4 Y = Float4::Load(&Row.Y[i]);
+        Float4 Z = Float4::Load(&Row.Z[i]);
+
+        // Displace the vertex along the sphere normal
+        const Float4 Length = Float4::Sqrt(X * X + Y * Y + Z * Z);
+        const Float4 Displ  = Float4::Load(&Row.Height[i]);
+        X                   = X + X / Length * Displ * SampleScale;
+        Y                   = Y + Y / Length * Displ * SampleScale;
+        Z                   = Z + Z / Length * Displ * SampleScale;
+        Y                   = Y - EarthRadius;
+        X.Store(&Row.X[i]);
+        Y.Store(&Row.Y[i]);
+        Z.Store(&Row.Z[i]);
+    }
+
+    int iColOffset, iRowOffset;
+    pDataSource->GetOffsets(iColOffset, iRowOffset);
+    for (int iCol = 0; iCol < Attribs.iGridDimension; ++iCol)
+    {
+        auto& Vert       = pVerts[iCol];
+        Vert.f3WorldPos  = float3{Row.X[iCol], Row.Y[iCol], Row.Z[iCol]};
+        Vert.f2MaskUV0.x = (Row.Col[iCol] + (float)iColOffset + 0.5f) / (float)pDataSource->GetNumCols();
+        Vert.f2MaskUV0.y = (Row.Row[iCol] + (float)iRowOffset + 0.5f) / (float)pDataSource->GetNumRows();
+    }
 }
 
+} // namespace
+
 
 class RingMeshBuilder
 {
@@ -235,65 +436,110 @@ public:
         m_iGridDimenion(iGridDimenion)
     {}
 
-    void CreateMesh(int                          iBaseIndex,
-                    int                          iStartCol,
-                    int                          iStartRow,
-                    int                          iNumCols,
-                    int                          iNumRows,
-                    enum QUAD_TRIANGULATION_TYPE QuadTriangType)
-    {
-        m_RingMeshes.push_back(RingSectorMesh());
-        auto& CurrMesh = m_RingMeshes.back();
-
-        std::vector<Uint32> IB;
-        StdTriStrip32       TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
-        TriStrip.AddStrip(iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType);
-
-        CurrMesh.uiNumIndices = (Uint32)IB.size();
-
-        // Prepare buffer description
-        BufferDesc IndexBufferDesc;
-        IndexBufferDesc.Name      = "Ring mesh index buffer";
-        IndexBufferDesc.Size      = (Uint32)(IB.size() * sizeof(IB[0]));
-        IndexBufferDesc.BindFlags = BIND_INDEX_BUFFER;
-        IndexBufferDesc.Usage     = USAGE_IMMUTABLE;
-        BufferData IBInitData;
-        IBInitData.pData    = IB.data();
-        IBInitData.DataSize = IndexBufferDesc.Size;
-        // Create the buffer
-        m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
-        VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
-
-        // Compute bounding box
-        auto& BB = CurrMesh.BndBox;
-        BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-        BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
-        for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
+    // Adds a ring sector. Its mesh is created by Build().
+    void AddSector(int                          iBaseIndex,
+                   int                          iStartCol,
+                   int                          iStartRow,
+                   int                          iNumCols,
+                   int                          iNumRows,
+                   enum QUAD_TRIANGULATION_TYPE QuadTriangType)
+    {
+        m_Sectors.push_back({iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType});
+    }
+
+    // Generates index strips and bounding boxes of all sectors, one task per sector,
+    // and creates the index buffers in the order the sectors were added.
+    void Build(TaskScheduler* pScheduler)
+    {
+        const auto FirstMesh = m_RingMeshes.size();
+        m_RingMeshes.resize(FirstMesh + m_Sectors.size());
+
+        std::vector<std::vector<Uint32>> IBs(m_Sectors.size());
+
+        auto BuildSector = [&](size_t SectorIdx) {
+            const auto& Sector = m_Sectors[SectorIdx];
+            auto&       IB     = IBs[SectorIdx];
+
+            StdTriStrip32 TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
+            TriStrip.AddStrip(Sector.iBaseIndex, Sector.iStartCol, Sector.iStartRow, Sector.iNumCols, Sector.iNumRows, Sector.QuadTriangType);
+
+            auto& CurrMesh        = m_RingMeshes[FirstMesh + SectorIdx];
+            CurrMesh.uiNumIndices = (Uint32)IB.size();
+
+            // Compute bounding box
+            auto& BB = CurrMesh.BndBox;
+            BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+            for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
+            {
+                const auto& CurrVert = m_VB[*Ind].f3WorldPos;
+
+                BB.Min = std::min(BB.Min, CurrVert);
+                BB.Max = std::max(BB.Max, CurrVert);
+            }
+        };
+
+        if (pScheduler != nullptr)
         {
-            const auto& CurrVert = m_VB[*Ind].f3WorldPos;
+            pScheduler->ParallelFor(static_cast<Uint32>(m_Sectors.size()), [&](Uint32, Uint32 SectorIdx) { BuildSector(SectorIdx); });
+        }
+        else
+        {
+            for (size_t SectorIdx = 0; SectorIdx < m_Sectors.size(); ++SectorIdx)
+                BuildSector(SectorIdx);
+        }
 
-            BB.Min = std::min(BB.Min, CurrVert);
-            BB.Max = std::max(BB.Max, CurrVert);
+        for (size_t SectorIdx = 0; SectorIdx < m_Sectors.size(); ++SectorIdx)
+        {
+            const auto& IB       = IBs[SectorIdx];
+            auto&       CurrMesh = m_RingMeshes[FirstMesh + SectorIdx];
+
+            // Prepare buffer description
+            BufferDesc IndexBufferDesc;
+            IndexBufferDesc.Name      = "Ring mesh index buffer";
+            IndexBufferDesc.Size      = (Uint32)(IB.size() * sizeof(IB[0]));
+            IndexBufferDesc.BindFlags = BIND_INDEX_BUFFER;
+            IndexBufferDesc.Usage     = USAGE_IMMUTABLE;
+            BufferData IBInitData;
+            IBInitData.pData    = IB.data();
+            IBInitData.DataSize = IndexBufferDesc.Size;
+            // Create the buffer
+            m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
+            VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
         }
+
+        m_Sectors.clear();
     }
 
 private:
+    struct Sector
+    {
+        int                     iBaseIndex;
+        int                     iStartCol;
+        int                     iStartRow;
+        int                     iNumCols;
+        int                     iNumRows;
+        QUAD_TRIANGULATION_TYPE QuadTriangType;
+    };
+
     RefCntAutoPtr<IRenderDevice>         m_pDevice;
     std::vector<RingSectorMesh>&         m_RingMeshes;
     const std::vector<HemisphereVertex>& m_VB;
     const int                            m_iGridDimenion;
+    std::vector<Sector>                  m_Sectors;
 };
 
 
-void GenerateSphereGeometry(IRenderDevice*                 pDevice,
-                            const float                    fEarthRadius,
-                            int                            iGridDimension,
-                            const int                      iNumRings,
-                            class ElevationDataSource*     pDataSource,
-                            float                          fSamplingStep,
-                            float                          fSampleScale,
-                            std::vector<HemisphereVertex>& VB,
-                            std::vector<RingSectorMesh>&   SphereMeshes)
+void GenerateSphereGeometry(IRenderDevice*                   pDevice,
+                            const float                      fEarthRadius,
+                            int                              iGridDimension,
+                            const int                        iNumRings,
+                            const class ElevationDataSource* pDataSource,
+                            float                            fSamplingStep,
+                            float                            fSampleScale,
+                            TaskScheduler*                   pScheduler,
+                            std::vector<HemisphereVertex>&   VB,
+                            std::vector<RingSectorMesh>&     SphereMeshes)
 {
     if ((iGridDimension - 1) % 4 != 0)
     {
@@ -305,50 +551,28 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 
     //const int iLargestGridScale = iGridDimension << (iNumRings-1);
 
-    RingMeshBuilder RingMeshBuilder(pDevice, VB, iGridDimension, SphereMeshes);
-
-    int iStartRing = 0;
-    VB.reserve((iNumRings - iStartRing) * iGridDimension * iGridDimension);
-    for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
-    {
-        int iCurrGridStart = (int)VB.size();
-        VB.resize(VB.size() + iGridDimension * iGridDimension);
-        float fGridScale = 1.f / (float)(1 << (iNumRings - 1 - iRing));
-        // Fill vertex buffer
-        for (int iRow = 0; iRow < iGridDimension; ++iRow)
-            for (int iCol = 0; iCol < iGridDimension; ++iCol)
-            {
-                auto& CurrVert = VB[iCurrGridStart + iCol + iRow * iGridDimension];
-                auto& f3Pos    = CurrVert.f3WorldPos;
-
-                f3Pos.x = static_cast<float>(iCol) / static_cast<float>(iGridDimension - 1);
-                f3Pos.z = static_cast<float>(iRow) / static_cast<float>(iGridDimension - 1);
-                f3Pos.x = f3Pos.x * 2 - 1;
-                f3Pos.z = f3Pos.z * 2 - 1;
-                f3Pos.y = 0;
-
-                float fDirectionScale = 1;
-                if (f3Pos.x != 0 || f3Pos.z != 0)
-                {
-                    float fDX       = fabs(f3Pos.x);
-                    float fDZ       = fabs(f3Pos.z);
-                    float fMaxD     = std::max(fDX, fDZ);
-                    float fMinD     = std::min(fDX, fDZ);
-                    float fTan      = fMinD / fMaxD;
-                    fDirectionScale = 1 / sqrt(1 + fTan * fTan);
-                }
+    SphereGridAttribs GridAttribs;
+    GridAttribs.iGridDimension = iGridDimension;
+    GridAttribs.fEarthRadius   = fEarthRadius;
+    GridAttribs.fSamplingStep  = fSamplingStep;
+    GridAttribs.fSampleScale   = fSampleScale;
+    GridAttribs.pDataSource    = pDataSource;
+    GridAttribs.ColCoords.resize(GridRow{iGridDimension}.Size);
+    for (size_t iCol = 0; iCol < GridAttribs.ColCoords.size(); ++iCol)
+        GridAttribs.ColCoords[iCol] = static_cast<float>(iCol) / static_cast<float>(iGridDimension - 1) * 2 - 1;
 
-                f3Pos.x *= fDirectionScale * fGridScale;
-                f3Pos.z *= fDirectionScale * fGridScale;
-                f3Pos.y = sqrt(std::max(0.f, 1.f - (f3Pos.x * f3Pos.x + f3Pos.z * f3Pos.z)));
+    const int iStartRing = 0;
+    VB.resize(static_cast<size_t>(iNumRings - iStartRing) * iGridDimension * iGridDimension);
 
-                f3Pos.x *= fEarthRadius;
-                f3Pos.z *= fEarthRadius;
-                f3Pos.y *= fEarthRadius;
+    // Every ring is generated by a separate task
+    auto GenerateRing = [&](int iRing) {
+        const int iCurrGridStart = (iRing - iStartRing) * iGridDimension * iGridDimension;
+        float     fGridScale     = 1.f / (float)(1 << (iNumRings - 1 - iRing));
 
-                ComputeVertexHeight(CurrVert, pDataSource, fSamplingStep, fSampleScale);
-                f3Pos.y -= fEarthRadius;
-            }
+        // Fill vertex buffer
+        GridRow Row{iGridDimension};
+        for (int iRow = 0; iRow < iGridDimension; ++iRow)
+            GenerateGridRow(GridAttribs, fGridScale, iRow, Row, &VB[iCurrGridStart + iRow * iGridDimension]);
 
         // Align vertices on the outer boundary
         if (iRing < iNumRings - 1)
@@ -374,41 +598,57 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
                 }
             }
         }
+    };
+
+    if (pScheduler != nullptr)
+    {
+        pScheduler->ParallelFor(static_cast<Uint32>(iNumRings - iStartRing), [&](Uint32, Uint32 Task) { GenerateRing(iStartRing + static_cast<int>(Task)); });
+    }
+    else
+    {
+        for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
+            GenerateRing(iRing);
+    }
 
+    RingMeshBuilder RingMeshBuilder(pDevice, VB, iGridDimension, SphereMeshes);
+    for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
+    {
+        const int iCurrGridStart = (iRing - iStartRing) * iGridDimension * iGridDimension;
 
         // Generate indices for the current ring
         if (iRing == 0)
         {
             // clang-format off
-            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,                   0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst,          0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,          iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst, iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart, 0,                   0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart, iGridMidst,          0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart, 0,          iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart, iGridMidst, iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
             // clang-format on
         }
         else
         {
             // clang-format off
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart,             0,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart,    iGridQuart,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart,    iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart,  iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
                                        
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart,             0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart,             0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
                                        
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart,  iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart,  iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart,             0, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddSector(iCurrGridStart,    iGridQuart, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart,    iGridMidst, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddSector(iCurrGridStart,  iGridQuart*3, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
             // clang-format on
         }
     }
+    RingMeshBuilder.Build(pScheduler);
 
     // We do not need per-vertex normals as we use normal map to shade terrain
     // Sphere tangent vertex are computed in the shader
@@ -495,7 +735,9 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
                                       const Uint16*   pHeightMap,
                                       size_t          HeightMapStride,
                                       int             iHeightMapDim,
-                                      ITexture*       ptex2DNormalMap)
+                                      float           fSampleSpacing,
+                                      ITexture*       ptex2DNormalMap,
+                                      TaskScheduler*  pScheduler)
 {
     TextureDesc HeightMapDesc;
     HeightMapDesc.Name      = "Height map texture";
@@ -529,17 +771,7 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
     for (Uint32 uiMipLevel = 1; uiMipLevel < HeightMapDesc.MipLevels; ++uiMipLevel)
     {
         const auto MipProps = GetMipLevelProperties(HeightMapDesc, uiMipLevel);
-        for (Uint32 uiRow = 0; uiRow < MipProps.LogicalHeight; ++uiRow)
-        {
-            for (Uint32 uiCol = 0; uiCol < MipProps.LogicalWidth; ++uiCol)
-            {
-                int iAverageHeight = 0;
-                for (int i = 0; i < 2; ++i)
-                    for (int j = 0; j < 2; ++j)
-                        iAverageHeight += pFinerMipLevel[(uiCol * 2 + i) + (uiRow * 2 + j) * size_t{FinerMipStride}];
-                pCurrMipLevel[uiCol + uiRow * CurrMipStride] = (Uint16)(iAverageHeight >> 2);
-            }
-        }
+        DownsampleUint16Image2x2(pFinerMipLevel, FinerMipStride, pCurrMipLevel, CurrMipStride, MipProps.LogicalWidth, MipProps.LogicalHeight, pScheduler);
 
         InitData[uiMipLevel].pData  = pCurrMipLevel;
         InitData[uiMipLevel].Stride = (Uint32)CurrMipStride * sizeof(*pCurrMipLevel);
@@ -556,22 +788,12 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
     pDevice->CreateTexture(HeightMapDesc, &HeigtMapInitData, &ptex2DHeightMap);
     VERIFY(ptex2DHeightMap, "Failed to create height map texture");
 
-    m_pResMapping->AddResource("g_tex2DElevationMap", ptex2DHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), true);
-
-    RefCntAutoPtr<IBuffer> pcbNMGenerationAttribs;
-    CreateUniformBuffer(pDevice, sizeof(NMGenerationAttribs), "NM Generation Attribs CB", &pcbNMGenerationAttribs);
-
-    m_pResMapping->AddResource("cbNMGenerationAttribs", pcbNMGenerationAttribs, true);
-
-    RefCntAutoPtr<IPipelineState> pRenderNormalMapPSO;
-    m_pRSNLoader->LoadPipelineState({"Render Normal Map", PIPELINE_TYPE_GRAPHICS, false}, &pRenderNormalMapPSO);
-
-    pRenderNormalMapPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
-
+    // The height map is released together with the SRB when the method returns
     RefCntAutoPtr<IShaderResourceBinding> pRenderNormalMapSRB;
-    pRenderNormalMapPSO->CreateShaderResourceBinding(&pRenderNormalMapSRB, true);
+    m_pRenderNormalMapPSO->CreateShaderResourceBinding(&pRenderNormalMapSRB, true);
+    pRenderNormalMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_tex2DElevationMap")->Set(ptex2DHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 
-    pContext->SetPipelineState(pRenderNormalMapPSO);
+    pContext->SetPipelineState(m_pRenderNormalMapPSO);
     pContext->CommitShaderResources(pRenderNormalMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
     const auto& NormalMapDesc = ptex2DNormalMap->GetDesc();
@@ -587,18 +809,229 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
         pContext->SetRenderTargets(_countof(pRTVs), pRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
         {
-            MapHelper<NMGenerationAttribs> NMGenerationAttribs(pContext, pcbNMGenerationAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+            MapHelper<NMGenerationAttribs> NMGenerationAttribs(pContext, m_pcbNMGenerationAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
             NMGenerationAttribs->m_fElevationScale        = m_Params.m_TerrainAttribs.m_fElevationScale;
-            NMGenerationAttribs->m_fSampleSpacingInterval = m_Params.m_TerrainAttribs.m_fElevationSamplingInterval;
+            NMGenerationAttribs->m_fSampleSpacingInterval = fSampleSpacing;
             NMGenerationAttribs->m_iMIPLevel              = static_cast<int>(uiMipLevel);
+            NMGenerationAttribs->m_iWrapCoords            = 0;
         }
 
         DrawAttribs DrawAttrs(4, DRAW_FLAG_VERIFY_ALL);
         pContext->Draw(DrawAttrs);
     }
+}
+
+
+namespace
+{
+
+// Every detail patch is one tile of the elevation data source
+constexpr Uint32 DetailPatchSize = TiledElevationFile::TileSize;
+
+// Mip levels of a detail patch, down to one sample
+constexpr Uint32 DetailPatchMipLevels = TiledElevationFile::TileSizeLog2 + 1;
+
+// Modulo that is never negative
+int PositiveMod(int x, int m)
+{
+    return ((x % m) + m) % m;
+}
+
+} // namespace
+
+void EarthHemsiphere::CreateDetailNormalMap(IRenderDevice* pDevice)
+{
+    const Uint32 DetailMapDim = DETAIL_WINDOW_PATCHES * DetailPatchSize;
+
+    TextureDesc HeightMapDesc;
+    HeightMapDesc.Name      = "Detail height map texture";
+    HeightMapDesc.Type      = RESOURCE_DIM_TEX_2D;
+    HeightMapDesc.Width     = DetailMapDim;
+    HeightMapDesc.Height    = DetailMapDim;
+    HeightMapDesc.Format    = TEX_FORMAT_R16_UINT;
+    HeightMapDesc.Usage     = USAGE_DEFAULT;
+    HeightMapDesc.BindFlags = BIND_SHADER_RESOURCE;
+    HeightMapDesc.MipLevels = DetailPatchMipLevels;
+    pDevice->CreateTexture(HeightMapDesc, nullptr, &m_ptex2DDetailHeightMap);
+    VERIFY(m_ptex2DDetailHeightMap, "Failed to create detail height map texture");
+
+    TextureDesc NormalMapDesc;
+    NormalMapDesc.Name      = "Detail normal map texture";
+    NormalMapDesc.Type      = RESOURCE_DIM_TEX_2D;
+    NormalMapDesc.Width     = DetailMapDim;
+    NormalMapDesc.Height    = DetailMapDim;
+    NormalMapDesc.Format    = TEX_FORMAT_RG8_UNORM;
+    NormalMapDesc.Usage     = USAGE_DEFAULT;
+    NormalMapDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
+    NormalMapDesc.MipLevels = DetailPatchMipLevels;
+    pDevice->CreateTexture(NormalMapDesc, nullptr, &m_ptex2DDetailNormalMap);
+    VERIFY(m_ptex2DDetailNormalMap, "Failed to create detail normal map texture");
+
+    m_DetailNormalMapRTVs.resize(NormalMapDesc.MipLevels);
+    for (Uint32 uiMipLevel = 0; uiMipLevel < NormalMapDesc.MipLevels; ++uiMipLevel)
+    {
+        TextureViewDesc TexViewDesc;
+        TexViewDesc.ViewType        = TEXTURE_VIEW_RENDER_TARGET;
+        TexViewDesc.MostDetailedMip = uiMipLevel;
+        m_ptex2DDetailNormalMap->CreateView(TexViewDesc, &m_DetailNormalMapRTVs[uiMipLevel]);
+    }
+
+    m_pRenderNormalMapPSO->CreateShaderResourceBinding(&m_pDetailNormalMapSRB, true);
+    m_pDetailNormalMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_tex2DElevationMap")->Set(m_ptex2DDetailHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
 
-    // Remove elevation map from resource mapping to release the resource
-    m_pResMapping->RemoveResourceByName("g_tex2DElevationMap");
+    m_DetailWindowStart = PatchCoords{};
+    m_DetailSlotPatches.assign(DETAIL_WINDOW_PATCHES * DETAIL_WINDOW_PATCHES, PatchCoords{});
+    m_PatchMipScratch.resize(DetailPatchSize / 2 * DetailPatchSize);
+}
+
+void EarthHemsiphere::UploadDetailPatch(IDeviceContext* pContext, int iStartCol, int iStartRow, Uint32 SlotX, Uint32 SlotY)
+{
+    // Patches that are completely inside the data set are uploaded directly from the mapped tile
+    size_t        SrcStride = 0;
+    const Uint16* pSrc      = m_pDataSource->GetPatchSamples(iStartCol, iStartRow, m_PatchScratch, SrcStride);
+
+    // Coarse mip levels are stacked on top of each other with the same stride, see RenderNormalMap()
+    const size_t MipStride = DetailPatchSize / 2;
+    Uint16*      pMipLevel = m_PatchMipScratch.data();
+    for (Uint32 uiMipLevel = 0; uiMipLevel < DetailPatchMipLevels; ++uiMipLevel)
+    {
+        const Uint32 MipPatchSize = DetailPatchSize >> uiMipLevel;
+        if (uiMipLevel > 0)
+        {
+            DownsampleUint16Image2x2(pSrc, SrcStride, pMipLevel, MipStride, MipPatchSize, MipPatchSize);
+            pSrc      = pMipLevel;
+            SrcStride = MipStride;
+            pMipLevel += MipPatchSize * MipStride;
+        }
+
+        Box DstBox{SlotX * MipPatchSize, (SlotX + 1) * MipPatchSize, SlotY * MipPatchSize, (SlotY + 1) * MipPatchSize};
+
+        TextureSubResData SubResData;
+        SubResData.pData  = pSrc;
+        SubResData.Stride = static_cast<Uint64>(SrcStride * sizeof(*pSrc));
+        pContext->UpdateTexture(m_ptex2DDetailHeightMap, uiMipLevel, 0, DstBox, SubResData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+}
+
+void EarthHemsiphere::UpdateDetailNormalMap(IDeviceContext* pContext, const float3& vCameraPosition)
+{
+    const float fSamplingInterval = m_Params.m_TerrainAttribs.m_fElevationSamplingInterval;
+
+    int iColOffset, iRowOffset;
+    m_pDataSource->GetOffsets(iColOffset, iRowOffset);
+
+    // Patch coordinates are unmirrored and include the offsets, so that the detail window
+    // is aligned with the tiles of the data source
+    auto GetWindowStart = [](float fCoord, int iOffset) {
+        const float fPatch = (fCoord + static_cast<float>(iOffset)) / static_cast<float>(DetailPatchSize);
+        return static_cast<int>(std::floor(fPatch)) - DETAIL_WINDOW_PATCHES / 2;
+    };
+    PatchCoords WindowStart;
+    WindowStart.Col = GetWindowStart(vCameraPosition.x / fSamplingInterval, iColOffset);
+    WindowStart.Row = GetWindowStart(vCameraPosition.z / fSamplingInterval, iRowOffset);
+    if (WindowStart == m_DetailWindowStart)
+        return;
+
+    // Upload the patches that entered the window. The normals of their neighbors are also
+    // regenerated since they depend on the new samples.
+    std::array<bool, DETAIL_WINDOW_PATCHES * DETAIL_WINDOW_PATCHES> DirtyPatches = {};
+
+    Uint32 NumDirtyPatches = 0;
+    for (int y = 0; y < DETAIL_WINDOW_PATCHES; ++y)
+    {
+        for (int x = 0; x < DETAIL_WINDOW_PATCHES; ++x)
+        {
+            const PatchCoords Patch{WindowStart.Col + x, WindowStart.Row + y};
+
+            const auto SlotX = static_cast<Uint32>(PositiveMod(Patch.Col, DETAIL_WINDOW_PATCHES));
+            const auto SlotY = static_cast<Uint32>(PositiveMod(Patch.Row, DETAIL_WINDOW_PATCHES));
+            auto&      Slot  = m_DetailSlotPatches[SlotX + SlotY * DETAIL_WINDOW_PATCHES];
+            if (Slot == Patch)
+                continue;
+
+            UploadDetailPatch(pContext, Patch.Col * static_cast<int>(DetailPatchSize) - iColOffset, Patch.Row * static_cast<int>(DetailPatchSize) - iRowOffset, SlotX, SlotY);
+            Slot = Patch;
+
+            for (int j = std::max(y - 1, 0); j <= std::min(y + 1, DETAIL_WINDOW_PATCHES - 1); ++j)
+            {
+                for (int i = std::max(x - 1, 0); i <= std::min(x + 1, DETAIL_WINDOW_PATCHES - 1); ++i)
+                {
+                    auto& Dirty = DirtyPatches[i + j * DETAIL_WINDOW_PATCHES];
+                    NumDirtyPatches += Dirty ? 0 : 1;
+                    Dirty = true;
+                }
+            }
+        }
+    }
+    m_DetailWindowStart = WindowStart;
+
+    pContext->SetPipelineState(m_pRenderNormalMapPSO);
+    pContext->CommitShaderResources(m_pDetailNormalMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    const bool IsGL = m_pDevice->GetDeviceInfo().IsGLDevice();
+    for (Uint32 uiMipLevel = 0; uiMipLevel < m_DetailNormalMapRTVs.size(); ++uiMipLevel)
+    {
+        ITextureView* pRTVs[] = {m_DetailNormalMapRTVs[uiMipLevel]};
+        pContext->SetRenderTargets(_countof(pRTVs), pRTVs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        {
+            MapHelper<NMGenerationAttribs> NMGenerationAttribs(pContext, m_pcbNMGenerationAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+            NMGenerationAttribs->m_fElevationScale        = m_Params.m_TerrainAttribs.m_fElevationScale;
+            NMGenerationAttribs->m_fSampleSpacingInterval = fSamplingInterval;
+            NMGenerationAttribs->m_iMIPLevel              = static_cast<int>(uiMipLevel);
+            NMGenerationAttribs->m_iWrapCoords            = 1;
+        }
+
+        DrawAttribs DrawAttrs(4, DRAW_FLAG_VERIFY_ALL);
+        if (NumDirtyPatches == DirtyPatches.size())
+        {
+            // The whole window is new, so the mip level is rendered with the default viewport
+            // that SetRenderTargets() has set
+            pContext->Draw(DrawAttrs);
+            continue;
+        }
+
+        const Uint32 MipPatchSize = DetailPatchSize >> uiMipLevel;
+        const Uint32 MipDim       = MipPatchSize * DETAIL_WINDOW_PATCHES;
+
+        for (int y = 0; y < DETAIL_WINDOW_PATCHES; ++y)
+        {
+            for (int x = 0; x < DETAIL_WINDOW_PATCHES; ++x)
+            {
+                if (!DirtyPatches[x + y * DETAIL_WINDOW_PATCHES])
+                    continue;
+
+                const auto SlotX = static_cast<Uint32>(PositiveMod(WindowStart.Col + x, DETAIL_WINDOW_PATCHES));
+                const auto SlotY = static_cast<Uint32>(PositiveMod(WindowStart.Row + y, DETAIL_WINDOW_PATCHES));
+
+                // The shader computes the normal of the texel the pixel is written to, so
+                // the patch is regenerated by restricting the viewport to its slot
+                Viewport VP;
+                VP.TopLeftX = static_cast<float>(SlotX * MipPatchSize);
+                VP.Width    = static_cast<float>(MipPatchSize);
+                VP.Height   = static_cast<float>(MipPatchSize);
+                // OpenGL viewport origin is the bottom left corner, and the engine flips the viewport.
+                // Texture rows are not flipped, so compensate for this.
+                VP.TopLeftY = static_cast<float>(IsGL ? MipDim - (SlotY + 1) * MipPatchSize : SlotY * MipPatchSize);
+                pContext->SetViewports(1, &VP, MipDim, MipDim);
+                pContext->Draw(DrawAttrs);
+            }
+        }
+    }
+
+    const auto WindowSize = static_cast<float>(DETAIL_WINDOW_PATCHES * DetailPatchSize);
+
+    m_NormalMapAttribs.f2DetailWindowStart.x = static_cast<float>(WindowStart.Col * static_cast<int>(DetailPatchSize));
+    m_NormalMapAttribs.f2DetailWindowStart.y = static_cast<float>(WindowStart.Row * static_cast<int>(DetailPatchSize));
+    m_NormalMapAttribs.f2DetailUVBias.x      = static_cast<float>(PositiveMod(WindowStart.Col, DETAIL_WINDOW_PATCHES)) / DETAIL_WINDOW_PATCHES;
+    m_NormalMapAttribs.f2DetailUVBias.y      = static_cast<float>(PositiveMod(WindowStart.Row, DETAIL_WINDOW_PATCHES)) / DETAIL_WINDOW_PATCHES;
+    m_NormalMapAttribs.fDetailWindowSize     = WindowSize;
+
+    // Page in the tiles around the window before it moves there
+    m_pDataSource->PrefetchRegion((WindowStart.Col - 1) * static_cast<int>(DetailPatchSize) - iColOffset,
+                                  (WindowStart.Row - 1) * static_cast<int>(DetailPatchSize) - iRowOffset,
+                                  (DETAIL_WINDOW_PATCHES + 2) * DetailPatchSize,
+                                  (DETAIL_WINDOW_PATCHES + 2) * DetailPatchSize);
 }
 
 
@@ -611,10 +1044,12 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
                              const Char*                TileNormalMapPath[],
                              IBuffer*                   pcbCameraAttribs,
                              IBuffer*                   pcbLightAttribs,
-                             IBuffer*                   pcMediaScatteringParams)
+                             IBuffer*                   pcMediaScatteringParams,
+                             TaskScheduler*             pScheduler)
 {
-    m_Params  = Params;
-    m_pDevice = pDevice;
+    m_Params      = Params;
+    m_pDevice     = pDevice;
+    m_pDataSource = pDataSource;
 
     RefCntAutoPtr<IRenderStateNotationParser> pRSNParser;
     {
@@ -631,17 +1066,16 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         CreateRenderStateNotationLoader({m_pDevice, pRSNParser, pStreamFactory}, &m_pRSNLoader);
     }
 
-    const Uint16* pHeightMap;
-    size_t        HeightMapPitch;
-    pDataSource->GetDataPtr(pHeightMap, HeightMapPitch);
-    Uint32 iHeightMapDim = pDataSource->GetNumCols();
-    VERIFY_EXPR(iHeightMapDim == pDataSource->GetNumRows());
+    // The coarse normal map is generated from the overview of the height map, so the
+    // full-resolution samples are never loaded at once
+    const Uint32 CoarseMapDim = pDataSource->GetOverviewWidth();
+    VERIFY_EXPR(CoarseMapDim == pDataSource->GetOverviewHeight());
 
     TextureDesc NormalMapDesc;
-    NormalMapDesc.Name      = "Normal map texture";
+    NormalMapDesc.Name      = "Coarse normal map texture";
     NormalMapDesc.Type      = RESOURCE_DIM_TEX_2D;
-    NormalMapDesc.Width     = iHeightMapDim;
-    NormalMapDesc.Height    = iHeightMapDim;
+    NormalMapDesc.Width     = CoarseMapDim;
+    NormalMapDesc.Height    = CoarseMapDim;
     NormalMapDesc.Format    = TEX_FORMAT_RG8_UNORM;
     NormalMapDesc.Usage     = USAGE_DEFAULT;
     NormalMapDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
@@ -652,6 +1086,18 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
     m_ptex2DNormalMapSRV = ptex2DNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
 
     CreateUniformBuffer(pDevice, sizeof(TerrainAttribs), "Terrain Attribs CB", &m_pcbTerrainAttribs);
+    CreateUniformBuffer(pDevice, sizeof(NMGenerationAttribs), "NM Generation Attribs CB", &m_pcbNMGenerationAttribs);
+    CreateUniformBuffer(pDevice, sizeof(NormalMapAttribs), "Normal Map Attribs CB", &m_pcbNormalMapAttribs);
+
+    // Overview samples are averages of 2^k x 2^k blocks, so the overview spans NumCols - 1 samples
+    const float fNumCols = static_cast<float>(pDataSource->GetNumCols());
+    const float fNumRows = static_cast<float>(pDataSource->GetNumRows());
+
+    m_NormalMapAttribs                   = {};
+    m_NormalMapAttribs.f2TerrainDim      = float2{fNumCols, fNumRows};
+    m_NormalMapAttribs.f2CoarseUVScale   = float2{fNumCols / (fNumCols - 1), fNumRows / (fNumRows - 1)};
+    m_NormalMapAttribs.fDetailWindowSize = static_cast<float>(DETAIL_WINDOW_PATCHES * DetailPatchSize);
+    m_NormalMapAttribs.fDetailBlendWidth = static_cast<float>(DetailPatchSize);
 
     ResourceMappingDesc ResMappingDesc;
     // clang-format off
@@ -660,7 +1106,9 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         { "cbCameraAttribs", pcbCameraAttribs }, 
         { "cbTerrainAttribs", m_pcbTerrainAttribs}, 
         { "cbLightAttribs", pcbLightAttribs}, 
-        { "g_tex2DNormalMap", ptex2DNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE) }, 
+        { "cbNMGenerationAttribs", m_pcbNMGenerationAttribs },
+        { "cbNormalMapAttribs", m_pcbNormalMapAttribs },
+        { "g_tex2DCoarseNormalMap", ptex2DNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE) }, 
         { "cbParticipatingMediaScatteringParams", pcMediaScatteringParams },
         {} 
     };
@@ -668,6 +1116,12 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
     ResMappingDesc.pEntries = pEntries;
     pDevice->CreateResourceMapping(ResMappingDesc, &m_pResMapping);
 
+    m_pRSNLoader->LoadPipelineState({"Render Normal Map", PIPELINE_TYPE_GRAPHICS, false}, &m_pRenderNormalMapPSO);
+    m_pRenderNormalMapPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+
+    CreateDetailNormalMap(pDevice);
+    m_pResMapping->AddResource("g_tex2DDetailNormalMap", m_ptex2DDetailNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), true);
+
     RefCntAutoPtr<ITexture> ptex2DMtrlMask;
     CreateTextureFromFile(MaterialMaskPath, TextureLoadInfo(), pDevice, &ptex2DMtrlMask);
     auto ptex2DMtrlMaskSRV = ptex2DMtrlMask->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
@@ -698,7 +1152,8 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
 
     m_pDevice->CreateSampler(Sam_ComparisonLinearClamp, &m_pComparisonSampler);
 
-    RenderNormalMap(pDevice, pContext, pHeightMap, HeightMapPitch, iHeightMapDim, ptex2DNormalMap);
+    const float fCoarseSampleSpacing = m_Params.m_TerrainAttribs.m_fElevationSamplingInterval * static_cast<float>(1u << pDataSource->GetOverviewLevel());
+    RenderNormalMap(pDevice, pContext, pDataSource->GetOverview(), CoarseMapDim, CoarseMapDim, fCoarseSampleSpacing, ptex2DNormalMap, pScheduler);
 
     {
         auto Callback = MakeCallback([&](PipelineStateCreateInfo& pPipelineCI) {
@@ -711,7 +1166,7 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
     }
 
     std::vector<HemisphereVertex> VB;
-    GenerateSphereGeometry(pDevice, Diligent::AirScatteringAttribs().fEarthRadius, m_Params.m_iRingDimension, m_Params.m_iNumRings, pDataSource, m_Params.m_TerrainAttribs.m_fElevationSamplingInterval, m_Params.m_TerrainAttribs.m_fElevationScale, VB, m_SphereMeshes);
+    GenerateSphereGeometry(pDevice, Diligent::AirScatteringAttribs().fEarthRadius, m_Params.m_iRingDimension, m_Params.m_iNumRings, pDataSource, m_Params.m_TerrainAttribs.m_fElevationSamplingInterval, m_Params.m_TerrainAttribs.m_fElevationScale, pScheduler, VB, m_SphereMeshes);
 
     BufferDesc VBDesc;
     VBDesc.Name      = "Hemisphere vertex buffer";
@@ -791,6 +1246,11 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
         *TerrainAttribs = m_Params.m_TerrainAttribs;
     }
 
+    {
+        MapHelper<NormalMapAttribs> NMAttribs(pContext, m_pcbNormalMapAttribs, MAP_WRITE, MAP_FLAG_DISCARD);
+        *NMAttribs = m_NormalMapAttribs;
+    }
+
 #if 0
     ID3D11ShaderResourceView *pSRVs[3 + 2*NUM_TILE_TEXTURES] = 
     {
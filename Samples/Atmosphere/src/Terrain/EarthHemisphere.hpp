@@ -45,6 +45,7 @@
 
 #pragma once
 
+#include <climits>
 #include <vector>
 
 #include "RenderDevice.h"
@@ -62,6 +63,8 @@
 namespace Diligent
 {
 
+class TaskScheduler;
+
 // Include structures in Diligent namespace
 #include "../../assets/shaders/HostSharedTerrainStructs.fxh"
 
@@ -125,7 +128,8 @@ public:
                 ITextureView*          pAmbientSkylightSRV,
                 bool                   bZOnlyPass);
 
-    // Creates device resources
+    // Creates device resources. If pScheduler is not null, the hemisphere mesh and
+    // the overview mip levels are generated in parallel. The data source must outlive the object.
     void Create(class ElevationDataSource* pDataSource,
                 const RenderingParams&     Params,
                 IRenderDevice*             pDevice,
@@ -135,20 +139,39 @@ public:
                 const char*                TileNormalMapPath[],
                 IBuffer*                   pcbCameraAttribs,
                 IBuffer*                   pcbLightAttribs,
-                IBuffer*                   pcMediaScatteringParams);
+                IBuffer*                   pcMediaScatteringParams,
+                TaskScheduler*             pScheduler = nullptr);
+
+    // Moves the detail normal map window to the camera. Height map patches that enter the window are
+    // uploaded from the elevation data source, and the normals of the affected patches are regenerated.
+    // Render targets are changed if the window moves, so this method must be called before the
+    // render targets of the frame are set. It must also be called at least once before Render().
+    void UpdateDetailNormalMap(IDeviceContext* pContext, const float3& vCameraPosition);
 
     enum
     {
         NUM_TILE_TEXTURES = 1 + 4
     }; // One base material + 4 masked materials
 
+    enum
+    {
+        DETAIL_WINDOW_PATCHES = 16
+    }; // The detail normal map covers DETAIL_WINDOW_PATCHES x DETAIL_WINDOW_PATCHES terrain patches around the camera
+
 private:
     void RenderNormalMap(IRenderDevice*  pd3dDevice,
                          IDeviceContext* pd3dImmediateContext,
                          const Uint16*   pHeightMap,
                          size_t          HeightMapPitch,
                          int             HeightMapDim,
-                         ITexture*       ptex2DNormalMap);
+                         float           fSampleSpacing,
+                         ITexture*       ptex2DNormalMap,
+                         TaskScheduler*  pScheduler);
+
+    void CreateDetailNormalMap(IRenderDevice* pDevice);
+
+    // Uploads all mip levels of the patch that starts at the specified sample to the slot of the detail height map
+    void UploadDetailPatch(IDeviceContext* pContext, int iStartCol, int iStartRow, Uint32 SlotX, Uint32 SlotY);
 
     RenderingParams m_Params;
 
@@ -160,6 +183,35 @@ private:
     RefCntAutoPtr<IBuffer>      m_pVertBuff;
     RefCntAutoPtr<ITextureView> m_ptex2DNormalMapSRV, m_ptex2DMtrlMaskSRV;
 
+    const class ElevationDataSource* m_pDataSource = nullptr;
+
+    RefCntAutoPtr<IPipelineState> m_pRenderNormalMapPSO;
+    RefCntAutoPtr<IBuffer>        m_pcbNMGenerationAttribs;
+    RefCntAutoPtr<IBuffer>        m_pcbNormalMapAttribs;
+    NormalMapAttribs              m_NormalMapAttribs = {};
+
+    // Detail height and normal maps are addressed toroidally: the sample at unmirrored position (Col, Row)
+    // is stored in texel (Col, Row) modulo the window size, so that only the patches that enter the window
+    // need to be updated when it moves.
+    RefCntAutoPtr<ITexture>                  m_ptex2DDetailHeightMap;
+    RefCntAutoPtr<ITexture>                  m_ptex2DDetailNormalMap;
+    std::vector<RefCntAutoPtr<ITextureView>> m_DetailNormalMapRTVs; // One per mip level
+    RefCntAutoPtr<IShaderResourceBinding>    m_pDetailNormalMapSRB;
+
+    // Patch coordinates of the first patch of the detail window and of the patch in every slot
+    struct PatchCoords
+    {
+        int Col = INT_MIN;
+        int Row = INT_MIN;
+
+        bool operator==(const PatchCoords& rhs) const { return Col == rhs.Col && Row == rhs.Row; }
+        bool operator!=(const PatchCoords& rhs) const { return !(*this == rhs); }
+    };
+    PatchCoords              m_DetailWindowStart;
+    std::vector<PatchCoords> m_DetailSlotPatches;
+    std::vector<Uint16>      m_PatchScratch;
+    std::vector<Uint16>      m_PatchMipScratch;
+
     RefCntAutoPtr<ITextureView> m_ptex2DTilesSRV[NUM_TILE_TEXTURES];
     RefCntAutoPtr<ITextureView> m_ptex2DTilNormalMapsSRV[NUM_TILE_TEXTURES];
 
@@ -46,6 +46,14 @@
 #include <algorithm>
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define ELEVATION_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define ELEVATION_NEON 1
+#endif
+
 #include "ElevationDataSource.hpp"
 #include "FileWrapper.hpp"
 #include "DataBlobImpl.hpp"
@@ -53,17 +61,28 @@
 #include "BasicFileStream.hpp"
 #include "TextureUtilities.h"
 #include "GraphicsAccessories.hpp"
+#include "TaskScheduler.hpp"
+#include "ImageDownsampler.hpp"
 
 namespace Diligent
 {
 
 // Creates data source from the specified raw data file
-ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
+ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile, TaskScheduler* pScheduler) :
     m_iNumLevels(0),
-    m_iPatchSize(128),
+    m_iPatchSize(TiledElevationFile::TileSize),
     m_iColOffset(0),
     m_iRowOffset(0)
 {
+    if (OpenTiledFile(strSrcDemFile, {}))
+        return;
+
+    // Tiled file created from the same version of the source file on a previous run
+    const String TiledFilePath = TiledElevationFile::GetCachePath(strSrcDemFile);
+    const auto   SrcFileStamp  = TiledElevationFile::GetSourceFileStamp(strSrcDemFile);
+    const bool   UseCache      = !TiledFilePath.empty() && SrcFileStamp.Size != 0;
+    if (UseCache && OpenTiledFile(TiledFilePath.c_str(), SrcFileStamp))
+        return;
 
 #if 1
     RefCntAutoPtr<Image> pHeightMap;
@@ -88,32 +107,17 @@ ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
 
     m_iNumCols++;
     m_iNumRows++;
-    m_iStride = (m_iNumCols + 1) & (-2);
 
     // Load the data
-    m_TheHeightMap.resize(size_t{m_iStride} * size_t{m_iNumRows});
-
     VERIFY(ImgInfo.ComponentType == VT_UINT16 && ImgInfo.NumComponents == 1, "Unexpected scanline size: 16-bit single-channel image is expected");
-    auto* pSrcImgData = reinterpret_cast<Uint8*>(pImageData->GetDataPtr());
-    for (Uint32 row = 0; row < ImgInfo.Height; row++, pSrcImgData += ImgInfo.RowStride)
-    {
-        memcpy(&m_TheHeightMap[row * m_iStride], pSrcImgData, size_t{ImgInfo.Width} * size_t{GetValueSize(ImgInfo.ComponentType)});
-    }
-
-    // Duplicate the last row and column
-    for (Uint32 iRow = 0; iRow < ImgInfo.Height; iRow++)
-        for (Uint32 iCol = ImgInfo.Width; iCol < m_iNumCols; iCol++)
-            GetElevSample(iCol, iRow) = GetElevSample((ImgInfo.Width - 1), iRow);
-
-    for (Uint32 iCol = 0; iCol < m_iNumCols; iCol++)
-        for (Uint32 iRow = ImgInfo.Height; iRow < m_iNumRows; iRow++)
-            GetElevSample(iCol, iRow) = GetElevSample(iCol, ImgInfo.Height - 1);
+    VERIFY(ImgInfo.RowStride % sizeof(Uint16) == 0, "Row stride is expected to be a multiple of the sample size");
+    InitTiles(reinterpret_cast<const Uint16*>(pImageData->GetDataPtr()), ImgInfo.RowStride / sizeof(Uint16), ImgInfo.Width, ImgInfo.Height);
+    pHeightMap.Release();
 
 #else
-    m_iStride  = 2048;
     m_iNumRows = m_iNumCols = 2048;
     m_iNumLevels            = 5;
-    m_TheHeightMap.resize(m_iStride * m_iNumRows);
+    std::vector<Uint16> HeightMap(size_t{m_iNumCols} * size_t{m_iNumRows});
     for (Uint32 j = 0; j < m_iNumRows; ++j)
     {
         for (Uint32 i = 0; i < m_iNumCols; ++i)
@@ -131,14 +135,118 @@ ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
             h = fabs(h) * 32000.f;
             h = std::min(h, (float)std::numeric_limits<Uint16>::max());
 
-            GetElevSample(i, j) = (Uint16)h;
+            HeightMap[i + j * m_iNumCols] = (Uint16)h;
         }
     }
+    InitTiles(HeightMap.data(), m_iNumCols, m_iNumCols, m_iNumRows);
 #endif
     m_MinMaxElevation.Resize(m_iNumLevels);
 
     // Calculate min/max elevations
-    CalculateMinMaxElevations();
+    CalculateMinMaxElevations(pScheduler);
+
+    m_OverviewLevel = TiledElevationFile::GetOverviewLevel(m_iNumCols, m_iNumRows);
+    m_OverviewStorage.resize(size_t{GetOverviewWidth()} * size_t{GetOverviewHeight()});
+    m_pOverview = m_OverviewStorage.data();
+    UpdateOverview(0, 0, m_iNumCols - 1, m_iNumRows - 1, pScheduler);
+
+    // Map the tiles from the file, so that the next run does not need to load the image,
+    // and the tiles that are not used can be evicted from memory
+    if (UseCache && WriteTiledFile(TiledFilePath.c_str(), SrcFileStamp))
+        OpenTiledFile(TiledFilePath.c_str(), SrcFileStamp);
+}
+
+void ElevationDataSource::InitTiles(const Uint16* pSamples, size_t Stride, Uint32 Width, Uint32 Height)
+{
+    constexpr Uint32 TileSize = TiledElevationFile::TileSize;
+
+    m_iNumTilesX            = TiledElevationFile::GetNumTiles(m_iNumCols);
+    const Uint32 NumTilesY  = TiledElevationFile::GetNumTiles(m_iNumRows);
+    const size_t TileLength = size_t{TileSize} * size_t{TileSize};
+    m_TileStorage.resize(size_t{m_iNumTilesX} * size_t{NumTilesY} * TileLength);
+
+    for (Uint32 TileY = 0; TileY < NumTilesY; ++TileY)
+    {
+        for (Uint32 TileX = 0; TileX < m_iNumTilesX; ++TileX)
+        {
+            Uint16* pTile = &m_TileStorage[(size_t{TileX} + size_t{TileY} * m_iNumTilesX) * TileLength];
+            for (Uint32 y = 0; y < TileSize; ++y)
+            {
+                const Uint32 iRow = TileY * TileSize + y;
+                if (iRow >= m_iNumRows)
+                    break; // Samples beyond the terrain are never accessed
+
+                const Uint16* pSrcRow  = pSamples + std::min(iRow, Height - 1) * Stride;
+                Uint16*       pDstRow  = pTile + y * TileSize;
+                const Uint32  StartCol = TileX * TileSize;
+                const Uint32  EndCol   = std::min(StartCol + TileSize, m_iNumCols);
+                const Uint32  NumCopy  = StartCol < Width ? std::min(EndCol, Width) - StartCol : 0;
+                memcpy(pDstRow, pSrcRow + StartCol, NumCopy * sizeof(Uint16));
+                // Duplicate the last column
+                for (Uint32 iCol = StartCol + NumCopy; iCol < EndCol; ++iCol)
+                    pDstRow[iCol - StartCol] = pSrcRow[Width - 1];
+            }
+        }
+    }
+
+    m_pTiles = m_TileStorage.data();
+}
+
+bool ElevationDataSource::OpenTiledFile(const Char* Path, const TiledElevationFile::SourceFileStamp& Source)
+{
+    if (!m_TiledFile.Open(Path, Source))
+        return false;
+
+    const auto& Desc  = m_TiledFile.GetDesc();
+    m_iNumCols        = Desc.NumCols;
+    m_iNumRows        = Desc.NumRows;
+    m_iNumLevels      = static_cast<int>(Desc.NumLevels);
+    m_iNumTilesX      = TiledElevationFile::GetNumTiles(m_iNumCols);
+    m_pTiles          = m_TiledFile.GetTiles();
+    m_TileStorage     = std::vector<Uint16>{};
+    m_OverviewLevel   = Desc.OverviewLevel;
+    m_pOverview       = m_TiledFile.GetOverview();
+    m_OverviewStorage = std::vector<Uint16>{};
+
+    // Min/max elevations are precomputed, so no tiles are accessed here
+    m_MinMaxElevation.Resize(m_iNumLevels);
+    const Uint16* pMinMax = m_TiledFile.GetMinMaxElevations();
+    for (int Level = 0; Level < m_iNumLevels; ++Level)
+    {
+        for (int VertOrder = 0; VertOrder < (1 << Level); ++VertOrder)
+        {
+            for (int HorzOrder = 0; HorzOrder < (1 << Level); ++HorzOrder, pMinMax += 2)
+                m_MinMaxElevation[QuadTreeNodeLocation(HorzOrder, VertOrder, Level)] = std::make_pair(pMinMax[0], pMinMax[1]);
+        }
+    }
+
+    return true;
+}
+
+bool ElevationDataSource::WriteTiledFile(const Char* Path, const TiledElevationFile::SourceFileStamp& Source) const
+{
+    std::vector<Uint16> MinMax;
+    MinMax.reserve(TiledElevationFile::GetNumMinMaxElevations(m_iNumLevels) * 2);
+    for (int Level = 0; Level < m_iNumLevels; ++Level)
+    {
+        for (int VertOrder = 0; VertOrder < (1 << Level); ++VertOrder)
+        {
+            for (int HorzOrder = 0; HorzOrder < (1 << Level); ++HorzOrder)
+            {
+                const auto& MinMaxElev = m_MinMaxElevation[QuadTreeNodeLocation(HorzOrder, VertOrder, Level)];
+                MinMax.push_back(MinMaxElev.first);
+                MinMax.push_back(MinMaxElev.second);
+            }
+        }
+    }
+
+    TiledElevationFile::FileDesc Desc;
+    Desc.NumCols        = m_iNumCols;
+    Desc.NumRows        = m_iNumRows;
+    Desc.NumLevels      = static_cast<Uint32>(m_iNumLevels);
+    Desc.OverviewLevel  = m_OverviewLevel;
+    Desc.Source         = Source;
+    return TiledElevationFile::Write(Path, Desc, MinMax.data(), m_pOverview, m_pTiles);
 }
 
 ElevationDataSource::~ElevationDataSource(void)
@@ -167,14 +275,90 @@ int MirrorCoord(int iCoord, int iDim)
     return iCoord;
 }
 
-inline Uint16& ElevationDataSource::GetElevSample(Int32 i, Int32 j)
+namespace
+{
+
+// Updates Min and Max with NumSamples consecutive samples
+void ReduceMinMax(const Uint16* pSamples, size_t NumSamples, Uint16& Min, Uint16& Max)
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    size_t i = 0;
+#if ELEVATION_SSE2
+    if (NumSamples >= 8)
+    {
+        // SSE2 only has signed 16-bit min/max, so flip the sign bits to keep the unsigned order
+        const __m128i SignBit = _mm_set1_epi16(static_cast<short>(0x8000));
+
+        __m128i MinVec = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(Min)), SignBit);
+        __m128i MaxVec = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(Max)), SignBit);
+        for (; i + 8 <= NumSamples; i += 8)
+        {
+            const __m128i Samples = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSamples + i)), SignBit);
+
+            MinVec = _mm_min_epi16(MinVec, Samples);
+            MaxVec = _mm_max_epi16(MaxVec, Samples);
+        }
+
+        MinVec = _mm_min_epi16(MinVec, _mm_shuffle_epi32(MinVec, _MM_SHUFFLE(1, 0, 3, 2)));
+        MinVec = _mm_min_epi16(MinVec, _mm_shuffle_epi32(MinVec, _MM_SHUFFLE(2, 3, 0, 1)));
+        MinVec = _mm_min_epi16(MinVec, _mm_shufflelo_epi16(MinVec, _MM_SHUFFLE(2, 3, 0, 1)));
+        MaxVec = _mm_max_epi16(MaxVec, _mm_shuffle_epi32(MaxVec, _MM_SHUFFLE(1, 0, 3, 2)));
+        MaxVec = _mm_max_epi16(MaxVec, _mm_shuffle_epi32(MaxVec, _MM_SHUFFLE(2, 3, 0, 1)));
+        MaxVec = _mm_max_epi16(MaxVec, _mm_shufflelo_epi16(MaxVec, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        Min = static_cast<Uint16>(_mm_extract_epi16(MinVec, 0) ^ 0x8000);
+        Max = static_cast<Uint16>(_mm_extract_epi16(MaxVec, 0) ^ 0x8000);
+    }
+#elif ELEVATION_NEON
+    if (NumSamples >= 8)
+    {
+        uint16x8_t MinVec = vdupq_n_u16(Min);
+        uint16x8_t MaxVec = vdupq_n_u16(Max);
+        for (; i + 8 <= NumSamples; i += 8)
+        {
+            const uint16x8_t Samples = vld1q_u16(pSamples + i);
+
+            MinVec = vminq_u16(MinVec, Samples);
+            MaxVec = vmaxq_u16(MaxVec, Samples);
+        }
+
+        uint16x4_t Min4 = vmin_u16(vget_low_u16(MinVec), vget_high_u16(MinVec));
+        uint16x4_t Max4 = vmax_u16(vget_low_u16(MaxVec), vget_high_u16(MaxVec));
+        Min4            = vpmin_u16(Min4, Min4);
+        Min4            = vpmin_u16(Min4, Min4);
+        Max4            = vpmax_u16(Max4, Max4);
+        Max4            = vpmax_u16(Max4, Max4);
+
+        Min = vget_lane_u16(Min4, 0);
+        Max = vget_lane_u16(Max4, 0);
+    }
+#endif
+
+    for (; i < NumSamples; ++i)
+    {
+        Min = std::min(Min, pSamples[i]);
+        Max = std::max(Max, pSamples[i]);
+    }
+}
+
+} // namespace
+
+inline const Uint16* ElevationDataSource::GetElevSamplePtr(Int32 i, Int32 j) const
+{
+    constexpr Uint32 TileSizeLog2 = TiledElevationFile::TileSizeLog2;
+    constexpr Uint32 TileMask     = TiledElevationFile::TileMask;
+
+    const size_t TileIdx = size_t{static_cast<Uint32>(i) >> TileSizeLog2} + size_t{static_cast<Uint32>(j) >> TileSizeLog2} * m_iNumTilesX;
+    return m_pTiles + (TileIdx << (2 * TileSizeLog2)) + (i & TileMask) + ((j & TileMask) << TileSizeLog2);
+}
+
+inline Uint16* ElevationDataSource::GetElevSamplePtr(Int32 i, Int32 j)
+{
+    return const_cast<Uint16*>(static_cast<const ElevationDataSource*>(this)->GetElevSamplePtr(i, j));
 }
 
 inline Uint16 ElevationDataSource::GetElevSample(Int32 i, Int32 j) const
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    return *GetElevSamplePtr(i, j);
 }
 
 float ElevationDataSource::GetInterpolatedHeight(float fCol, float fRow, int iStep) const
@@ -210,6 +394,99 @@ float ElevationDataSource::GetInterpolatedHeight(float fCol, float fRow, int iSt
     return fInterpolatedHeight;
 }
 
+void ElevationDataSource::GetInterpolatedHeights(const float* pCols, const float* pRows, float* pHeights, size_t NumSamples) const
+{
+    size_t i = 0;
+#if ELEVATION_SSE2 || ELEVATION_NEON
+    for (; i + 4 <= NumSamples; i += 4)
+    {
+        // Integer coordinates of the top left sample and bilinear weights
+        alignas(16) Int32 iCol0[4], iRow0[4];
+        alignas(16) float fHWeight[4], fVWeight[4];
+#    if ELEVATION_SSE2
+        {
+            const __m128 fCol = _mm_loadu_ps(pCols + i);
+            const __m128 fRow = _mm_loadu_ps(pRows + i);
+
+            // Truncation rounds negative values up, so subtract one where the truncated value is greater
+            __m128i iCol = _mm_cvttps_epi32(fCol);
+            __m128i iRow = _mm_cvttps_epi32(fRow);
+            iCol         = _mm_add_epi32(iCol, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(iCol), fCol)));
+            iRow         = _mm_add_epi32(iRow, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(iRow), fRow)));
+            _mm_store_ps(fHWeight, _mm_sub_ps(fCol, _mm_cvtepi32_ps(iCol)));
+            _mm_store_ps(fVWeight, _mm_sub_ps(fRow, _mm_cvtepi32_ps(iRow)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(iCol0), _mm_add_epi32(iCol, _mm_set1_epi32(m_iColOffset)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(iRow0), _mm_add_epi32(iRow, _mm_set1_epi32(m_iRowOffset)));
+        }
+#    else
+        {
+            const float32x4_t fCol = vld1q_f32(pCols + i);
+            const float32x4_t fRow = vld1q_f32(pRows + i);
+
+            int32x4_t iCol = vcvtq_s32_f32(fCol);
+            int32x4_t iRow = vcvtq_s32_f32(fRow);
+            iCol           = vaddq_s32(iCol, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(iCol), fCol)));
+            iRow           = vaddq_s32(iRow, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(iRow), fRow)));
+            vst1q_f32(fHWeight, vsubq_f32(fCol, vcvtq_f32_s32(iCol)));
+            vst1q_f32(fVWeight, vsubq_f32(fRow, vcvtq_f32_s32(iRow)));
+            vst1q_s32(iCol0, vaddq_s32(iCol, vdupq_n_s32(m_iColOffset)));
+            vst1q_s32(iRow0, vaddq_s32(iRow, vdupq_n_s32(m_iRowOffset)));
+        }
+#    endif
+
+        alignas(16) float H00[4], H10[4], H01[4], H11[4];
+        for (int Lane = 0; Lane < 4; ++Lane)
+        {
+            int iCol1 = iCol0[Lane] + 1;
+            int iRow1 = iRow0[Lane] + 1;
+            int iCol  = iCol0[Lane];
+            int iRow  = iRow0[Lane];
+            // Coordinates are only mirrored on the terrain boundary
+            if (iCol < 0 || iCol1 >= static_cast<int>(m_iNumCols))
+            {
+                iCol  = MirrorCoord(iCol, m_iNumCols);
+                iCol1 = MirrorCoord(iCol1, m_iNumCols);
+            }
+            if (iRow < 0 || iRow1 >= static_cast<int>(m_iNumRows))
+            {
+                iRow  = MirrorCoord(iRow, m_iNumRows);
+                iRow1 = MirrorCoord(iRow1, m_iNumRows);
+            }
+            H00[Lane] = GetElevSample(iCol, iRow);
+            H10[Lane] = GetElevSample(iCol1, iRow);
+            H01[Lane] = GetElevSample(iCol, iRow1);
+            H11[Lane] = GetElevSample(iCol1, iRow1);
+        }
+
+        // Same operation order as in GetInterpolatedHeight()
+#    if ELEVATION_SSE2
+        {
+            const __m128 One = _mm_set1_ps(1.f);
+            const __m128 HW  = _mm_load_ps(fHWeight);
+            const __m128 VW  = _mm_load_ps(fVWeight);
+            const __m128 HW1 = _mm_sub_ps(One, HW);
+            const __m128 H0  = _mm_add_ps(_mm_mul_ps(_mm_load_ps(H00), HW1), _mm_mul_ps(_mm_load_ps(H10), HW));
+            const __m128 H1  = _mm_add_ps(_mm_mul_ps(_mm_load_ps(H01), HW1), _mm_mul_ps(_mm_load_ps(H11), HW));
+            _mm_storeu_ps(pHeights + i, _mm_add_ps(_mm_mul_ps(H0, _mm_sub_ps(One, VW)), _mm_mul_ps(H1, VW)));
+        }
+#    else
+        {
+            const float32x4_t One = vdupq_n_f32(1.f);
+            const float32x4_t HW  = vld1q_f32(fHWeight);
+            const float32x4_t VW  = vld1q_f32(fVWeight);
+            const float32x4_t HW1 = vsubq_f32(One, HW);
+            const float32x4_t H0  = vaddq_f32(vmulq_f32(vld1q_f32(H00), HW1), vmulq_f32(vld1q_f32(H10), HW));
+            const float32x4_t H1  = vaddq_f32(vmulq_f32(vld1q_f32(H01), HW1), vmulq_f32(vld1q_f32(H11), HW));
+            vst1q_f32(pHeights + i, vaddq_f32(vmulq_f32(H0, vsubq_f32(One, VW)), vmulq_f32(H1, VW)));
+        }
+#    endif
+    }
+#endif
+
+    for (; i < NumSamples; ++i)
+        pHeights[i] = GetInterpolatedHeight(pCols[i], pRows[i]);
+}
+
 float3 ElevationDataSource::ComputeSurfaceNormal(float fCol, float fRow, float fSampleSpacing, float fHeightScale, int iStep) const
 {
     float Height1 = GetInterpolatedHeight(fCol + (float)iStep, fRow, iStep);
@@ -229,31 +506,63 @@ float3 ElevationDataSource::ComputeSurfaceNormal(float fCol, float fRow, float f
     return Normal;
 }
 
-void ElevationDataSource::RecomputePatchMinMaxElevations(const QuadTreeNodeLocation& pos)
+std::pair<Uint16, Uint16> ElevationDataSource::ComputeRegionMinMax(Uint32 StartCol, Uint32 StartRow, Uint32 EndCol, Uint32 EndRow) const
 {
-    if (pos.level == m_iNumLevels - 1)
-    {
-        std::pair<Uint16, Uint16>& CurrPatchMinMaxElev = m_MinMaxElevation[QuadTreeNodeLocation(pos.horzOrder, pos.vertOrder, pos.level)];
+    constexpr Uint32 TileSizeLog2 = TiledElevationFile::TileSizeLog2;
+    constexpr Uint32 TileMask     = TiledElevationFile::TileMask;
 
-        int iStartCol = pos.horzOrder * m_iPatchSize;
-        int iStartRow = pos.vertOrder * m_iPatchSize;
+    VERIFY_EXPR(StartCol <= EndCol && EndCol < m_iNumCols && StartRow <= EndRow && EndRow < m_iNumRows);
+
+    Uint16 Min = GetElevSample(StartCol, StartRow);
+    Uint16 Max = Min;
+    for (Uint32 TileY = StartRow >> TileSizeLog2; TileY <= (EndRow >> TileSizeLog2); ++TileY)
+    {
+        const Uint32 FirstRow = std::max(StartRow, TileY << TileSizeLog2);
+        const Uint32 LastRow  = std::min(EndRow, (TileY << TileSizeLog2) + TileMask);
+        for (Uint32 TileX = StartCol >> TileSizeLog2; TileX <= (EndCol >> TileSizeLog2); ++TileX)
+        {
+            const Uint32 FirstCol = std::max(StartCol, TileX << TileSizeLog2);
+            const Uint32 LastCol  = std::min(EndCol, (TileX << TileSizeLog2) + TileMask);
+            const Uint32 Width    = LastCol - FirstCol + 1;
 
-        CurrPatchMinMaxElev.first = CurrPatchMinMaxElev.second = GetElevSample(iStartCol, iStartRow);
-        for (int iRow = iStartRow; iRow <= iStartRow + m_iPatchSize; iRow++)
-            for (int iCol = iStartCol; iCol <= iStartCol + m_iPatchSize; iCol++)
+            const Uint16* pFirstSample = GetElevSamplePtr(FirstCol, FirstRow);
+            if (Width == TiledElevationFile::TileSize)
             {
-                Uint16 CurrElev            = GetElevSample(std::min(iCol, (Int32)m_iNumCols - 1), std::min(iRow, (Int32)m_iNumRows - 1));
-                CurrPatchMinMaxElev.first  = std::min(CurrPatchMinMaxElev.first, CurrElev);
-                CurrPatchMinMaxElev.second = std::max(CurrPatchMinMaxElev.second, CurrElev);
+                // Rows that span the whole tile are adjacent in memory
+                ReduceMinMax(pFirstSample, size_t{Width} * (LastRow - FirstRow + 1), Min, Max);
             }
+            else
+            {
+                for (Uint32 iRow = FirstRow; iRow <= LastRow; ++iRow)
+                    ReduceMinMax(pFirstSample + (iRow - FirstRow) * TiledElevationFile::TileSize, Width, Min, Max);
+            }
+        }
+    }
+
+    return std::make_pair(Min, Max);
+}
+
+void ElevationDataSource::RecomputePatchMinMaxElevations(const QuadTreeNodeLocation& pos)
+{
+    if (pos.level == m_iNumLevels - 1)
+    {
+        // Patches include the first row and column of their neighbors. Samples beyond
+        // the terrain are clamped to the last row and column.
+        const Uint32 iStartCol = std::min(static_cast<Uint32>(pos.horzOrder * m_iPatchSize), m_iNumCols - 1);
+        const Uint32 iStartRow = std::min(static_cast<Uint32>(pos.vertOrder * m_iPatchSize), m_iNumRows - 1);
+        const Uint32 iEndCol   = std::min(static_cast<Uint32>(pos.horzOrder * m_iPatchSize + m_iPatchSize), m_iNumCols - 1);
+        const Uint32 iEndRow   = std::min(static_cast<Uint32>(pos.vertOrder * m_iPatchSize + m_iPatchSize), m_iNumRows - 1);
+
+        m_MinMaxElevation[pos] = ComputeRegionMinMax(iStartCol, iStartRow, iEndCol, iEndRow);
     }
     else
     {
-        std::pair<Uint16, Uint16>& CurrPatchMinMaxElev = m_MinMaxElevation[pos];
-        std::pair<Uint16, Uint16>& LBChildMinMaxElev   = m_MinMaxElevation[GetChildLocation(pos, 0)];
-        std::pair<Uint16, Uint16>& RBChildMinMaxElev   = m_MinMaxElevation[GetChildLocation(pos, 1)];
-        std::pair<Uint16, Uint16>& LTChildMinMaxElev   = m_MinMaxElevation[GetChildLocation(pos, 2)];
-        std::pair<Uint16, Uint16>& RTChildMinMaxElev   = m_MinMaxElevation[GetChildLocation(pos, 3)];
+        std::pair<Uint16, Uint16>&       CurrPatchMinMaxElev = m_MinMaxElevation[pos];
+        const std::pair<Uint16, Uint16>* pChildrenMinMaxElev = m_MinMaxElevation.GetChildren(pos);
+        const std::pair<Uint16, Uint16>& LBChildMinMaxElev   = pChildrenMinMaxElev[0];
+        const std::pair<Uint16, Uint16>& RBChildMinMaxElev   = pChildrenMinMaxElev[1];
+        const std::pair<Uint16, Uint16>& LTChildMinMaxElev   = pChildrenMinMaxElev[2];
+        const std::pair<Uint16, Uint16>& RTChildMinMaxElev   = pChildrenMinMaxElev[3];
 
         CurrPatchMinMaxElev.first = std::min(LBChildMinMaxElev.first, RBChildMinMaxElev.first);
         CurrPatchMinMaxElev.first = std::min(CurrPatchMinMaxElev.first, LTChildMinMaxElev.first);
@@ -266,19 +575,332 @@ void ElevationDataSource::RecomputePatchMinMaxElevations(const QuadTreeNodeLocat
 }
 
 // Calculates min/max elevations for the hierarchy
-void ElevationDataSource::CalculateMinMaxElevations()
+void ElevationDataSource::CalculateMinMaxElevations(TaskScheduler* pScheduler)
 {
-    // Calculate min/max elevations starting from the finest level
-    for (HierarchyReverseIterator it(m_iNumLevels); it.IsValid(); it.Next())
+    const int LeafLevel = m_iNumLevels - 1;
+
+    // Leaf patches are processed in Morton order, which is the order of the nodes in m_MinMaxElevation
+    const Uint32 NumLeafPatches     = 1u << (2 * LeafLevel);
+    auto         RecomputeLeafPatch = [&](Uint32 MortonOrder) {
+        QuadTreeNodeLocation Pos;
+        Pos.level = LeafLevel;
+        DecodeMortonOrder(MortonOrder, Pos.horzOrder, Pos.vertOrder);
+        RecomputePatchMinMaxElevations(Pos);
+    };
+    if (pScheduler != nullptr && NumLeafPatches > 1)
+    {
+        pScheduler->ParallelFor(NumLeafPatches, [&](Uint32, Uint32 MortonOrder) { RecomputeLeafPatch(MortonOrder); });
+    }
+    else
+    {
+        for (Uint32 MortonOrder = 0; MortonOrder < NumLeafPatches; ++MortonOrder)
+            RecomputeLeafPatch(MortonOrder);
+    }
+
+    // Calculate min/max elevations of the coarser levels from their children
+    for (HierarchyReverseMortonIterator it(LeafLevel); it.IsValid(); it.Next())
     {
         RecomputePatchMinMaxElevations(it);
     }
 }
 
-void ElevationDataSource::GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch)
+void ElevationDataSource::UpdateMinMaxElevations(Uint32 FirstHorzOrder, Uint32 FirstVertOrder, Uint32 LastHorzOrder, Uint32 LastVertOrder, TaskScheduler* pScheduler)
+{
+    const int LeafLevel = m_iNumLevels - 1;
+
+    // Leaf patches are independent and take almost all the time
+    const Uint32 NumPatchesX = LastHorzOrder - FirstHorzOrder + 1;
+    const Uint32 NumPatches  = NumPatchesX * (LastVertOrder - FirstVertOrder + 1);
+    auto         RecomputeLeafPatch = [&](Uint32 PatchIdx) {
+        const Uint32 HorzOrder = FirstHorzOrder + PatchIdx % NumPatchesX;
+        const Uint32 VertOrder = FirstVertOrder + PatchIdx / NumPatchesX;
+        RecomputePatchMinMaxElevations(QuadTreeNodeLocation(static_cast<int>(HorzOrder), static_cast<int>(VertOrder), LeafLevel));
+    };
+    if (pScheduler != nullptr && NumPatches > 1)
+    {
+        pScheduler->ParallelFor(NumPatches, [&](Uint32, Uint32 PatchIdx) { RecomputeLeafPatch(PatchIdx); });
+    }
+    else
+    {
+        for (Uint32 PatchIdx = 0; PatchIdx < NumPatches; ++PatchIdx)
+            RecomputeLeafPatch(PatchIdx);
+    }
+
+    // Only the ancestors of the recomputed patches need to be updated
+    for (int Level = LeafLevel - 1; Level >= 0; --Level)
+    {
+        FirstHorzOrder >>= 1;
+        FirstVertOrder >>= 1;
+        LastHorzOrder >>= 1;
+        LastVertOrder >>= 1;
+        for (Uint32 VertOrder = FirstVertOrder; VertOrder <= LastVertOrder; ++VertOrder)
+        {
+            for (Uint32 HorzOrder = FirstHorzOrder; HorzOrder <= LastHorzOrder; ++HorzOrder)
+                RecomputePatchMinMaxElevations(QuadTreeNodeLocation(static_cast<int>(HorzOrder), static_cast<int>(VertOrder), Level));
+        }
+    }
+}
+
+void ElevationDataSource::SetElevations(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, const Uint16* pSrc, size_t SrcStride, TaskScheduler* pScheduler)
+{
+    VERIFY_EXPR(StartCol + NumCols <= m_iNumCols && StartRow + NumRows <= m_iNumRows);
+    if (NumCols == 0 || NumRows == 0)
+        return;
+
+    constexpr Uint32 TileSize = TiledElevationFile::TileSize;
+
+    for (Uint32 iRow = StartRow; iRow < StartRow + NumRows; ++iRow)
+    {
+        const Uint16* pSrcRow = pSrc + (iRow - StartRow) * SrcStride;
+        for (Uint32 iCol = StartCol; iCol < StartCol + NumCols;)
+        {
+            const Uint32 NumCopy = std::min((iCol / TileSize + 1) * TileSize, StartCol + NumCols) - iCol;
+            memcpy(GetElevSamplePtr(iCol, iRow), pSrcRow + (iCol - StartCol), NumCopy * sizeof(Uint16));
+            iCol += NumCopy;
+        }
+    }
+
+    // A sample on a patch boundary belongs to both adjacent patches. Leaf patches that start
+    // beyond the last column or row use the samples of that column or row.
+    const Uint32 PatchSize     = static_cast<Uint32>(m_iPatchSize);
+    const Uint32 LastLeafOrder = (1u << (m_iNumLevels - 1)) - 1;
+    const Uint32 EndCol        = StartCol + NumCols - 1;
+    const Uint32 EndRow        = StartRow + NumRows - 1;
+
+    const Uint32 FirstHorzOrder = std::min((StartCol > 0 ? StartCol - 1 : 0) / PatchSize, LastLeafOrder);
+    const Uint32 FirstVertOrder = std::min((StartRow > 0 ? StartRow - 1 : 0) / PatchSize, LastLeafOrder);
+    const Uint32 LastHorzOrder  = EndCol == m_iNumCols - 1 ? LastLeafOrder : std::min(EndCol / PatchSize, LastLeafOrder);
+    const Uint32 LastVertOrder  = EndRow == m_iNumRows - 1 ? LastLeafOrder : std::min(EndRow / PatchSize, LastLeafOrder);
+    UpdateMinMaxElevations(FirstHorzOrder, FirstVertOrder, LastHorzOrder, LastVertOrder, pScheduler);
+
+    UpdateOverview(StartCol, StartRow, EndCol, EndRow, pScheduler);
+}
+
+void ElevationDataSource::CopyRow(Uint32 StartCol, Uint32 iRow, Uint32 NumCols, Uint16* pDst) const
+{
+    constexpr Uint32 TileSize = TiledElevationFile::TileSize;
+
+    for (Uint32 iCol = StartCol; iCol < StartCol + NumCols;)
+    {
+        const Uint32 NumCopy = std::min((iCol / TileSize + 1) * TileSize, StartCol + NumCols) - iCol;
+        memcpy(pDst + (iCol - StartCol), GetElevSamplePtr(iCol, iRow), NumCopy * sizeof(Uint16));
+        iCol += NumCopy;
+    }
+}
+
+void ElevationDataSource::CopyRegion(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, Uint16* pDst, size_t DstStride) const
+{
+    VERIFY_EXPR(StartCol + NumCols <= m_iNumCols && StartRow + NumRows <= m_iNumRows);
+    if (NumCols == 0 || NumRows == 0)
+        return;
+
+    constexpr Uint32 TileSize     = TiledElevationFile::TileSize;
+    constexpr Uint32 TileSizeLog2 = TiledElevationFile::TileSizeLog2;
+
+    const Uint32 FirstTileX = StartCol >> TileSizeLog2;
+    const Uint32 NumTilesX  = ((StartCol + NumCols - 1) >> TileSizeLog2) - FirstTileX + 1;
+    for (Uint32 iRow = StartRow; iRow < StartRow + NumRows; ++iRow)
+    {
+        const Uint32 TileY = iRow >> TileSizeLog2;
+        // Start paging in the next row of tiles while the current one is copied
+        if (iRow == StartRow || (iRow & TiledElevationFile::TileMask) == 0)
+        {
+            const Uint32 LastRow = StartRow + NumRows - 1;
+            if (((iRow + TileSize) >> TileSizeLog2) <= (LastRow >> TileSizeLog2))
+                m_TiledFile.Prefetch(FirstTileX, TileY + 1, NumTilesX, 1);
+        }
+
+        CopyRow(StartCol, iRow, NumCols, pDst + (iRow - StartRow) * DstStride);
+    }
+}
+
+void ElevationDataSource::CopyMirroredRegion(int iStartCol, int iStartRow, Uint32 NumCols, Uint32 NumRows, Uint16* pDst, size_t DstStride) const
 {
-    pDataPtr = &m_TheHeightMap[0];
-    Pitch    = m_iStride;
+    iStartCol += m_iColOffset;
+    iStartRow += m_iRowOffset;
+
+    // clang-format off
+    const bool ColsInside = iStartCol >= 0 && static_cast<Uint32>(iStartCol) + NumCols <= m_iNumCols;
+    const bool RowsInside = iStartRow >= 0 && static_cast<Uint32>(iStartRow) + NumRows <= m_iNumRows;
+    // clang-format on
+    if (ColsInside && RowsInside)
+    {
+        CopyRegion(static_cast<Uint32>(iStartCol), static_cast<Uint32>(iStartRow), NumCols, NumRows, pDst, DstStride);
+        return;
+    }
+
+    for (Uint32 Row = 0; Row < NumRows; ++Row)
+    {
+        const Uint32 iRow    = static_cast<Uint32>(MirrorCoord(iStartRow + static_cast<int>(Row), m_iNumRows));
+        Uint16*      pDstRow = pDst + Row * DstStride;
+        if (ColsInside)
+        {
+            CopyRow(static_cast<Uint32>(iStartCol), iRow, NumCols, pDstRow);
+        }
+        else
+        {
+            for (Uint32 Col = 0; Col < NumCols; ++Col)
+                pDstRow[Col] = GetElevSample(MirrorCoord(iStartCol + static_cast<int>(Col), m_iNumCols), iRow);
+        }
+    }
+}
+
+const Uint16* ElevationDataSource::GetPatchSamples(int iStartCol, int iStartRow, std::vector<Uint16>& Scratch, size_t& Stride) const
+{
+    constexpr Uint32 TileSize = TiledElevationFile::TileSize;
+    static_assert(TileSize == 128, "Patches are expected to match the tiles");
+
+    const int iCol = iStartCol + m_iColOffset;
+    const int iRow = iStartRow + m_iRowOffset;
+    // clang-format off
+    if (iCol >= 0 && iCol % TileSize == 0 && static_cast<Uint32>(iCol) + TileSize <= m_iNumCols &&
+        iRow >= 0 && iRow % TileSize == 0 && static_cast<Uint32>(iRow) + TileSize <= m_iNumRows)
+    // clang-format on
+    {
+        Stride = TileSize;
+        return GetElevSamplePtr(iCol, iRow);
+    }
+
+    Scratch.resize(size_t{TileSize} * size_t{TileSize});
+    CopyMirroredRegion(iStartCol, iStartRow, TileSize, TileSize, Scratch.data(), TileSize);
+    Stride = TileSize;
+    return Scratch.data();
+}
+
+void ElevationDataSource::PrefetchRegion(int iStartCol, int iStartRow, Uint32 NumCols, Uint32 NumRows) const
+{
+    if (NumCols == 0 || NumRows == 0)
+        return;
+
+    // Mirrored coordinates of a range are not necessarily contiguous, so prefetch the tiles
+    // of the range that contains all of them
+    auto GetMirroredRange = [](int iStart, Uint32 Num, Uint32 Dim, Uint32& First, Uint32& Last) {
+        First = Dim;
+        Last  = 0;
+        for (Uint32 i = 0; i < std::min(Num, 2 * Dim); ++i)
+        {
+            const auto iCoord = static_cast<Uint32>(MirrorCoord(iStart + static_cast<int>(i), Dim));
+            First             = std::min(First, iCoord);
+            Last              = std::max(Last, iCoord);
+        }
+    };
+
+    Uint32 FirstCol, LastCol, FirstRow, LastRow;
+    GetMirroredRange(iStartCol + m_iColOffset, NumCols, m_iNumCols, FirstCol, LastCol);
+    GetMirroredRange(iStartRow + m_iRowOffset, NumRows, m_iNumRows, FirstRow, LastRow);
+
+    constexpr Uint32 TileSizeLog2 = TiledElevationFile::TileSizeLog2;
+    m_TiledFile.Prefetch(FirstCol >> TileSizeLog2, FirstRow >> TileSizeLog2,
+                         (LastCol >> TileSizeLog2) - (FirstCol >> TileSizeLog2) + 1,
+                         (LastRow >> TileSizeLog2) - (FirstRow >> TileSizeLog2) + 1);
+}
+
+namespace
+{
+
+// Downsamples the Dim x Dim image NumLevels times and writes the result to pDst
+void DownsampleLevels(const Uint16* pSrc, size_t SrcStride, Uint32 Dim, Uint32 NumLevels, Uint16* pDst, size_t DstStride, std::vector<Uint16>& Temp)
+{
+    if (NumLevels == 0)
+    {
+        for (Uint32 Row = 0; Row < Dim; ++Row)
+            memcpy(pDst + Row * DstStride, pSrc + Row * SrcStride, Dim * sizeof(Uint16));
+        return;
+    }
+
+    // Intermediate levels alternate between two parts of Temp
+    const size_t Part0Size = size_t{Dim / 2} * size_t{Dim / 2};
+    Temp.resize(Part0Size + Part0Size / 4);
+    for (Uint32 Level = 1; Level <= NumLevels; ++Level)
+    {
+        const Uint32 LevelDim = Dim >> Level;
+        Uint16*      pLevel   = Level == NumLevels ? pDst : &Temp[(Level & 0x01) ? 0 : Part0Size];
+        const size_t Stride   = Level == NumLevels ? DstStride : LevelDim;
+        DownsampleUint16Image2x2(pSrc, SrcStride, pLevel, Stride, LevelDim, LevelDim);
+        pSrc      = pLevel;
+        SrcStride = Stride;
+    }
+}
+
+} // namespace
+
+void ElevationDataSource::UpdateOverview(Uint32 FirstCol, Uint32 FirstRow, Uint32 LastCol, Uint32 LastRow, TaskScheduler* pScheduler)
+{
+    constexpr Uint32 TileSize     = TiledElevationFile::TileSize;
+    constexpr Uint32 TileSizeLog2 = TiledElevationFile::TileSizeLog2;
+
+    // The overview is computed in blocks of BlockTiles x BlockTiles tiles. Every tile of the block is
+    // downsampled separately first. If one overview sample covers more than one tile, the results are
+    // then downsampled further. Since the 2x2 blocks never cross tile boundaries, this gives the same
+    // result as downsampling the whole height map.
+    const Uint32 TileLevels   = std::min(m_OverviewLevel, TileSizeLog2);
+    const Uint32 TileDim      = TileSize >> TileLevels;
+    const Uint32 BlockTiles   = 1u << (m_OverviewLevel - TileLevels);
+    const Uint32 BlockDim     = (BlockTiles * TileDim) >> (m_OverviewLevel - TileLevels);
+    const Uint32 BlockSamples = BlockTiles * TileSize;
+
+    const Uint32 OverviewWidth  = GetOverviewWidth();
+    const Uint32 OverviewHeight = GetOverviewHeight();
+    const Uint32 NumBlocksX     = (OverviewWidth + BlockDim - 1) / BlockDim;
+    const Uint32 NumBlocksY     = (OverviewHeight + BlockDim - 1) / BlockDim;
+
+    const Uint32 FirstBlockX = FirstCol / BlockSamples;
+    const Uint32 FirstBlockY = FirstRow / BlockSamples;
+    const Uint32 LastBlockX  = std::min(LastCol / BlockSamples, NumBlocksX - 1);
+    const Uint32 LastBlockY  = std::min(LastRow / BlockSamples, NumBlocksY - 1);
+    if (FirstBlockX > LastBlockX || FirstBlockY > LastBlockY)
+        return;
+
+    struct ThreadScratch
+    {
+        std::vector<Uint16> Block;
+        std::vector<Uint16> Temp;
+    };
+    std::vector<ThreadScratch> Scratch(pScheduler != nullptr ? pScheduler->GetNumThreads() : 1);
+
+    const Uint32 NumBlocksInRangeX = LastBlockX - FirstBlockX + 1;
+    const Uint32 NumBlocksInRange  = NumBlocksInRangeX * (LastBlockY - FirstBlockY + 1);
+    auto         UpdateBlock       = [&](Uint32 ThreadId, Uint32 BlockIdx) {
+        const Uint32 BlockX = FirstBlockX + BlockIdx % NumBlocksInRangeX;
+        const Uint32 BlockY = FirstBlockY + BlockIdx / NumBlocksInRangeX;
+
+        auto&        Block       = Scratch[ThreadId].Block;
+        auto&        Temp        = Scratch[ThreadId].Temp;
+        const Uint32 BlockStride = BlockTiles * TileDim;
+        Block.resize(size_t{BlockStride} * size_t{BlockStride});
+        for (Uint32 TileY = 0; TileY < BlockTiles; ++TileY)
+        {
+            for (Uint32 TileX = 0; TileX < BlockTiles; ++TileX)
+            {
+                const Uint16* pTile = GetElevSamplePtr((BlockX * BlockTiles + TileX) * TileSize, (BlockY * BlockTiles + TileY) * TileSize);
+                DownsampleLevels(pTile, TileSize, TileSize, TileLevels, &Block[size_t{TileY} * TileDim * BlockStride + TileX * TileDim], BlockStride, Temp);
+            }
+        }
+
+        Uint16* pDst = m_pOverview + size_t{BlockY} * BlockDim * OverviewWidth + BlockX * BlockDim;
+        if (BlockTiles > 1)
+        {
+            DownsampleLevels(Block.data(), BlockStride, BlockStride, m_OverviewLevel - TileLevels, pDst, OverviewWidth, Temp);
+        }
+        else
+        {
+            // The terrain may be smaller than one tile
+            const Uint32 NumCopyCols = std::min(BlockDim, OverviewWidth - BlockX * BlockDim);
+            const Uint32 NumCopyRows = std::min(BlockDim, OverviewHeight - BlockY * BlockDim);
+            for (Uint32 Row = 0; Row < NumCopyRows; ++Row)
+                memcpy(pDst + Row * OverviewWidth, &Block[Row * BlockStride], NumCopyCols * sizeof(Uint16));
+        }
+    };
+
+    if (pScheduler != nullptr && NumBlocksInRange > 1)
+    {
+        pScheduler->ParallelFor(NumBlocksInRange, UpdateBlock);
+    }
+    else
+    {
+        for (Uint32 BlockIdx = 0; BlockIdx < NumBlocksInRange; ++BlockIdx)
+            UpdateBlock(0, BlockIdx);
+    }
 }
 
 } // namespace Diligent
@@ -50,19 +50,52 @@
 #include "BasicMath.hpp"
 #include "HierarchyArray.hpp"
 #include "DynamicQuadTreeNode.hpp"
+#include "TiledElevationFile.hpp"
 
 namespace Diligent
 {
 
-// Class implementing elevation data source
+class TaskScheduler;
+
+// Class implementing elevation data source.
+// Height map samples are stored in tiles of the patch size. When the data comes from a tiled elevation
+// file, the tiles are mapped from the file rather than loaded, so only the tiles that are accessed are
+// paged in, and the data set does not need to fit into memory. A downsampled overview of the whole
+// height map is kept next to the tiles.
 class ElevationDataSource
 {
 public:
-    // Creates data source from the specified raw data file
-    ElevationDataSource(const Char* strSrcDemFile);
+    // Creates data source from the specified tiled elevation file or image file.
+    // For an image file, the tiled file created from the same version of the image on a previous run
+    // is mapped from the user's cache directory if it exists. Otherwise, the image is loaded and the
+    // tiled file is written to the cache directory.
+    // If pScheduler is not null, min/max elevations of the leaf patches are computed in parallel.
+    ElevationDataSource(const Char* strSrcDemFile, TaskScheduler* pScheduler = nullptr);
     virtual ~ElevationDataSource(void);
 
-    void GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch);
+    // Copies NumCols x NumRows samples starting at (StartCol, StartRow) to pDst. DstStride is in samples.
+    void CopyRegion(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, Uint16* pDst, size_t DstStride) const;
+
+    // Same as CopyRegion(), but the coordinates are relative to the offsets and are mirrored
+    // on the terrain boundary in the same way as in GetInterpolatedHeight().
+    void CopyMirroredRegion(int iStartCol, int iStartRow, Uint32 NumCols, Uint32 NumRows, Uint16* pDst, size_t DstStride) const;
+
+    // Returns the PatchSize x PatchSize samples starting at (iStartCol, iStartRow). The coordinates are the same
+    // as in CopyMirroredRegion(). If the patch is a tile, the returned pointer points to the tile itself.
+    // Otherwise, the samples are copied to Scratch. Stride receives the row stride in samples.
+    const Uint16* GetPatchSamples(int iStartCol, int iStartRow, std::vector<Uint16>& Scratch, size_t& Stride) const;
+
+    // Asks the OS to start paging in the tiles that contain the specified samples. The coordinates are
+    // the same as in CopyMirroredRegion().
+    void PrefetchRegion(int iStartCol, int iStartRow, Uint32 NumCols, Uint32 NumRows) const;
+
+    // The overview is the height map downsampled 2x2 GetOverviewLevel() times in row-major order, see
+    // TiledElevationFile. Its dimensions are GetOverviewWidth() x GetOverviewHeight().
+    const Uint16* GetOverview() const { return m_pOverview; }
+
+    Uint32 GetOverviewLevel() const { return m_OverviewLevel; }
+    Uint32 GetOverviewWidth() const { return TiledElevationFile::GetOverviewDim(m_iNumCols, m_OverviewLevel); }
+    Uint32 GetOverviewHeight() const { return TiledElevationFile::GetOverviewDim(m_iNumRows, m_OverviewLevel); }
 
     // Returns minimal height of the whole terrain
     Uint16 GetGlobalMinElevation() const;
@@ -72,6 +105,12 @@ public:
 
     void RecomputePatchMinMaxElevations(const QuadTreeNodeLocation& pos);
 
+    // Replaces NumCols x NumRows samples starting at (StartCol, StartRow) with the samples from pSrc, and
+    // recomputes min/max elevations of the patches that contain these samples and of their ancestors only,
+    // as well as the overview. SrcStride is in samples. If the data is mapped from a file, modified pages are
+    // private to the process and the file is not changed. Textures and meshes created from the data are not updated.
+    void SetElevations(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, const Uint16* pSrc, size_t SrcStride, TaskScheduler* pScheduler = nullptr);
+
     void SetOffsets(int iColOffset, int iRowOffset)
     {
         m_iColOffset = iColOffset;
@@ -85,17 +124,40 @@ public:
 
     float GetInterpolatedHeight(float fCol, float fRow, int iStep = 1) const;
 
+    // Computes GetInterpolatedHeight(pCols[i], pRows[i]) for NumSamples samples, four at a time
+    void GetInterpolatedHeights(const float* pCols, const float* pRows, float* pHeights, size_t NumSamples) const;
+
     float3 ComputeSurfaceNormal(float fCol, float fRow, float fSampleSpacing, float fHeightScale, int iStep = 1) const;
 
     unsigned int GetNumCols() const { return m_iNumCols; }
     unsigned int GetNumRows() const { return m_iNumRows; }
 
 private:
-    inline Uint16  GetElevSample(Int32 i, Int32 j) const;
-    inline Uint16& GetElevSample(Int32 i, Int32 j);
+    inline const Uint16* GetElevSamplePtr(Int32 i, Int32 j) const;
+    inline Uint16*       GetElevSamplePtr(Int32 i, Int32 j);
+    inline Uint16        GetElevSample(Int32 i, Int32 j) const;
+
+    // Computes min/max of the samples in the [StartCol, EndCol] x [StartRow, EndRow] range
+    std::pair<Uint16, Uint16> ComputeRegionMinMax(Uint32 StartCol, Uint32 StartRow, Uint32 EndCol, Uint32 EndRow) const;
+
+    // Splits the Width x Height image into tiles. Samples beyond the image duplicate the last row and column.
+    void InitTiles(const Uint16* pSamples, size_t Stride, Uint32 Width, Uint32 Height);
+
+    // Copies NumCols samples of the row iRow starting at StartCol
+    void CopyRow(Uint32 StartCol, Uint32 iRow, Uint32 NumCols, Uint16* pDst) const;
+
+    // Recomputes the overview samples that cover the [FirstCol, LastCol] x [FirstRow, LastRow] range
+    void UpdateOverview(Uint32 FirstCol, Uint32 FirstRow, Uint32 LastCol, Uint32 LastRow, TaskScheduler* pScheduler);
+
+    bool OpenTiledFile(const Char* Path, const TiledElevationFile::SourceFileStamp& Source);
+    bool WriteTiledFile(const Char* Path, const TiledElevationFile::SourceFileStamp& Source) const;
 
     // Calculates min/max elevations for all patches in the tree
-    void CalculateMinMaxElevations();
+    void CalculateMinMaxElevations(TaskScheduler* pScheduler);
+
+    // Recomputes min/max elevations of the leaf patches in the [FirstHorzOrder, LastHorzOrder] x [FirstVertOrder, LastVertOrder]
+    // range and of all their ancestors
+    void UpdateMinMaxElevations(Uint32 FirstHorzOrder, Uint32 FirstVertOrder, Uint32 LastHorzOrder, Uint32 LastVertOrder, TaskScheduler* pScheduler);
 
     // Hierarchy array storing minimal and maximal heights for quad tree nodes
     HierarchyArray<std::pair<Uint16, Uint16>> m_MinMaxElevation;
@@ -104,9 +166,17 @@ private:
     int m_iPatchSize;
     int m_iColOffset, m_iRowOffset;
 
-    // The whole terrain height map
-    std::vector<Uint16> m_TheHeightMap;
-    Uint32              m_iNumCols, m_iNumRows, m_iStride;
+    // The whole terrain height map, split into tiles. Points to either m_TileStorage or the mapped file.
+    Uint16*             m_pTiles = nullptr;
+    std::vector<Uint16> m_TileStorage;
+
+    // Points to either m_OverviewStorage or the mapped file
+    Uint16*             m_pOverview     = nullptr;
+    Uint32              m_OverviewLevel = 0;
+    std::vector<Uint16> m_OverviewStorage;
+
+    TiledElevationFile  m_TiledFile;
+    Uint32              m_iNumCols, m_iNumRows, m_iNumTilesX;
 };
 
 } // namespace Diligent
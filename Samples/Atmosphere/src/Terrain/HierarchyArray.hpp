@@ -46,37 +46,183 @@
 #pragma once
 
 #include <vector>
+#include "BasicTypes.h"
+#include "DebugUtilities.hpp"
 #include "DynamicQuadTreeNode.hpp"
 
 namespace Diligent
 {
 
+// Interleaves the bits of the horizontal and vertical orders of a node, with the horizontal
+// order in the even bits. Both orders must be less than 2^16.
+inline Uint32 EncodeMortonOrder(int horzOrder, int vertOrder)
+{
+    auto SpreadBits = [](Uint32 x) {
+        x &= 0x0000FFFFu;
+        x = (x | (x << 8u)) & 0x00FF00FFu;
+        x = (x | (x << 4u)) & 0x0F0F0F0Fu;
+        x = (x | (x << 2u)) & 0x33333333u;
+        x = (x | (x << 1u)) & 0x55555555u;
+        return x;
+    };
+    return SpreadBits(static_cast<Uint32>(horzOrder)) | (SpreadBits(static_cast<Uint32>(vertOrder)) << 1u);
+}
+
+inline void DecodeMortonOrder(Uint32 mortonOrder, int& horzOrder, int& vertOrder)
+{
+    auto CompactBits = [](Uint32 x) {
+        x &= 0x55555555u;
+        x = (x | (x >> 1u)) & 0x33333333u;
+        x = (x | (x >> 2u)) & 0x0F0F0F0Fu;
+        x = (x | (x >> 4u)) & 0x00FF00FFu;
+        x = (x | (x >> 8u)) & 0x0000FFFFu;
+        return x;
+    };
+    horzOrder = static_cast<int>(CompactBits(mortonOrder));
+    vertOrder = static_cast<int>(CompactBits(mortonOrder >> 1u));
+}
+
+// Number of nodes in all levels above the specified one: 1 + 4 + ... + 4^(level-1)
+inline size_t GetHierarchyLevelOffset(int level)
+{
+    return ((size_t{1} << (2 * level)) - 1) / 3;
+}
+
+// Base class for iterators that visit the nodes of every level in Morton order,
+// which is the order of the nodes in HierarchyArray
+class HierarchyMortonIteratorBase : public HierarchyIteratorBase
+{
+public:
+    // Index of the current node in HierarchyArray
+    size_t GetIndex() const { return m_index; }
+
+    // Index of the first child of the current node in HierarchyArray
+    size_t GetChildrenIndex() const { return GetHierarchyLevelOffset(m_current.level + 1) + size_t{m_mortonOrder} * 4; }
+
+protected:
+    void StartLevel(int level)
+    {
+        m_current.level     = level;
+        m_current.horzOrder = 0;
+        m_current.vertOrder = 0;
+        m_currentLevelSize  = 1 << level;
+        m_mortonOrder       = 0;
+        m_index             = GetHierarchyLevelOffset(level);
+    }
+
+    // Returns false when the current level is complete
+    bool NextInLevel()
+    {
+        ++m_index;
+        if (++m_mortonOrder == static_cast<Uint32>(m_currentLevelSize) * static_cast<Uint32>(m_currentLevelSize))
+            return false;
+        DecodeMortonOrder(m_mortonOrder, m_current.horzOrder, m_current.vertOrder);
+        return true;
+    }
+
+    Uint32 m_mortonOrder = 0;
+    size_t m_index       = 0;
+};
+
+// Iterator traversing the quad tree level by level starting from the root up to the specified level.
+// Nodes are visited in the order they are stored in HierarchyArray.
+class HierarchyMortonIterator : public HierarchyMortonIteratorBase
+{
+public:
+    HierarchyMortonIterator(int nLevels) :
+        m_nLevels(nLevels)
+    {
+        VERIFY_EXPR(nLevels <= 16);
+        StartLevel(0);
+    }
+    bool IsValid() const { return m_current.level < m_nLevels; }
+    void Next()
+    {
+        if (!NextInLevel())
+            StartLevel(m_current.level + 1);
+    }
+
+private:
+    int m_nLevels;
+};
+
+// Iterator traversing the quad tree level by level starting from the specified level up to the root.
+// Nodes of every level are visited in the order they are stored in HierarchyArray,
+// so that all children of a node are visited before the node itself.
+class HierarchyReverseMortonIterator : public HierarchyMortonIteratorBase
+{
+public:
+    HierarchyReverseMortonIterator(int nLevels)
+    {
+        VERIFY_EXPR(nLevels <= 16);
+        if (nLevels > 0)
+            StartLevel(nLevels - 1);
+        else
+            m_current.level = -1;
+    }
+    bool IsValid() const { return m_current.level >= 0; }
+    void Next()
+    {
+        if (!NextInLevel())
+        {
+            if (m_current.level > 0)
+                StartLevel(m_current.level - 1);
+            else
+                m_current.level = -1;
+        }
+    }
+};
+
 // Template class implementing hierarchy array, which is a quad tree indexed by
-// quad tree node location
+// quad tree node location. All levels are stored in a single array starting from the root.
+// Nodes of every level are stored in Morton order, so nodes that are close to each other
+// in the tree are close in memory, and the four children of a node are adjacent.
 template <class T>
 class HierarchyArray
 {
 public:
     T& operator[](const QuadTreeNodeLocation& at)
     {
-        return m_data[at.level][at.horzOrder + (at.vertOrder << at.level)];
+        return m_data[GetIndex(at)];
     }
     const T& operator[](const QuadTreeNodeLocation& at) const
     {
-        return m_data[at.level][at.horzOrder + (at.vertOrder << at.level)];
+        return m_data[GetIndex(at)];
+    }
+
+    T& operator[](const HierarchyMortonIteratorBase& it)
+    {
+        return m_data[it.GetIndex()];
+    }
+    const T& operator[](const HierarchyMortonIteratorBase& it) const
+    {
+        return m_data[it.GetIndex()];
+    }
+
+    // Returns the four children of the node in the order of sibling indices of GetChildLocation()
+    T* GetChildren(const QuadTreeNodeLocation& parent)
+    {
+        return &m_data[GetChildrenIndex(parent)];
+    }
+    const T* GetChildren(const QuadTreeNodeLocation& parent) const
+    {
+        return &m_data[GetChildrenIndex(parent)];
+    }
+    T* GetChildren(const HierarchyMortonIteratorBase& it)
+    {
+        VERIFY_EXPR(it.GetChildrenIndex() + 4 <= m_data.size());
+        return &m_data[it.GetChildrenIndex()];
+    }
+    const T* GetChildren(const HierarchyMortonIteratorBase& it) const
+    {
+        VERIFY_EXPR(it.GetChildrenIndex() + 4 <= m_data.size());
+        return &m_data[it.GetChildrenIndex()];
     }
 
     void Resize(size_t numLevelsInHierarchy)
     {
-        m_data.resize(numLevelsInHierarchy);
-        if (numLevelsInHierarchy)
-        {
-            for (size_t level = numLevelsInHierarchy; level--;)
-            {
-                size_t numElementsInLevel = (size_t)1 << level;
-                m_data[level].resize(numElementsInLevel * numElementsInLevel);
-            }
-        }
+        VERIFY_EXPR(numLevelsInHierarchy <= 16);
+        m_data.resize(GetHierarchyLevelOffset(static_cast<int>(numLevelsInHierarchy)));
     }
 
     bool Empty() const
@@ -84,8 +230,20 @@ public:
         return m_data.empty();
     }
 
+    static size_t GetIndex(const QuadTreeNodeLocation& at)
+    {
+        return GetHierarchyLevelOffset(at.level) + EncodeMortonOrder(at.horzOrder, at.vertOrder);
+    }
+
 private:
-    std::vector<std::vector<T>> m_data;
+    size_t GetChildrenIndex(const QuadTreeNodeLocation& parent) const
+    {
+        const size_t Index = GetHierarchyLevelOffset(parent.level + 1) + size_t{EncodeMortonOrder(parent.horzOrder, parent.vertOrder)} * 4;
+        VERIFY_EXPR(Index + 4 <= m_data.size());
+        return Index;
+    }
+
+    std::vector<T> m_data;
 };
 
 } // namespace Diligent
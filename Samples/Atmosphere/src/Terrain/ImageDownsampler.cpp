@@ -0,0 +1,132 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define DOWNSAMPLER_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define DOWNSAMPLER_NEON 1
+#endif
+
+#include <algorithm>
+
+#include "ImageDownsampler.hpp"
+#include "TaskScheduler.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+void DownsampleRow(const Uint16* pSrcRow0, const Uint16* pSrcRow1, Uint16* pDstRow, Uint32 DstWidth)
+{
+    Uint32 Col = 0;
+#if DOWNSAMPLER_SSE2
+    // Every iteration averages 16 columns of two source rows into 8 destination texels
+    const __m128i LowMask = _mm_set1_epi32(0xFFFF);
+    const __m128i Bias    = _mm_set1_epi32(0x8000);
+    for (; Col + 8 <= DstWidth; Col += 8)
+    {
+        const __m128i* pSrc0 = reinterpret_cast<const __m128i*>(pSrcRow0 + Col * 2);
+        const __m128i* pSrc1 = reinterpret_cast<const __m128i*>(pSrcRow1 + Col * 2);
+
+        const __m128i A0 = _mm_loadu_si128(pSrc0 + 0);
+        const __m128i A1 = _mm_loadu_si128(pSrc0 + 1);
+        const __m128i B0 = _mm_loadu_si128(pSrc1 + 0);
+        const __m128i B1 = _mm_loadu_si128(pSrc1 + 1);
+
+        // Add even and odd texels as 32-bit integers, so that the sum of four texels does not overflow
+        __m128i Sum0 = _mm_add_epi32(_mm_and_si128(A0, LowMask), _mm_srli_epi32(A0, 16));
+        __m128i Sum1 = _mm_add_epi32(_mm_and_si128(A1, LowMask), _mm_srli_epi32(A1, 16));
+        Sum0         = _mm_add_epi32(Sum0, _mm_add_epi32(_mm_and_si128(B0, LowMask), _mm_srli_epi32(B0, 16)));
+        Sum1         = _mm_add_epi32(Sum1, _mm_add_epi32(_mm_and_si128(B1, LowMask), _mm_srli_epi32(B1, 16)));
+
+        // SSE2 can only pack with signed saturation, so shift the averages to the signed range and back
+        const __m128i Avg0 = _mm_sub_epi32(_mm_srli_epi32(Sum0, 2), Bias);
+        const __m128i Avg1 = _mm_sub_epi32(_mm_srli_epi32(Sum1, 2), Bias);
+        const __m128i Avg  = _mm_xor_si128(_mm_packs_epi32(Avg0, Avg1), _mm_set1_epi16(-0x8000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDstRow + Col), Avg);
+    }
+#elif DOWNSAMPLER_NEON
+    for (; Col + 8 <= DstWidth; Col += 8)
+    {
+        const uint16x8_t A0 = vld1q_u16(pSrcRow0 + Col * 2);
+        const uint16x8_t A1 = vld1q_u16(pSrcRow0 + Col * 2 + 8);
+        const uint16x8_t B0 = vld1q_u16(pSrcRow1 + Col * 2);
+        const uint16x8_t B1 = vld1q_u16(pSrcRow1 + Col * 2 + 8);
+
+        // Pairwise additions widen to 32 bits, so the sum of four texels does not overflow
+        const uint32x4_t Sum0 = vpadalq_u16(vpaddlq_u16(A0), B0);
+        const uint32x4_t Sum1 = vpadalq_u16(vpaddlq_u16(A1), B1);
+        vst1q_u16(pDstRow + Col, vcombine_u16(vshrn_n_u32(Sum0, 2), vshrn_n_u32(Sum1, 2)));
+    }
+#endif
+
+    for (; Col < DstWidth; ++Col)
+    {
+        const Uint32 Sum = Uint32{pSrcRow0[Col * 2]} + Uint32{pSrcRow0[Col * 2 + 1]} + Uint32{pSrcRow1[Col * 2]} + Uint32{pSrcRow1[Col * 2 + 1]};
+        pDstRow[Col]     = static_cast<Uint16>(Sum >> 2);
+    }
+}
+
+} // namespace
+
+void DownsampleUint16Image2x2(const Uint16*  pSrc,
+                              size_t         SrcStride,
+                              Uint16*        pDst,
+                              size_t         DstStride,
+                              Uint32         DstWidth,
+                              Uint32         DstHeight,
+                              TaskScheduler* pScheduler)
+{
+    // Rows are processed in bands that are large enough to amortize the scheduling cost
+    constexpr Uint32 RowsPerBand = 16;
+    const Uint32     NumBands    = (DstHeight + RowsPerBand - 1) / RowsPerBand;
+
+    auto DownsampleBand = [&](Uint32 Band) {
+        const auto EndRow = std::min(DstHeight, (Band + 1) * RowsPerBand);
+        for (Uint32 Row = Band * RowsPerBand; Row < EndRow; ++Row)
+        {
+            const auto* pSrcRow0 = pSrc + size_t{Row} * 2 * SrcStride;
+            DownsampleRow(pSrcRow0, pSrcRow0 + SrcStride, pDst + size_t{Row} * DstStride, DstWidth);
+        }
+    };
+
+    if (pScheduler != nullptr && NumBands > 1)
+    {
+        pScheduler->ParallelFor(NumBands, [&](Uint32, Uint32 Band) { DownsampleBand(Band); });
+    }
+    else
+    {
+        for (Uint32 Band = 0; Band < NumBands; ++Band)
+            DownsampleBand(Band);
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,452 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "TiledElevationFile.hpp"
+#include "DebugUtilities.hpp"
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#elif PLATFORM_LINUX || PLATFORM_ANDROID || PLATFORM_MACOS || PLATFORM_IOS || PLATFORM_TVOS
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define TILED_ELEVATION_FILE_POSIX 1
+#endif
+
+namespace Diligent
+{
+
+constexpr Uint32     TiledElevationFile::TileSizeLog2;
+constexpr Uint32     TiledElevationFile::TileSize;
+constexpr Uint32     TiledElevationFile::TileMask;
+constexpr Uint32     TiledElevationFile::MaxOverviewDim;
+constexpr const Char TiledElevationFile::Extension[];
+
+namespace
+{
+
+const char   TiledFileMagic[8] = {'E', 'L', 'E', 'V', 'T', 'I', 'L', 'E'};
+const Uint32 TiledFileVersion  = 3;
+
+// Larger than the page size on all supported platforms. Tiles are multiples of
+// the page size too, so every tile starts at a page boundary.
+const Uint64 TilesAlignment = 65536;
+
+struct TiledFileHeader
+{
+    char   Magic[8];
+    Uint32 Version;
+    Uint32 TileSizeLog2;
+    Uint32 NumCols;
+    Uint32 NumRows;
+    Uint32 NumLevels;
+    Uint32 OverviewLevel;
+    Uint64 SourceFileSize;
+    Uint64 SourceFileTime;
+    Uint64 MinMaxOffset;
+    Uint64 OverviewOffset;
+    Uint64 TilesOffset;
+};
+
+Uint64 GetTilesSize(Uint32 NumCols, Uint32 NumRows)
+{
+    return Uint64{TiledElevationFile::GetNumTiles(NumCols)} * Uint64{TiledElevationFile::GetNumTiles(NumRows)} *
+        TiledElevationFile::TileSize * TiledElevationFile::TileSize * sizeof(Uint16);
+}
+
+Uint64 GetOverviewSize(Uint32 NumCols, Uint32 NumRows, Uint32 OverviewLevel)
+{
+    return Uint64{TiledElevationFile::GetOverviewDim(NumCols, OverviewLevel)} * Uint64{TiledElevationFile::GetOverviewDim(NumRows, OverviewLevel)} * sizeof(Uint16);
+}
+
+Uint64 AlignOffset(Uint64 Offset, Uint64 Alignment)
+{
+    return (Offset + Alignment - 1) & ~(Alignment - 1);
+}
+
+bool SectionFits(Uint64 Offset, Uint64 Size, size_t FileSize)
+{
+    return Offset <= FileSize && Size <= FileSize - Offset;
+}
+
+// Paths in the sample use backslashes
+std::string GetNativePath(const Char* Path)
+{
+    std::string NativePath{Path};
+#if !PLATFORM_WIN32
+    for (auto& c : NativePath)
+    {
+        if (c == '\\')
+            c = '/';
+    }
+#endif
+    return NativePath;
+}
+
+// Creates the directory if it does not exist. The parent directory must exist.
+bool MakeDirectory(const std::string& Path)
+{
+#if PLATFORM_WIN32
+    return CreateDirectoryA(Path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#elif TILED_ELEVATION_FILE_POSIX
+    return mkdir(Path.c_str(), 0755) == 0 || errno == EEXIST;
+#else
+    (void)Path;
+    return false;
+#endif
+}
+
+} // namespace
+
+size_t TiledElevationFile::GetNumMinMaxElevations(Uint32 NumLevels)
+{
+    // 1 + 4 + 16 + ... + 4^(NumLevels-1)
+    return ((size_t{1} << (2 * NumLevels)) - 1) / 3;
+}
+
+Uint32 TiledElevationFile::GetOverviewLevel(Uint32 NumCols, Uint32 NumRows)
+{
+    Uint32 OverviewLevel = 0;
+    while (GetOverviewDim(NumCols, OverviewLevel) > MaxOverviewDim || GetOverviewDim(NumRows, OverviewLevel) > MaxOverviewDim)
+        ++OverviewLevel;
+    return OverviewLevel;
+}
+
+TiledElevationFile::~TiledElevationFile()
+{
+    Close();
+}
+
+bool TiledElevationFile::Open(const Char* Path, const SourceFileStamp& Source)
+{
+    Close();
+
+    const auto NativePath = GetNativePath(Path);
+
+#if PLATFORM_WIN32
+    m_FileHandle = CreateFileA(NativePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (m_FileHandle == INVALID_HANDLE_VALUE)
+    {
+        m_FileHandle = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(m_FileHandle, &FileSize) || FileSize.QuadPart < static_cast<LONGLONG>(sizeof(TiledFileHeader)))
+    {
+        Close();
+        return false;
+    }
+
+    m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (m_MappingHandle == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<const Uint8*>(MapViewOfFile(m_MappingHandle, FILE_MAP_COPY, 0, 0, 0));
+    m_Size  = static_cast<size_t>(FileSize.QuadPart);
+#elif TILED_ELEVATION_FILE_POSIX
+    const int fd = open(NativePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat FileStat = {};
+    if (fstat(fd, &FileStat) != 0 || FileStat.st_size < static_cast<off_t>(sizeof(TiledFileHeader)))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* pData = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open
+    close(fd);
+    if (pData == MAP_FAILED)
+        return false;
+
+    // Terrain patches are accessed in no particular order, so reading ahead past the accessed tile
+    // mostly loads pages that are not needed. Prefetch() requests the tiles that will be needed.
+    madvise(pData, static_cast<size_t>(FileStat.st_size), MADV_RANDOM);
+
+    m_pData = static_cast<const Uint8*>(pData);
+    m_Size  = static_cast<size_t>(FileStat.st_size);
+#else
+    (void)NativePath;
+#endif
+
+    if (m_pData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    TiledFileHeader Header;
+    memcpy(&Header, m_pData, sizeof(Header));
+
+    // clang-format off
+    bool IsValid =
+        memcmp(Header.Magic, TiledFileMagic, sizeof(TiledFileMagic)) == 0 &&
+        Header.Version      == TiledFileVersion &&
+        Header.TileSizeLog2 == TileSizeLog2     &&
+        Header.NumCols >= 2 && Header.NumRows >= 2 &&
+        ((Header.NumCols - 1) & (Header.NumCols - 2)) == 0 &&
+        ((Header.NumRows - 1) & (Header.NumRows - 2)) == 0 &&
+        Header.NumLevels >= 1 && Header.NumLevels <= 24 &&
+        Header.OverviewLevel == GetOverviewLevel(Header.NumCols, Header.NumRows) &&
+        (Source.Size == 0 || (Header.SourceFileSize == Source.Size && Header.SourceFileTime == Source.ModificationTime));
+    // clang-format on
+    if (IsValid)
+    {
+        // Leaf patches must cover all samples
+        const Uint64 NumLeafSamples = (Uint64{TileSize} << (Header.NumLevels - 1)) + 1;
+        // clang-format off
+        IsValid =
+            NumLeafSamples >= Header.NumCols &&
+            NumLeafSamples >= Header.NumRows &&
+            Header.MinMaxOffset   % sizeof(Uint16) == 0 &&
+            Header.OverviewOffset % sizeof(Uint16) == 0 &&
+            Header.TilesOffset    % TilesAlignment == 0 &&
+            SectionFits(Header.MinMaxOffset,   GetNumMinMaxElevations(Header.NumLevels) * 2 * sizeof(Uint16), m_Size) &&
+            SectionFits(Header.OverviewOffset, GetOverviewSize(Header.NumCols, Header.NumRows, Header.OverviewLevel), m_Size) &&
+            SectionFits(Header.TilesOffset,    GetTilesSize(Header.NumCols, Header.NumRows), m_Size);
+        // clang-format on
+    }
+    if (!IsValid)
+    {
+        Close();
+        return false;
+    }
+
+    m_Desc.NumCols                 = Header.NumCols;
+    m_Desc.NumRows                 = Header.NumRows;
+    m_Desc.NumLevels               = Header.NumLevels;
+    m_Desc.OverviewLevel           = Header.OverviewLevel;
+    m_Desc.Source.Size             = Header.SourceFileSize;
+    m_Desc.Source.ModificationTime = Header.SourceFileTime;
+
+    m_pMinMax   = reinterpret_cast<const Uint16*>(m_pData + Header.MinMaxOffset);
+    m_pOverview = reinterpret_cast<Uint16*>(const_cast<Uint8*>(m_pData) + Header.OverviewOffset);
+    m_pTiles    = reinterpret_cast<Uint16*>(const_cast<Uint8*>(m_pData) + Header.TilesOffset);
+
+    return true;
+}
+
+void TiledElevationFile::Close()
+{
+#if PLATFORM_WIN32
+    if (m_pData != nullptr)
+        UnmapViewOfFile(m_pData);
+    if (m_MappingHandle != nullptr)
+        CloseHandle(m_MappingHandle);
+    if (m_FileHandle != nullptr)
+        CloseHandle(m_FileHandle);
+    m_MappingHandle = nullptr;
+    m_FileHandle    = nullptr;
+#elif TILED_ELEVATION_FILE_POSIX
+    if (m_pData != nullptr)
+        munmap(const_cast<Uint8*>(m_pData), m_Size);
+#endif
+
+    m_pData     = nullptr;
+    m_Size      = 0;
+    m_pMinMax   = nullptr;
+    m_pOverview = nullptr;
+    m_pTiles    = nullptr;
+    m_Desc      = FileDesc{};
+}
+
+void TiledElevationFile::Prefetch(Uint32 FirstTileX, Uint32 FirstTileY, Uint32 NumTilesX, Uint32 NumTilesY) const
+{
+    if (m_pTiles == nullptr || NumTilesX == 0 || NumTilesY == 0)
+        return;
+
+    const Uint32 TotalTilesX = GetNumTiles(m_Desc.NumCols);
+    VERIFY_EXPR(FirstTileX + NumTilesX <= TotalTilesX && FirstTileY + NumTilesY <= GetNumTiles(m_Desc.NumRows));
+
+    const size_t TileBytes = size_t{TileSize} * size_t{TileSize} * sizeof(Uint16);
+    // Tiles of one row of the range are adjacent in the file
+    for (Uint32 TileY = FirstTileY; TileY < FirstTileY + NumTilesY; ++TileY)
+    {
+        auto*        pRangeStart = m_pTiles + ((size_t{FirstTileX} + size_t{TileY} * TotalTilesX) << (2 * TileSizeLog2));
+        const size_t RangeSize   = NumTilesX * TileBytes;
+#if PLATFORM_WIN32
+#    if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY Range;
+        Range.VirtualAddress = pRangeStart;
+        Range.NumberOfBytes  = RangeSize;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+#    else
+        (void)pRangeStart;
+        (void)RangeSize;
+#    endif
+#elif TILED_ELEVATION_FILE_POSIX
+        madvise(pRangeStart, RangeSize, MADV_WILLNEED);
+#else
+        (void)pRangeStart;
+        (void)RangeSize;
+#endif
+    }
+}
+
+bool TiledElevationFile::Write(const Char* Path, const FileDesc& Desc, const Uint16* pMinMax, const Uint16* pOverview, const Uint16* pTiles)
+{
+    VERIFY(Desc.OverviewLevel == GetOverviewLevel(Desc.NumCols, Desc.NumRows), "Unexpected overview level");
+
+    TiledFileHeader Header = {};
+    memcpy(Header.Magic, TiledFileMagic, sizeof(TiledFileMagic));
+    Header.Version        = TiledFileVersion;
+    Header.TileSizeLog2   = TileSizeLog2;
+    Header.NumCols        = Desc.NumCols;
+    Header.NumRows        = Desc.NumRows;
+    Header.NumLevels      = Desc.NumLevels;
+    Header.OverviewLevel  = Desc.OverviewLevel;
+    Header.SourceFileSize = Desc.Source.Size;
+    Header.SourceFileTime = Desc.Source.ModificationTime;
+    Header.MinMaxOffset   = sizeof(Header);
+    Header.OverviewOffset = Header.MinMaxOffset + GetNumMinMaxElevations(Desc.NumLevels) * 2 * sizeof(Uint16);
+    Header.TilesOffset    = AlignOffset(Header.OverviewOffset + GetOverviewSize(Desc.NumCols, Desc.NumRows, Desc.OverviewLevel), TilesAlignment);
+
+    const auto NativePath = GetNativePath(Path);
+    const auto TempPath   = NativePath + ".tmp";
+
+    FILE* pFile = fopen(TempPath.c_str(), "wb");
+    if (pFile == nullptr)
+        return false;
+
+    Uint64 Offset       = 0;
+    auto   WriteSection = [&](Uint64 SectionOffset, const void* pData, Uint64 Size) {
+        static const Uint8 Padding[4096] = {};
+        while (Offset < SectionOffset)
+        {
+            const auto PaddingSize = static_cast<size_t>(std::min(SectionOffset - Offset, Uint64{sizeof(Padding)}));
+            if (fwrite(Padding, 1, PaddingSize, pFile) != PaddingSize)
+                return false;
+            Offset += PaddingSize;
+        }
+        Offset += Size;
+        return fwrite(pData, 1, static_cast<size_t>(Size), pFile) == Size;
+    };
+
+    // clang-format off
+    bool Succeeded =
+        WriteSection(0,                     &Header,   sizeof(Header)) &&
+        WriteSection(Header.MinMaxOffset,   pMinMax,   GetNumMinMaxElevations(Desc.NumLevels) * 2 * sizeof(Uint16)) &&
+        WriteSection(Header.OverviewOffset, pOverview, GetOverviewSize(Desc.NumCols, Desc.NumRows, Desc.OverviewLevel)) &&
+        WriteSection(Header.TilesOffset,    pTiles,    GetTilesSize(Desc.NumCols, Desc.NumRows));
+    // clang-format on
+    Succeeded = (fclose(pFile) == 0) && Succeeded;
+
+    if (Succeeded)
+    {
+        // Replace the previous file, if any
+        remove(NativePath.c_str());
+        Succeeded = rename(TempPath.c_str(), NativePath.c_str()) == 0;
+    }
+    if (!Succeeded)
+        remove(TempPath.c_str());
+
+    return Succeeded;
+}
+
+TiledElevationFile::SourceFileStamp TiledElevationFile::GetSourceFileStamp(const Char* Path)
+{
+    SourceFileStamp Stamp;
+
+    const auto NativePath = GetNativePath(Path);
+#if PLATFORM_WIN32
+    WIN32_FILE_ATTRIBUTE_DATA Attribs = {};
+    if (!GetFileAttributesExA(NativePath.c_str(), GetFileExInfoStandard, &Attribs))
+        return Stamp;
+    Stamp.Size             = (Uint64{Attribs.nFileSizeHigh} << 32) | Uint64{Attribs.nFileSizeLow};
+    Stamp.ModificationTime = (Uint64{Attribs.ftLastWriteTime.dwHighDateTime} << 32) | Uint64{Attribs.ftLastWriteTime.dwLowDateTime};
+#elif TILED_ELEVATION_FILE_POSIX
+    struct stat FileStat = {};
+    if (stat(NativePath.c_str(), &FileStat) != 0)
+        return Stamp;
+    Stamp.Size             = static_cast<Uint64>(FileStat.st_size);
+    Stamp.ModificationTime = static_cast<Uint64>(FileStat.st_mtime);
+#else
+    (void)NativePath;
+#endif
+    return Stamp;
+}
+
+std::string TiledElevationFile::GetCachePath(const Char* SourcePath)
+{
+    // Assets may be installed to a read-only location, so the tiled file is kept in the user's cache directory
+    std::string CacheDir;
+#if PLATFORM_WIN32
+    if (const char* LocalAppData = getenv("LOCALAPPDATA"))
+        CacheDir = LocalAppData;
+    const char Separator = '\\';
+#elif PLATFORM_LINUX
+    const char* XdgCacheHome = getenv("XDG_CACHE_HOME");
+    if (XdgCacheHome != nullptr && XdgCacheHome[0] != '\0')
+        CacheDir = XdgCacheHome;
+    else if (const char* Home = getenv("HOME"))
+        CacheDir = std::string{Home} + "/.cache";
+    const char Separator = '/';
+#elif PLATFORM_MACOS
+    if (const char* Home = getenv("HOME"))
+        CacheDir = std::string{Home} + "/Library/Caches";
+    const char Separator = '/';
+#else
+    const char Separator = '/';
+#endif
+    // The base directory itself may not exist yet, e.g. ~/.cache
+    if (CacheDir.empty() || !MakeDirectory(CacheDir))
+        return {};
+
+    for (const char* SubDir : {"DiligentSamples", "Atmosphere"})
+    {
+        (CacheDir += Separator) += SubDir;
+        if (!MakeDirectory(CacheDir))
+            return {};
+    }
+
+    const auto  NativePath = GetNativePath(SourcePath);
+    const auto  NameStart  = NativePath.find_last_of("\\/");
+    std::string FileName   = NameStart != std::string::npos ? NativePath.substr(NameStart + 1) : NativePath;
+    return CacheDir + Separator + FileName + Extension;
+}
+
+} // namespace Diligent
@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Elevation file that is mapped into memory, so that the OS pages the data in when it
+// is first accessed and can evict it under memory pressure. The mapping is copy-on-write:
+// modified pages become private to the process, and the file itself is never changed.
+// The file contains the min/max elevation hierarchy, a downsampled overview of the height map,
+// and the height map itself split into TileSize x TileSize tiles. Tiles are stored in row-major
+// order, and so are the samples inside every tile. Every tile is aligned to the page size, so a
+// terrain patch only touches the pages of its own tiles.
+class TiledElevationFile
+{
+public:
+    static constexpr Uint32 TileSizeLog2 = 7;
+    static constexpr Uint32 TileSize     = 1u << TileSizeLog2;
+    static constexpr Uint32 TileMask     = TileSize - 1;
+
+    // Extension appended to the source file name to get the name of the tiled file
+    static constexpr Char Extension[] = ".tiles";
+
+    // Identifies the version of the file the tiles were created from
+    struct SourceFileStamp
+    {
+        Uint64 Size             = 0; // Zero if unknown
+        Uint64 ModificationTime = 0; // In platform-specific units
+
+        bool operator==(const SourceFileStamp& rhs) const { return Size == rhs.Size && ModificationTime == rhs.ModificationTime; }
+        bool operator!=(const SourceFileStamp& rhs) const { return !(*this == rhs); }
+    };
+
+    // The overview is the height map downsampled 2x2 OverviewLevel times, so that neither of its
+    // dimensions exceeds MaxOverviewDim. It covers the first NumCols-1 x NumRows-1 samples.
+    static constexpr Uint32 MaxOverviewDim = 2048;
+
+    struct FileDesc
+    {
+        Uint32 NumCols       = 0;
+        Uint32 NumRows       = 0;
+        Uint32 NumLevels     = 0;
+        Uint32 OverviewLevel = 0;
+
+        SourceFileStamp Source;
+    };
+
+    TiledElevationFile() = default;
+    ~TiledElevationFile();
+
+    // clang-format off
+    TiledElevationFile           (const TiledElevationFile&) = delete;
+    TiledElevationFile& operator=(const TiledElevationFile&) = delete;
+    // clang-format on
+
+    // Maps the file. Returns false if the file does not exist or is not a valid tiled elevation file.
+    // If Source.Size is not zero, the file is also rejected if it was created from a different version
+    // of the source file, i.e. from a file of a different size or modification time.
+    bool Open(const Char* Path, const SourceFileStamp& Source);
+    void Close();
+
+    bool IsOpen() const { return m_pData != nullptr; }
+
+    const FileDesc& GetDesc() const { return m_Desc; }
+
+    // Min/max elevation pairs of all quad tree levels starting from the coarsest one.
+    // Nodes of every level are stored in row-major order.
+    const Uint16* GetMinMaxElevations() const { return m_pMinMax; }
+
+    // Overview samples in row-major order. The row stride is GetOverviewDim(NumCols, OverviewLevel).
+    Uint16* GetOverview() const { return m_pOverview; }
+
+    // All tiles. Tile (TileX, TileY) starts at GetTiles() + ((TileX + TileY * GetNumTiles(NumCols)) << (2 * TileSizeLog2)).
+    Uint16* GetTiles() const { return m_pTiles; }
+
+    // Asks the OS to start reading the tiles of the specified range in the background
+    void Prefetch(Uint32 FirstTileX, Uint32 FirstTileY, Uint32 NumTilesX, Uint32 NumTilesY) const;
+
+    // Writes the file. The file is written to a temporary file first, which then replaces
+    // the existing file, if any, so that a partially written file is never opened.
+    static bool Write(const Char* Path, const FileDesc& Desc, const Uint16* pMinMax, const Uint16* pOverview, const Uint16* pTiles);
+
+    // Returns a zero size if the file does not exist
+    static SourceFileStamp GetSourceFileStamp(const Char* Path);
+
+    // Returns the path of the tiled file for the specified source file in the user's cache directory,
+    // which is created if necessary. Returns an empty string if there is no writable cache directory.
+    static std::string GetCachePath(const Char* SourcePath);
+
+    static Uint32 GetNumTiles(Uint32 NumSamples) { return (NumSamples + TileMask) >> TileSizeLog2; }
+    static size_t GetNumMinMaxElevations(Uint32 NumLevels);
+
+    // NumSamples must be 2^n+1
+    static Uint32 GetOverviewDim(Uint32 NumSamples, Uint32 OverviewLevel) { return (NumSamples - 1) >> OverviewLevel; }
+    static Uint32 GetOverviewLevel(Uint32 NumCols, Uint32 NumRows);
+
+private:
+    FileDesc m_Desc;
+
+    const Uint8*  m_pData   = nullptr;
+    size_t        m_Size    = 0;
+    const Uint16* m_pMinMax   = nullptr;
+    Uint16*       m_pOverview = nullptr;
+    Uint16*       m_pTiles    = nullptr;
+
+#if PLATFORM_WIN32
+    void* m_FileHandle    = nullptr;
+    void* m_MappingHandle = nullptr;
+#endif
+};
+
+} // namespace Diligent
@@ -0,0 +1,283 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define BOX_CULLER_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define BOX_CULLER_NEON 1
+#endif
+
+#include <cmath>
+
+#include "BoxCuller.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Frustum planes and bounds in the form used by the box tests
+struct PreparedFrustum
+{
+    // A box with center c and extent e is fully outside the plane if
+    // dot(c, n) + dot(e, abs(n)) + d < 0
+    struct Plane
+    {
+        float3 Normal;
+        float3 AbsNormal;
+        float  Distance = 0;
+    };
+    Plane  Planes[ViewFrustum::NUM_PLANES];
+    Uint32 NumPlanes = 0;
+
+    // The box is also outside if it does not overlap the bounding box of the frustum corners.
+    // This is only valid when the frustum is closed.
+    bool   TestBounds = false;
+    float3 BoundsCenter;
+    float3 BoundsExtent;
+};
+
+PreparedFrustum PrepareFrustum(const BoxCuller::FrustumAttribs& Attribs)
+{
+    PreparedFrustum Prepared;
+    for (Uint32 PlaneIdx = 0; PlaneIdx < ViewFrustum::NUM_PLANES; ++PlaneIdx)
+    {
+        if ((Attribs.PlaneFlags & (1u << PlaneIdx)) == 0)
+            continue;
+
+        const auto& SrcPlane = Attribs.Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(PlaneIdx));
+        auto&       DstPlane = Prepared.Planes[Prepared.NumPlanes++];
+
+        DstPlane.Normal    = SrcPlane.Normal;
+        DstPlane.AbsNormal = float3{std::abs(SrcPlane.Normal.x), std::abs(SrcPlane.Normal.y), std::abs(SrcPlane.Normal.z)};
+        DstPlane.Distance  = SrcPlane.Distance;
+    }
+
+    if ((Attribs.PlaneFlags & FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) == FRUSTUM_PLANE_FLAG_FULL_FRUSTUM)
+    {
+        float3 Min = Attribs.Frustum.FrustumCorners[0];
+        float3 Max = Attribs.Frustum.FrustumCorners[0];
+        for (Uint32 i = 1; i < _countof(Attribs.Frustum.FrustumCorners); ++i)
+        {
+            Min = std::min(Min, Attribs.Frustum.FrustumCorners[i]);
+            Max = std::max(Max, Attribs.Frustum.FrustumCorners[i]);
+        }
+        Prepared.TestBounds   = true;
+        Prepared.BoundsCenter = (Max + Min) * 0.5f;
+        Prepared.BoundsExtent = (Max - Min) * 0.5f;
+    }
+
+    return Prepared;
+}
+
+// Returns a 4-bit mask with a bit set for every box of the group that is not fully outside the frustum
+#if BOX_CULLER_SSE2
+
+Uint32 TestGroup(const float* pGroup, const PreparedFrustum& Frustum)
+{
+    const __m128 CenterX = _mm_loadu_ps(pGroup + 0);
+    const __m128 CenterY = _mm_loadu_ps(pGroup + 4);
+    const __m128 CenterZ = _mm_loadu_ps(pGroup + 8);
+    const __m128 ExtentX = _mm_loadu_ps(pGroup + 12);
+    const __m128 ExtentY = _mm_loadu_ps(pGroup + 16);
+    const __m128 ExtentZ = _mm_loadu_ps(pGroup + 20);
+
+    const __m128 Zero    = _mm_setzero_ps();
+    __m128       Outside = Zero;
+    for (Uint32 i = 0; i < Frustum.NumPlanes; ++i)
+    {
+        const auto& Plane = Frustum.Planes[i];
+
+        __m128 Dist = _mm_add_ps(_mm_mul_ps(CenterX, _mm_set1_ps(Plane.Normal.x)), _mm_set1_ps(Plane.Distance));
+        Dist        = _mm_add_ps(Dist, _mm_mul_ps(CenterY, _mm_set1_ps(Plane.Normal.y)));
+        Dist        = _mm_add_ps(Dist, _mm_mul_ps(CenterZ, _mm_set1_ps(Plane.Normal.z)));
+        Dist        = _mm_add_ps(Dist, _mm_mul_ps(ExtentX, _mm_set1_ps(Plane.AbsNormal.x)));
+        Dist        = _mm_add_ps(Dist, _mm_mul_ps(ExtentY, _mm_set1_ps(Plane.AbsNormal.y)));
+        Dist        = _mm_add_ps(Dist, _mm_mul_ps(ExtentZ, _mm_set1_ps(Plane.AbsNormal.z)));
+        Outside     = _mm_or_ps(Outside, _mm_cmplt_ps(Dist, Zero));
+    }
+
+    if (Frustum.TestBounds)
+    {
+        // abs(x) clears the sign bit
+        const __m128 AbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+        const __m128 DistX = _mm_and_ps(_mm_sub_ps(CenterX, _mm_set1_ps(Frustum.BoundsCenter.x)), AbsMask);
+        const __m128 DistY = _mm_and_ps(_mm_sub_ps(CenterY, _mm_set1_ps(Frustum.BoundsCenter.y)), AbsMask);
+        const __m128 DistZ = _mm_and_ps(_mm_sub_ps(CenterZ, _mm_set1_ps(Frustum.BoundsCenter.z)), AbsMask);
+        Outside            = _mm_or_ps(Outside, _mm_cmpgt_ps(DistX, _mm_add_ps(ExtentX, _mm_set1_ps(Frustum.BoundsExtent.x))));
+        Outside            = _mm_or_ps(Outside, _mm_cmpgt_ps(DistY, _mm_add_ps(ExtentY, _mm_set1_ps(Frustum.BoundsExtent.y))));
+        Outside            = _mm_or_ps(Outside, _mm_cmpgt_ps(DistZ, _mm_add_ps(ExtentZ, _mm_set1_ps(Frustum.BoundsExtent.z))));
+    }
+
+    return ~static_cast<Uint32>(_mm_movemask_ps(Outside)) & 0xFu;
+}
+
+#elif BOX_CULLER_NEON
+
+Uint32 TestGroup(const float* pGroup, const PreparedFrustum& Frustum)
+{
+    const float32x4_t CenterX = vld1q_f32(pGroup + 0);
+    const float32x4_t CenterY = vld1q_f32(pGroup + 4);
+    const float32x4_t CenterZ = vld1q_f32(pGroup + 8);
+    const float32x4_t ExtentX = vld1q_f32(pGroup + 12);
+    const float32x4_t ExtentY = vld1q_f32(pGroup + 16);
+    const float32x4_t ExtentZ = vld1q_f32(pGroup + 20);
+
+    const float32x4_t Zero    = vdupq_n_f32(0);
+    uint32x4_t        Outside = vdupq_n_u32(0);
+    for (Uint32 i = 0; i < Frustum.NumPlanes; ++i)
+    {
+        const auto& Plane = Frustum.Planes[i];
+
+        float32x4_t Dist = vmlaq_n_f32(vdupq_n_f32(Plane.Distance), CenterX, Plane.Normal.x);
+        Dist             = vmlaq_n_f32(Dist, CenterY, Plane.Normal.y);
+        Dist             = vmlaq_n_f32(Dist, CenterZ, Plane.Normal.z);
+        Dist             = vmlaq_n_f32(Dist, ExtentX, Plane.AbsNormal.x);
+        Dist             = vmlaq_n_f32(Dist, ExtentY, Plane.AbsNormal.y);
+        Dist             = vmlaq_n_f32(Dist, ExtentZ, Plane.AbsNormal.z);
+        Outside          = vorrq_u32(Outside, vcltq_f32(Dist, Zero));
+    }
+
+    if (Frustum.TestBounds)
+    {
+        const float32x4_t DistX = vabdq_f32(CenterX, vdupq_n_f32(Frustum.BoundsCenter.x));
+        const float32x4_t DistY = vabdq_f32(CenterY, vdupq_n_f32(Frustum.BoundsCenter.y));
+        const float32x4_t DistZ = vabdq_f32(CenterZ, vdupq_n_f32(Frustum.BoundsCenter.z));
+        Outside                 = vorrq_u32(Outside, vcgtq_f32(DistX, vaddq_f32(ExtentX, vdupq_n_f32(Frustum.BoundsExtent.x))));
+        Outside                 = vorrq_u32(Outside, vcgtq_f32(DistY, vaddq_f32(ExtentY, vdupq_n_f32(Frustum.BoundsExtent.y))));
+        Outside                 = vorrq_u32(Outside, vcgtq_f32(DistZ, vaddq_f32(ExtentZ, vdupq_n_f32(Frustum.BoundsExtent.z))));
+    }
+
+    // Keep one bit per lane and gather the lanes into a 4-bit mask
+    static const Uint32 LaneBits[] = {1, 2, 4, 8};
+
+    const uint32x4_t Bits = vandq_u32(Outside, vld1q_u32(LaneBits));
+    const uint32x2_t Sum  = vorr_u32(vget_low_u32(Bits), vget_high_u32(Bits));
+    return ~(vget_lane_u32(Sum, 0) | vget_lane_u32(Sum, 1)) & 0xFu;
+}
+
+#else
+
+Uint32 TestGroup(const float* pGroup, const PreparedFrustum& Frustum)
+{
+    Uint32 Visible = 0;
+    for (Uint32 Lane = 0; Lane < 4; ++Lane)
+    {
+        const float3 Center{pGroup[Lane + 0], pGroup[Lane + 4], pGroup[Lane + 8]};
+        const float3 Extent{pGroup[Lane + 12], pGroup[Lane + 16], pGroup[Lane + 20]};
+
+        bool Outside = false;
+        for (Uint32 i = 0; i < Frustum.NumPlanes && !Outside; ++i)
+        {
+            const auto& Plane = Frustum.Planes[i];
+            Outside           = dot(Center, Plane.Normal) + dot(Extent, Plane.AbsNormal) + Plane.Distance < 0;
+        }
+
+        if (Frustum.TestBounds && !Outside)
+        {
+            const float3 Dist = Center - Frustum.BoundsCenter;
+            const float3 Size = Extent + Frustum.BoundsExtent;
+            Outside           = std::abs(Dist.x) > Size.x || std::abs(Dist.y) > Size.y || std::abs(Dist.z) > Size.z;
+        }
+
+        if (!Outside)
+            Visible |= 1u << Lane;
+    }
+    return Visible;
+}
+
+#endif
+
+} // namespace
+
+void BoxCuller::Clear()
+{
+    m_Groups.clear();
+    m_NumBoxes = 0;
+}
+
+Uint32 BoxCuller::AddBox(const BoundBox& Box)
+{
+    const auto Lane = m_NumBoxes % GroupSize;
+    if (Lane == 0)
+        m_Groups.resize(m_Groups.size() + NUM_BOX_COMPONENTS * GroupSize, 0.f);
+
+    const auto Center = (Box.Max + Box.Min) * 0.5f;
+    const auto Extent = (Box.Max - Box.Min) * 0.5f;
+
+    float* pGroup = &m_Groups[m_Groups.size() - NUM_BOX_COMPONENTS * GroupSize];
+    // clang-format off
+    pGroup[CENTER_X * GroupSize + Lane] = Center.x;
+    pGroup[CENTER_Y * GroupSize + Lane] = Center.y;
+    pGroup[CENTER_Z * GroupSize + Lane] = Center.z;
+    pGroup[EXTENT_X * GroupSize + Lane] = Extent.x;
+    pGroup[EXTENT_Y * GroupSize + Lane] = Extent.y;
+    pGroup[EXTENT_Z * GroupSize + Lane] = Extent.z;
+    // clang-format on
+
+    return m_NumBoxes++;
+}
+
+void BoxCuller::Cull(const FrustumAttribs* pFrustums, Uint32 NumFrustums, std::vector<Uint64>& Visibility) const
+{
+    static_assert(64 % GroupSize == 0, "Box groups must not straddle mask words");
+
+    const auto MaskSize = GetMaskSize();
+    Visibility.assign(size_t{MaskSize} * NumFrustums, 0);
+
+    std::vector<PreparedFrustum> Frustums(NumFrustums);
+    for (Uint32 f = 0; f < NumFrustums; ++f)
+        Frustums[f] = PrepareFrustum(pFrustums[f]);
+
+    // Every group of boxes is loaded once and tested against all frustums
+    const auto NumGroups = (m_NumBoxes + GroupSize - 1) / GroupSize;
+    for (Uint32 Group = 0; Group < NumGroups; ++Group)
+    {
+        const float* pGroup = &m_Groups[Group * NUM_BOX_COMPONENTS * GroupSize];
+
+        const auto FirstBox = Group * GroupSize;
+        for (Uint32 f = 0; f < NumFrustums; ++f)
+        {
+            const Uint64 GroupMask = TestGroup(pGroup, Frustums[f]);
+            Visibility[f * MaskSize + FirstBox / 64] |= GroupMask << (FirstBox % 64);
+        }
+    }
+
+    // Clear the bits of the empty boxes in the last group
+    if (m_NumBoxes % 64 != 0)
+    {
+        const auto LastWordMask = (Uint64{1} << (m_NumBoxes % 64)) - 1;
+        for (Uint32 f = 0; f < NumFrustums; ++f)
+            Visibility[f * MaskSize + MaskSize - 1] &= LastWordMask;
+    }
+}
+
+} // namespace Diligent
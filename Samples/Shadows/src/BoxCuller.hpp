@@ -0,0 +1,89 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "AdvancedMath.hpp"
+
+namespace Diligent
+{
+
+// Tests axis-aligned bounding boxes against several view frustums in one sweep.
+// Boxes are stored in groups of four as a structure of arrays, so that every
+// frustum plane is tested against four boxes with a single SIMD instruction.
+class BoxCuller
+{
+public:
+    struct FrustumAttribs
+    {
+        ViewFrustumExt      Frustum;
+        FRUSTUM_PLANE_FLAGS PlaneFlags = FRUSTUM_PLANE_FLAG_FULL_FRUSTUM;
+    };
+
+    void Clear();
+
+    // Returns the index of the box
+    Uint32 AddBox(const BoundBox& Box);
+
+    Uint32 GetNumBoxes() const { return m_NumBoxes; }
+
+    // Number of 64-bit words in the visibility mask of one frustum
+    Uint32 GetMaskSize() const { return (m_NumBoxes + 63) / 64; }
+
+    // Writes NumFrustums visibility masks of GetMaskSize() words each to Visibility.
+    // Bit i of the mask is set if box i is not fully outside the frustum. The results
+    // use the same tests as GetBoxVisibility(Frustum, Box, PlaneFlags) != BoxVisibility::Invisible.
+    void Cull(const FrustumAttribs* pFrustums, Uint32 NumFrustums, std::vector<Uint64>& Visibility) const;
+
+    static bool IsVisible(const Uint64* pMask, Uint32 Box)
+    {
+        return (pMask[Box / 64] & (Uint64{1} << (Box % 64))) != 0;
+    }
+
+private:
+    enum BOX_COMPONENT
+    {
+        CENTER_X = 0,
+        CENTER_Y,
+        CENTER_Z,
+        EXTENT_X,
+        EXTENT_Y,
+        EXTENT_Z,
+        NUM_BOX_COMPONENTS
+    };
+    static constexpr Uint32 GroupSize = 4;
+
+    // Box i is stored in group i / 4, lane i % 4. Component c of that box is at
+    // m_Groups[(i / 4) * NUM_BOX_COMPONENTS * 4 + c * 4 + i % 4]. Unused lanes hold empty boxes.
+    std::vector<float> m_Groups;
+    Uint32             m_NumBoxes = 0;
+};
+
+} // namespace Diligent
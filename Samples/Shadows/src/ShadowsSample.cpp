@@ -25,6 +25,12 @@
  *  of the possibility of such damages.
  */
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
 #include "ShadowsSample.hpp"
 #include "MapHelper.hpp"
 #include "FileSystem.hpp"
@@ -37,6 +43,7 @@
 #include "imGuIZMO.h"
 #include "ImGuiUtils.hpp"
 #include "CallbackWrapper.hpp"
+#include "FrameProfiler.hpp"
 
 namespace Diligent
 {
@@ -48,12 +55,33 @@ SampleBase* CreateSample()
 
 ShadowsSample::~ShadowsSample()
 {
+    StopWorkerThreads();
+}
+
+std::string GetArgument(const char*& pos, const char* ArgName);
+
+void ShadowsSample::ProcessCommandLine(const char* CmdLine)
+{
+    const auto* pos = strchr(CmdLine, '-');
+    while (pos != nullptr)
+    {
+        ++pos;
+        std::string Arg;
+        if (!(Arg = GetArgument(pos, "threads")).empty())
+        {
+            m_NumWorkerThreads = clamp(atoi(Arg.c_str()), 0, 128);
+        }
+        pos = strchr(pos, '-');
+    }
 }
 
 void ShadowsSample::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs)
 {
     SampleBase::ModifyEngineInitInfo(Attribs);
 
+    // The main thread records passes into a deferred context too, so that all passes can be executed in order
+    Attribs.EngineCI.NumDeferredContexts = std::max(std::thread::hardware_concurrency(), 2u);
+
     Attribs.EngineCI.Features.DepthClamp = DEVICE_FEATURE_STATE_OPTIONAL;
 
 #if D3D12_SUPPORTED
@@ -75,6 +103,7 @@ void ShadowsSample::Initialize(const SampleInitInfo& InitInfo)
     std::string Directory;
     FileSystem::GetPathComponents(MeshFileName, &Directory, nullptr);
     m_Mesh.LoadGPUResources(Directory.c_str(), m_pDevice, m_pImmediateContext);
+    InitializeBoundBoxes();
 
     m_LightAttribs.ShadowAttribs.iNumCascades     = 4;
     m_LightAttribs.ShadowAttribs.fFixedDepthBias  = 0.0025f;
@@ -111,6 +140,86 @@ void ShadowsSample::Initialize(const SampleInitInfo& InitInfo)
     CreatePipelineStates();
 
     CreateShadowMap();
+
+    // Deferred contexts are not supported in OpenGL
+    m_MaxWorkerThreads = std::max(static_cast<int>(m_pDeferredContexts.size()) - 1, 0);
+    m_NumWorkerThreads = std::min(m_NumWorkerThreads, m_MaxWorkerThreads);
+    StartWorkerThreads(m_NumWorkerThreads);
+}
+
+void ShadowsSample::InitializeBoundBoxes()
+{
+    const auto NumMeshes = m_Mesh.GetNumMeshes();
+
+    m_BoxCuller.Clear();
+    for (Uint32 meshIdx = 0; meshIdx < NumMeshes; ++meshIdx)
+    {
+        const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
+        BoundBox    BB;
+        BB.Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
+        BB.Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
+        m_BoxCuller.AddBox(BB);
+    }
+
+    // The file only stores mesh bounds, so compute subset bounds from the vertices referenced by the subset indices
+    m_FirstSubsetBox.resize(NumMeshes);
+    for (Uint32 meshIdx = 0; meshIdx < NumMeshes; ++meshIdx)
+    {
+        const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
+        m_FirstSubsetBox[meshIdx] = m_BoxCuller.GetNumBoxes();
+
+        const auto  VBIdx     = SubMesh.VertexBuffers[0];
+        const auto  Stride    = m_Mesh.GetVertexStride(VBIdx);
+        const auto* pVertices = m_Mesh.GetRawVerticesAt(VBIdx);
+        const auto* pIndices  = m_Mesh.GetRawIndicesAt(SubMesh.IndexBuffer);
+        const auto  IBFormat  = m_Mesh.GetIBFormat(meshIdx);
+
+        Uint32 PosOffset = ~0u;
+        for (const auto* pElem = m_Mesh.VBElements(VBIdx); pElem->Stream != 0xFF; ++pElem)
+        {
+            if (pElem->Usage == DXSDKMESH_VERTEX_SEMANTIC_POSITION && pElem->Type == DXSDKMESH_VERTEX_DATA_TYPE_FLOAT3)
+                PosOffset = pElem->Offset;
+        }
+
+        for (Uint32 subsetIdx = 0; subsetIdx < SubMesh.NumSubsets; ++subsetIdx)
+        {
+            const auto& Subset = m_Mesh.GetSubset(meshIdx, subsetIdx);
+
+            // Fall back to the mesh bounds if the positions are not available
+            BoundBox BB;
+            BB.Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
+            BB.Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
+            if (PosOffset != ~0u && pVertices != nullptr && pIndices != nullptr && Subset.IndexCount > 0)
+            {
+                BB.Min = float3{+FLT_MAX, +FLT_MAX, +FLT_MAX};
+                BB.Max = float3{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+                for (auto i = Subset.IndexStart; i < Subset.IndexStart + Subset.IndexCount; ++i)
+                {
+                    const Uint32 VertIdx = IBFormat == VT_UINT32 ?
+                        reinterpret_cast<const Uint32*>(pIndices)[i] :
+                        reinterpret_cast<const Uint16*>(pIndices)[i];
+
+                    float3 Pos;
+                    memcpy(&Pos, pVertices + size_t{VertIdx} * Stride + PosOffset, sizeof(Pos));
+                    BB.Min = std::min(BB.Min, Pos);
+                    BB.Max = std::max(BB.Max, Pos);
+                }
+            }
+            m_BoxCuller.AddBox(BB);
+        }
+    }
+}
+
+void ShadowsSample::StartWorkerThreads(int NumThreads)
+{
+    if (NumThreads > 0)
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
+}
+
+void ShadowsSample::StopWorkerThreads()
+{
+    m_pScheduler.reset();
+    m_PassCmdLists.clear();
 }
 
 void ShadowsSample::UpdateUI()
@@ -120,6 +229,19 @@ void ShadowsSample::UpdateUI()
     {
         ImGui::gizmo3D("Light direction", reinterpret_cast<float3&>(m_LightAttribs.f4Direction), ImGui::GetTextLineHeight() * 10);
 
+        {
+            ImGui::ScopedDisabler Disable(m_MaxWorkerThreads == 0);
+            if (ImGui::SliderInt("Worker threads", &m_NumWorkerThreads, 0, m_MaxWorkerThreads))
+            {
+                StopWorkerThreads();
+                StartWorkerThreads(m_NumWorkerThreads);
+            }
+            ImGui::HelpMarker("With worker threads, every shadow cascade and the main pass are recorded in parallel into deferred contexts");
+        }
+        ImGui::Text("Recording time: %.2f ms", m_RecordTime);
+        ImGui::Text("Visible subsets: %u", m_NumVisibleSubsets);
+        ImGui::HelpMarker("Total number of draw calls in all passes after culling meshes and subsets against the cascade and camera frustums");
+
         {
             constexpr int MinShadowMapSize = 512;
             int           ShadowMapComboId = 0;
@@ -496,106 +618,236 @@ void ShadowsSample::CreateShadowMap()
     InitializeResourceBindings();
 }
 
-void ShadowsSample::RenderShadowMap()
+void ShadowsSample::RenderShadowCascade(IDeviceContext* pCtx, int iCascade, bool IsDeferred)
 {
-    auto iNumShadowCascades = m_LightAttribs.ShadowAttribs.iNumCascades;
-    for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
-    {
-        const auto CascadeProjMatr = m_ShadowMapMgr.GetCascadeTranform(iCascade).Proj;
+    DILIGENT_PROFILE_SCOPE("Shadow cascade");
 
-        auto WorldToLightViewSpaceMatr = m_LightAttribs.ShadowAttribs.mWorldToLightViewT.Transpose();
-        auto WorldToLightProjSpaceMatr = WorldToLightViewSpaceMatr * CascadeProjMatr;
+    const auto CascadeProjMatr           = m_ShadowMapMgr.GetCascadeTranform(iCascade).Proj;
+    const auto WorldToLightProjSpaceMatr = GetCascadeViewProj(iCascade);
 
-        CameraAttribs ShadowCameraAttribs = {};
+    CameraAttribs ShadowCameraAttribs = {};
 
-        ShadowCameraAttribs.mViewT     = m_LightAttribs.ShadowAttribs.mWorldToLightViewT;
-        ShadowCameraAttribs.mProjT     = CascadeProjMatr.Transpose();
-        ShadowCameraAttribs.mViewProjT = WorldToLightProjSpaceMatr.Transpose();
+    ShadowCameraAttribs.mViewT     = m_LightAttribs.ShadowAttribs.mWorldToLightViewT;
+    ShadowCameraAttribs.mProjT     = CascadeProjMatr.Transpose();
+    ShadowCameraAttribs.mViewProjT = WorldToLightProjSpaceMatr.Transpose();
 
-        ShadowCameraAttribs.f4ViewportSize.x = static_cast<float>(m_ShadowSettings.Resolution);
-        ShadowCameraAttribs.f4ViewportSize.y = static_cast<float>(m_ShadowSettings.Resolution);
-        ShadowCameraAttribs.f4ViewportSize.z = 1.f / ShadowCameraAttribs.f4ViewportSize.x;
-        ShadowCameraAttribs.f4ViewportSize.w = 1.f / ShadowCameraAttribs.f4ViewportSize.y;
-
-        {
-            MapHelper<CameraAttribs> CameraData(m_pImmediateContext, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-            *CameraData = ShadowCameraAttribs;
-        }
+    ShadowCameraAttribs.f4ViewportSize.x = static_cast<float>(m_ShadowSettings.Resolution);
+    ShadowCameraAttribs.f4ViewportSize.y = static_cast<float>(m_ShadowSettings.Resolution);
+    ShadowCameraAttribs.f4ViewportSize.z = 1.f / ShadowCameraAttribs.f4ViewportSize.x;
+    ShadowCameraAttribs.f4ViewportSize.w = 1.f / ShadowCameraAttribs.f4ViewportSize.y;
 
-        auto* pCascadeDSV = m_ShadowMapMgr.GetCascadeDSV(iCascade);
-        m_pImmediateContext->SetRenderTargets(0, nullptr, pCascadeDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        m_pImmediateContext->ClearDepthStencil(pCascadeDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    {
+        // Dynamic buffers must be mapped in every context that uses them
+        MapHelper<CameraAttribs> CameraData(pCtx, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        *CameraData = ShadowCameraAttribs;
+    }
 
-        ViewFrustumExt Frutstum;
-        ExtractViewFrustumPlanesFromMatrix(WorldToLightProjSpaceMatr, Frutstum, m_pDevice->GetDeviceInfo().IsGLDevice());
+    // In deferred contexts, the shadow map has been transitioned to depth-write state by the main thread
+    const auto RTMode = IsDeferred ? RESOURCE_STATE_TRANSITION_MODE_VERIFY : RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
 
-        //if (iCascade == 0)
-        DrawMesh(m_pImmediateContext, true, Frutstum);
-    }
+    auto* pCascadeDSV = m_ShadowMapMgr.GetCascadeDSV(iCascade);
+    pCtx->SetRenderTargets(0, nullptr, pCascadeDSV, RTMode);
+    pCtx->ClearDepthStencil(pCascadeDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RTMode);
 
-    if (m_ShadowSettings.iShadowMode > SHADOW_MODE_PCF)
-        m_ShadowMapMgr.ConvertToFilterable(m_pImmediateContext, m_LightAttribs.ShadowAttribs);
+    if (!IsDeferred)
+        pCtx->TransitionShaderResources(m_RenderMeshShadowPSO[0], m_ShadowSRBs[0]);
+    DrawMesh(pCtx, true, m_PassVisibility.data() + size_t{m_BoxCuller.GetMaskSize()} * iCascade, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 }
 
-// Render a frame
-void ShadowsSample::Render()
+void ShadowsSample::RenderMainPass(IDeviceContext* pCtx, bool IsDeferred)
 {
-    RenderShadowMap();
+    DILIGENT_PROFILE_SCOPE("Main pass");
+
+    // Reset default framebuffer. When the pass is deferred, the main thread has already transitioned it.
+    const auto RTMode = IsDeferred ? RESOURCE_STATE_TRANSITION_MODE_VERIFY : RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
 
-    // Reset default framebuffer
     auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
     auto* pDSV = m_pSwapChain->GetDepthBufferDSV();
-    m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pCtx->SetRenderTargets(1, &pRTV, pDSV, RTMode);
 
     // Clear the back buffer
     const float ClearColor[] = {0.23f, 0.5f, 0.74f, 1.0f};
-    m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pCtx->ClearRenderTarget(pRTV, ClearColor, RTMode);
+    pCtx->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RTMode);
 
     {
-        MapHelper<LightAttribs> LightData(m_pImmediateContext, m_LightAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        MapHelper<LightAttribs> LightData(pCtx, m_LightAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
         *LightData = m_LightAttribs;
     }
 
-    // Get pretransform matrix that rotates the scene according the surface orientation
-    auto SrfPreTransform = GetSurfacePretransformMatrix(float3{0, 0, 1});
-
-    const auto  CameraView     = m_Camera.GetViewMatrix() * SrfPreTransform;
     const auto& CameraWorld    = m_Camera.GetWorldMatrix();
     float3      CameraWorldPos = float3::MakeVector(CameraWorld[3]);
     const auto& Proj           = m_Camera.GetProjMatrix();
-
-    auto CameraViewProj = CameraView * Proj;
+    const auto  CameraViewProj = GetCameraViewProj();
 
     {
-        MapHelper<CameraAttribs> CamAttribs(m_pImmediateContext, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        MapHelper<CameraAttribs> CamAttribs(pCtx, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
         CamAttribs->mProjT        = Proj.Transpose();
         CamAttribs->mViewProjT    = CameraViewProj.Transpose();
         CamAttribs->mViewProjInvT = CameraViewProj.Inverse().Transpose();
         CamAttribs->f4Position    = float4(CameraWorldPos, 1);
     }
 
-    ViewFrustumExt Frutstum;
-    ExtractViewFrustumPlanesFromMatrix(CameraViewProj, Frutstum, m_pDevice->GetDeviceInfo().IsGLDevice());
-    DrawMesh(m_pImmediateContext, false, Frutstum);
+    // The main pass is recorded while the shadow map is still in depth-write state, so its state
+    // can't be verified in a deferred context. The main thread transitions it before executing the pass.
+    if (!IsDeferred)
+        pCtx->TransitionShaderResources(m_RenderMeshPSO[0], m_SRBs[0]);
+    const auto MainPass = m_LightAttribs.ShadowAttribs.iNumCascades;
+    DrawMesh(pCtx, false, m_PassVisibility.data() + size_t{m_BoxCuller.GetMaskSize()} * MainPass, IsDeferred ? RESOURCE_STATE_TRANSITION_MODE_NONE : RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+}
+
+float4x4 ShadowsSample::GetCascadeViewProj(int iCascade) const
+{
+    const auto& CascadeProjMatr           = m_ShadowMapMgr.GetCascadeTranform(iCascade).Proj;
+    const auto  WorldToLightViewSpaceMatr = m_LightAttribs.ShadowAttribs.mWorldToLightViewT.Transpose();
+    return WorldToLightViewSpaceMatr * CascadeProjMatr;
 }
 
+float4x4 ShadowsSample::GetCameraViewProj() const
+{
+    // Get pretransform matrix that rotates the scene according the surface orientation
+    const auto SrfPreTransform = GetSurfacePretransformMatrix(float3{0, 0, 1});
+    return m_Camera.GetViewMatrix() * SrfPreTransform * m_Camera.GetProjMatrix();
+}
 
-void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const ViewFrustumExt& Frustum)
+void ShadowsSample::CullScene()
 {
+    DILIGENT_PROFILE_SCOPE("Frustum culling");
+
+    const auto NumCascades = m_LightAttribs.ShadowAttribs.iNumCascades;
+    const auto IsGL        = m_pDevice->GetDeviceInfo().IsGLDevice();
+
+    m_PassFrustums.resize(NumCascades + 1);
+    for (int iCascade = 0; iCascade < NumCascades; ++iCascade)
+    {
+        auto& Pass = m_PassFrustums[iCascade];
+        ExtractViewFrustumPlanesFromMatrix(GetCascadeViewProj(iCascade), Pass.Frustum, IsGL);
+        // Notice that for shadow passes we test against frustum with open near plane
+        Pass.PlaneFlags = FRUSTUM_PLANE_FLAG_OPEN_NEAR;
+    }
+
+    auto& MainPass = m_PassFrustums[NumCascades];
+    ExtractViewFrustumPlanesFromMatrix(GetCameraViewProj(), MainPass.Frustum, IsGL);
+    MainPass.PlaneFlags = FRUSTUM_PLANE_FLAG_FULL_FRUSTUM;
+
+    // Every box is loaded once and tested against the frustums of all passes
+    m_BoxCuller.Cull(m_PassFrustums.data(), static_cast<Uint32>(m_PassFrustums.size()), m_PassVisibility);
+
+    m_NumVisibleSubsets = 0;
+    for (size_t pass = 0; pass < m_PassFrustums.size(); ++pass)
+    {
+        const auto* pVisibility = m_PassVisibility.data() + size_t{m_BoxCuller.GetMaskSize()} * pass;
+        for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
+        {
+            if (!BoxCuller::IsVisible(pVisibility, meshIdx))
+                continue;
+
+            for (Uint32 subsetIdx = 0; subsetIdx < m_Mesh.GetMesh(meshIdx).NumSubsets; ++subsetIdx)
+            {
+                if (BoxCuller::IsVisible(pVisibility, m_FirstSubsetBox[meshIdx] + subsetIdx))
+                    ++m_NumVisibleSubsets;
+            }
+        }
+    }
+}
+
+void ShadowsSample::RenderParallel()
+{
+    VERIFY_EXPR(m_pScheduler);
+
+    const auto NumCascades = m_LightAttribs.ShadowAttribs.iNumCascades;
+    const auto NumPasses   = static_cast<Uint32>(NumCascades + 1);
+    m_PassCmdLists.resize(NumPasses);
+
+    // Deferred contexts can't transition resources, so transition the shadow map for the shadow passes now
+    StateTransitionDesc Barrier{m_ShadowMapMgr.GetSRV()->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_DEPTH_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+
+    // Every pass is a task. A thread may record several passes, each into a separate command list.
+    m_pScheduler->ParallelFor(
+        NumPasses,
+        [this, NumCascades](Uint32 ThreadId, Uint32 PassId) {
+            auto* pCtx = m_pDeferredContexts[ThreadId].RawPtr();
+            pCtx->Begin(0);
+            if (static_cast<int>(PassId) < NumCascades)
+                RenderShadowCascade(pCtx, static_cast<int>(PassId), true);
+            else
+                RenderMainPass(pCtx, true);
+            pCtx->FinishCommandList(&m_PassCmdLists[PassId]);
+        });
+
+    // Execute the passes in order
+    m_CmdListPtrs.clear();
+    for (int iCascade = 0; iCascade < NumCascades; ++iCascade)
+        m_CmdListPtrs.push_back(m_PassCmdLists[iCascade]);
+    m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+
+    if (m_ShadowSettings.iShadowMode > SHADOW_MODE_PCF)
+        m_ShadowMapMgr.ConvertToFilterable(m_pImmediateContext, m_LightAttribs.ShadowAttribs);
+
     // Note that Vulkan requires shadow map to be transitioned to DEPTH_READ state, not SHADER_RESOURCE
-    pCtx->TransitionShaderResources((bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO)[0], (bIsShadowPass ? m_ShadowSRBs : m_SRBs)[0]);
+    m_pImmediateContext->TransitionShaderResources(m_RenderMeshPSO[0], m_SRBs[0]);
+
+    ICommandList* pMainPassCmdList = m_PassCmdLists[NumCascades];
+    m_pImmediateContext->ExecuteCommandLists(1, &pMainPassCmdList);
+
+    for (auto& pCmdList : m_PassCmdLists)
+    {
+        // Release command lists now to release all outstanding references.
+        // In d3d11 mode, command lists hold references to the swap chain's back buffer
+        // that cause swap chain resize to fail.
+        pCmdList.Release();
+    }
+
+    // Call FinishFrame() to release dynamic resources allocated by deferred contexts.
+    // This must be done after the command lists have been submitted, and in Metal backend
+    // from the same thread that recorded the commands.
+    m_pScheduler->RunOnEachThread([this](Uint32 ThreadId) {
+        m_pDeferredContexts[ThreadId]->FinishFrame();
+    });
+}
+
+// Render a frame
+void ShadowsSample::Render()
+{
+    const auto RecordStart = std::chrono::high_resolution_clock::now();
+
+    // Visibility is computed once for all passes before any of them is recorded
+    CullScene();
+
+    if (m_pScheduler)
+    {
+        RenderParallel();
+    }
+    else
+    {
+        for (int iCascade = 0; iCascade < m_LightAttribs.ShadowAttribs.iNumCascades; ++iCascade)
+            RenderShadowCascade(m_pImmediateContext, iCascade, false);
+
+        if (m_ShadowSettings.iShadowMode > SHADOW_MODE_PCF)
+            m_ShadowMapMgr.ConvertToFilterable(m_pImmediateContext, m_LightAttribs.ShadowAttribs);
+
+        RenderMainPass(m_pImmediateContext, false);
+    }
+
+    const auto RecordTime = std::chrono::duration<double, std::milli>{std::chrono::high_resolution_clock::now() - RecordStart}.count();
+    m_RecordTime          = m_RecordTime * 0.95 + RecordTime * 0.05;
+}
+
+
+void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const Uint64* pVisibility, RESOURCE_STATE_TRANSITION_MODE CommitMode)
+{
+    // Resource states can only be verified when shader resources are committed in VERIFY mode
+    const auto DrawFlags = CommitMode == RESOURCE_STATE_TRANSITION_MODE_VERIFY ? DRAW_FLAG_VERIFY_ALL : DRAW_FLAG_VERIFY_DRAW_ATTRIBS;
 
     for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
     {
-        const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
-        BoundBox    BB;
-        BB.Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
-        BB.Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
-        // Notice that for shadow pass we test against frustum with open near plane
-        if (GetBoxVisibility(Frustum, BB, bIsShadowPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) == BoxVisibility::Invisible)
+        // Mesh boxes come first, so the box index is the mesh index
+        if (!BoxCuller::IsVisible(pVisibility, meshIdx))
             continue;
 
+        const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
+
         IBuffer* pVBs[] = {m_Mesh.GetMeshVertexBuffer(meshIdx, 0)};
         pCtx->SetVertexBuffers(0, 1, pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
 
@@ -608,13 +860,16 @@ void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const Vie
         auto& pPSO     = (bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO)[PSOIndex];
         pCtx->SetPipelineState(pPSO);
 
-        // Draw all subsets
+        // Draw visible subsets
         for (Uint32 subsetIdx = 0; subsetIdx < SubMesh.NumSubsets; ++subsetIdx)
         {
+            if (!BoxCuller::IsVisible(pVisibility, m_FirstSubsetBox[meshIdx] + subsetIdx))
+                continue;
+
             const auto& Subset = m_Mesh.GetSubset(meshIdx, subsetIdx);
-            pCtx->CommitShaderResources((bIsShadowPass ? m_ShadowSRBs : m_SRBs)[Subset.MaterialID], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            pCtx->CommitShaderResources((bIsShadowPass ? m_ShadowSRBs : m_SRBs)[Subset.MaterialID], CommitMode);
 
-            DrawIndexedAttribs drawAttrs(static_cast<Uint32>(Subset.IndexCount), IBFormat, DRAW_FLAG_VERIFY_ALL);
+            DrawIndexedAttribs drawAttrs(static_cast<Uint32>(Subset.IndexCount), IBFormat, DrawFlags);
             drawAttrs.FirstIndexLocation = static_cast<Uint32>(Subset.IndexStart);
             pCtx->DrawIndexed(drawAttrs);
         }
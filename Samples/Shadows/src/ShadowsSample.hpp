@@ -27,12 +27,17 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
 #include "DXSDKMeshLoader.hpp"
 #include "FirstPersonCamera.hpp"
 #include "ShadowMapManager.hpp"
 #include "RenderStateNotationLoader.h"
+#include "TaskScheduler.hpp"
+#include "BoxCuller.hpp"
 
 namespace Diligent
 {
@@ -44,6 +49,7 @@ class ShadowsSample final : public SampleBase
 public:
     ~ShadowsSample();
     virtual void ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
+    virtual void ProcessCommandLine(const char* CmdLine) override final;
 
     virtual void Initialize(const SampleInitInfo& InitInfo) override final;
 
@@ -55,13 +61,27 @@ public:
     virtual void WindowResize(Uint32 Width, Uint32 Height) override final;
 
 private:
-    void DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const struct ViewFrustumExt& Frustum);
+    // pVisibility is the visibility mask of the pass computed by CullScene()
+    void DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const Uint64* pVisibility, RESOURCE_STATE_TRANSITION_MODE CommitMode);
     void CreatePipelineStates();
     void InitializeResourceBindings();
     void CreateShadowMap();
-    void RenderShadowMap();
     void UpdateUI();
 
+    void     InitializeBoundBoxes();
+    float4x4 GetCascadeViewProj(int iCascade) const;
+    float4x4 GetCameraViewProj() const;
+    // Tests meshes and subsets against the frustums of all shadow cascades and the main pass
+    void CullScene();
+
+    // If IsDeferred is true, the pass is recorded into a deferred context and does not transition any resources
+    void RenderShadowCascade(IDeviceContext* pCtx, int iCascade, bool IsDeferred);
+    void RenderMainPass(IDeviceContext* pCtx, bool IsDeferred);
+    void RenderParallel();
+
+    void StartWorkerThreads(int NumThreads);
+    void StopWorkerThreads();
+
     static void DXSDKMESH_VERTEX_ELEMENTtoInputLayoutDesc(const DXSDKMESH_VERTEX_ELEMENT* VertexElement,
                                                           Uint32                          Stride,
                                                           InputLayoutDesc&                Layout,
@@ -102,6 +122,28 @@ private:
 
     RefCntAutoPtr<ISampler> m_pComparisonSampler;
     RefCntAutoPtr<ISampler> m_pFilterableShadowMapSampler;
+
+    // When there are worker threads, every shadow cascade and the main pass are recorded into separate
+    // command lists in parallel and executed in order. Otherwise, all passes are rendered by the immediate context.
+    std::unique_ptr<TaskScheduler> m_pScheduler;
+
+    // Every thread of the scheduler, including the main thread, records into its own deferred context
+    int m_MaxWorkerThreads = 0;
+    int m_NumWorkerThreads = 4;
+
+    std::vector<RefCntAutoPtr<ICommandList>> m_PassCmdLists; // Shadow cascades, followed by the main pass
+    std::vector<ICommandList*>               m_CmdListPtrs;
+
+    double m_RecordTime = 0; // Smoothed command recording time, in milliseconds
+
+    // Bounding boxes of all meshes, followed by the bounding boxes of all subsets
+    BoxCuller           m_BoxCuller;
+    std::vector<Uint32> m_FirstSubsetBox; // Index of the box of the first subset of every mesh
+
+    std::vector<BoxCuller::FrustumAttribs> m_PassFrustums;   // Shadow cascades, followed by the main pass
+    std::vector<Uint64>                    m_PassVisibility; // Visibility masks of all passes, in the same order
+
+    Uint32 m_NumVisibleSubsets = 0; // Total number of subsets drawn by all passes
 };
 
 } // namespace Diligent
@@ -0,0 +1,315 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include "SpriteSimulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Align.hpp"
+#include "DebugUtilities.hpp"
+#include "TaskScheduler.hpp"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define SPRITE_SIMULATION_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define SPRITE_SIMULATION_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define SPRITE_SIMULATION_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Minimal set of vector operations required by the simulation.
+#if SPRITE_SIMULATION_AVX2
+
+constexpr Uint32 SIMDWidth = 8;
+
+using FloatV = __m256;
+using IntV   = __m256i;
+using MaskV  = __m256;
+
+// clang-format off
+inline FloatV LoadF  (const float* p)           { return _mm256_loadu_ps(p); }
+inline void   StoreF (float* p, FloatV v)       { _mm256_storeu_ps(p, v); }
+inline IntV   LoadI  (const Uint32* p)          { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void   StoreI (Uint32* p, IntV v)        { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline FloatV SetF   (float f)                  { return _mm256_set1_ps(f); }
+inline FloatV Add    (FloatV a, FloatV b)       { return _mm256_add_ps(a, b); }
+inline FloatV Mul    (FloatV a, FloatV b)       { return _mm256_mul_ps(a, b); }
+inline FloatV Abs    (FloatV a)                 { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+inline MaskV  CmpGt  (FloatV a, FloatV b)       { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline MaskV  Or     (MaskV a, MaskV b)         { return _mm256_or_ps(a, b); }
+inline FloatV NegateIf(MaskV m, FloatV a)       { return _mm256_xor_ps(a, _mm256_and_ps(m, _mm256_set1_ps(-0.f))); }
+inline FloatV Select (MaskV m, FloatV a, FloatV b) { return _mm256_blendv_ps(b, a, m); }
+inline IntV   Select (MaskV m, IntV a, IntV b)  { return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b), _mm256_castsi256_ps(a), m)); }
+inline IntV   Xor    (IntV a, IntV b)           { return _mm256_xor_si256(a, b); }
+template <int N> inline IntV ShiftLeft (IntV a) { return _mm256_slli_epi32(a, N); }
+template <int N> inline IntV ShiftRight(IntV a) { return _mm256_srli_epi32(a, N); }
+// Converts the upper 24 bits of every element to a float in [0, 1)
+inline FloatV ToUnitFloat(IntV a)               { return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(a, 8)), _mm256_set1_ps(1.f / 16777216.f)); }
+// clang-format on
+
+#elif SPRITE_SIMULATION_SSE2
+
+constexpr Uint32 SIMDWidth = 4;
+
+using FloatV = __m128;
+using IntV   = __m128i;
+using MaskV  = __m128;
+
+// clang-format off
+inline FloatV LoadF  (const float* p)           { return _mm_loadu_ps(p); }
+inline void   StoreF (float* p, FloatV v)       { _mm_storeu_ps(p, v); }
+inline IntV   LoadI  (const Uint32* p)          { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void   StoreI (Uint32* p, IntV v)        { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline FloatV SetF   (float f)                  { return _mm_set1_ps(f); }
+inline FloatV Add    (FloatV a, FloatV b)       { return _mm_add_ps(a, b); }
+inline FloatV Mul    (FloatV a, FloatV b)       { return _mm_mul_ps(a, b); }
+inline FloatV Abs    (FloatV a)                 { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+inline MaskV  CmpGt  (FloatV a, FloatV b)       { return _mm_cmpgt_ps(a, b); }
+inline MaskV  Or     (MaskV a, MaskV b)         { return _mm_or_ps(a, b); }
+inline FloatV NegateIf(MaskV m, FloatV a)       { return _mm_xor_ps(a, _mm_and_ps(m, _mm_set1_ps(-0.f))); }
+inline FloatV Select (MaskV m, FloatV a, FloatV b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline IntV   Select (MaskV m, IntV a, IntV b)  { return _mm_castps_si128(Select(m, _mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+inline IntV   Xor    (IntV a, IntV b)           { return _mm_xor_si128(a, b); }
+template <int N> inline IntV ShiftLeft (IntV a) { return _mm_slli_epi32(a, N); }
+template <int N> inline IntV ShiftRight(IntV a) { return _mm_srli_epi32(a, N); }
+inline FloatV ToUnitFloat(IntV a)               { return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a, 8)), _mm_set1_ps(1.f / 16777216.f)); }
+// clang-format on
+
+#elif SPRITE_SIMULATION_NEON
+
+constexpr Uint32 SIMDWidth = 4;
+
+using FloatV = float32x4_t;
+using IntV   = uint32x4_t;
+using MaskV  = uint32x4_t;
+
+// clang-format off
+inline FloatV LoadF  (const float* p)           { return vld1q_f32(p); }
+inline void   StoreF (float* p, FloatV v)       { vst1q_f32(p, v); }
+inline IntV   LoadI  (const Uint32* p)          { return vld1q_u32(p); }
+inline void   StoreI (Uint32* p, IntV v)        { vst1q_u32(p, v); }
+inline FloatV SetF   (float f)                  { return vdupq_n_f32(f); }
+inline FloatV Add    (FloatV a, FloatV b)       { return vaddq_f32(a, b); }
+inline FloatV Mul    (FloatV a, FloatV b)       { return vmulq_f32(a, b); }
+inline FloatV Abs    (FloatV a)                 { return vabsq_f32(a); }
+inline MaskV  CmpGt  (FloatV a, FloatV b)       { return vcgtq_f32(a, b); }
+inline MaskV  Or     (MaskV a, MaskV b)         { return vorrq_u32(a, b); }
+inline FloatV NegateIf(MaskV m, FloatV a)       { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vandq_u32(m, vdupq_n_u32(0x80000000u)))); }
+inline FloatV Select (MaskV m, FloatV a, FloatV b) { return vbslq_f32(m, a, b); }
+inline IntV   Select (MaskV m, IntV a, IntV b)  { return vbslq_u32(m, a, b); }
+inline IntV   Xor    (IntV a, IntV b)           { return veorq_u32(a, b); }
+template <int N> inline IntV ShiftLeft (IntV a) { return vshlq_n_u32(a, N); }
+template <int N> inline IntV ShiftRight(IntV a) { return vshrq_n_u32(a, N); }
+inline FloatV ToUnitFloat(IntV a)               { return vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(a, 8)), 1.f / 16777216.f); }
+// clang-format on
+
+#else
+
+// No SIMD instruction set is available. Use scalar operations with the same semantics.
+constexpr Uint32 SIMDWidth = 1;
+
+using FloatV = float;
+using IntV   = Uint32;
+using MaskV  = bool;
+
+// clang-format off
+inline FloatV LoadF  (const float* p)           { return *p; }
+inline void   StoreF (float* p, FloatV v)       { *p = v; }
+inline IntV   LoadI  (const Uint32* p)          { return *p; }
+inline void   StoreI (Uint32* p, IntV v)        { *p = v; }
+inline FloatV SetF   (float f)                  { return f; }
+inline FloatV Add    (FloatV a, FloatV b)       { return a + b; }
+inline FloatV Mul    (FloatV a, FloatV b)       { return a * b; }
+inline FloatV Abs    (FloatV a)                 { return std::abs(a); }
+inline MaskV  CmpGt  (FloatV a, FloatV b)       { return a > b; }
+inline MaskV  Or     (MaskV a, MaskV b)         { return a || b; }
+inline FloatV NegateIf(MaskV m, FloatV a)       { return m ? -a : a; }
+inline FloatV Select (MaskV m, FloatV a, FloatV b) { return m ? a : b; }
+inline IntV   Select (MaskV m, IntV a, IntV b)  { return m ? a : b; }
+inline IntV   Xor    (IntV a, IntV b)           { return a ^ b; }
+template <int N> inline IntV ShiftLeft (IntV a) { return a << N; }
+template <int N> inline IntV ShiftRight(IntV a) { return a >> N; }
+inline FloatV ToUnitFloat(IntV a)               { return static_cast<float>(a >> 8) * (1.f / 16777216.f); }
+// clang-format on
+
+#endif
+
+// Pad arrays so that any task processes whole vectors
+constexpr Uint32 PaddingAlignment = 8;
+static_assert(PaddingAlignment % SIMDWidth == 0, "Padding must be a multiple of the SIMD width");
+
+inline Uint32 XorShift32(Uint32 x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+inline IntV XorShift32(IntV x)
+{
+    x = Xor(x, ShiftLeft<13>(x));
+    x = Xor(x, ShiftRight<17>(x));
+    x = Xor(x, ShiftLeft<5>(x));
+    return x;
+}
+
+} // namespace
+
+void SpriteSimulation::Resize(Uint32 NumSprites)
+{
+    m_NumSprites = NumSprites;
+
+    const auto PaddedSize = AlignUp(NumSprites, PaddingAlignment);
+    // Padding sprites stay at the origin and never move
+    m_PosX.assign(PaddedSize, 0.f);
+    m_PosY.assign(PaddedSize, 0.f);
+    m_MoveDirX.assign(PaddedSize, 0.f);
+    m_MoveDirY.assign(PaddedSize, 0.f);
+    m_Angle.assign(PaddedSize, 0.f);
+    m_RotSpeed.assign(PaddedSize, 0.f);
+    m_RngState.resize(PaddedSize);
+    for (Uint32 i = 0; i < PaddedSize; ++i)
+    {
+        // Xorshift state must never be zero
+        m_RngState[i] = std::max((i + 1) * 0x9E3779B9u, 1u);
+    }
+}
+
+void SpriteSimulation::SetSprite(Uint32 Ind, const float2& Pos, const float2& MoveDir, float Angle, float RotSpeed)
+{
+    VERIFY_EXPR(Ind < m_NumSprites);
+    m_PosX[Ind]     = Pos.x;
+    m_PosY[Ind]     = Pos.y;
+    m_MoveDirX[Ind] = MoveDir.x;
+    m_MoveDirY[Ind] = MoveDir.y;
+    m_Angle[Ind]    = Angle;
+    m_RotSpeed[Ind] = RotSpeed;
+}
+
+void SpriteSimulation::Update(float ElapsedTime, UPDATE_MODE Mode, TaskScheduler* pScheduler)
+{
+    const auto PaddedSize = static_cast<Uint32>(m_PosX.size());
+    if (Mode == UPDATE_MODE_SCALAR)
+    {
+        UpdateScalar(ElapsedTime, 0, m_NumSprites);
+        return;
+    }
+
+    const Uint32 NumTasks = (PaddedSize + SpritesPerTask - 1) / SpritesPerTask;
+    if (pScheduler == nullptr || NumTasks <= 1)
+    {
+        UpdateSIMD(ElapsedTime, 0, PaddedSize);
+        return;
+    }
+
+    pScheduler->ParallelFor(NumTasks, [&](Uint32, Uint32 TaskId) {
+        const auto Start = TaskId * SpritesPerTask;
+        const auto End   = std::min(Start + SpritesPerTask, PaddedSize);
+        UpdateSIMD(ElapsedTime, Start, End);
+    });
+}
+
+void SpriteSimulation::UpdateScalar(float ElapsedTime, Uint32 Start, Uint32 End)
+{
+    for (Uint32 i = Start; i < End; ++i)
+    {
+        m_Angle[i] += m_RotSpeed[i] * ElapsedTime;
+
+        bool Bounce = false;
+        if (std::abs(m_PosX[i] + m_MoveDirX[i] * ElapsedTime) > MaxPos)
+        {
+            m_MoveDirX[i] *= -1.f;
+            Bounce = true;
+        }
+        m_PosX[i] += m_MoveDirX[i] * ElapsedTime;
+
+        if (std::abs(m_PosY[i] + m_MoveDirY[i] * ElapsedTime) > MaxPos)
+        {
+            m_MoveDirY[i] *= -1.f;
+            Bounce = true;
+        }
+        m_PosY[i] += m_MoveDirY[i] * ElapsedTime;
+
+        if (Bounce)
+        {
+            m_RngState[i] = XorShift32(m_RngState[i]);
+            const auto Rnd = static_cast<float>(m_RngState[i] >> 8) * (1.f / 16777216.f);
+            m_RotSpeed[i]  = MinRotSpeed + Rnd * (MaxRotSpeed - MinRotSpeed);
+        }
+    }
+}
+
+void SpriteSimulation::UpdateSIMD(float ElapsedTime, Uint32 Start, Uint32 End)
+{
+    VERIFY((Start % SIMDWidth) == 0 && (End % SIMDWidth) == 0, "Range must consist of whole vectors");
+
+    const auto dt        = SetF(ElapsedTime);
+    const auto MaxPosV   = SetF(MaxPos);
+    const auto MinRotV   = SetF(MinRotSpeed);
+    const auto RotRangeV = SetF(MaxRotSpeed - MinRotSpeed);
+
+    for (Uint32 i = Start; i < End; i += SIMDWidth)
+    {
+        const auto RotSpeed = LoadF(&m_RotSpeed[i]);
+        StoreF(&m_Angle[i], Add(LoadF(&m_Angle[i]), Mul(RotSpeed, dt)));
+
+        auto PosX     = LoadF(&m_PosX[i]);
+        auto MoveDirX = LoadF(&m_MoveDirX[i]);
+        auto BounceX  = CmpGt(Abs(Add(PosX, Mul(MoveDirX, dt))), MaxPosV);
+        MoveDirX      = NegateIf(BounceX, MoveDirX);
+        StoreF(&m_PosX[i], Add(PosX, Mul(MoveDirX, dt)));
+        StoreF(&m_MoveDirX[i], MoveDirX);
+
+        auto PosY     = LoadF(&m_PosY[i]);
+        auto MoveDirY = LoadF(&m_MoveDirY[i]);
+        auto BounceY  = CmpGt(Abs(Add(PosY, Mul(MoveDirY, dt))), MaxPosV);
+        MoveDirY      = NegateIf(BounceY, MoveDirY);
+        StoreF(&m_PosY[i], Add(PosY, Mul(MoveDirY, dt)));
+        StoreF(&m_MoveDirY[i], MoveDirY);
+
+        // Only the generators of the sprites that bounced advance their state
+        const auto Bounce   = Or(BounceX, BounceY);
+        const auto RngState = LoadI(&m_RngState[i]);
+        const auto NewState = XorShift32(RngState);
+        const auto NewSpeed = Add(MinRotV, Mul(ToUnitFloat(NewState), RotRangeV));
+        StoreI(&m_RngState[i], Select(Bounce, NewState, RngState));
+        StoreF(&m_RotSpeed[i], Select(Bounce, NewSpeed, RotSpeed));
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,93 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+class TaskScheduler;
+
+/// Simulation of sprites that move and rotate inside the [-0.95, +0.95] square and bounce off its borders.
+
+/// The state of all sprites is kept in a structure of arrays, so that it can be updated with SIMD
+/// instructions (AVX2, SSE2 or NEON, depending on the target). Every sprite has its own xorshift random
+/// number generator that picks a new rotation speed after a bounce. The result of the update thus does
+/// not depend on how the work is split between threads. The scalar and SIMD modes may differ in the last
+/// bits, because the compiler is free to contract the scalar multiply-adds into FMA instructions.
+class SpriteSimulation
+{
+public:
+    enum UPDATE_MODE : int
+    {
+        // Reference scalar update on the calling thread
+        UPDATE_MODE_SCALAR = 0,
+
+        // Vectorized update distributed between the threads of the task scheduler
+        UPDATE_MODE_SIMD
+    };
+
+    void Resize(Uint32 NumSprites);
+
+    void SetSprite(Uint32 Ind, const float2& Pos, const float2& MoveDir, float Angle, float RotSpeed);
+
+    /// Updates all sprites. pScheduler may be null, in which case all work is done by the calling thread.
+    void Update(float ElapsedTime, UPDATE_MODE Mode, TaskScheduler* pScheduler);
+
+    Uint32 GetNumSprites() const { return m_NumSprites; }
+
+    float2 GetPos(Uint32 Ind) const { return float2{m_PosX[Ind], m_PosY[Ind]}; }
+    float  GetAngle(Uint32 Ind) const { return m_Angle[Ind]; }
+
+    static constexpr float MaxPos      = 0.95f;
+    static constexpr float MinRotSpeed = -PI_F * 0.5f;
+    static constexpr float MaxRotSpeed = +PI_F * 0.5f;
+
+private:
+    void UpdateScalar(float ElapsedTime, Uint32 Start, Uint32 End);
+    void UpdateSIMD(float ElapsedTime, Uint32 Start, Uint32 End);
+
+    // Number of sprites updated by a single task. Must be a multiple of the SIMD width.
+    static constexpr Uint32 SpritesPerTask = 4096;
+
+    Uint32 m_NumSprites = 0;
+
+    // All arrays are padded to a multiple of the SIMD width
+    std::vector<float>  m_PosX;
+    std::vector<float>  m_PosY;
+    std::vector<float>  m_MoveDirX;
+    std::vector<float>  m_MoveDirY;
+    std::vector<float>  m_Angle;
+    std::vector<float>  m_RotSpeed;
+    std::vector<Uint32> m_RngState;
+};
+
+} // namespace Diligent
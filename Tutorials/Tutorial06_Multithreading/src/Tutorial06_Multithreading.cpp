@@ -28,6 +28,8 @@
 #include <random>
 #include <string>
 #include <algorithm>
+#include <thread>
+#include <chrono>
 
 #include "Tutorial06_Multithreading.hpp"
 #include "MapHelper.hpp"
@@ -36,6 +38,7 @@
 #include "../../Common/src/TexturedCube.hpp"
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
+#include "FrameProfiler.hpp"
 
 namespace Diligent
 {
@@ -93,6 +96,24 @@ void Tutorial06_Multithreading::CreatePipelineState(std::vector<StateTransitionD
     // never change and are bound directly to the pipeline state object.
     m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
     m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "InstanceData")->Set(m_InstanceConstants);
+
+    // clang-format off
+    // Per-instance data - second buffer slot
+    // We will use four attributes to encode instance-specific 4x4 transformation matrix
+    LayoutElement InstLayoutElems[] =
+    {
+        LayoutElement{2, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        LayoutElement{3, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        LayoutElement{4, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        LayoutElement{5, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+    };
+    // clang-format on
+    CubePsoCI.VSFilePath             = "cube_inst.vsh";
+    CubePsoCI.ExtraLayoutElements    = InstLayoutElems;
+    CubePsoCI.NumExtraLayoutElements = _countof(InstLayoutElems);
+
+    m_pInstancedPSO = TexturedCube::CreatePipelineState(CubePsoCI);
+    m_pInstancedPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
 }
 
 void Tutorial06_Multithreading::LoadTextures(std::vector<StateTransitionDesc>& Barriers)
@@ -119,6 +140,9 @@ void Tutorial06_Multithreading::LoadTextures(std::vector<StateTransitionDesc>& B
         // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
         m_pPSO->CreateShaderResourceBinding(&m_SRB[tex], true);
         m_SRB[tex]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
+
+        m_pInstancedPSO->CreateShaderResourceBinding(&m_InstancedSRB[tex], true);
+        m_InstancedSRB[tex]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
     }
 }
 
@@ -130,6 +154,7 @@ void Tutorial06_Multithreading::UpdateUI()
         if (ImGui::SliderInt("Grid Size", &m_GridSize, 1, 32))
         {
             PopulateInstanceData();
+            CreateInstanceBuffers();
         }
         {
             ImGui::ScopedDisabler Disable(m_MaxThreads == 0);
@@ -139,6 +164,17 @@ void Tutorial06_Multithreading::UpdateUI()
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
+        {
+            // Instance buffer modes are only listed if the device supports base instance
+            static const char* const RenderModes[] = {"Map per draw", "Base instance", "Instanced"};
+            if (ImGui::Combo("Render mode", &m_RenderMode, RenderModes, m_BaseInstanceSupported ? static_cast<int>(_countof(RenderModes)) : 1))
+            {
+                // Instances are only sorted by texture in instance buffer modes
+                PopulateInstanceData();
+            }
+        }
+        ImGui::Text("Draw calls: %u", m_NumDrawCalls);
+        ImGui::Text("Recording time: %.2f ms", m_RecordTime);
     }
 
     ImGui::End();
@@ -151,6 +187,18 @@ void Tutorial06_Multithreading::Initialize(const SampleInitInfo& InitInfo)
     m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
     m_NumWorkerThreads = std::min(4, m_MaxThreads);
 
+    // Direct3D, Vulkan and Metal always support base instance. Desktop GL requires
+    // version 4.2 (ARB_base_instance), and core GLES does not support it at all.
+    const auto& DeviceInfo = m_pDevice->GetDeviceInfo();
+    if (DeviceInfo.Type == RENDER_DEVICE_TYPE_GLES)
+        m_BaseInstanceSupported = false;
+    else if (DeviceInfo.Type == RENDER_DEVICE_TYPE_GL)
+        m_BaseInstanceSupported = DeviceInfo.APIVersion.Major > 4 || (DeviceInfo.APIVersion.Major == 4 && DeviceInfo.APIVersion.Minor >= 2);
+    else
+        m_BaseInstanceSupported = true;
+    if (!m_BaseInstanceSupported)
+        m_RenderMode = RENDER_MODE_CONSTANT_BUFFER;
+
     std::vector<StateTransitionDesc> Barriers;
 
     CreatePipelineState(Barriers);
@@ -210,81 +258,68 @@ void Tutorial06_Multithreading::PopulateInstanceData()
             }
         }
     }
-}
 
-void Tutorial06_Multithreading::StartWorkerThreads(size_t NumThreads)
-{
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
+    if (m_RenderMode != RENDER_MODE_CONSTANT_BUFFER)
     {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
+        // Sort instances by texture so that instanced mode can draw long runs of cubes with the same
+        // texture in one draw call. The cubes are opaque, so the draw order does not affect the image.
+        // Map per draw mode keeps the original random order.
+        std::stable_sort(m_InstanceData.begin(), m_InstanceData.end(),
+                         [](const InstanceData& lhs, const InstanceData& rhs) {
+                             return lhs.TextureInd < rhs.TextureInd;
+                         });
     }
-    m_CmdLists.resize(NumThreads);
 }
 
-void Tutorial06_Multithreading::StopWorkerThreads()
+void Tutorial06_Multithreading::CreateInstanceBuffers()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
+    // Instance buffer modes split the instances evenly between all contexts. Every context
+    // writes its whole subset into its own dynamic buffer with a single map.
+    const auto NumContexts  = static_cast<Uint32>(std::max(m_ThreadState.size(), size_t{1}));
+    const auto NumInstances = static_cast<Uint32>(m_InstanceData.size());
+
+    BufferDesc InstBuffDesc;
+    InstBuffDesc.Name           = "Instance data buffer";
+    InstBuffDesc.Usage          = USAGE_DYNAMIC;
+    InstBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+    InstBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    InstBuffDesc.Size           = sizeof(float4x4) * std::max((NumInstances + NumContexts - 1) / NumContexts, 1u);
 
-    for (auto& thread : m_WorkerThreads)
+    std::vector<StateTransitionDesc> Barriers;
+    m_InstanceBuffers.resize(NumContexts);
+    for (auto& pBuffer : m_InstanceBuffers)
     {
-        thread.join();
+        pBuffer.Release();
+        m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &pBuffer);
+        Barriers.emplace_back(pBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
-    m_CmdLists.clear();
+    m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 }
 
-void Tutorial06_Multithreading::WorkerThreadFunc(Tutorial06_Multithreading* pThis, Uint32 ThreadNum)
+void Tutorial06_Multithreading::StartWorkerThreads(size_t NumThreads)
 {
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx     = pThis->m_pDeferredContexts[ThreadNum];
-    const int       NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        pThis->RenderSubset(pDeferredCtx, 1 + ThreadNum);
-
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
-
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
+    if (NumThreads > 0)
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
+    m_ThreadState.resize(NumThreads + 1);
+    m_CmdLists.resize(NumThreads);
+    CreateInstanceBuffers();
+}
 
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
+void Tutorial06_Multithreading::StopWorkerThreads()
+{
+    m_pScheduler.reset();
+    m_ThreadState.clear();
+    m_CmdLists.clear();
+}
 
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread going through the loop twice in
-        // a row.
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
+IDeviceContext* Tutorial06_Multithreading::GetThreadContext(Uint32 ThreadId)
+{
+    // Main thread (thread id 0) uses the immediate context, every
+    // worker thread uses its own deferred context
+    return ThreadId == 0 ? m_pImmediateContext.RawPtr() : m_pDeferredContexts[ThreadId - 1].RawPtr();
 }
 
-void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
+void Tutorial06_Multithreading::PrepareContext(IDeviceContext* pCtx, Uint32 ThreadId)
 {
     // Deferred contexts start in default state. We must bind everything to the context.
     // Render targets are set and transitioned to correct states by the main thread, here we only verify the states.
@@ -301,46 +336,99 @@ void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset
         CBConstants[1] = m_RotationMatrix.Transpose();
     }
 
+    const bool UseInstanceBuffer = m_RenderMode != RENDER_MODE_CONSTANT_BUFFER;
+
     // Bind vertex and index buffers. This must be done for every context
-    IBuffer* pBuffs[] = {m_CubeVertexBuffer};
-    pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+    IBuffer* pBuffs[] = {m_CubeVertexBuffer, m_InstanceBuffers[ThreadId]};
+    pCtx->SetVertexBuffers(0, UseInstanceBuffer ? 2 : 1, pBuffs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
     pCtx->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
+    // Set the pipeline state
+    pCtx->SetPipelineState(UseInstanceBuffer ? m_pInstancedPSO : m_pPSO);
+}
+
+Uint32 Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 ThreadId, Uint32 StartInst, Uint32 EndInst)
+{
+    // On worker threads, the zone is written to the thread's profiler buffer without locking
+    DILIGENT_PROFILE_SCOPE("RenderSubset");
+
     DrawIndexedAttribs DrawAttrs;     // This is an indexed draw call
     DrawAttrs.IndexType  = VT_UINT32; // Index type
     DrawAttrs.NumIndices = 36;
     DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
 
-    // Set the pipeline state
-    pCtx->SetPipelineState(m_pPSO);
-    Uint32 NumSubsets   = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    Uint32 NumInstances = static_cast<Uint32>(m_InstanceData.size());
-    Uint32 SusbsetSize  = NumInstances / NumSubsets;
-    Uint32 StartInst    = SusbsetSize * Subset;
-    Uint32 EndInst      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : NumInstances;
-    for (size_t inst = StartInst; inst < EndInst; ++inst)
+    if (m_RenderMode == RENDER_MODE_CONSTANT_BUFFER)
     {
-        const auto& CurrInstData = m_InstanceData[inst];
-        // Shader resources have been explicitly transitioned to correct states, so
-        // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
-        // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
-        // verify that all resources are in correct states. This mode only has effect
-        // in debug and development builds.
-        pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-
+        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
         {
-            // Map the buffer and write current world-view-projection matrix
-            MapHelper<float4x4> InstData(pCtx, m_InstanceConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-            if (InstData == nullptr)
+            const auto& CurrInstData = m_InstanceData[inst];
+            // Shader resources have been explicitly transitioned to correct states, so
+            // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
+            // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
+            // verify that all resources are in correct states. This mode only has effect
+            // in debug and development builds.
+            pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
             {
-                LOG_ERROR_MESSAGE("Failed to map instance data buffer");
-                break;
+                // Map the buffer and write current world-view-projection matrix
+                MapHelper<float4x4> InstData(pCtx, m_InstanceConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+                if (InstData == nullptr)
+                {
+                    LOG_ERROR_MESSAGE("Failed to map instance data buffer");
+                    return inst - StartInst;
+                }
+                *InstData = CurrInstData.Matrix.Transpose();
             }
-            *InstData = CurrInstData.Matrix.Transpose();
+
+            pCtx->DrawIndexed(DrawAttrs);
         }
+        return EndInst - StartInst;
+    }
+
+    auto* pInstanceBuffer = m_InstanceBuffers[ThreadId].RawPtr();
+    VERIFY_EXPR((EndInst - StartInst) * sizeof(float4x4) <= pInstanceBuffer->GetDesc().Size);
+    {
+        // Write matrices of all instances in the subset with a single map
+        MapHelper<float4x4> InstData(pCtx, pInstanceBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+        if (InstData == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Failed to map instance data buffer");
+            return 0;
+        }
+        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
+            InstData[inst - StartInst] = m_InstanceData[inst].Matrix;
+    }
 
+    Uint32 NumDrawCalls = 0;
+    int    CurrTexture  = -1;
+    for (Uint32 inst = StartInst; inst < EndInst;)
+    {
+        const auto TextureInd = m_InstanceData[inst].TextureInd;
+
+        auto RangeEnd = inst + 1;
+        if (m_RenderMode == RENDER_MODE_INSTANCED)
+        {
+            // Instances are sorted by texture, so find the end of the run that uses the same texture
+            while (RangeEnd < EndInst && m_InstanceData[RangeEnd].TextureInd == TextureInd)
+                ++RangeEnd;
+        }
+
+        if (TextureInd != CurrTexture)
+        {
+            pCtx->CommitShaderResources(m_InstancedSRB[TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            CurrTexture = TextureInd;
+        }
+
+        // Instance data of the subset starts at the beginning of the buffer
+        DrawAttrs.NumInstances          = RangeEnd - inst;
+        DrawAttrs.FirstInstanceLocation = inst - StartInst;
         pCtx->DrawIndexed(DrawAttrs);
+        ++NumDrawCalls;
+
+        inst = RangeEnd;
     }
+
+    return NumDrawCalls;
 }
 
 // Render a frame
@@ -353,23 +441,93 @@ void Tutorial06_Multithreading::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    if (!m_WorkerThreads.empty())
+    const auto RecordStart = std::chrono::high_resolution_clock::now();
+
+    const auto NumInstances = static_cast<Uint32>(m_InstanceData.size());
+    if (!m_pScheduler)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        PrepareContext(m_pImmediateContext, 0);
+        m_NumDrawCalls = RenderSubset(m_pImmediateContext, 0, 0, NumInstances);
     }
+    else
+    {
+        for (auto& State : m_ThreadState)
+            State = ThreadState{};
 
-    RenderSubset(m_pImmediateContext, 0);
+        if (m_RenderMode == RENDER_MODE_CONSTANT_BUFFER)
+        {
+            // Split the instances into small chunks. Every thread records the chunks it
+            // picks up into its own context; idle threads steal chunks from busy ones.
+            const auto NumTasks = (NumInstances + InstancesPerTask - 1) / InstancesPerTask;
+            m_pScheduler->ParallelFor(
+                NumTasks,
+                [this, NumInstances](Uint32 ThreadId, Uint32 TaskId) {
+                    auto* pCtx  = GetThreadContext(ThreadId);
+                    auto& State = m_ThreadState[ThreadId];
+                    if (!State.ContextReady)
+                    {
+                        if (ThreadId > 0)
+                            pCtx->Begin(0);
+                        PrepareContext(pCtx, ThreadId);
+                        State.ContextReady = true;
+                    }
+
+                    const auto StartInst = TaskId * InstancesPerTask;
+                    const auto EndInst   = std::min(StartInst + InstancesPerTask, NumInstances);
+                    State.NumDrawCalls += RenderSubset(pCtx, ThreadId, StartInst, EndInst);
+                },
+                [this](Uint32 ThreadId) {
+                    // Finish command list on the thread that recorded it
+                    if (ThreadId > 0 && m_ThreadState[ThreadId].ContextReady)
+                    {
+                        DILIGENT_PROFILE_SCOPE("FinishCommandList");
+                        m_pDeferredContexts[ThreadId - 1]->FinishCommandList(&m_CmdLists[ThreadId - 1]);
+                    }
+                });
+        }
+        else
+        {
+            // Every thread records one contiguous subset of the instances, so that its
+            // instance buffer is mapped only once per frame.
+            const auto NumThreads = m_pScheduler->GetNumThreads();
+            VERIFY_EXPR(m_InstanceBuffers.size() == NumThreads);
+            m_pScheduler->RunOnEachThread(
+                [this, NumInstances, NumThreads](Uint32 ThreadId) {
+                    const auto StartInst = static_cast<Uint32>(Uint64{NumInstances} * ThreadId / NumThreads);
+                    const auto EndInst   = static_cast<Uint32>(Uint64{NumInstances} * (ThreadId + 1) / NumThreads);
+                    if (StartInst == EndInst)
+                        return;
+
+                    auto* pCtx  = GetThreadContext(ThreadId);
+                    auto& State = m_ThreadState[ThreadId];
+                    if (ThreadId > 0)
+                        pCtx->Begin(0);
+                    PrepareContext(pCtx, ThreadId);
+                    State.ContextReady = true;
+                    State.NumDrawCalls = RenderSubset(pCtx, ThreadId, StartInst, EndInst);
+                    if (ThreadId > 0)
+                    {
+                        DILIGENT_PROFILE_SCOPE("FinishCommandList");
+                        pCtx->FinishCommandList(&m_CmdLists[ThreadId - 1]);
+                    }
+                });
+        }
 
-    if (!m_WorkerThreads.empty())
-    {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
+        m_NumDrawCalls = 0;
+        for (const auto& State : m_ThreadState)
+            m_NumDrawCalls += State.NumDrawCalls;
 
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
+        m_CmdListPtrs.clear();
+        for (auto& cmdList : m_CmdLists)
+        {
+            if (cmdList)
+                m_CmdListPtrs.push_back(cmdList);
+        }
 
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+        {
+            DILIGENT_PROFILE_GPU_SCOPE("ExecuteCommandLists", m_pImmediateContext);
+            m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+        }
 
         for (auto& cmdList : m_CmdLists)
         {
@@ -378,9 +536,22 @@ void Tutorial06_Multithreading::Render()
             // that cause swap chain resize to fail.
             cmdList.Release();
         }
+    }
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+    const auto RecordTime = std::chrono::duration<double, std::milli>{std::chrono::high_resolution_clock::now() - RecordStart}.count();
+    m_RecordTime          = m_RecordTime * 0.95 + RecordTime * 0.05;
+
+    if (m_pScheduler)
+    {
+        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+        // IMPORTANT: we must wait until the command lists are submitted for execution
+        //            because FinishFrame() invalidates all dynamic resources.
+        // IMPORTANT: In Metal backend FinishFrame must be called from the same
+        //            thread that issued rendering commands.
+        m_pScheduler->RunOnEachThread([this](Uint32 ThreadId) {
+            if (ThreadId > 0)
+                m_pDeferredContexts[ThreadId - 1]->FinishFrame();
+        });
     }
 }
 
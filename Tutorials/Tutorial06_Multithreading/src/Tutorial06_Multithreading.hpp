@@ -27,13 +27,11 @@
 
 #pragma once
 
-#include <atomic>
 #include <vector>
-#include <thread>
-#include <mutex>
+#include <memory>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -55,33 +53,69 @@ private:
     void LoadTextures(std::vector<StateTransitionDesc>& Barriers);
     void UpdateUI();
     void PopulateInstanceData();
+    void CreateInstanceBuffers();
 
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
 
-    void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
+    void PrepareContext(IDeviceContext* pCtx, Uint32 ThreadId);
+    // Returns the number of draw calls
+    Uint32 RenderSubset(IDeviceContext* pCtx, Uint32 ThreadId, Uint32 StartInst, Uint32 EndInst);
 
-    static void WorkerThreadFunc(Tutorial06_Multithreading* pThis, Uint32 ThreadNum);
+    IDeviceContext* GetThreadContext(Uint32 ThreadId);
 
-    ThreadingTools::Signal   m_RenderSubsetSignal;
-    ThreadingTools::Signal   m_ExecuteCommandListsSignal;
-    ThreadingTools::Signal   m_GotoNextFrameSignal;
-    std::atomic_int          m_NumThreadsCompleted;
-    std::atomic_int          m_NumThreadsReady;
-    std::vector<std::thread> m_WorkerThreads;
+    enum RENDER_MODE : int
+    {
+        // Map the instance constant buffer before every draw call
+        RENDER_MODE_CONSTANT_BUFFER = 0,
+
+        // Every context writes the instance matrices of its subset into its own instance buffer
+        // with a single map, then issues one draw call per cube using the base instance offset
+        RENDER_MODE_BASE_INSTANCE,
+
+        // Same as above, but draw all consecutive cubes with the same texture with a single instanced draw call
+        RENDER_MODE_INSTANCED
+    };
+    int m_RenderMode = RENDER_MODE_CONSTANT_BUFFER;
+
+    // Instance buffer modes need the base instance in draw commands
+    bool m_BaseInstanceSupported = false;
+
+    // In constant buffer mode, worker threads pick instance chunks dynamically and steal them
+    // from each other, so that all threads finish at approximately the same time.
+    std::unique_ptr<TaskScheduler> m_pScheduler;
+
+    static constexpr Uint32 InstancesPerTask = 64;
+
+    // Every element is only accessed by its own thread
+    struct ThreadState
+    {
+        // Indicates if the thread's context has been prepared for recording in the current frame
+        bool   ContextReady = false;
+        Uint32 NumDrawCalls = 0;
+    };
+    std::vector<ThreadState> m_ThreadState;
+
+    Uint32 m_NumDrawCalls = 0;
+    double m_RecordTime   = 0; // Smoothed command recording time, in milliseconds
 
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
     RefCntAutoPtr<IPipelineState> m_pPSO;
+    RefCntAutoPtr<IPipelineState> m_pInstancedPSO;
     RefCntAutoPtr<IBuffer>        m_CubeVertexBuffer;
     RefCntAutoPtr<IBuffer>        m_CubeIndexBuffer;
     RefCntAutoPtr<IBuffer>        m_InstanceConstants;
     RefCntAutoPtr<IBuffer>        m_VSConstants;
 
+    // Dynamic instance buffers, one per context, indexed by thread id
+    std::vector<RefCntAutoPtr<IBuffer>> m_InstanceBuffers;
+
     static constexpr int NumTextures = 4;
 
     RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
+    RefCntAutoPtr<IShaderResourceBinding> m_InstancedSRB[NumTextures];
     RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
 
     float4x4 m_ViewProjMatrix;
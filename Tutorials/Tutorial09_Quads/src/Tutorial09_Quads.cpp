@@ -31,6 +31,8 @@
 #include <algorithm>
 #include <limits>
 #include <cstdlib>
+#include <thread>
+#include <chrono>
 
 #include "Tutorial09_Quads.hpp"
 #include "MapHelper.hpp"
@@ -343,6 +345,8 @@ void Tutorial09_Quads::UpdateUI()
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
+        ImGui::Combo("Update mode", &m_UpdateMode, "Scalar\0SIMD\0\0");
+        ImGui::Text("Update time: %.2f ms", m_UpdateTime);
     }
     ImGui::End();
 }
@@ -352,7 +356,8 @@ void Tutorial09_Quads::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
 
-    m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
+    // The main thread records commands into a deferred context too
+    m_MaxThreads       = std::max(static_cast<int>(m_pDeferredContexts.size()) - 1, 0);
     m_NumWorkerThreads = std::min(m_NumWorkerThreads, m_MaxThreads);
 
     std::vector<StateTransitionDesc> Barriers;
@@ -371,6 +376,7 @@ void Tutorial09_Quads::Initialize(const SampleInitInfo& InitInfo)
 void Tutorial09_Quads::InitializeQuads()
 {
     m_Quads.resize(m_NumQuads);
+    m_Simulation.Resize(static_cast<Uint32>(m_NumQuads));
 
     std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
                       // to generate consistent distribution.
@@ -387,12 +393,13 @@ void Tutorial09_Quads::InitializeQuads()
     {
         auto& CurrInst     = m_Quads[quad];
         CurrInst.Size      = scale_distr(gen);
-        CurrInst.Angle     = angle_distr(gen);
-        CurrInst.Pos.x     = pos_distr(gen);
-        CurrInst.Pos.y     = pos_distr(gen);
-        CurrInst.MoveDir.x = move_dir_distr(gen);
-        CurrInst.MoveDir.y = move_dir_distr(gen);
-        CurrInst.RotSpeed  = rot_distr(gen);
+        const auto Angle    = angle_distr(gen);
+        const auto PosX     = pos_distr(gen);
+        const auto PosY     = pos_distr(gen);
+        const auto DirX     = move_dir_distr(gen);
+        const auto DirY     = move_dir_distr(gen);
+        const auto RotSpeed = rot_distr(gen);
+        m_Simulation.SetSprite(static_cast<Uint32>(quad), float2{PosX, PosY}, float2{DirX, DirY}, Angle, RotSpeed);
         // Texture array index
         CurrInst.TextureInd = tex_distr(gen);
         CurrInst.StateInd   = state_distr(gen);
@@ -401,108 +408,28 @@ void Tutorial09_Quads::InitializeQuads()
 
 void Tutorial09_Quads::UpdateQuads(float elapsedTime)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    const auto UpdateStart = std::chrono::high_resolution_clock::now();
 
-    std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int quad = 0; quad < m_NumQuads; ++quad)
-    {
-        auto& CurrInst = m_Quads[quad];
-        CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
-        if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.x *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.x += CurrInst.MoveDir.x * elapsedTime;
-        if (std::abs(CurrInst.Pos.y + CurrInst.MoveDir.y * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.y *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.y += CurrInst.MoveDir.y * elapsedTime;
-    }
+    m_Simulation.Update(elapsedTime, static_cast<SpriteSimulation::UPDATE_MODE>(m_UpdateMode), m_pScheduler.get());
+
+    const auto UpdateTime = std::chrono::duration<double, std::milli>{std::chrono::high_resolution_clock::now() - UpdateStart}.count();
+    m_UpdateTime          = m_UpdateTime * 0.95 + UpdateTime * 0.05;
 }
 
 void Tutorial09_Quads::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
-    {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
-    }
-    m_CmdLists.resize(NumThreads);
+    if (NumThreads > 0)
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
 }
 
 void Tutorial09_Quads::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
-
-    for (auto& thread : m_WorkerThreads)
-    {
-        thread.join();
-    }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
+    m_pScheduler.reset();
     m_CmdLists.clear();
 }
 
-void Tutorial09_Quads::WorkerThreadFunc(Tutorial09_Quads* pThis, Uint32 ThreadNum)
-{
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx = pThis->m_pDeferredContexts[ThreadNum];
-
-    const int NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    VERIFY_EXPR(NumWorkerThreads > 0);
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        if (pThis->m_BatchSize > 1)
-            pThis->RenderSubset<true>(pDeferredCtx, 1 + ThreadNum);
-        else
-            pThis->RenderSubset<false>(pDeferredCtx, 1 + ThreadNum);
-
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
-
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
-
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread go through the loop twice in
-        // a row
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
-}
-
 template <bool UseBatch>
-void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
+void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 StartBatch, Uint32 EndBatch)
 {
     // Deferred contexts start in default state. We must bind everything to the context
     // Render targets are set and transitioned to correct states by the main thread, here we only verify states
@@ -518,12 +445,6 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     DrawAttrs.Flags       = DRAW_FLAG_VERIFY_ALL;
     DrawAttrs.NumVertices = 4;
 
-    Uint32       NumSubsets   = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalQuads   = static_cast<Uint32>(m_Quads.size());
-    const Uint32 TotalBatches = (TotalQuads + m_BatchSize - 1) / m_BatchSize;
-    const Uint32 SusbsetSize  = TotalBatches / NumSubsets;
-    const Uint32 StartBatch   = SusbsetSize * Subset;
-    const Uint32 EndBatch     = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
     for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
     {
         const Uint32 StartInst = batch * m_BatchSize;
@@ -559,8 +480,10 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                     0.f,               CurrInstData.Size
                 };
                 // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
+                const auto Pos      = m_Simulation.GetPos(inst);
+                const auto Angle    = m_Simulation.GetAngle(inst);
+                float      sinAngle = sinf(Angle);
+                float      cosAngle = cosf(Angle);
                 float2x2 RotMatr(cosAngle, -sinAngle,
                                  sinAngle, cosAngle);
                 auto     Matr = ScaleMatr * RotMatr;
@@ -571,7 +494,7 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                 {
                     auto& CurrQuad                = BatchData[inst - StartInst];
                     CurrQuad.QuadRotationAndScale = QuadRotationAndScale;
-                    CurrQuad.QuadCenter           = CurrInstData.Pos;
+                    CurrQuad.QuadCenter           = Pos;
                     CurrQuad.TexArrInd            = static_cast<float>(CurrInstData.TextureInd);
                 }
                 else
@@ -586,8 +509,8 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                     MapHelper<QuadAttribs> InstData(pCtx, m_QuadAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
 
                     InstData->g_QuadRotationAndScale = QuadRotationAndScale;
-                    InstData->g_QuadCenter.x         = CurrInstData.Pos.x;
-                    InstData->g_QuadCenter.y         = CurrInstData.Pos.y;
+                    InstData->g_QuadCenter.x         = Pos.x;
+                    InstData->g_QuadCenter.y         = Pos.y;
                 }
             }
         }
@@ -610,38 +533,57 @@ void Tutorial09_Quads::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    if (!m_WorkerThreads.empty())
+    const Uint32 TotalQuads   = static_cast<Uint32>(m_Quads.size());
+    const Uint32 TotalBatches = (TotalQuads + m_BatchSize - 1) / m_BatchSize;
+    if (!m_pScheduler)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        if (m_BatchSize > 1)
+            RenderSubset<true>(m_pImmediateContext, 0, TotalBatches);
+        else
+            RenderSubset<false>(m_pImmediateContext, 0, TotalBatches);
+        return;
     }
 
-    if (m_BatchSize > 1)
-        RenderSubset<true>(m_pImmediateContext, 0);
-    else
-        RenderSubset<false>(m_pImmediateContext, 0);
+    // Use several tasks per thread so that idle threads have something to steal
+    const Uint32 NumTasks = std::min(TotalBatches, m_pScheduler->GetNumThreads() * TasksPerThread);
+    m_CmdLists.resize(NumTasks);
+    m_pScheduler->ParallelFor(NumTasks, [&](Uint32 ThreadId, Uint32 TaskId) {
+        // Every thread uses its own deferred context
+        IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId];
 
-    if (!m_WorkerThreads.empty())
-    {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
+        const Uint32 StartBatch = static_cast<Uint32>(Uint64{TotalBatches} * TaskId / NumTasks);
+        const Uint32 EndBatch   = static_cast<Uint32>(Uint64{TotalBatches} * (TaskId + 1) / NumTasks);
 
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
+        pDeferredCtx->Begin(0);
+        if (m_BatchSize > 1)
+            RenderSubset<true>(pDeferredCtx, StartBatch, EndBatch);
+        else
+            RenderSubset<false>(pDeferredCtx, StartBatch, EndBatch);
+        pDeferredCtx->FinishCommandList(&m_CmdLists[TaskId]);
+    });
 
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+    m_CmdListPtrs.resize(m_CmdLists.size());
+    for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
+        m_CmdListPtrs[i] = m_CmdLists[i];
 
-        for (auto& cmdList : m_CmdLists)
-        {
-            // Release command lists now to release all outstanding references
-            // In d3d11 mode, command lists hold references to the swap chain's back buffer
-            // that cause swap chain resize to fail
-            cmdList.Release();
-        }
+    m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+    for (auto& cmdList : m_CmdLists)
+    {
+        // Release command lists now to release all outstanding references
+        // In d3d11 mode, command lists hold references to the swap chain's back buffer
+        // that cause swap chain resize to fail
+        cmdList.Release();
     }
+
+    // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+    // IMPORTANT: we must wait until the command lists are submitted for execution
+    //            because FinishFrame() invalidates all dynamic resources.
+    // IMPORTANT: In Metal backend FinishFrame must be called from the same
+    //            thread that issued rendering commands.
+    m_pScheduler->RunOnEachThread([this](Uint32 ThreadId) {
+        m_pDeferredContexts[ThreadId]->FinishFrame();
+    });
 }
 
 void Tutorial09_Quads::CreateInstanceBuffer()
@@ -27,13 +27,12 @@
 
 #pragma once
 
-#include <atomic>
 #include <vector>
-#include <thread>
-#include <mutex>
+#include <memory>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
+#include "../../Common/src/SpriteSimulation.hpp"
 
 namespace Diligent
 {
@@ -63,18 +62,14 @@ private:
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
     template <bool UseBatch>
-    void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
+    void RenderSubset(IDeviceContext* pCtx, Uint32 StartBatch, Uint32 EndBatch);
 
-    static void WorkerThreadFunc(Tutorial09_Quads* pThis, Uint32 ThreadNum);
+    // Quads are blended, so the draw order must be preserved. Every task records its
+    // own command list, and the command lists are executed in the task order.
+    std::unique_ptr<TaskScheduler> m_pScheduler;
 
-    ThreadingTools::Signal m_RenderSubsetSignal;
-    ThreadingTools::Signal m_ExecuteCommandListsSignal;
-    ThreadingTools::Signal m_GotoNextFrameSignal;
+    static constexpr Uint32 TasksPerThread = 4;
 
-    std::atomic_int m_NumThreadsCompleted;
-    std::atomic_int m_NumThreadsReady;
-
-    std::vector<std::thread>                 m_WorkerThreads;
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
@@ -100,16 +95,17 @@ private:
 
     struct QuadData
     {
-        float2 Pos;
-        float2 MoveDir;
         float  Size;
-        float  Angle;
-        float  RotSpeed;
         int    TextureInd;
         int    StateInd;
     };
     std::vector<QuadData> m_Quads;
 
+    // Positions and rotation angles are updated by the simulation that keeps them in a structure of arrays
+    SpriteSimulation m_Simulation;
+    int              m_UpdateMode = SpriteSimulation::UPDATE_MODE_SIMD;
+    double           m_UpdateTime = 0; // Smoothed simulation update time, in milliseconds
+
     struct InstanceData
     {
         float4 QuadRotationAndScale;
@@ -31,9 +31,14 @@
 #include <algorithm>
 #include <limits>
 #include <cstdlib>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <deque>
 
 #include "Tutorial10_DataStreaming.hpp"
 #include "MapHelper.hpp"
+#include "Align.hpp"
 #include "GraphicsUtilities.h"
 #include "TextureUtilities.h"
 #include "imgui.h"
@@ -122,6 +127,138 @@ private:
     std::vector<MapInfo> m_MapInfo;
 };
 
+// Ring buffer in unified memory that is shared by all contexts. The buffer is persistently mapped,
+// and any thread may allocate space from it without locking by advancing the head with CAS.
+// Allocations are tracked with a monotonically increasing offset, so that wraparound is handled naturally.
+// The space is reclaimed at the beginning of every frame once the GPU has signaled the fence value of the frame that used it.
+class StreamingRingBuffer
+{
+public:
+    static constexpr Uint32 InvalidOffset = ~Uint32{0};
+
+    StreamingRingBuffer(IRenderDevice* pDevice, IDeviceContext* pCtx, BIND_FLAGS BindFlags, Uint32 Size, const Char* Name) :
+        m_BufferSize{Size}
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name           = Name;
+        BuffDesc.Usage          = USAGE_UNIFIED;
+        BuffDesc.BindFlags      = BindFlags;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        BuffDesc.Size           = Size;
+        pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
+        if (!m_pBuffer)
+            LOG_ERROR_AND_THROW("Failed to create streaming ring buffer '", Name, "'");
+
+        // Unified buffers stay mapped for their entire lifetime
+        m_MappedData.Map(pCtx, m_pBuffer, MAP_WRITE, MAP_FLAG_NO_OVERWRITE);
+        if (m_MappedData == nullptr)
+            LOG_ERROR_AND_THROW("Failed to map streaming ring buffer '", Name, "'");
+    }
+
+    // Returns offset of the allocated region or InvalidOffset if there is not enough free space.
+    // This method is thread-safe.
+    Uint32 Allocate(Uint32 Size)
+    {
+        Size = AlignUp(Size, Alignment);
+
+        auto Head = m_Head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto Start = Head;
+            // Allocations never cross the end of the buffer. If the region does not fit, skip
+            // the remaining space and wrap around to the beginning of the buffer.
+            if (Start % m_BufferSize + Size > m_BufferSize)
+                Start = AlignUp(Start + 1, Uint64{m_BufferSize});
+
+            const auto End = Start + Size;
+            // The tail is only modified by BeginFrame() while no other thread allocates
+            if (End - m_Tail > m_BufferSize)
+            {
+                m_NumFailedAllocations.fetch_add(1, std::memory_order_relaxed);
+                return InvalidOffset;
+            }
+
+            if (m_Head.compare_exchange_weak(Head, End, std::memory_order_relaxed))
+                return static_cast<Uint32>(Start % m_BufferSize);
+        }
+    }
+
+    void* GetCPUAddress(Uint32 Offset)
+    {
+        return static_cast<Uint8*>(m_MappedData) + Offset;
+    }
+
+    // Must be called before any allocation in the frame
+    void BeginFrame(IDeviceContext* pCtx, IFence* pFence)
+    {
+        // Release the space used by the frames that the GPU has completed
+        const auto CompletedValue = pFence->GetCompletedValue();
+        while (!m_InFlightFrames.empty() && m_InFlightFrames.front().FenceValue <= CompletedValue)
+        {
+            m_Tail = m_InFlightFrames.front().Head;
+            m_InFlightFrames.pop_front();
+        }
+
+        // If the new frame is not expected to fit into the free space, wait for the GPU
+        // rather than forcing the allocations to fail.
+        if (!m_InFlightFrames.empty() && m_BufferSize - (m_Head.load() - m_Tail) < m_LastFrameSize)
+        {
+            // Make sure the fence signal has been submitted to the GPU
+            pCtx->Flush();
+            do
+            {
+                pFence->Wait(m_InFlightFrames.front().FenceValue);
+                m_Tail = m_InFlightFrames.front().Head;
+                m_InFlightFrames.pop_front();
+            } while (!m_InFlightFrames.empty() && m_BufferSize - (m_Head.load() - m_Tail) < m_LastFrameSize);
+        }
+
+        m_FrameStart = m_Head.load();
+    }
+
+    // Must be called after all command lists of the frame have been submitted and the
+    // signal of the FenceValue has been enqueued.
+    void EndFrame(Uint64 FenceValue)
+    {
+        const auto Head = m_Head.load();
+        m_InFlightFrames.push_back({FenceValue, Head});
+        m_LastFrameSize = Head - m_FrameStart;
+        m_HighWaterMark = std::max(m_HighWaterMark, Head - m_Tail);
+    }
+
+    IBuffer* GetBuffer() { return m_pBuffer; }
+    Uint32   GetSize() const { return m_BufferSize; }
+
+    // The maximum amount of memory that has been in use at the same time
+    Uint64 GetHighWaterMark() const { return m_HighWaterMark; }
+
+    Uint32 GetNumFailedAllocations() const { return m_NumFailedAllocations.load(); }
+
+private:
+    // Vertex and index buffer offsets must be properly aligned
+    static constexpr Uint32 Alignment = 16;
+
+    RefCntAutoPtr<IBuffer> m_pBuffer;
+    MapHelper<Uint8>       m_MappedData;
+    const Uint32           m_BufferSize;
+
+    std::atomic<Uint64> m_Head{0};
+    Uint64              m_Tail = 0;
+
+    struct FrameInfo
+    {
+        Uint64 FenceValue;
+        Uint64 Head;
+    };
+    std::deque<FrameInfo> m_InFlightFrames;
+
+    Uint64 m_FrameStart    = 0;
+    Uint64 m_LastFrameSize = 0;
+    Uint64 m_HighWaterMark = 0;
+
+    std::atomic<Uint32> m_NumFailedAllocations{0};
+};
+
 SampleBase* CreateSample()
 {
     return new Tutorial10_DataStreaming();
@@ -432,11 +569,23 @@ void Tutorial10_DataStreaming::UpdateUI()
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
+        ImGui::Combo("Update mode", &m_UpdateMode, "Scalar\0SIMD\0\0");
+        ImGui::Text("Update time: %.2f ms", m_UpdateTime);
         if (m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_D3D12 ||
             m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_VULKAN)
         {
             ImGui::Checkbox("Persistent map", &m_bAllowPersistentMap);
         }
+        if (m_StreamingRingVB)
+        {
+            ImGui::Checkbox("Shared ring buffer", &m_bUseRingBuffer);
+            if (m_bUseRingBuffer)
+            {
+                ImGui::Text("Ring VB high-water mark: %.1f / %.1f MB", static_cast<double>(m_StreamingRingVB->GetHighWaterMark()) / (1 << 20), static_cast<double>(m_StreamingRingVB->GetSize()) / (1 << 20));
+                ImGui::Text("Ring IB high-water mark: %.1f / %.1f MB", static_cast<double>(m_StreamingRingIB->GetHighWaterMark()) / (1 << 20), static_cast<double>(m_StreamingRingIB->GetSize()) / (1 << 20));
+                ImGui::Text("Failed ring allocations: %u", m_StreamingRingVB->GetNumFailedAllocations() + m_StreamingRingIB->GetNumFailedAllocations());
+            }
+        }
     }
     ImGui::End();
 }
@@ -446,7 +595,8 @@ void Tutorial10_DataStreaming::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
 
-    m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
+    // The main thread records commands into a deferred context too
+    m_MaxThreads       = std::max(static_cast<int>(m_pDeferredContexts.size()) - 1, 0);
     m_NumWorkerThreads = std::min(m_NumWorkerThreads, m_MaxThreads);
 
     std::vector<StateTransitionDesc> Barriers;
@@ -460,6 +610,23 @@ void Tutorial10_DataStreaming::Initialize(const SampleInitInfo& InitInfo)
     Barriers.emplace_back(m_StreamingVB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     Barriers.emplace_back(m_StreamingIB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
 
+    // Shared ring buffers require memory that is visible to both CPU and GPU
+    const auto DevType = m_pDevice->GetDeviceInfo().Type;
+    if ((DevType == RENDER_DEVICE_TYPE_D3D12 || DevType == RENDER_DEVICE_TYPE_VULKAN) &&
+        (m_pDevice->GetAdapterInfo().Memory.UnifiedMemoryCPUAccess & CPU_ACCESS_WRITE) != 0)
+    {
+        m_StreamingRingVB.reset(new StreamingRingBuffer(m_pDevice, m_pImmediateContext, BIND_VERTEX_BUFFER, StreamingRingBufferSize, "Streaming ring vertex buffer"));
+        m_StreamingRingIB.reset(new StreamingRingBuffer(m_pDevice, m_pImmediateContext, BIND_INDEX_BUFFER, StreamingRingBufferSize, "Streaming ring index buffer"));
+        Barriers.emplace_back(m_StreamingRingVB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        Barriers.emplace_back(m_StreamingRingIB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+
+        FenceDesc FenceCI;
+        FenceCI.Name = "Streaming ring buffer fence";
+        m_pDevice->CreateFence(FenceCI, &m_pFrameCompleteFence);
+
+        m_bUseRingBuffer = true;
+    }
+
     InitializePolygonGeometry();
     InitializePolygons();
 
@@ -498,6 +665,7 @@ void Tutorial10_DataStreaming::InitializePolygonGeometry()
 void Tutorial10_DataStreaming::InitializePolygons()
 {
     m_Polygons.resize(m_NumPolygons);
+    m_Simulation.Resize(static_cast<Uint32>(m_NumPolygons));
 
     std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
                       // to generate consistent distribution.
@@ -515,12 +683,13 @@ void Tutorial10_DataStreaming::InitializePolygons()
     {
         auto& CurrInst     = m_Polygons[Polygon];
         CurrInst.Size      = scale_distr(gen);
-        CurrInst.Angle     = angle_distr(gen);
-        CurrInst.Pos.x     = pos_distr(gen);
-        CurrInst.Pos.y     = pos_distr(gen);
-        CurrInst.MoveDir.x = move_dir_distr(gen);
-        CurrInst.MoveDir.y = move_dir_distr(gen);
-        CurrInst.RotSpeed  = rot_distr(gen);
+        const auto Angle    = angle_distr(gen);
+        const auto PosX     = pos_distr(gen);
+        const auto PosY     = pos_distr(gen);
+        const auto DirX     = move_dir_distr(gen);
+        const auto DirY     = move_dir_distr(gen);
+        const auto RotSpeed = rot_distr(gen);
+        m_Simulation.SetSprite(static_cast<Uint32>(Polygon), float2{PosX, PosY}, float2{DirX, DirY}, Angle, RotSpeed);
         // Texture array index
         CurrInst.TextureInd = tex_distr(gen);
         CurrInst.StateInd   = state_distr(gen);
@@ -528,125 +697,63 @@ void Tutorial10_DataStreaming::InitializePolygons()
     }
 }
 
-std::pair<Diligent::Uint32, Diligent::Uint32> Tutorial10_DataStreaming::WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum)
+Tutorial10_DataStreaming::PolygonAllocation Tutorial10_DataStreaming::WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum)
 {
+    const auto VBSize = static_cast<Uint32>(PolygonGeo.Verts.size() * sizeof(float2));
+    const auto IBSize = static_cast<Uint32>(PolygonGeo.Inds.size() * sizeof(Uint32));
+
+    if (m_bUseRingBuffer)
+    {
+        // Request memory for vertices and indices from the shared ring buffers
+        const auto VBOffset = m_StreamingRingVB->Allocate(VBSize);
+        const auto IBOffset = VBOffset != StreamingRingBuffer::InvalidOffset ? m_StreamingRingIB->Allocate(IBSize) : StreamingRingBuffer::InvalidOffset;
+        if (IBOffset != StreamingRingBuffer::InvalidOffset)
+        {
+            memcpy(m_StreamingRingVB->GetCPUAddress(VBOffset), PolygonGeo.Verts.data(), VBSize);
+            memcpy(m_StreamingRingIB->GetCPUAddress(IBOffset), PolygonGeo.Inds.data(), IBSize);
+            return {m_StreamingRingVB->GetBuffer(), VBOffset, m_StreamingRingIB->GetBuffer(), IBOffset};
+        }
+        // The frame needs more space than the ring buffers have. Use per-context buffers for the remaining polygons.
+    }
+
     // Request memory for vertices and indices
-    auto  VBOffset   = m_StreamingVB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Verts.size()) * sizeof(float2), CtxNum);
-    auto  IBOffset   = m_StreamingIB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Inds.size()) * sizeof(Uint32), CtxNum);
+    auto  VBOffset   = m_StreamingVB->Allocate(pCtx, VBSize, CtxNum);
+    auto  IBOffset   = m_StreamingIB->Allocate(pCtx, IBSize, CtxNum);
     auto* VertexData = reinterpret_cast<float2*>(reinterpret_cast<Uint8*>(m_StreamingVB->GetMappedCPUAddress(CtxNum)) + VBOffset);
     auto* IndexData  = reinterpret_cast<Uint32*>(reinterpret_cast<Uint8*>(m_StreamingIB->GetMappedCPUAddress(CtxNum)) + IBOffset);
-    memcpy(VertexData, PolygonGeo.Verts.data(), PolygonGeo.Verts.size() * sizeof(float2));
-    memcpy(IndexData, PolygonGeo.Inds.data(), PolygonGeo.Inds.size() * sizeof(Uint32));
+    memcpy(VertexData, PolygonGeo.Verts.data(), VBSize);
+    memcpy(IndexData, PolygonGeo.Inds.data(), IBSize);
 
     m_StreamingVB->Release(CtxNum);
     m_StreamingIB->Release(CtxNum);
 
-    return {VBOffset, IBOffset};
+    return {m_StreamingVB->GetBuffer(), VBOffset, m_StreamingIB->GetBuffer(), IBOffset};
 }
 
 void Tutorial10_DataStreaming::UpdatePolygons(float elapsedTime)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    const auto UpdateStart = std::chrono::high_resolution_clock::now();
 
-    std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
-    {
-        auto& CurrInst = m_Polygons[Polygon];
-        CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
-        if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.x *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.x += CurrInst.MoveDir.x * elapsedTime;
-        if (std::abs(CurrInst.Pos.y + CurrInst.MoveDir.y * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.y *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.y += CurrInst.MoveDir.y * elapsedTime;
-    }
+    m_Simulation.Update(elapsedTime, static_cast<SpriteSimulation::UPDATE_MODE>(m_UpdateMode), m_pScheduler.get());
+
+    const auto UpdateTime = std::chrono::duration<double, std::milli>{std::chrono::high_resolution_clock::now() - UpdateStart}.count();
+    m_UpdateTime          = m_UpdateTime * 0.95 + UpdateTime * 0.05;
 }
 
 void Tutorial10_DataStreaming::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
-    {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
-    }
-    m_CmdLists.resize(NumThreads);
+    if (NumThreads > 0)
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumThreads)});
 }
 
 void Tutorial10_DataStreaming::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
-
-    for (auto& thread : m_WorkerThreads)
-    {
-        thread.join();
-    }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
+    m_pScheduler.reset();
     m_CmdLists.clear();
 }
 
-void Tutorial10_DataStreaming::WorkerThreadFunc(Tutorial10_DataStreaming* pThis, Uint32 ThreadNum)
-{
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx     = pThis->m_pDeferredContexts[ThreadNum];
-    const int       NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    VERIFY_EXPR(NumWorkerThreads > 0);
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        if (pThis->m_BatchSize > 1)
-            pThis->RenderSubset<true>(pDeferredCtx, 1 + ThreadNum);
-        else
-            pThis->RenderSubset<false>(pDeferredCtx, 1 + ThreadNum);
-
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
-
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
-
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread go through the loop twice in
-        // a row
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
-}
-
 template <bool UseBatch>
-void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
+void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, size_t CtxNum, Uint32 StartBatch, Uint32 EndBatch)
 {
     // Deferred contexts start in default state. We must bind everything to the context
     // Render targets are set and transitioned to correct states by the main thread, here we only verify states
@@ -657,12 +764,6 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     DrawAttrs.IndexType = VT_UINT32;
     DrawAttrs.Flags     = DRAW_FLAG_VERIFY_ALL;
 
-    Uint32       NumSubsets    = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.size());
-    const Uint32 TotalBatches  = (TotalPolygons + m_BatchSize - 1) / m_BatchSize;
-    const Uint32 SusbsetSize   = TotalBatches / NumSubsets;
-    const Uint32 StartBatch    = SusbsetSize * Subset;
-    const Uint32 EndBatch      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
     for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
     {
         const Uint32 StartInst = batch * m_BatchSize;
@@ -673,12 +774,12 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
         pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
 
         const auto&  PolygonGeo = m_PolygonGeo[m_Polygons[StartInst].NumVerts];
-        auto         Offsets    = WritePolygon(PolygonGeo, pCtx, Subset);
-        const Uint64 offsets[]  = {Offsets.first, 0};
-        IBuffer*     pBuffs[]   = {m_StreamingVB->GetBuffer(), m_BatchDataBuffer};
+        const auto   Allocation = WritePolygon(PolygonGeo, pCtx, CtxNum);
+        const Uint64 offsets[]  = {Allocation.VBOffset, 0};
+        IBuffer*     pBuffs[]   = {Allocation.pVB, m_BatchDataBuffer};
         pCtx->SetVertexBuffers(0, UseBatch ? 2 : 1, pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
 
-        pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), Offsets.second, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        pCtx->SetIndexBuffer(Allocation.pIB, Allocation.IBOffset, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
         MapHelper<InstanceData> BatchData;
         if (UseBatch)
@@ -706,8 +807,10 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                     0.f,               CurrInstData.Size
                 };
                 // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
+                const auto Pos      = m_Simulation.GetPos(inst);
+                const auto Angle    = m_Simulation.GetAngle(inst);
+                float      sinAngle = sinf(Angle);
+                float      cosAngle = cosf(Angle);
                 float2x2 RotMatr(cosAngle, -sinAngle,
                                  sinAngle, cosAngle);
 
@@ -719,7 +822,7 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                 {
                     auto& CurrPolygon                   = BatchData[inst - StartInst];
                     CurrPolygon.PolygonRotationAndScale = PolygonRotationAndScale;
-                    CurrPolygon.PolygonCenter           = CurrInstData.Pos;
+                    CurrPolygon.PolygonCenter           = Pos;
                     CurrPolygon.TexArrInd               = static_cast<float>(CurrInstData.TextureInd);
                 }
                 else
@@ -734,8 +837,8 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                     MapHelper<PolygonAttribs> InstData(pCtx, m_PolygonAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
 
                     InstData->g_PolygonRotationAndScale = PolygonRotationAndScale;
-                    InstData->g_PolygonCenter.x         = CurrInstData.Pos.x;
-                    InstData->g_PolygonCenter.y         = CurrInstData.Pos.y;
+                    InstData->g_PolygonCenter.x         = Pos.x;
+                    InstData->g_PolygonCenter.y         = Pos.y;
                 }
             }
         }
@@ -748,8 +851,8 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
         pCtx->DrawIndexed(DrawAttrs);
     }
 
-    m_StreamingVB->Flush(Subset);
-    m_StreamingIB->Flush(Subset);
+    m_StreamingVB->Flush(CtxNum);
+    m_StreamingIB->Flush(CtxNum);
 }
 
 // Render a frame
@@ -765,38 +868,78 @@ void Tutorial10_DataStreaming::Render()
     m_StreamingIB->AllowPersistentMapping(m_bAllowPersistentMap);
     m_StreamingVB->AllowPersistentMapping(m_bAllowPersistentMap);
 
-    if (!m_WorkerThreads.empty())
+    if (m_bUseRingBuffer)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        m_StreamingRingVB->BeginFrame(m_pImmediateContext, m_pFrameCompleteFence);
+        m_StreamingRingIB->BeginFrame(m_pImmediateContext, m_pFrameCompleteFence);
     }
 
-    if (m_BatchSize > 1)
-        RenderSubset<true>(m_pImmediateContext, 0);
-    else
-        RenderSubset<false>(m_pImmediateContext, 0);
-
-    if (!m_WorkerThreads.empty())
+    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.size());
+    const Uint32 TotalBatches  = (TotalPolygons + m_BatchSize - 1) / m_BatchSize;
+    if (!m_pScheduler)
     {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
+        if (m_BatchSize > 1)
+            RenderSubset<true>(m_pImmediateContext, 0, 0, TotalBatches);
+        else
+            RenderSubset<false>(m_pImmediateContext, 0, 0, TotalBatches);
+        EndStreamingRingFrame();
+        return;
+    }
 
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
+    // Use several tasks per thread so that idle threads have something to steal
+    const Uint32 NumTasks = std::min(TotalBatches, m_pScheduler->GetNumThreads() * TasksPerThread);
+    m_CmdLists.resize(NumTasks);
+    m_pScheduler->ParallelFor(NumTasks, [&](Uint32 ThreadId, Uint32 TaskId) {
+        // Every thread uses its own deferred context. Streaming buffer context 0 is
+        // reserved for the immediate context.
+        IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId];
 
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+        const Uint32 StartBatch = static_cast<Uint32>(Uint64{TotalBatches} * TaskId / NumTasks);
+        const Uint32 EndBatch   = static_cast<Uint32>(Uint64{TotalBatches} * (TaskId + 1) / NumTasks);
 
-        for (auto& cmdList : m_CmdLists)
-        {
-            // Release command lists now to release all outstanding references
-            // In d3d11 mode, command lists hold references to the swap chain's back buffer
-            // that cause swap chain resize to fail
-            cmdList.Release();
-        }
+        pDeferredCtx->Begin(0);
+        if (m_BatchSize > 1)
+            RenderSubset<true>(pDeferredCtx, 1 + ThreadId, StartBatch, EndBatch);
+        else
+            RenderSubset<false>(pDeferredCtx, 1 + ThreadId, StartBatch, EndBatch);
+        pDeferredCtx->FinishCommandList(&m_CmdLists[TaskId]);
+    });
+
+    m_CmdListPtrs.resize(m_CmdLists.size());
+    for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
+        m_CmdListPtrs[i] = m_CmdLists[i];
+
+    m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+    for (auto& cmdList : m_CmdLists)
+    {
+        // Release command lists now to release all outstanding references
+        // In d3d11 mode, command lists hold references to the swap chain's back buffer
+        // that cause swap chain resize to fail
+        cmdList.Release();
     }
+
+    // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+    // IMPORTANT: we must wait until the command lists are submitted for execution
+    //            because FinishFrame() invalidates all dynamic resources.
+    // IMPORTANT: In Metal backend FinishFrame must be called from the same
+    //            thread that issued rendering commands.
+    m_pScheduler->RunOnEachThread([this](Uint32 ThreadId) {
+        m_pDeferredContexts[ThreadId]->FinishFrame();
+    });
+
+    EndStreamingRingFrame();
+}
+
+void Tutorial10_DataStreaming::EndStreamingRingFrame()
+{
+    if (!m_bUseRingBuffer)
+        return;
+
+    // The ring buffer space used by this frame can be reused once the GPU reaches this signal
+    m_pImmediateContext->EnqueueSignal(m_pFrameCompleteFence, ++m_FrameCompleteFenceValue);
+    m_StreamingRingVB->EndFrame(m_FrameCompleteFenceValue);
+    m_StreamingRingIB->EndFrame(m_FrameCompleteFenceValue);
 }
 
 void Tutorial10_DataStreaming::CreateInstanceBuffer()
@@ -27,14 +27,12 @@
 
 #pragma once
 
-#include <atomic>
 #include <memory>
 #include <vector>
-#include <thread>
-#include <mutex>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
+#include "../../Common/src/SpriteSimulation.hpp"
 
 namespace Diligent
 {
@@ -66,18 +64,13 @@ private:
     void StopWorkerThreads();
 
     template <bool UseBatch>
-    void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
+    void RenderSubset(IDeviceContext* pCtx, size_t CtxNum, Uint32 StartBatch, Uint32 EndBatch);
 
-    static void WorkerThreadFunc(Tutorial10_DataStreaming* pThis, Uint32 ThreadNum);
+    // Polygons are blended, so the draw order must be preserved. Every task records its
+    // own command list, and the command lists are executed in the task order.
+    std::unique_ptr<TaskScheduler> m_pScheduler;
 
-    ThreadingTools::Signal m_RenderSubsetSignal;
-    ThreadingTools::Signal m_ExecuteCommandListsSignal;
-    ThreadingTools::Signal m_GotoNextFrameSignal;
-
-    std::atomic_int m_NumThreadsCompleted;
-    std::atomic_int m_NumThreadsReady;
-
-    std::vector<std::thread> m_WorkerThreads;
+    static constexpr Uint32 TasksPerThread = 4;
 
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
@@ -91,6 +84,14 @@ private:
     std::unique_ptr<class StreamingBuffer> m_StreamingVB;
     std::unique_ptr<class StreamingBuffer> m_StreamingIB;
 
+    // Ring buffers shared by all contexts. Only available if the device supports unified memory with CPU write access.
+    static constexpr const Uint32              StreamingRingBufferSize = 16 << 20;
+    std::unique_ptr<class StreamingRingBuffer> m_StreamingRingVB;
+    std::unique_ptr<class StreamingRingBuffer> m_StreamingRingIB;
+    RefCntAutoPtr<IFence>                      m_pFrameCompleteFence;
+    Uint64                                     m_FrameCompleteFenceValue = 0;
+    bool                                       m_bUseRingBuffer          = false;
+
     static constexpr int                  NumTextures = 4;
     RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
     RefCntAutoPtr<IShaderResourceBinding> m_BatchSRB;
@@ -108,17 +109,18 @@ private:
 
     struct PolygonData
     {
-        float2 Pos;
-        float2 MoveDir;
         float  Size;
-        float  Angle;
-        float  RotSpeed;
         int    TextureInd;
         int    StateInd;
         int    NumVerts;
     };
     std::vector<PolygonData> m_Polygons;
 
+    // Positions and rotation angles are updated by the simulation that keeps them in a structure of arrays
+    SpriteSimulation m_Simulation;
+    int              m_UpdateMode = SpriteSimulation::UPDATE_MODE_SIMD;
+    double           m_UpdateTime = 0; // Smoothed simulation update time, in milliseconds
+
     struct InstanceData
     {
         float4 PolygonRotationAndScale;
@@ -135,7 +137,16 @@ private:
     };
     std::vector<PolygonGeometry> m_PolygonGeo;
     bool                         m_bAllowPersistentMap = false;
-    std::pair<Uint32, Uint32>    WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum);
+
+    struct PolygonAllocation
+    {
+        IBuffer* pVB;
+        Uint32   VBOffset;
+        IBuffer* pIB;
+        Uint32   IBOffset;
+    };
+    PolygonAllocation WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum);
+    void              EndStreamingRingFrame();
 };
 
 } // namespace Diligent
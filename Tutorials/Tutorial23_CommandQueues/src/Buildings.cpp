@@ -26,9 +26,18 @@
 
 #include <random>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define GEN_MIPMAP_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define GEN_MIPMAP_NEON 1
+#endif
+
 #include "Buildings.hpp"
 #include "MapHelper.hpp"
 #include "PlatformMisc.hpp"
+#include "Align.hpp"
 
 namespace Diligent
 {
@@ -509,6 +518,10 @@ void CreateBuilding(const float2            Center,
     }
 }
 
+// Alignment of buffer-to-texture copies in DirectX 12, in bytes
+constexpr Uint32 UploadRowPitchAlignment = 256;
+constexpr Uint32 UploadOffsetAlignment   = 512;
+
 } // namespace
 
 void Buildings::CreateResources(IDeviceContext* pContext)
@@ -642,12 +655,13 @@ void Buildings::CreateResources(IDeviceContext* pContext)
         m_OpaqueTexAtlasStaging->SetState(RESOURCE_STATE_UNKNOWN);
 #endif
 
-        Uint32 SliceSize = 0;
-        for (Uint32 Mip = 0; Mip < TexDesc.MipLevels; ++Mip)
-            SliceSize += std::max(1u, TexDesc.Width >> Mip) * std::max(1u, TexDesc.Height >> Mip);
+        m_PackedSliceLayout = ComputeSliceLayout(TexDesc, 1, 1);
+        // DirectX 12 requires the row pitch and the offset of buffer-to-texture copies to be aligned.
+        m_UploadSliceLayout = ComputeSliceLayout(TexDesc, UploadRowPitchAlignment / 4, UploadOffsetAlignment / 4);
 
+        const Uint32 SliceSize = m_PackedSliceLayout.Size;
         m_OpaqueTexAtlasPixels.resize(SliceSize * TexDesc.ArraySize);
-        m_GenTexTask.Pixels.resize(SliceSize);
+        m_OpaqueTexAtlasSliceStale.assign(TexDesc.ArraySize, false);
         m_OpaqueTexAtlasSliceSize = SliceSize * 4;
 
         // Initialize content
@@ -656,14 +670,47 @@ void Buildings::CreateResources(IDeviceContext* pContext)
         UpdateAtlas(pContext, ~0u, Unused);
         pContext->Flush();
 
-        // Begin texture generation in async thread
+        // Two tasks per thread let the threads generate new slices while the ready ones are waiting to be copied.
+        const Uint32 NumGenTexTasks = std::min(static_cast<Uint32>(m_GenTexThreads.size()) * 2, TexDesc.ArraySize);
+
+        // Staging buffers can only stay mapped while the GPU reads them in DirectX 12 and Vulkan.
+        const auto DevType = m_Device->GetDeviceInfo().Type;
+        if (DevType == RENDER_DEVICE_TYPE_D3D12 || DevType == RENDER_DEVICE_TYPE_VULKAN)
         {
-            m_GenTexTask.ArraySlice = 0;
-            m_GenTexTask.Time       = CurrentTime;
+            BufferDesc BuffDesc;
+            BuffDesc.Name                 = "Buildings texture upload ring";
+            BuffDesc.Usage                = USAGE_STAGING;
+            BuffDesc.CPUAccessFlags       = CPU_ACCESS_WRITE;
+            BuffDesc.Size                 = Uint64{m_UploadSliceLayout.Size} * 4 * NumGenTexTasks;
+            BuffDesc.ImmediateContextMask = m_ImmediateContextMask;
+            m_Device->CreateBuffer(BuffDesc, nullptr, &m_UploadRing);
+
+            VERIFY_EXPR((m_UploadRing->GetState() & RESOURCE_STATE_COPY_SOURCE) != 0);
+            m_UploadRing->SetState(RESOURCE_STATE_UNKNOWN);
+
+            // The buffer is mapped for its entire lifetime
+            m_UploadRingData.Map(pContext, m_UploadRing, MAP_WRITE, MAP_FLAG_NONE);
+            if (m_UploadRingData == nullptr)
+            {
+                LOG_WARNING_MESSAGE("Failed to map the upload ring, only UpdateTexture() will be used to upload the texture atlas");
+                m_UploadRing.Release();
+            }
+        }
 
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::Initial);
+        // Begin texture generation in worker threads.
+        {
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+
+            m_GenTexTasks.resize(NumGenTexTasks);
+            m_NextGenTexSlice = 0;
+            for (Uint32 i = 0; i < m_GenTexTasks.size(); ++i)
+            {
+                VERIFY_EXPR(m_GenTexTasks[i].Status == TaskStatus::Initial);
+                m_GenTexTasks[i].Pixels.resize(SliceSize);
+                StartGenTexTask(i);
+            }
         }
+        m_GenTexCondVar.notify_all();
     }
 
     m_DrawOpaqueSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_OpaqueTexAtlas")->Set(m_OpaqueTexAtlas->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
@@ -675,12 +722,10 @@ void Buildings::Initialize(IRenderDevice* pDevice, IBuffer* pDrawConstants, Uint
     m_DrawConstants        = pDrawConstants;
     m_ImmediateContextMask = ImmediateContextMask;
 
-#if USE_STAGING_TEXTURE
     FenceDesc FenceCI;
     FenceCI.Name = "Upload complete fence";
     FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
     m_Device->CreateFence(FenceCI, &m_UploadCompleteFence);
-#endif
 }
 
 void Buildings::CreatePSO(const ScenePSOCreateAttribs& Attr)
@@ -971,27 +1016,106 @@ static void GenWindowsAndTopNeonLineTexture(Uint32* Pixels, const Uint32 W, cons
     }
 }
 
-static void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, const Uint32 SrcH, Uint32* DstPixels, const Uint32 DstW, const Uint32 DstH)
+// Averages a 2x2 block of RGBA8 texels. Alpha stores self-emission, which is
+// disabled unless more than two source texels are emissive.
+static Uint32 FilterTexel(Uint32 c0, Uint32 c1, Uint32 c2, Uint32 c3)
+{
+    Uint32 col = 0;
+    for (Uint32 Shift = 0; Shift < 24; Shift += 8)
+        col |= ((((c0 >> Shift) & 0xFF) + ((c1 >> Shift) & 0xFF) + ((c2 >> Shift) & 0xFF) + ((c3 >> Shift) & 0xFF)) >> 2) << Shift;
+
+    // disable self-emission
+    Uint32 NumEmissionPix = (c0 > 0xFFFFFF) + (c1 > 0xFFFFFF) + (c2 > 0xFFFFFF) + (c3 > 0xFFFFFF);
+    if (NumEmissionPix > 2)
+        col |= (((c0 >> 24) + (c1 >> 24) + (c2 >> 24) + (c3 >> 24)) >> 2) << 24;
+
+    return col;
+}
+
+#if GEN_MIPMAP_SSE2
+
+// Returns per-channel sums of the 2x2 blocks for two destination texels,
+// given four texels from each of two source rows.
+static __m128i SumTexelBlocks(__m128i Row0, __m128i Row1)
+{
+    const __m128i Zero = _mm_setzero_si128();
+
+    const __m128i Sum01 = _mm_add_epi16(_mm_unpacklo_epi8(Row0, Zero), _mm_unpacklo_epi8(Row1, Zero));
+    const __m128i Sum23 = _mm_add_epi16(_mm_unpackhi_epi8(Row0, Zero), _mm_unpackhi_epi8(Row1, Zero));
+    return _mm_add_epi16(_mm_unpacklo_epi64(Sum01, Sum23), _mm_unpackhi_epi64(Sum01, Sum23));
+}
+
+// Filters two destination texels and returns them as 16-bit channels
+static __m128i FilterTexels(__m128i Row0, __m128i Row1)
+{
+    const __m128i Zero    = _mm_setzero_si128();
+    const __m128i RGBMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+    const __m128i Color = _mm_srli_epi16(SumTexelBlocks(Row0, Row1), 2);
+    // Every zero channel adds 255 to the sum
+    const __m128i ZeroSum  = SumTexelBlocks(_mm_cmpeq_epi8(Row0, Zero), _mm_cmpeq_epi8(Row1, Zero));
+    const __m128i Emissive = _mm_cmplt_epi16(ZeroSum, _mm_set1_epi16(256));
+    return _mm_and_si128(Color, _mm_or_si128(Emissive, RGBMask));
+}
+
+#elif GEN_MIPMAP_NEON
+
+static uint16x8_t SumTexelBlocks(uint8x16_t Row0, uint8x16_t Row1)
+{
+    const uint16x8_t Sum01 = vaddl_u8(vget_low_u8(Row0), vget_low_u8(Row1));
+    const uint16x8_t Sum23 = vaddl_u8(vget_high_u8(Row0), vget_high_u8(Row1));
+    return vcombine_u16(vadd_u16(vget_low_u16(Sum01), vget_high_u16(Sum01)),
+                        vadd_u16(vget_low_u16(Sum23), vget_high_u16(Sum23)));
+}
+
+static uint8x8_t FilterTexels(uint8x16_t Row0, uint8x16_t Row1)
+{
+    const uint8x16_t Zero    = vdupq_n_u8(0);
+    const uint16x8_t RGBMask = vreinterpretq_u16_u64(vdupq_n_u64(0x0000FFFFFFFFFFFFull));
+
+    const uint16x8_t Color    = vshrq_n_u16(SumTexelBlocks(Row0, Row1), 2);
+    const uint16x8_t ZeroSum  = SumTexelBlocks(vceqq_u8(Row0, Zero), vceqq_u8(Row1, Zero));
+    const uint16x8_t Emissive = vcltq_u16(ZeroSum, vdupq_n_u16(256));
+    return vmovn_u16(vandq_u16(Color, vorrq_u16(Emissive, RGBMask)));
+}
+
+#endif
+
+// Strides are in pixels
+static void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, const Uint32 SrcH, const Uint32 SrcStride,
+                      Uint32* DstPixels, const Uint32 DstW, const Uint32 DstH, const Uint32 DstStride)
 {
     VERIFY_EXPR(SrcW >= 2 && SrcH >= 2);
 
     for (Uint32 y = 0; y < DstH; ++y)
     {
-        for (Uint32 x = 0; x < DstW; ++x)
+        const Uint32* SrcRow0 = &SrcPixels[(y * 2 + 0) * SrcStride];
+        const Uint32* SrcRow1 = &SrcPixels[(y * 2 + 1) * SrcStride];
+        Uint32*       DstRow  = &DstPixels[y * DstStride];
+
+        Uint32 x = 0;
+#if GEN_MIPMAP_SSE2
+        // 4 destination texels per iteration
+        for (; x + 4 <= DstW; x += 4)
         {
-            float4 c0  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 0) * SrcW]);
-            float4 c1  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 0) * SrcW]);
-            float4 c2  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 1) * SrcW]);
-            float4 c3  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 1) * SrcW]);
-            float4 col = (c0 + c1 + c2 + c3) * 0.25f;
-
-            // disable self-emission
-            Uint32 NumEmissionPix = (c0.a > 0.f) + (c1.a > 0.f) + (c2.a > 0.f) + (c3.a > 0.f);
-            if (NumEmissionPix <= 2)
-                col.a = 0.f;
-
-            DstPixels[x + y * DstW] = F4Color_To_RGBA8Unorm(col);
+            const __m128i Lo = FilterTexels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&SrcRow0[x * 2 + 0])),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SrcRow1[x * 2 + 0])));
+            const __m128i Hi = FilterTexels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&SrcRow0[x * 2 + 4])),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SrcRow1[x * 2 + 4])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&DstRow[x]), _mm_packus_epi16(Lo, Hi));
         }
+#elif GEN_MIPMAP_NEON
+        for (; x + 4 <= DstW; x += 4)
+        {
+            const uint8x8_t Lo = FilterTexels(vld1q_u8(reinterpret_cast<const uint8_t*>(&SrcRow0[x * 2 + 0])),
+                                              vld1q_u8(reinterpret_cast<const uint8_t*>(&SrcRow1[x * 2 + 0])));
+            const uint8x8_t Hi = FilterTexels(vld1q_u8(reinterpret_cast<const uint8_t*>(&SrcRow0[x * 2 + 4])),
+                                              vld1q_u8(reinterpret_cast<const uint8_t*>(&SrcRow1[x * 2 + 4])));
+            vst1q_u8(reinterpret_cast<uint8_t*>(&DstRow[x]), vcombine_u8(Lo, Hi));
+        }
+#endif
+        for (; x < DstW; ++x)
+            DstRow[x] = FilterTexel(SrcRow0[x * 2 + 0], SrcRow0[x * 2 + 1], SrcRow1[x * 2 + 0], SrcRow1[x * 2 + 1]);
     }
 }
 
@@ -1022,28 +1146,55 @@ static void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice
 
 void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRateMb, Uint32& ActualTransferRateMb)
 {
+    ActualTransferRateMb = 0;
     if (RequiredTransferRateMb == 0)
         return;
 
-    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
+    const auto& TexDesc        = m_OpaqueTexAtlas->GetDesc();
+    const bool  UploadFromRing = UseUploadRing && IsUploadRingSupported();
 
-    // Try to read a new texture
-    for (Uint32 i = 0; i < 100; ++i)
+    // Restart the tasks whose upload ring slices have been copied to the atlas by the GPU
     {
-        TaskStatus Expected = TaskStatus::TexReady;
-        if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::CopyTex, std::memory_order_acquire, std::memory_order_relaxed))
+        const auto CompletedFenceValue = m_UploadCompleteFence->GetCompletedValue();
+
+        bool TasksStarted = false;
         {
-            Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * m_GenTexTask.ArraySlice;
-            memcpy(&m_OpaqueTexAtlasPixels[Offset], m_GenTexTask.Pixels.data(), m_OpaqueTexAtlasSliceSize);
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+            for (Uint32 TaskInd = 0; TaskInd < m_GenTexTasks.size(); ++TaskInd)
+            {
+                const auto& Task = m_GenTexTasks[TaskInd];
+                if (Task.Status == TaskStatus::CopyTex && Task.UploadFenceValue != 0 && Task.UploadFenceValue <= CompletedFenceValue)
+                {
+                    StartGenTexTask(TaskInd);
+                    TasksStarted = true;
+                }
+            }
+        }
+        if (TasksStarted)
+            m_GenTexCondVar.notify_all();
+    }
 
-            // Update task parameters
-            m_GenTexTask.ArraySlice = (m_GenTexTask.ArraySlice + 1) % TexDesc.ArraySize;
-            m_GenTexTask.Time       = CurrentTime;
+    // Read all textures that are ready in CPU memory. The lock is only held to change the task status,
+    // so the worker threads are not blocked while the pixels are being copied.
+    for (Uint32 TaskInd = 0; TaskInd < m_GenTexTasks.size(); ++TaskInd)
+    {
+        auto& Task = m_GenTexTasks[TaskInd];
+        {
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+            if (Task.Status != TaskStatus::TexReady || Task.UseUploadRing)
+                continue;
+            Task.Status = TaskStatus::CopyTex;
+        }
 
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::CopyTex);
-            break;
+        Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * Task.ArraySlice;
+        memcpy(&m_OpaqueTexAtlasPixels[Offset], Task.Pixels.data(), m_OpaqueTexAtlasSliceSize);
+        m_OpaqueTexAtlasSliceStale[Task.ArraySlice] = false;
+
+        {
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+            StartGenTexTask(TaskInd);
         }
+        m_GenTexCondVar.notify_one();
     }
 
 #if USE_STAGING_TEXTURE
@@ -1061,13 +1212,55 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
         pContext->TransitionResourceStates(1, &Barrier);
     }
 
-    Uint32       CopiedCpuToGpu = 0;
-    const Uint32 FirstSlice     = m_m_OpaqueTexAtlasOffset;
+    Uint32 CopiedCpuToGpu = 0;
+
+    // Copy the slices that were generated in the upload ring. The slices are not copied on the CPU side,
+    // and the ring regions are not reused until the GPU signals the fence that is enqueued below.
+    for (Uint32 TaskInd = 0; TaskInd < m_GenTexTasks.size() && ActualTransferRateMb < RequiredTransferRateMb; ++TaskInd)
+    {
+        auto& Task = m_GenTexTasks[TaskInd];
+        {
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+            if (Task.Status != TaskStatus::TexReady || !Task.UseUploadRing)
+                continue;
+            Task.Status = TaskStatus::CopyTex;
+        }
+
+        const Uint64 RingOffset = Uint64{m_UploadSliceLayout.Size} * TaskInd;
+        for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
+        {
+            const auto& Mip = m_UploadSliceLayout.Mips[Mipmap];
+            const auto  W   = std::max(1u, TexDesc.Width >> Mipmap);
+            const auto  H   = std::max(1u, TexDesc.Height >> Mipmap);
+
+            TextureSubResData SubRes;
+            SubRes.pSrcBuffer = m_UploadRing;
+            SubRes.SrcOffset  = (RingOffset + Mip.Offset) * 4;
+            SubRes.Stride     = Mip.Stride * 4;
+            Box Region{0u, W, 0u, H};
+            pContext->UpdateTexture(m_OpaqueTexAtlas, Mipmap, Task.ArraySlice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
+
+            CopiedCpuToGpu += W * H * 4;
+        }
+        Task.UploadFenceValue = m_UploadCompleteFenceValue + 1;
+        m_OpaqueTexAtlasSliceStale[Task.ArraySlice] = true;
+
+        ActualTransferRateMb = (CopiedCpuToGpu >> 20) + (CopiedCpuToGpu >> 21); // round bytes to Mb
+    }
+
+    const Uint32 FirstSlice = m_m_OpaqueTexAtlasOffset;
 
     // Each frame we copy pixels from CPU side to GPU side.
-    for (Uint32 SliceInd = 0; SliceInd < TexDesc.ArraySize; ++SliceInd)
+    for (Uint32 SliceInd = 0; SliceInd < TexDesc.ArraySize && !UploadFromRing; ++SliceInd)
     {
-        Uint32 Slice  = (FirstSlice + SliceInd) % TexDesc.ArraySize;
+        Uint32 Slice = (FirstSlice + SliceInd) % TexDesc.ArraySize;
+        if (m_OpaqueTexAtlasSliceStale[Slice])
+        {
+            // Uploading the CPU-side copy would revert the newer slice from the upload ring
+            m_m_OpaqueTexAtlasOffset = Slice;
+            continue;
+        }
+
         Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
         for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
         {
@@ -1117,88 +1310,168 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 
     pContext->EndDebugGroup();
 
-#if USE_STAGING_TEXTURE
     pContext->EnqueueSignal(m_UploadCompleteFence, ++m_UploadCompleteFenceValue);
-#endif
 }
 
 Buildings::Buildings()
 {
-    m_GenTexThreadLooping.store(true);
-    m_GenTexThread = std::thread{&Buildings::ThreadProc, this};
+    // Leave one core for the render thread
+    const Uint32 NumThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    m_GenTexThreadsLooping = true;
+    for (Uint32 i = 0; i < NumThreads; ++i)
+        m_GenTexThreads.emplace_back(&Buildings::ThreadProc, this);
 }
 
 Buildings::~Buildings()
 {
-    m_GenTexThreadLooping.store(false);
-    m_GenTexThread.join();
+    {
+        std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+        m_GenTexThreadsLooping = false;
+    }
+    m_GenTexCondVar.notify_all();
+
+    for (auto& Thread : m_GenTexThreads)
+        Thread.join();
+}
+
+// m_GenTexMtx must be locked
+void Buildings::StartGenTexTask(Uint32 TaskIndex)
+{
+    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
+    auto&       Task    = m_GenTexTasks[TaskIndex];
+    VERIFY_EXPR(Task.Status == TaskStatus::Initial || Task.Status == TaskStatus::CopyTex);
+
+    Task.ArraySlice       = m_NextGenTexSlice;
+    Task.Time             = CurrentTime;
+    Task.UseUploadRing    = UseUploadRing && IsUploadRingSupported();
+    Task.UploadFenceValue = 0;
+    Task.Status           = TaskStatus::NewTask;
+    m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
 }
 
 void Buildings::ThreadProc()
 {
-    while (m_GenTexThreadLooping.load())
+    std::unique_lock<std::mutex> Lock{m_GenTexMtx};
+    for (;;)
     {
-        for (Uint32 i = 0; i < 100; ++i)
-        {
-            // Check the task status.
-            // If task status is 'NewTask' then change status to GenTex,
-            // invalidate CPU cache to make changes from another thread visible to current thread.
-            TaskStatus Expected = TaskStatus::NewTask;
-            if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::GenTex, std::memory_order_acquire, std::memory_order_relaxed))
+        // Find a new task and change its status to 'GenTex', so that no other thread takes it.
+        GenTexTask* pTask = nullptr;
+        m_GenTexCondVar.wait(Lock, [&]() {
+            if (m_NextInitSlice < m_NumInitSlices)
+                return true;
+            for (auto& Task : m_GenTexTasks)
             {
-                const auto& TexDesc   = m_OpaqueTexAtlas->GetDesc();
-                const auto  Slice     = m_GenTexTask.ArraySlice;
-                Uint32      SrcOffset = 0;
-                GenTexture(&m_GenTexTask.Pixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, m_GenTexTask.Time);
-
-                for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
+                if (Task.Status == TaskStatus::NewTask)
                 {
-                    const Uint32* SrcPixels = &m_GenTexTask.Pixels[SrcOffset];
-                    const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-                    const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-                    const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-                    Uint32*       DstPixels = &m_GenTexTask.Pixels[DstOffset];
-                    const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-                    const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-                    GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-                    SrcOffset = DstOffset;
+                    pTask = &Task;
+                    return true;
                 }
+            }
+            return !m_GenTexThreadsLooping;
+        });
+        if (!m_GenTexThreadsLooping)
+            break;
 
-                // Change status to 'TexReady' and flush CPU cache to make local changes visible for other threads.
-                const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::TexReady, std::memory_order_release);
-                VERIFY_EXPR(OldStatus == TaskStatus::GenTex);
+        if (pTask == nullptr)
+        {
+            GenerateInitSlice(Lock);
+            continue;
+        }
 
-                break;
-            }
+        pTask->Status    = TaskStatus::GenTex;
+        const auto Slice = pTask->ArraySlice;
+        const auto Time  = pTask->Time;
+
+        // Slices in the upload ring are written directly to the mapped staging memory
+        Uint32*            pPixels = pTask->Pixels.data();
+        const SliceLayout* pLayout = &m_PackedSliceLayout;
+        if (pTask->UseUploadRing)
+        {
+            const auto TaskIndex = static_cast<Uint32>(pTask - m_GenTexTasks.data());
+            pPixels              = static_cast<Uint32*>(m_UploadRingData) + m_UploadSliceLayout.Size * TaskIndex;
+            pLayout              = &m_UploadSliceLayout;
         }
-        std::this_thread::sleep_for(std::chrono::microseconds{1});
+
+        Lock.unlock();
+        GenerateSlice(pPixels, *pLayout, Slice, Time);
+        Lock.lock();
+
+        VERIFY_EXPR(pTask->Status == TaskStatus::GenTex);
+        pTask->Status = TaskStatus::TexReady;
     }
 }
 
-void Buildings::GenerateOpaqueTexture()
+void Buildings::GenerateSlice(Uint32* Pixels, const SliceLayout& Layout, Uint32 Slice, Uint32 Time) const
 {
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-    for (Uint32 Slice = 0; Slice < TexDesc.ArraySize; ++Slice)
+    // Texture generators write tightly packed rows
+    VERIFY_EXPR(Layout.Mips[0].Offset == 0 && Layout.Mips[0].Stride == TexDesc.Width);
+    GenTexture(Pixels, TexDesc.Width, TexDesc.Height, Slice, Time);
+
+    for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
     {
-        Uint32 SrcOffset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
-        GenTexture(&m_OpaqueTexAtlasPixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, 0u);
+        const auto& Src  = Layout.Mips[Mipmap - 1];
+        const auto& Dst  = Layout.Mips[Mipmap];
+        const auto  SrcW = std::max(1u, TexDesc.Width >> (Mipmap - 1));
+        const auto  SrcH = std::max(1u, TexDesc.Height >> (Mipmap - 1));
+        const auto  DstW = std::max(1u, TexDesc.Width >> Mipmap);
+        const auto  DstH = std::max(1u, TexDesc.Height >> Mipmap);
+
+        GenMipmap(&Pixels[Src.Offset], SrcW, SrcH, Src.Stride, &Pixels[Dst.Offset], DstW, DstH, Dst.Stride);
+    }
+}
 
-        for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
-        {
-            const Uint32* SrcPixels = &m_OpaqueTexAtlasPixels[SrcOffset];
-            const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-            const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-            const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-            Uint32*       DstPixels = &m_OpaqueTexAtlasPixels[DstOffset];
-            const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-            const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-            GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-            SrcOffset = DstOffset;
-        }
+Buildings::SliceLayout Buildings::ComputeSliceLayout(const TextureDesc& TexDesc, Uint32 StrideAlignment, Uint32 OffsetAlignment)
+{
+    SliceLayout Layout;
+    Layout.Mips.resize(TexDesc.MipLevels);
+    for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
+    {
+        auto& Mip  = Layout.Mips[Mipmap];
+        Mip.Offset = AlignUp(Layout.Size, OffsetAlignment);
+        Mip.Stride = AlignUp(std::max(1u, TexDesc.Width >> Mipmap), StrideAlignment);
+        Layout.Size = Mip.Offset + Mip.Stride * std::max(1u, TexDesc.Height >> Mipmap);
+    }
+    Layout.Size = AlignUp(Layout.Size, OffsetAlignment);
+    return Layout;
+}
+
+void Buildings::GenerateOpaqueTexture()
+{
+    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
+
+    // Hand all slices to the worker threads, which are idle until the first tasks are started
+    {
+        std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+        VERIFY_EXPR(m_NumInitSlices == 0);
+        m_NumInitSlices     = TexDesc.ArraySize;
+        m_NextInitSlice     = 0;
+        m_NumInitSlicesDone = 0;
     }
+    m_GenTexCondVar.notify_all();
+
+    // The current thread generates slices too and then waits for the workers to finish theirs
+    std::unique_lock<std::mutex> Lock{m_GenTexMtx};
+    while (m_NextInitSlice < m_NumInitSlices)
+        GenerateInitSlice(Lock);
+    m_GenTexCondVar.wait(Lock, [this]() { return m_NumInitSlicesDone == m_NumInitSlices; });
+    m_NumInitSlices = 0;
+}
+
+// m_GenTexMtx must be locked by Lock
+void Buildings::GenerateInitSlice(std::unique_lock<std::mutex>& Lock)
+{
+    VERIFY_EXPR(m_NextInitSlice < m_NumInitSlices);
+    const auto Slice = m_NextInitSlice++;
+
+    Lock.unlock();
+    GenerateSlice(&m_OpaqueTexAtlasPixels[(m_OpaqueTexAtlasSliceSize / 4) * Slice], m_PackedSliceLayout, Slice, 0u);
+    Lock.lock();
+
+    if (++m_NumInitSlicesDone == m_NumInitSlices)
+        m_GenTexCondVar.notify_all();
 }
 
 } // namespace Diligent
@@ -28,8 +28,12 @@
 
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
 
 #include "Terrain.hpp"
+#include "MapHelper.hpp"
 
 // Single staging texture allocates less memory, but spends more time
 // than when UpdateTexture() is used with implicit staging buffer.
@@ -60,8 +64,31 @@ public:
         return TexDesc.Width * TexDesc.Height * TexDesc.ArraySize * 4;
     }
 
+    // The upload ring is only created when the backend allows keeping a staging buffer mapped while the GPU reads from it
+    bool IsUploadRingSupported() const { return m_UploadRing != nullptr; }
+
+    // The modes count different data: the upload ring only transfers newly generated slices,
+    // while UpdateTexture mode re-uploads every slice of the CPU-side copy in turn.
+    const char* GetUploadModeName() const { return UseUploadRing && IsUploadRingSupported() ? "Upload ring (new slices)" : "UpdateTexture (all slices)"; }
+
 private:
+    // Placement of the mip levels of one atlas slice in memory, in pixels
+    struct SliceLayout
+    {
+        struct MipLevel
+        {
+            Uint32 Offset = 0;
+            Uint32 Stride = 0;
+        };
+        std::vector<MipLevel> Mips;
+        Uint32                Size = 0;
+    };
+    static SliceLayout ComputeSliceLayout(const TextureDesc& TexDesc, Uint32 StrideAlignment, Uint32 OffsetAlignment);
+
     void GenerateOpaqueTexture();
+    void GenerateInitSlice(std::unique_lock<std::mutex>& Lock);
+    void GenerateSlice(Uint32* Pixels, const SliceLayout& Layout, Uint32 Slice, Uint32 Time) const;
+    void StartGenTexTask(Uint32 TaskIndex);
     void ThreadProc();
 
     RefCntAutoPtr<IRenderDevice> m_Device;
@@ -84,7 +111,15 @@ private:
 
     std::vector<Uint32> m_OpaqueTexAtlasPixels;
     Uint32              m_OpaqueTexAtlasSliceSize = 0; // in bytes
+    SliceLayout         m_PackedSliceLayout;           // slices in m_OpaqueTexAtlasPixels and GenTexTask::Pixels
+    SliceLayout         m_UploadSliceLayout;           // slices in m_UploadRing
+
+    // Slices that were last uploaded from the ring, so m_OpaqueTexAtlasPixels holds older content.
+    // They are not re-uploaded from the CPU-side copy until they are regenerated there.
+    std::vector<bool> m_OpaqueTexAtlasSliceStale;
 
+    // Atlas slices are generated by a pool of worker threads. Each task holds one slice,
+    // so up to m_GenTexTasks.size() slices are in flight at the same time.
     enum class TaskStatus : Uint32
     {
         NewTask  = 0,
@@ -95,23 +130,46 @@ private:
     };
     struct GenTexTask
     {
-        std::atomic<TaskStatus> Status{TaskStatus::Initial}; // protects access to other fields
-        std::vector<Uint32>     Pixels;
-        Uint32                  ArraySlice = 0;
-        Uint32                  Time       = 0;
+        TaskStatus          Status = TaskStatus::Initial; // protected by m_GenTexMtx
+        std::vector<Uint32> Pixels;                       // owned by the thread that changed the status to GenTex or CopyTex
+        Uint32              ArraySlice = 0;
+        Uint32              Time       = 0;
+
+        // If true, the slice is generated in the task's region of m_UploadRing instead of Pixels
+        bool UseUploadRing = false;
+        // The task stays in 'CopyTex' status until m_UploadCompleteFence reaches this value
+        Uint64 UploadFenceValue = 0;
     };
-    GenTexTask        m_GenTexTask;
-    std::thread       m_GenTexThread;
-    std::atomic<bool> m_GenTexThreadLooping{false};
+    std::vector<GenTexTask>  m_GenTexTasks;
+    Uint32                   m_NextGenTexSlice = 0;
+    std::vector<std::thread> m_GenTexThreads;
+    std::mutex               m_GenTexMtx;
+    std::condition_variable  m_GenTexCondVar; // signaled when a task becomes 'NewTask', initial slices are added or done, or the threads must exit
+    bool                     m_GenTexThreadsLooping = false;
+
+    // Initial atlas content is generated by the same threads directly into m_OpaqueTexAtlasPixels,
+    // one slice at a time. All counters are protected by m_GenTexMtx.
+    Uint32 m_NumInitSlices     = 0;
+    Uint32 m_NextInitSlice     = 0;
+    Uint32 m_NumInitSlicesDone = 0;
+
+    // Persistently mapped staging buffer with one slice per generation task. Worker threads
+    // write the slices directly to it, and the slices are copied to the atlas by the GPU.
+    RefCntAutoPtr<IBuffer> m_UploadRing;
+    MapHelper<Uint32>      m_UploadRingData;
+
+    RefCntAutoPtr<IFence> m_UploadCompleteFence;
+    Uint64                m_UploadCompleteFenceValue = 0;
 
 #if USE_STAGING_TEXTURE
     RefCntAutoPtr<ITexture> m_OpaqueTexAtlasStaging;
-    RefCntAutoPtr<IFence>   m_UploadCompleteFence;
-    Uint64                  m_UploadCompleteFenceValue = 0;
 #endif
 
 public:
     Uint32 CurrentTime = 0;
+
+    // Upload the generated slices from the upload ring instead of the CPU-side atlas copy
+    bool UseUploadRing = false;
 };
 
 } // namespace Diligent
@@ -24,8 +24,11 @@
  *  of the possibility of such damages.
  */
 
+#include <algorithm>
+
 #include "Profiler.hpp"
 #include "imgui.h"
+#include "ImGuiUtils.hpp"
 
 namespace Diligent
 {
@@ -35,156 +38,116 @@ static constexpr float GraphHeight = 100.f;
 
 void Profiler::Initialize(IRenderDevice* pDevice)
 {
-    m_Device  = pDevice;
-    m_FrameId = 0;
-
-    QueryDesc queryDesc;
-    queryDesc.Name = "Timestamp query";
-    queryDesc.Type = QUERY_TYPE_TIMESTAMP;
-
-    m_SupportsTransferQueueProfiling = pDevice->GetDeviceInfo().Features.TransferQueueTimestampQueries;
+    m_Timeline.reset(new FrameProfiler{pDevice});
+}
 
-    for (auto& Frame : m_FrameHistory)
+const char* Profiler::GetPassName(PASS_TYPE Pass)
+{
+    switch (Pass)
     {
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics1.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics1.GpuTimeQueryEnd);
-
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics2.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics2.GpuTimeQueryEnd);
-
-        m_Device->CreateQuery(queryDesc, &Frame.Compute.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Compute.GpuTimeQueryEnd);
-
-        m_Device->CreateQuery(queryDesc, &Frame.Transfer.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Transfer.GpuTimeQueryEnd);
+        // clang-format off
+        case FRAME:      return "Frame";
+        case GRAPHICS_1: return "Graphics pass 1";
+        case GRAPHICS_2: return "Graphics pass 2";
+        case COMPUTE:    return "Compute pass";
+        case TRANSFER:   return "Upload pass";
+        // clang-format on
+        default:
+            UNEXPECTED("Unknown pass type");
+            return "Unknown";
     }
 }
 
 void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
 {
-    if (m_Device == nullptr)
+    if (m_Timeline == nullptr)
         return;
 
-    const auto BeginCounters = [&](auto& Pass) //
-    {
-        Pass.QuerySupported = (pContext != nullptr && ((pContext->GetDesc().QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK) > COMMAND_QUEUE_TYPE_TRANSFER || m_SupportsTransferQueueProfiling));
-        if (Pass.QuerySupported)
-        {
-            pContext->EndQuery(Pass.GpuTimeQueryBegin);
-        }
-        Pass.CpuTImeBegin = TimePoint::clock::now();
-    };
+    if (PassType == FRAME)
+        m_Timeline->BeginFrame();
 
-    auto& Frame = m_FrameHistory[m_FrameId];
-    switch (PassType)
-    {
-        case GRAPHICS_1:
-            BeginCounters(Frame.Graphics1);
-            break;
-        case GRAPHICS_2:
-            BeginCounters(Frame.Graphics2);
-            break;
-        case COMPUTE:
-            BeginCounters(Frame.Compute);
-            break;
-        case TRANSFER:
-            BeginCounters(Frame.Transfer);
-            break;
-        case FRAME:
-            BeginCounters(Frame.Frame);
-            break;
-        default:
-            UNEXPECTED("Unknown pass type");
-    }
+    m_Timeline->BeginScope(GetPassName(PassType), pContext);
 }
 
 void Profiler::End(IDeviceContext* pContext, PASS_TYPE PassType)
 {
-    if (m_Device == nullptr)
+    if (m_Timeline == nullptr)
         return;
 
-    const auto EndCounters = [pContext](auto& Pass) //
+    m_Timeline->EndScope(pContext);
+
+    if (PassType == FRAME)
+        m_Timeline->EndFrame();
+}
+
+Profiler::Frame Profiler::GetFrameCounters(const FrameProfiler::Frame& TimelineFrame)
+{
+    Frame Counters;
+    for (const auto& Scope : TimelineFrame.Scopes)
     {
-        if (Pass.QuerySupported)
+        PassCounters* pPass = nullptr;
+        // Scope names are the pointers returned by GetPassName()
+        if (Scope.Name == GetPassName(FRAME))
+            pPass = &Counters.Frame;
+        else if (Scope.Name == GetPassName(GRAPHICS_1))
+            pPass = &Counters.Graphics1;
+        else if (Scope.Name == GetPassName(GRAPHICS_2))
+            pPass = &Counters.Graphics2;
+        else if (Scope.Name == GetPassName(COMPUTE))
+            pPass = &Counters.Compute;
+        else if (Scope.Name == GetPassName(TRANSFER))
+            pPass = &Counters.Transfer;
+        else
+            continue;
+
+        pPass->CpuTimeBegin = Scope.CpuBegin;
+        pPass->CpuTimeEnd   = Scope.CpuEnd;
+        if (Scope.GpuLane != FrameProfiler::CpuLane)
         {
-            pContext->EndQuery(Pass.GpuTimeQueryEnd);
-            Pass.Queried = true;
+            pPass->GpuTimeBegin = Scope.GpuBegin;
+            pPass->GpuTimeEnd   = Scope.GpuEnd;
+            pPass->Queried      = true;
         }
-        Pass.CpuTImeEnd = TimePoint::clock::now();
-    };
-
-    auto& Frame = m_FrameHistory[m_FrameId];
-    switch (PassType)
-    {
-        case GRAPHICS_1:
-            EndCounters(Frame.Graphics1);
-            break;
-        case GRAPHICS_2:
-            EndCounters(Frame.Graphics2);
-            break;
-        case COMPUTE:
-            EndCounters(Frame.Compute);
-            break;
-        case TRANSFER:
-            EndCounters(Frame.Transfer);
-            break;
-        case FRAME:
-            EndCounters(Frame.Frame);
-            break;
-        default:
-            UNEXPECTED("Unknown pass type");
     }
+    return Counters;
 }
 
-void Profiler::SetCpuToGpuTransferRate(Uint32 RateInMb)
+bool Profiler::SaveTrace(const char* FilePath) const
 {
-    m_TempCpuToGpuTransferRateMb = RateInMb;
+    return m_Timeline != nullptr && m_Timeline->WriteChromeTrace(FilePath);
 }
 
-void Profiler::Update(double ElapsedTime)
+void Profiler::SetCpuToGpuTransferRate(Uint32 RateInMb, const char* UploadMode)
 {
-    if (m_Device == nullptr)
-        return;
-
-    ++m_FrameId;
-
-    // Read query data
+    // Do not mix the rates of different modes
+    if (m_UploadMode != UploadMode)
     {
-        auto& Frame = m_FrameHistory[m_FrameId];
-
-        const auto ReadTime = [](IQuery* pQuery, double& Time) //
-        {
-            Time = 0.0;
-            QueryDataTimestamp TimeData;
-            if (pQuery->GetData(&TimeData, sizeof(TimeData), true))
-                Time = static_cast<double>(TimeData.Counter) / static_cast<double>(TimeData.Frequency);
-        };
-
-        const auto UpdatePass = [ReadTime](PassCounters& Pass) //
-        {
-            if (Pass.QuerySupported && Pass.Queried)
-            {
-                ReadTime(Pass.GpuTimeQueryBegin, Pass.GpuTimeBegin);
-                ReadTime(Pass.GpuTimeQueryEnd, Pass.GpuTimeEnd);
-                VERIFY_EXPR(Pass.GpuTimeEnd >= Pass.GpuTimeBegin);
-                VERIFY_EXPR(Pass.CpuTImeEnd > Pass.CpuTImeBegin);
-            }
-        };
-
-        UpdatePass(Frame.Graphics1);
-        UpdatePass(Frame.Graphics2);
-        UpdatePass(Frame.Compute);
-        UpdatePass(Frame.Transfer);
+        m_UploadMode                 = UploadMode;
+        m_TempCpuToGpuTransferRateMb = 0;
     }
+    m_TempCpuToGpuTransferRateMb += RateInMb;
+}
+
+void Profiler::Update(double ElapsedTime)
+{
+    if (m_Timeline == nullptr)
+        return;
 
     // Update UI
     m_AccumTime += ElapsedTime;
     if (m_AccumTime > UpdateInterval)
     {
-        m_AccumTime = 0.0;
+        // GPU timings become available a few frames after the frame was recorded
+        const auto* pCurrFrame = m_Timeline->GetLastResolvedFrame();
+        const auto* pPrevFrame = pCurrFrame != nullptr && pCurrFrame->Index > 0 ? m_Timeline->GetFrame(pCurrFrame->Index - 1) : nullptr;
+        if (pCurrFrame == nullptr || pPrevFrame == nullptr)
+            return;
+
+        const double IntervalTime = m_AccumTime;
+        m_AccumTime               = 0.0;
 
-        auto&       Curr = m_FrameHistory[m_FrameId];
-        const auto& Prev = m_FrameHistory[(m_FrameId - 1) % m_FrameHistory.size()];
+        const auto Curr = GetFrameCounters(*pCurrFrame);
+        const auto Prev = GetFrameCounters(*pPrevFrame);
 
         const auto CalcFrameTimes = [](const Frame& f, double& Begin, double& End) //
         {
@@ -269,14 +232,35 @@ void Profiler::Update(double ElapsedTime)
         TimeToStr(values1_ss, Gfx1Time + Gfx2Time);
         TimeToStr(values1_ss, CompTime);
         TimeToStr(values1_ss, TransfTime);
-        ByteSizeToStr(values1_ss, m_TempCpuToGpuTransferRateMb / ElapsedTime);
+        const double TransferRateMb = m_TempCpuToGpuTransferRateMb / IntervalTime;
+        ByteSizeToStr(values1_ss, TransferRateMb);
         m_GpuCountersStr = values1_ss.str();
 
-        const auto CpuGfx1Time   = std::chrono::duration_cast<SecondsD>(Curr.Graphics1.CpuTImeEnd - Curr.Graphics1.CpuTImeBegin).count();
-        const auto CpuGfx2Time   = std::chrono::duration_cast<SecondsD>(Curr.Graphics2.CpuTImeEnd - Curr.Graphics2.CpuTImeBegin).count();
-        const auto CpuCompTime   = std::chrono::duration_cast<SecondsD>(Curr.Compute.CpuTImeEnd - Curr.Compute.CpuTImeBegin).count();
-        const auto CpuTransfTime = std::chrono::duration_cast<SecondsD>(Curr.Transfer.CpuTImeEnd - Curr.Transfer.CpuTImeBegin).count();
-        const auto CpuFrameTime  = std::chrono::duration_cast<SecondsD>(Curr.Frame.CpuTImeEnd - Curr.Frame.CpuTImeBegin).count();
+        if (TransferRateMb > 0.0)
+        {
+            auto Rate = std::find_if(m_TransferRates.begin(), m_TransferRates.end(), [this](const TransferRate& R) { return R.Mode == m_UploadMode; });
+            if (Rate == m_TransferRates.end())
+                Rate = m_TransferRates.insert(m_TransferRates.end(), TransferRate{m_UploadMode});
+            Rate->RateMb = TransferRateMb;
+
+            std::stringstream rates_ss;
+            rates_ss.precision(1);
+            rates_ss.flags(std::ios_base::fixed);
+            rates_ss << "Achieved transfer rate:" << std::endl;
+            for (const auto& R : m_TransferRates)
+            {
+                rates_ss << "  " << R.Mode << ": ";
+                ByteSizeToStr(rates_ss, R.RateMb);
+            }
+            m_TransferRatesStr = rates_ss.str();
+        }
+        m_TempCpuToGpuTransferRateMb = 0;
+
+        const auto CpuGfx1Time   = Curr.Graphics1.CpuTimeEnd - Curr.Graphics1.CpuTimeBegin;
+        const auto CpuGfx2Time   = Curr.Graphics2.CpuTimeEnd - Curr.Graphics2.CpuTimeBegin;
+        const auto CpuCompTime   = Curr.Compute.CpuTimeEnd - Curr.Compute.CpuTimeBegin;
+        const auto CpuTransfTime = Curr.Transfer.CpuTimeEnd - Curr.Transfer.CpuTimeBegin;
+        const auto CpuFrameTime  = Curr.Frame.CpuTimeEnd - Curr.Frame.CpuTimeBegin;
 
         std::stringstream values2_ss;
         values2_ss.precision(1);
@@ -289,24 +273,11 @@ void Profiler::Update(double ElapsedTime)
         TimeToStr(values2_ss, CpuTransfTime);
         m_CpuCountersStr = values2_ss.str();
     }
-
-    // Clear state
-    {
-        auto& Curr = m_FrameHistory[m_FrameId];
-
-        Curr.Graphics1.Queried = false;
-        Curr.Graphics2.Queried = false;
-        Curr.Compute.Queried   = false;
-        Curr.Transfer.Queried  = false;
-        Curr.Frame.Queried     = false;
-
-        m_TempCpuToGpuTransferRateMb = 0;
-    }
 }
 
 void Profiler::UpdateUI()
 {
-    if (m_Device == nullptr)
+    if (m_Timeline == nullptr)
         return;
 
     ImGui::SetNextWindowPos(ImVec2(240, 10), ImGuiCond_FirstUseEver);
@@ -401,6 +372,19 @@ void Profiler::UpdateUI()
             ImGui::SameLine(0.f, 20.f);
             ImGui::TextDisabled("%s", m_CpuCountersStr.c_str());
         }
+
+        if (!m_TransferRatesStr.empty())
+            ImGui::TextDisabled("%s", m_TransferRatesStr.c_str());
+
+        if (ImGui::Button("Save trace"))
+        {
+            const char* TraceFile = "Tutorial23_Trace.json";
+            if (SaveTrace(TraceFile))
+                LOG_INFO_MESSAGE("Saved ", m_Timeline->GetFrameCount(), " frames to '", TraceFile, "'. Open it in chrome://tracing or Perfetto.");
+            else
+                LOG_ERROR_MESSAGE("Failed to save profiler trace to '", TraceFile, "'");
+        }
+        ImGui::HelpMarker("Writes the recorded CPU and GPU timeline of the last frames in Chrome trace format");
     }
     ImGui::End();
 }
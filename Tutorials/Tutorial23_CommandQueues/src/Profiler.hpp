@@ -26,9 +26,10 @@
 
 #pragma once
 
-#include <array>
-#include <chrono>
+#include <memory>
+#include <vector>
 #include "SampleBase.hpp"
+#include "FrameProfiler.hpp"
 
 namespace Diligent
 {
@@ -49,38 +50,33 @@ public:
 
     void Begin(IDeviceContext* pContext, PASS_TYPE Pass);
     void End(IDeviceContext* pContext, PASS_TYPE Pass);
-    void SetCpuToGpuTransferRate(Uint32 RateInMb);
+    // Adds the amount of data uploaded in the current frame using the given upload mode
+    void SetCpuToGpuTransferRate(Uint32 RateInMb, const char* UploadMode);
 
     void UpdateUI();
     void Update(double ElapsedTime);
 
-private:
-    using TimePoint = std::chrono::high_resolution_clock::time_point;
-    using SecondsD  = std::chrono::duration<double>;
+    // Writes the recorded frames in Chrome trace event format
+    bool SaveTrace(const char* FilePath) const;
 
-    RefCntAutoPtr<IRenderDevice> m_Device;
+private:
+    static constexpr float UpdateInterval = 1.f / 5.f;
 
-    static constexpr Uint32 NumFramesPOT   = 3;
-    static constexpr float  UpdateInterval = 1.f / 5.f;
+    // All passes are recorded as scopes of the frame timeline
+    std::unique_ptr<FrameProfiler> m_Timeline;
 
-    Uint32 m_FrameId : NumFramesPOT;
-    Uint32 m_TempCpuToGpuTransferRateMb     = 0;
-    bool   m_SupportsTransferQueueProfiling = false;
+    Uint32 m_TempCpuToGpuTransferRateMb = 0; // accumulated during the update interval
+    String m_UploadMode;
 
     struct PassCounters
     {
-        RefCntAutoPtr<IQuery> GpuTimeQueryBegin;
-        RefCntAutoPtr<IQuery> GpuTimeQueryEnd;
-
         // time in seconds
         double GpuTimeBegin = 0.0;
         double GpuTimeEnd   = 0.0;
+        double CpuTimeBegin = 0.0;
+        double CpuTimeEnd   = 0.0;
 
-        TimePoint CpuTImeBegin = {};
-        TimePoint CpuTImeEnd   = {};
-
-        bool QuerySupported = false;
-        bool Queried        = false;
+        bool Queried = false;
     };
 
     struct Frame
@@ -91,7 +87,8 @@ private:
         PassCounters Compute;
         PassCounters Transfer;
     };
-    std::array<Frame, (1 << NumFramesPOT)> m_FrameHistory = {};
+    static Frame       GetFrameCounters(const FrameProfiler::Frame& TimelineFrame);
+    static const char* GetPassName(PASS_TYPE Pass);
 
     struct Graph
     {
@@ -108,6 +105,15 @@ private:
     Graph  m_Graph2;
     String m_GpuCountersStr;
     String m_CpuCountersStr;
+
+    // The last achieved transfer rate for every upload mode that has been used
+    struct TransferRate
+    {
+        String Mode;
+        double RateMb = 0.0;
+    };
+    std::vector<TransferRate> m_TransferRates;
+    String                    m_TransferRatesStr;
     double m_AccumTime = 0.0;
 };
 
@@ -506,7 +506,7 @@ void Tutorial23_CommandQueues::UploadPass()
 
     Uint32 CpuToGpuTransferRateMb = 0;
     m_Buildings.UpdateAtlas(TransferCtx, TransferRate, CpuToGpuTransferRateMb);
-    m_Profiler.SetCpuToGpuTransferRate(CpuToGpuTransferRateMb);
+    m_Profiler.SetCpuToGpuTransferRate(CpuToGpuTransferRateMb, m_Buildings.GetUploadModeName());
 
     m_Profiler.End(TransferCtx, Profiler::TRANSFER);
 
@@ -730,6 +730,8 @@ void Tutorial23_CommandQueues::UpdateUI()
             ImGui::SliderInt("##TransferRate", &m_TransferRateMbExp2, 0, TexSizePOT, TransferRateStr.c_str());
 
             ImGui::Checkbox("Use async transfer", &m_UseAsyncTransfer);
+            if (m_Buildings.IsUploadRingSupported())
+                ImGui::Checkbox("Upload from ring", &m_Buildings.UseUploadRing);
             ImGui::Separator();
         }
 